@@ -54,7 +54,26 @@
 #define	BCRYPT_SALTSPACE	(7 + (BCRYPT_MAXSALT * 4 + 2) / 3 + 1)
 #define	BCRYPT_HASHSPACE	61
 
+#define	BCRYPT_LANES	4	/* Hashes computed in lockstep */
+
+/*
+ * The state of one hash. Blowfish is a long chain of dependent table
+ * lookups, so a single hash keeps the CPU waiting on memory; running
+ * several independent hashes of the same cost in lockstep lets their
+ * lookups overlap.
+ */
+struct bcrypt_lane {
+	blf_ctx state;
+	const u_int8_t *key;
+	u_int16_t key_len;
+	u_int8_t csalt[BCRYPT_MAXSALT];
+	u_int8_t minor;
+	u_int8_t logr;
+};
+
 char   *bcrypt_gensalt(u_int8_t);
+void	_bcrypt_checkpass_batch(const char * const *, const char * const *,
+	    int *, size_t);
 
 static int encode_base64(char *, const u_int8_t *, size_t);
 static int decode_base64(u_int8_t *, size_t, const char *);
@@ -85,32 +104,30 @@ bcrypt_initsalt(int log_rounds, uint8_t *salt, size_t saltbuflen)
 	return 0;
 }
 
+/* Function for Feistel Networks, as in blowfish.c */
+#define F(s, x) ((((s)[        (((x)>>24)&0xFF)]  \
+		 + (s)[0x100 + (((x)>>16)&0xFF)]) \
+		 ^ (s)[0x200 + (((x)>> 8)&0xFF)]) \
+		 + (s)[0x300 + ( (x)     &0xFF)])
+
+#define BLFRND(s,p,i,j,n) (i ^= F(s,j) ^ (p)[n])
+
 /*
- * the core bcrypt function
+ * Check the salt and cost of a hash and prepare a lane for it.
  */
 static int
-bcrypt_hashpass(const char *key, const char *salt, char *encrypted,
-    size_t encryptedlen)
+bcrypt_initlane(struct bcrypt_lane *lane, const char *key, const char *salt)
 {
-	blf_ctx state;
-	u_int32_t rounds, i, k;
-	u_int16_t j;
 	size_t key_len;
-	u_int8_t salt_len, logr, minor;
-	u_int8_t ciphertext[4 * BCRYPT_WORDS] = "OrpheanBeholderScryDoubt";
-	u_int8_t csalt[BCRYPT_MAXSALT];
-	u_int32_t cdata[BCRYPT_WORDS];
-
-	if (encryptedlen < BCRYPT_HASHSPACE)
-		goto inval;
+	u_int8_t logr, minor;
 
 	/* Check and discard "$" identifier */
 	if (salt[0] != '$')
-		goto inval;
+		return -1;
 	salt += 1;
 
 	if (salt[0] != BCRYPT_VERSION)
-		goto inval;
+		return -1;
 
 	/* Check for minor versions */
 	switch ((minor = salt[1])) {
@@ -128,42 +145,163 @@ bcrypt_hashpass(const char *key, const char *salt, char *encrypted,
 		key_len++; /* include the NUL */
 		break;
 	default:
-		 goto inval;
+		return -1;
 	}
 	if (salt[2] != '$')
-		goto inval;
+		return -1;
 	/* Discard version + "$" identifier */
 	salt += 3;
 
 	/* Check and parse num rounds */
 	if (!isdigit((unsigned char)salt[0]) ||
 	    !isdigit((unsigned char)salt[1]) || salt[2] != '$')
-		goto inval;
+		return -1;
 	logr = (salt[1] - '0') + ((salt[0] - '0') * 10);
 	if (logr < BCRYPT_MINLOGROUNDS || logr > 31)
-		goto inval;
-	/* Computer power doesn't increase linearly, 2^x should be fine */
-	rounds = 1U << logr;
+		return -1;
 
 	/* Discard num rounds + "$" identifier */
 	salt += 3;
 
 	if (strlen(salt) * 3 / 4 < BCRYPT_MAXSALT)
-		goto inval;
+		return -1;
 
 	/* We dont want the base64 salt but the raw data */
-	if (decode_base64(csalt, BCRYPT_MAXSALT, salt))
-		goto inval;
-	salt_len = BCRYPT_MAXSALT;
+	if (decode_base64(lane->csalt, BCRYPT_MAXSALT, salt))
+		return -1;
+
+	lane->key = (const u_int8_t *)key;
+	lane->key_len = key_len;
+	lane->minor = minor;
+	lane->logr = logr;
+
+	return 0;
+}
+
+/*
+ * Blowfish_encipher() for every lane at once.
+ */
+static void
+bcrypt_encipher(struct bcrypt_lane *lanes, int n, u_int32_t *xl,
+    u_int32_t *xr)
+{
+	u_int32_t *s, *p, t;
+	int i, k;
+
+	for (k = 0; k < n; k++)
+		xl[k] ^= lanes[k].state.P[0];
+	for (i = 1; i < BLF_N + 1; i += 2) {
+		for (k = 0; k < n; k++) {
+			s = lanes[k].state.S[0];
+			p = lanes[k].state.P;
+			BLFRND(s, p, xr[k], xl[k], i);
+		}
+		for (k = 0; k < n; k++) {
+			s = lanes[k].state.S[0];
+			p = lanes[k].state.P;
+			BLFRND(s, p, xl[k], xr[k], i + 1);
+		}
+	}
+	for (k = 0; k < n; k++) {
+		t = xl[k];
+		xl[k] = xr[k] ^ lanes[k].state.P[BLF_N + 1];
+		xr[k] = t;
+	}
+}
+
+/*
+ * Blowfish_expand0state() for every lane at once, with either the key or
+ * the salt of each lane.
+ */
+static void
+bcrypt_expand0state(struct bcrypt_lane *lanes, int n, int salt)
+{
+	u_int32_t datal[BCRYPT_LANES], datar[BCRYPT_LANES];
+	const u_int8_t *key;
+	u_int16_t keybytes;
+	u_int16_t i, j, k;
+	int l;
+
+	for (l = 0; l < n; l++) {
+		if (salt) {
+			key = lanes[l].csalt;
+			keybytes = BCRYPT_MAXSALT;
+		} else {
+			key = lanes[l].key;
+			keybytes = lanes[l].key_len;
+		}
+		j = 0;
+		for (i = 0; i < BLF_N + 2; i++)
+			lanes[l].state.P[i] ^=
+			    Blowfish_stream2word(key, keybytes, &j);
+		datal[l] = 0;
+		datar[l] = 0;
+	}
+
+	for (i = 0; i < BLF_N + 2; i += 2) {
+		bcrypt_encipher(lanes, n, datal, datar);
+		for (l = 0; l < n; l++) {
+			lanes[l].state.P[i] = datal[l];
+			lanes[l].state.P[i + 1] = datar[l];
+		}
+	}
+
+	for (i = 0; i < 4; i++) {
+		for (k = 0; k < 256; k += 2) {
+			bcrypt_encipher(lanes, n, datal, datar);
+			for (l = 0; l < n; l++) {
+				lanes[l].state.S[i][k] = datal[l];
+				lanes[l].state.S[i][k + 1] = datar[l];
+			}
+		}
+	}
+}
+
+/*
+ * the core bcrypt function, for up to BCRYPT_LANES hashes of the same cost
+ */
+static void
+bcrypt_hashlanes(struct bcrypt_lane *lanes, int n)
+{
+	u_int32_t rounds, k;
+	int l;
+
+	/* Computer power doesn't increase linearly, 2^x should be fine */
+	rounds = 1U << lanes[0].logr;
 
 	/* Setting up S-Boxes and Subkeys */
-	Blowfish_initstate(&state);
-	Blowfish_expandstate(&state, csalt, salt_len,
-	    (u_int8_t *) key, key_len);
+	for (l = 0; l < n; l++) {
+		Blowfish_initstate(&lanes[l].state);
+		Blowfish_expandstate(&lanes[l].state, lanes[l].csalt,
+		    BCRYPT_MAXSALT, lanes[l].key, lanes[l].key_len);
+	}
+	if (n == 1) {
+		for (k = 0; k < rounds; k++) {
+			Blowfish_expand0state(&lanes[0].state, lanes[0].key,
+			    lanes[0].key_len);
+			Blowfish_expand0state(&lanes[0].state, lanes[0].csalt,
+			    BCRYPT_MAXSALT);
+		}
+		return;
+	}
+
 	for (k = 0; k < rounds; k++) {
-		Blowfish_expand0state(&state, (u_int8_t *) key, key_len);
-		Blowfish_expand0state(&state, csalt, salt_len);
+		bcrypt_expand0state(lanes, n, 0);
+		bcrypt_expand0state(lanes, n, 1);
 	}
+}
+
+/*
+ * Encrypt the magic text with the expanded state of a lane and encode
+ * the result.
+ */
+static void
+bcrypt_encodelane(struct bcrypt_lane *lane, char *encrypted)
+{
+	u_int32_t i, k;
+	u_int16_t j;
+	u_int8_t ciphertext[4 * BCRYPT_WORDS] = "OrpheanBeholderScryDoubt";
+	u_int32_t cdata[BCRYPT_WORDS];
 
 	/* This can be precomputed later */
 	j = 0;
@@ -172,7 +310,7 @@ bcrypt_hashpass(const char *key, const char *salt, char *encrypted,
 
 	/* Now do the encryption */
 	for (k = 0; k < 64; k++)
-		blf_enc(&state, cdata, BCRYPT_WORDS / 2);
+		blf_enc(&lane->state, cdata, BCRYPT_WORDS / 2);
 
 	for (i = 0; i < BCRYPT_WORDS; i++) {
 		ciphertext[4 * i + 3] = cdata[i] & 0xff;
@@ -185,13 +323,27 @@ bcrypt_hashpass(const char *key, const char *salt, char *encrypted,
 	}
 
 
-	snprintf(encrypted, 8, "$2%c$%2.2u$", minor, logr);
-	encode_base64(encrypted + 7, csalt, BCRYPT_MAXSALT);
+	snprintf(encrypted, 8, "$2%c$%2.2u$", lane->minor, lane->logr);
+	encode_base64(encrypted + 7, lane->csalt, BCRYPT_MAXSALT);
 	encode_base64(encrypted + 7 + 22, ciphertext, 4 * BCRYPT_WORDS - 1);
-	explicit_bzero(&state, sizeof(state));
 	explicit_bzero(ciphertext, sizeof(ciphertext));
-	explicit_bzero(csalt, sizeof(csalt));
 	explicit_bzero(cdata, sizeof(cdata));
+}
+
+static int
+bcrypt_hashpass(const char *key, const char *salt, char *encrypted,
+    size_t encryptedlen)
+{
+	struct bcrypt_lane lane;
+
+	if (encryptedlen < BCRYPT_HASHSPACE)
+		goto inval;
+
+	if (bcrypt_initlane(&lane, key, salt) != 0)
+		goto inval;
+	bcrypt_hashlanes(&lane, 1);
+	bcrypt_encodelane(&lane, encrypted);
+	explicit_bzero(&lane, sizeof(lane));
 	return 0;
 
 inval:
@@ -236,6 +388,64 @@ bcrypt_checkpass(const char *pass, const char *goodhash)
 }
 DEF_WEAK(bcrypt_checkpass);
 
+static void
+bcrypt_checklanes(struct bcrypt_lane *lanes, const size_t *idx, int n,
+    const char * const *goodhash, int *result)
+{
+	char hash[BCRYPT_HASHSPACE];
+	const char *good;
+	int l;
+
+	bcrypt_hashlanes(lanes, n);
+	for (l = 0; l < n; l++) {
+		bcrypt_encodelane(&lanes[l], hash);
+		good = goodhash[idx[l]];
+		if (strlen(hash) == strlen(good) &&
+		    timingsafe_bcmp(hash, good, strlen(good)) == 0)
+			result[idx[l]] = 0;
+	}
+
+	explicit_bzero(hash, sizeof(hash));
+}
+
+/*
+ * Check every password whose hash is a bcrypt hash, setting its result
+ * to 0 if it matches and -1 otherwise. Consecutive hashes of the same
+ * cost are computed together. Other entries are left alone.
+ */
+void
+_bcrypt_checkpass_batch(const char * const *pass,
+    const char * const *goodhash, int *result, size_t count)
+{
+	struct bcrypt_lane lanes[BCRYPT_LANES];
+	size_t idx[BCRYPT_LANES];
+	size_t i;
+	int n = 0;
+
+	for (i = 0; i < count; i++) {
+		if (goodhash[i] == NULL || goodhash[i][0] != '$' ||
+		    goodhash[i][1] != '2')
+			continue;
+		result[i] = -1;
+		if (bcrypt_initlane(&lanes[n], pass[i], goodhash[i]) != 0)
+			continue;
+		if (n > 0 && lanes[n].logr != lanes[0].logr) {
+			bcrypt_checklanes(lanes, idx, n, goodhash, result);
+			lanes[0] = lanes[n];
+			n = 0;
+		}
+		idx[n++] = i;
+		if (n == BCRYPT_LANES) {
+			bcrypt_checklanes(lanes, idx, n, goodhash, result);
+			n = 0;
+		}
+	}
+	if (n > 0)
+		bcrypt_checklanes(lanes, idx, n, goodhash, result);
+
+	explicit_bzero(lanes, sizeof(lanes));
+}
+
 /*
  * Measure this system's performance by measuring the time for 8 rounds.
  * We are aiming for something that takes around 0.1s, but not too much over.
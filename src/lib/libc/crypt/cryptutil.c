@@ -21,6 +21,14 @@
 #include <login_cap.h>
 #include <errno.h>
 
+void	_bcrypt_checkpass_batch(const char * const *, const char * const *,
+	    int *, size_t);
+
+/* Declared here until the prototype is added to <unistd.h>. */
+int	crypt_checkpass_batch(const char * const *, const char * const *,
+	    int *, size_t);
+PROTO_NORMAL(crypt_checkpass_batch);
+
 int
 crypt_checkpass(const char *pass, const char *goodhash)
 {
@@ -50,6 +58,49 @@ fail:
 }
 DEF_WEAK(crypt_checkpass);
 
+int
+crypt_checkpass_batch(const char * const *pass, const char * const *goodhash,
+    int *result, size_t count)
+{
+	char dummy[_PASSWORD_LEN];
+	size_t i;
+	int rv = 0;
+
+	for (i = 0; i < count; i++) {
+		result[i] = -1;
+
+		if (goodhash[i] == NULL) {
+			/* fake it */
+			bcrypt_newhash(pass[i], 8, dummy, sizeof(dummy));
+			continue;
+		}
+
+		/* empty password */
+		if (strlen(goodhash[i]) == 0 && strlen(pass[i]) == 0) {
+			result[i] = 0;
+			continue;
+		}
+
+		/* checked together below */
+		if (goodhash[i][0] == '$' && goodhash[i][1] == '2')
+			continue;
+
+		/* unsupported. fake it. */
+		bcrypt_newhash(pass[i], 8, dummy, sizeof(dummy));
+	}
+
+	_bcrypt_checkpass_batch(pass, goodhash, result, count);
+
+	for (i = 0; i < count; i++) {
+		if (result[i] != 0)
+			rv = -1;
+	}
+	if (rv != 0)
+		errno = EACCES;
+	return rv;
+}
+DEF_WEAK(crypt_checkpass_batch);
+
 int
 crypt_newhash(const char *pass, const char *pref, char *hash, size_t hashlen)
 {
@@ -66,6 +66,7 @@
 #include <openssl/err.h>
 #include <openssl/x509v3.h>
 
+#include "asn1_local.h"
 #include "bytestring.h"
 
 const ASN1_ITEM ASN1_BIT_STRING_it = {
@@ -307,7 +308,8 @@ i2c_ASN1_BIT_STRING(ASN1_BIT_STRING *a, unsigned char **pp)
 }
 
 int
-c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs)
+c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs,
+    ASN1_ARENA *arena)
 {
 	ASN1_BIT_STRING *abs = NULL;
 	uint8_t *data = NULL;
@@ -319,7 +321,7 @@ c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs)
 		goto err;
 
 	if (*out_abs != NULL) {
-		ASN1_BIT_STRING_free(*out_abs);
+		asn1_arena_string_free(arena, *out_abs);
 		*out_abs = NULL;
 	}
 
@@ -328,12 +330,12 @@ c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs)
 		goto err;
 	}
 
-	if (!CBS_stow(cbs, &data, &data_len))
+	if (!asn1_arena_stow(arena, cbs, &data, &data_len))
 		goto err;
 	if (data_len > INT_MAX)
 		goto err;
 
-	if ((abs = ASN1_BIT_STRING_new()) == NULL)
+	if ((abs = asn1_arena_string_new(arena, V_ASN1_BIT_STRING)) == NULL)
 		goto err;
 
 	abs->data = data;
@@ -357,8 +359,8 @@ c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs)
 	ret = 1;
 
  err:
-	ASN1_BIT_STRING_free(abs);
-	freezero(data, data_len);
+	asn1_arena_string_free(arena, abs);
+	asn1_arena_freezero(arena, data, data_len);
 
 	return ret;
 }
@@ -381,7 +383,7 @@ c2i_ASN1_BIT_STRING(ASN1_BIT_STRING **out_abs, const unsigned char **pp, long le
 
 	CBS_init(&content, *pp, len);
 
-	if (!c2i_ASN1_BIT_STRING_cbs(&abs, &content))
+	if (!c2i_ASN1_BIT_STRING_cbs(&abs, &content, NULL))
 		return NULL;
 
 	*pp = CBS_data(&content);
@@ -356,7 +356,8 @@ a2i_ASN1_ENUMERATED(BIO *bp, ASN1_ENUMERATED *bs, char *buf, int size)
 LCRYPTO_ALIAS(a2i_ASN1_ENUMERATED);
 
 int
-c2i_ASN1_ENUMERATED_cbs(ASN1_ENUMERATED **out_aenum, CBS *cbs)
+c2i_ASN1_ENUMERATED_cbs(ASN1_ENUMERATED **out_aenum, CBS *cbs,
+    ASN1_ARENA *arena)
 {
 	ASN1_ENUMERATED *aenum = NULL;
 
@@ -364,11 +365,11 @@ c2i_ASN1_ENUMERATED_cbs(ASN1_ENUMERATED **out_aenum, CBS *cbs)
 		return 0;
 
 	if (*out_aenum != NULL) {
-		ASN1_INTEGER_free(*out_aenum);
+		asn1_arena_string_free(arena, *out_aenum);
 		*out_aenum = NULL;
 	}
 
-	if (!c2i_ASN1_INTEGER_cbs((ASN1_INTEGER **)&aenum, cbs))
+	if (!c2i_ASN1_INTEGER_cbs((ASN1_INTEGER **)&aenum, cbs, arena))
 		return 0;
 
 	aenum->type = V_ASN1_ENUMERATED | (aenum->type & V_ASN1_NEG);
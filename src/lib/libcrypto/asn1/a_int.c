@@ -66,6 +66,7 @@
 #include <openssl/buffer.h>
 #include <openssl/err.h>
 
+#include "asn1_local.h"
 #include "bytestring.h"
 
 const ASN1_ITEM ASN1_INTEGER_it = {
@@ -657,7 +658,7 @@ i2c_ASN1_INTEGER(ASN1_INTEGER *aint, unsigned char **pp)
 }
 
 int
-c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs)
+c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs, ASN1_ARENA *arena)
 {
 	ASN1_INTEGER *aint = NULL;
 	uint8_t *data = NULL;
@@ -670,7 +671,7 @@ c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs)
 		goto err;
 
 	if (*out_aint != NULL) {
-		ASN1_INTEGER_free(*out_aint);
+		asn1_arena_string_free(arena, *out_aint);
 		*out_aint = NULL;
 	}
 
@@ -704,12 +705,12 @@ c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs)
 		}
 	}
 
-	if (!CBS_stow(cbs, &data, &data_len))
+	if (!asn1_arena_stow(arena, cbs, &data, &data_len))
 		goto err;
 	if (data_len > INT_MAX)
 		goto err;
 
-	if ((aint = ASN1_INTEGER_new()) == NULL)
+	if ((aint = asn1_arena_string_new(arena, V_ASN1_INTEGER)) == NULL)
 		goto err;
 
 	/*
@@ -731,8 +732,8 @@ c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs)
 	ret = 1;
 
  err:
-	ASN1_INTEGER_free(aint);
-	freezero(data, data_len);
+	asn1_arena_string_free(arena, aint);
+	asn1_arena_freezero(arena, data, data_len);
 
 	return ret;
 }
@@ -755,7 +756,7 @@ c2i_ASN1_INTEGER(ASN1_INTEGER **out_aint, const unsigned char **pp, long len)
 
 	CBS_init(&content, *pp, len);
 
-	if (!c2i_ASN1_INTEGER_cbs(&aint, &content))
+	if (!c2i_ASN1_INTEGER_cbs(&aint, &content, NULL))
 		return NULL;
 
 	*pp = CBS_data(&content);
@@ -531,11 +531,12 @@ i2a_ASN1_OBJECT(BIO *bp, const ASN1_OBJECT *aobj)
 LCRYPTO_ALIAS(i2a_ASN1_OBJECT);
 
 int
-c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content)
+c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content,
+    ASN1_ARENA *arena)
 {
 	ASN1_OBJECT *aobj = NULL;
 	uint8_t *data = NULL;
-	size_t data_len;
+	size_t data_len = 0;
 	CBS cbs;
 
 	if (out_aobj == NULL)
@@ -559,18 +560,27 @@ c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content)
 		}
 	}
 
-	if (!CBS_stow(content, &data, &data_len))
+	if (!asn1_arena_stow(arena, content, &data, &data_len))
 		goto err;
 
 	if (data_len > INT_MAX)
 		goto err;
 
-	if ((aobj = ASN1_OBJECT_new()) == NULL)
+	/*
+	 * Objects allocated from an arena are not marked as dynamic, so that
+	 * ASN1_OBJECT_free() leaves them alone.
+	 */
+	if (arena != NULL)
+		aobj = asn1_arena_calloc(arena, 1, sizeof(*aobj));
+	else
+		aobj = ASN1_OBJECT_new();
+	if (aobj == NULL)
 		goto err;
 
 	aobj->data = data;
 	aobj->length = (int)data_len; /* XXX - change length to size_t. */
-	aobj->flags |= ASN1_OBJECT_FLAG_DYNAMIC_DATA;
+	if (arena == NULL)
+		aobj->flags |= ASN1_OBJECT_FLAG_DYNAMIC_DATA;
 
 	*out_aobj = aobj;
 
@@ -578,7 +588,7 @@ c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content)
 
  err:
 	ASN1_OBJECT_free(aobj);
-	free(data);
+	asn1_arena_freezero(arena, data, data_len);
 
 	return 0;
 }
@@ -601,7 +611,7 @@ c2i_ASN1_OBJECT(ASN1_OBJECT **out_aobj, const unsigned char **pp, long len)
 
 	CBS_init(&content, *pp, len);
 
-	if (!c2i_ASN1_OBJECT_cbs(&aobj, &content))
+	if (!c2i_ASN1_OBJECT_cbs(&aobj, &content, NULL))
 		return NULL;
 
 	*pp = CBS_data(&content);
@@ -663,7 +673,7 @@ d2i_ASN1_OBJECT(ASN1_OBJECT **out_aobj, const unsigned char **pp, long length)
 		return NULL;
 	}
 
-	if (!c2i_ASN1_OBJECT_cbs(&aobj, &content))
+	if (!c2i_ASN1_OBJECT_cbs(&aobj, &content, NULL))
 		return NULL;
 
 	*pp = CBS_data(&cbs);
@@ -829,6 +829,27 @@ int ASN1_i2d_bio(i2d_of_void *i2d, BIO *out, unsigned char *x);
 		  CHECKED_PTR_OF(const type, x)))
 
 int ASN1_item_i2d_bio(const ASN1_ITEM *it, BIO *out, void *x);
+
+typedef struct asn1_stream_st ASN1_STREAM;
+
+ASN1_STREAM *ASN1_STREAM_new(BIO *bio);
+void ASN1_STREAM_free(ASN1_STREAM *stream);
+int ASN1_STREAM_set_max_element(ASN1_STREAM *stream, size_t max_element);
+int ASN1_STREAM_get_depth(const ASN1_STREAM *stream);
+int ASN1_STREAM_peek(ASN1_STREAM *stream, int *out_tag, int *out_class,
+    int *out_constructed);
+int ASN1_STREAM_enter(ASN1_STREAM *stream);
+int ASN1_STREAM_leave(ASN1_STREAM *stream);
+int ASN1_STREAM_skip(ASN1_STREAM *stream);
+void *ASN1_STREAM_d2i(ASN1_STREAM *stream, const ASN1_ITEM *it);
+
+typedef struct asn1_arena_st ASN1_ARENA;
+
+ASN1_ARENA *ASN1_ARENA_new(void);
+void ASN1_ARENA_free(ASN1_ARENA *arena);
+ASN1_VALUE *ASN1_item_d2i_arena(ASN1_ARENA *arena, const unsigned char **in,
+    long len, const ASN1_ITEM *it);
+
 int ASN1_UTCTIME_print(BIO *fp, const ASN1_UTCTIME *a);
 int ASN1_GENERALIZEDTIME_print(BIO *fp, const ASN1_GENERALIZEDTIME *a);
 int ASN1_TIME_print(BIO *fp, const ASN1_TIME *a);
@@ -0,0 +1,370 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Bump allocator for transient decode trees. The template decoder allocates
+ * structures, strings, integers, bit strings, objects and ANY values from
+ * the arena, while items with their own functions (such as X509_NAME), the
+ * cached encodings and anything allocated by aux callbacks remain on the
+ * heap. Freeing the arena walks each decoded tree once to release the heap
+ * parts, skipping everything that the arena owns, and then releases the
+ * chunks in one go. Chunks are kept in a tree ordered by address, so that
+ * the walk finds whether the arena owns a pointer in logarithmic time.
+ */
+
+#include <sys/tree.h>
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/asn1.h>
+#include <openssl/asn1t.h>
+#include <openssl/err.h>
+
+#include "asn1_local.h"
+#include "bytestring.h"
+
+#define ASN1_ARENA_ALIGN		16
+#define ASN1_ARENA_MIN_CHUNK		4096
+#define ASN1_ARENA_MAX_CHUNK		65536
+
+struct asn1_arena_chunk {
+	RB_ENTRY(asn1_arena_chunk) entry;
+	struct asn1_arena_chunk *next;
+	uintptr_t start;
+	size_t size;
+	size_t used;
+};
+
+/* Chunk data starts after the header, rounded up to the alignment. */
+#define ASN1_ARENA_CHUNK_HEADER \
+    ((sizeof(struct asn1_arena_chunk) + ASN1_ARENA_ALIGN - 1) & \
+    ~(size_t)(ASN1_ARENA_ALIGN - 1))
+
+struct asn1_arena_root {
+	struct asn1_arena_root *next;
+	const ASN1_ITEM *it;
+	ASN1_VALUE *val;
+};
+
+RB_HEAD(asn1_arena_chunk_tree, asn1_arena_chunk);
+
+struct asn1_arena_st {
+	struct asn1_arena_chunk *chunks;
+	struct asn1_arena_chunk_tree chunk_tree;
+	struct asn1_arena_root *roots;
+	size_t chunk_size;
+	int held;
+};
+
+static uint8_t *
+asn1_arena_chunk_data(struct asn1_arena_chunk *chunk)
+{
+	return (uint8_t *)chunk + ASN1_ARENA_CHUNK_HEADER;
+}
+
+/*
+ * Chunks never overlap, so ordering them by their data ranges also finds
+ * the chunk containing a given address, using a key of size 1.
+ */
+static int
+asn1_arena_chunk_cmp(const struct asn1_arena_chunk *a,
+    const struct asn1_arena_chunk *b)
+{
+	if (a->start + a->size <= b->start)
+		return -1;
+	if (b->start + b->size <= a->start)
+		return 1;
+
+	return 0;
+}
+
+RB_PROTOTYPE_STATIC(asn1_arena_chunk_tree, asn1_arena_chunk, entry,
+    asn1_arena_chunk_cmp);
+RB_GENERATE_STATIC(asn1_arena_chunk_tree, asn1_arena_chunk, entry,
+    asn1_arena_chunk_cmp);
+
+ASN1_ARENA *
+ASN1_ARENA_new(void)
+{
+	ASN1_ARENA *arena;
+
+	if ((arena = calloc(1, sizeof(*arena))) == NULL) {
+		ASN1error(ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+	RB_INIT(&arena->chunk_tree);
+	arena->chunk_size = ASN1_ARENA_MIN_CHUNK;
+
+	return arena;
+}
+LCRYPTO_ALIAS(ASN1_ARENA_new);
+
+void
+ASN1_ARENA_free(ASN1_ARENA *arena)
+{
+	struct asn1_arena_chunk *chunk, *next;
+	struct asn1_arena_root *root;
+
+	if (arena == NULL)
+		return;
+
+	/* Roots are kept newest first, so trees are freed in reverse order. */
+	for (root = arena->roots; root != NULL; root = root->next)
+		asn1_item_ex_free_arena(&root->val, root->it, arena);
+
+	/*
+	 * A value that is still referenced lives in the chunks, so they are
+	 * leaked rather than freed underneath it.
+	 */
+	if (arena->held) {
+		free(arena);
+		return;
+	}
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		freezero(chunk, ASN1_ARENA_CHUNK_HEADER + chunk->size);
+	}
+	free(arena);
+}
+LCRYPTO_ALIAS(ASN1_ARENA_free);
+
+static struct asn1_arena_chunk *
+asn1_arena_chunk_new(size_t size)
+{
+	struct asn1_arena_chunk *chunk;
+
+	if (size > SIZE_MAX - ASN1_ARENA_CHUNK_HEADER)
+		return NULL;
+	if ((chunk = calloc(1, ASN1_ARENA_CHUNK_HEADER + size)) == NULL)
+		return NULL;
+	chunk->start = (uintptr_t)asn1_arena_chunk_data(chunk);
+	chunk->size = size;
+
+	return chunk;
+}
+
+/*
+ * Allocations are zeroed, since chunks are zeroed when they are allocated
+ * and memory is never handed out twice.
+ */
+void *
+asn1_arena_calloc(ASN1_ARENA *arena, size_t nmemb, size_t size)
+{
+	struct asn1_arena_chunk *chunk;
+	size_t len;
+
+	if (arena == NULL)
+		return calloc(nmemb, size);
+
+	if (size != 0 && nmemb > SIZE_MAX / size)
+		return NULL;
+	len = nmemb * size;
+	if (len > SIZE_MAX - ASN1_ARENA_ALIGN)
+		return NULL;
+	len = (len + ASN1_ARENA_ALIGN - 1) & ~(size_t)(ASN1_ARENA_ALIGN - 1);
+	if (len == 0)
+		len = ASN1_ARENA_ALIGN;
+
+	if ((chunk = arena->chunks) != NULL && chunk->size - chunk->used >= len)
+		goto done;
+
+	/*
+	 * Large allocations get a chunk of their own, which is linked in
+	 * behind the current chunk so that its free space is not lost.
+	 */
+	if (len > arena->chunk_size / 2) {
+		if ((chunk = asn1_arena_chunk_new(len)) == NULL)
+			return NULL;
+		RB_INSERT(asn1_arena_chunk_tree, &arena->chunk_tree, chunk);
+		if (arena->chunks != NULL) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else
+			arena->chunks = chunk;
+		goto done;
+	}
+
+	if ((chunk = asn1_arena_chunk_new(arena->chunk_size)) == NULL)
+		return NULL;
+	RB_INSERT(asn1_arena_chunk_tree, &arena->chunk_tree, chunk);
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	if (arena->chunk_size < ASN1_ARENA_MAX_CHUNK)
+		arena->chunk_size *= 2;
+
+ done:
+	chunk->used += len;
+
+	return asn1_arena_chunk_data(chunk) + chunk->used - len;
+}
+
+int
+asn1_arena_owns(ASN1_ARENA *arena, const void *ptr)
+{
+	struct asn1_arena_chunk key;
+
+	if (arena == NULL || ptr == NULL)
+		return 0;
+
+	memset(&key, 0, sizeof(key));
+	key.start = (uintptr_t)ptr;
+	key.size = 1;
+
+	return RB_FIND(asn1_arena_chunk_tree, &arena->chunk_tree,
+	    &key) != NULL;
+}
+
+/*
+ * Values owned by the arena cannot outlive it. If a reference counted value
+ * is still referenced elsewhere when the arena is freed, it keeps the
+ * arena's reference and the arena memory is leaked instead of being freed
+ * underneath the other holders.
+ */
+int
+asn1_arena_hold(ASN1_ARENA *arena, ASN1_VALUE **pval, const ASN1_ITEM *it)
+{
+	const ASN1_AUX *aux = it->funcs;
+	atomic_int *references;
+
+	if (aux == NULL || (aux->flags & ASN1_AFLG_REFCOUNT) == 0)
+		return 0;
+	if (!asn1_arena_owns(arena, *pval))
+		return 0;
+	/* Reference counts are updated atomically by CRYPTO_add(). */
+	references = (atomic_int *)((char *)*pval + aux->ref_offset);
+	if (atomic_load_explicit(references, memory_order_acquire) <= 1)
+		return 0;
+
+	arena->held = 1;
+
+	return 1;
+}
+
+void
+asn1_arena_freezero(ASN1_ARENA *arena, void *ptr, size_t len)
+{
+	if (asn1_arena_owns(arena, ptr))
+		return;
+
+	freezero(ptr, len);
+}
+
+int
+asn1_arena_stow(ASN1_ARENA *arena, CBS *cbs, uint8_t **out_data,
+    size_t *out_len)
+{
+	uint8_t *data;
+
+	if (arena == NULL)
+		return CBS_stow(cbs, out_data, out_len);
+
+	*out_data = NULL;
+	*out_len = 0;
+
+	if (CBS_len(cbs) == 0)
+		return 1;
+
+	if ((data = asn1_arena_calloc(arena, 1, CBS_len(cbs))) == NULL)
+		return 0;
+	memcpy(data, CBS_data(cbs), CBS_len(cbs));
+
+	*out_data = data;
+	*out_len = CBS_len(cbs);
+
+	return 1;
+}
+
+ASN1_STRING *
+asn1_arena_string_new(ASN1_ARENA *arena, int type)
+{
+	ASN1_STRING *astr;
+
+	if (arena == NULL)
+		return ASN1_STRING_type_new(type);
+
+	if ((astr = asn1_arena_calloc(arena, 1, sizeof(*astr))) == NULL) {
+		ASN1error(ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+	astr->type = type;
+
+	return astr;
+}
+
+/* Equivalent of ASN1_STRING_set(), for a string without data. */
+int
+asn1_arena_string_set(ASN1_ARENA *arena, ASN1_STRING *astr, CBS *cbs)
+{
+	if (arena == NULL)
+		return ASN1_STRING_set(astr, CBS_data(cbs), CBS_len(cbs));
+
+	if (CBS_len(cbs) >= INT_MAX)
+		return 0;
+	astr->data = asn1_arena_calloc(arena, 1, CBS_len(cbs) + 1);
+	if (astr->data == NULL) {
+		ASN1error(ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	memcpy(astr->data, CBS_data(cbs), CBS_len(cbs));
+	astr->length = CBS_len(cbs);
+
+	return 1;
+}
+
+void
+asn1_arena_string_free(ASN1_ARENA *arena, ASN1_STRING *astr)
+{
+	if (asn1_arena_owns(arena, astr))
+		return;
+
+	ASN1_STRING_free(astr);
+}
+
+ASN1_VALUE *
+ASN1_item_d2i_arena(ASN1_ARENA *arena, const unsigned char **in, long len,
+    const ASN1_ITEM *it)
+{
+	struct asn1_arena_root *root;
+	ASN1_VALUE *val = NULL;
+	CBS cbs;
+
+	if (arena == NULL || len < 0)
+		return NULL;
+
+	if ((root = asn1_arena_calloc(arena, 1, sizeof(*root))) == NULL) {
+		ASN1error(ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+
+	CBS_init(&cbs, *in, len);
+	if (asn1_item_d2i_cbs(&val, &cbs, it, arena) != 1)
+		return NULL;
+	*in = CBS_data(&cbs);
+
+	root->it = it;
+	root->val = val;
+	root->next = arena->roots;
+	arena->roots = root;
+
+	return val;
+}
+LCRYPTO_ALIAS(ASN1_item_d2i_arena);
@@ -185,6 +185,25 @@ void asn1_enc_cleanup(ASN1_VALUE **pval, const ASN1_ITEM *it);
 int asn1_enc_save(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it);
 int asn1_enc_restore(int *len, unsigned char **out, ASN1_VALUE **pval, const ASN1_ITEM *it);
 
+void *asn1_arena_calloc(ASN1_ARENA *arena, size_t nmemb, size_t size);
+int asn1_arena_owns(ASN1_ARENA *arena, const void *ptr);
+int asn1_arena_hold(ASN1_ARENA *arena, ASN1_VALUE **pval, const ASN1_ITEM *it);
+void asn1_arena_freezero(ASN1_ARENA *arena, void *ptr, size_t len);
+int asn1_arena_stow(ASN1_ARENA *arena, CBS *cbs, uint8_t **out_data,
+    size_t *out_len);
+ASN1_STRING *asn1_arena_string_new(ASN1_ARENA *arena, int type);
+int asn1_arena_string_set(ASN1_ARENA *arena, ASN1_STRING *astr, CBS *cbs);
+void asn1_arena_string_free(ASN1_ARENA *arena, ASN1_STRING *astr);
+
+int asn1_item_d2i_cbs(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
+    ASN1_ARENA *arena);
+int asn1_item_ex_new_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena);
+void asn1_item_ex_free_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena);
+void asn1_template_free_arena(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt,
+    ASN1_ARENA *arena);
+
 int i2d_ASN1_BOOLEAN(int a, unsigned char **pp);
 int d2i_ASN1_BOOLEAN(int *a, const unsigned char **pp, long length);
 
@@ -218,16 +237,20 @@ int asn1_must_be_primitive(int tag);
 int asn1_tag2charwidth(int tag);
 
 int asn1_abs_set_unused_bits(ASN1_BIT_STRING *abs, uint8_t unused_bits);
-int c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs);
+int c2i_ASN1_BIT_STRING_cbs(ASN1_BIT_STRING **out_abs, CBS *cbs,
+    ASN1_ARENA *arena);
 
-int c2i_ASN1_ENUMERATED_cbs(ASN1_ENUMERATED **out_aenum, CBS *cbs);
+int c2i_ASN1_ENUMERATED_cbs(ASN1_ENUMERATED **out_aenum, CBS *cbs,
+    ASN1_ARENA *arena);
 
 int asn1_aint_get_uint64(CBS *cbs, uint64_t *out_val);
 int asn1_aint_set_uint64(uint64_t val, uint8_t **out_data, int *out_len);
 int asn1_aint_get_int64(CBS *cbs, int negative, int64_t *out_val);
-int c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs);
+int c2i_ASN1_INTEGER_cbs(ASN1_INTEGER **out_aint, CBS *cbs,
+    ASN1_ARENA *arena);
 
-int c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content);
+int c2i_ASN1_OBJECT_cbs(ASN1_OBJECT **out_aobj, CBS *content,
+    ASN1_ARENA *arena);
 int i2t_ASN1_OBJECT_internal(const ASN1_OBJECT *aobj, char *buf, int buf_len,
     int no_name);
 ASN1_OBJECT *t2i_ASN1_OBJECT_internal(const char *oid);
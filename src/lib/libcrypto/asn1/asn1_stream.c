@@ -0,0 +1,394 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Pull-style decoder for DER read from a BIO. Only the identifier and length
+ * octets of the next element are buffered, so that the caller can walk into
+ * constructed elements, skip elements it is not interested in and decode
+ * one element at a time (for example each X509_REVOKED in a CRL) without
+ * the enclosing structure ever being held in memory. Memory use is bounded
+ * by the read buffer and the largest element passed to ASN1_STREAM_d2i().
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/asn1.h>
+#include <openssl/asn1t.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+
+#include "asn1_local.h"
+#include "bytestring.h"
+
+#define ASN1_STREAM_BUF_SIZE		16384
+
+/* One identifier octet, up to five tag octets and nine length octets. */
+#define ASN1_STREAM_HEADER_MAX		15
+
+/* Matches the nesting limit of the template decoder. */
+#define ASN1_STREAM_MAX_DEPTH		30
+
+#define ASN1_STREAM_MAX_ELEMENT		(1024 * 1024)
+
+struct asn1_stream_st {
+	BIO *bio;
+	int eof;
+	int error;
+
+	uint8_t *buf;
+	size_t buf_off;
+	size_t buf_len;
+
+	uint8_t *elem;
+	size_t elem_len;
+	size_t max_element;
+
+	/* Header of the next element, if it has been peeked. */
+	int have_header;
+	uint8_t tag_class;
+	int constructed;
+	uint32_t tag_number;
+	size_t header_len;
+	size_t content_len;
+
+	/* Content octets left in each entered element. */
+	size_t remaining[ASN1_STREAM_MAX_DEPTH + 1];
+	int depth;
+};
+
+ASN1_STREAM *
+ASN1_STREAM_new(BIO *bio)
+{
+	ASN1_STREAM *stream;
+
+	if ((stream = calloc(1, sizeof(*stream))) == NULL)
+		goto err;
+	if ((stream->buf = malloc(ASN1_STREAM_BUF_SIZE)) == NULL)
+		goto err;
+	stream->bio = bio;
+	stream->max_element = ASN1_STREAM_MAX_ELEMENT;
+
+	return stream;
+
+ err:
+	ASN1error(ERR_R_MALLOC_FAILURE);
+	ASN1_STREAM_free(stream);
+
+	return NULL;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_new);
+
+void
+ASN1_STREAM_free(ASN1_STREAM *stream)
+{
+	if (stream == NULL)
+		return;
+
+	free(stream->buf);
+	free(stream->elem);
+	free(stream);
+}
+LCRYPTO_ALIAS(ASN1_STREAM_free);
+
+int
+ASN1_STREAM_set_max_element(ASN1_STREAM *stream, size_t max_element)
+{
+	if (max_element == 0 || max_element > LONG_MAX) {
+		ASN1error(ASN1_R_TOO_LONG);
+		return 0;
+	}
+	stream->max_element = max_element;
+
+	return 1;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_set_max_element);
+
+int
+ASN1_STREAM_get_depth(const ASN1_STREAM *stream)
+{
+	return stream->depth;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_get_depth);
+
+/*
+ * Ensure that at least want bytes are buffered, unless the end of input
+ * has been reached. Returns the number of bytes available.
+ */
+static size_t
+asn1_stream_fill(ASN1_STREAM *stream, size_t want)
+{
+	size_t avail;
+	int n;
+
+	if ((avail = stream->buf_len - stream->buf_off) >= want ||
+	    stream->eof)
+		return avail;
+
+	memmove(stream->buf, stream->buf + stream->buf_off, avail);
+	stream->buf_off = 0;
+	stream->buf_len = avail;
+
+	while (stream->buf_len < want) {
+		n = BIO_read(stream->bio, stream->buf + stream->buf_len,
+		    ASN1_STREAM_BUF_SIZE - stream->buf_len);
+		if (n <= 0) {
+			stream->eof = 1;
+			break;
+		}
+		stream->buf_len += n;
+	}
+
+	return stream->buf_len - stream->buf_off;
+}
+
+/* Read len bytes into out, or discard them if out is NULL. */
+static int
+asn1_stream_read(ASN1_STREAM *stream, uint8_t *out, size_t len)
+{
+	size_t avail, n;
+
+	while (len > 0) {
+		if ((avail = asn1_stream_fill(stream, 1)) == 0) {
+			ASN1error(ASN1_R_NOT_ENOUGH_DATA);
+			stream->error = 1;
+			return 0;
+		}
+		if ((n = avail) > len)
+			n = len;
+		if (out != NULL) {
+			memcpy(out, stream->buf + stream->buf_off, n);
+			out += n;
+		}
+		stream->buf_off += n;
+		len -= n;
+	}
+
+	return 1;
+}
+
+/* Consume the peeked element, or its header only if enter is set. */
+static int
+asn1_stream_consume(ASN1_STREAM *stream, uint8_t *out, int enter)
+{
+	size_t len;
+
+	len = stream->header_len;
+	if (!enter)
+		len += stream->content_len;
+
+	if (!asn1_stream_read(stream, out, len))
+		return 0;
+
+	if (stream->depth > 0)
+		stream->remaining[stream->depth] -= stream->header_len +
+		    stream->content_len;
+	stream->have_header = 0;
+
+	return 1;
+}
+
+int
+ASN1_STREAM_peek(ASN1_STREAM *stream, int *out_tag, int *out_class,
+    int *out_constructed)
+{
+	uint8_t tag_class;
+	uint32_t tag_number;
+	size_t avail, length;
+	int constructed, indefinite;
+	CBS cbs;
+
+	if (stream->error)
+		return -1;
+
+	if (stream->have_header)
+		goto done;
+
+	if (stream->depth > 0 && stream->remaining[stream->depth] == 0)
+		return 0;
+
+	if ((avail = asn1_stream_fill(stream, ASN1_STREAM_HEADER_MAX)) == 0) {
+		if (stream->depth == 0)
+			return 0;
+		ASN1error(ASN1_R_NOT_ENOUGH_DATA);
+		goto err;
+	}
+
+	/* The header must not extend beyond the enclosing element. */
+	if (stream->depth > 0 && avail > stream->remaining[stream->depth])
+		avail = stream->remaining[stream->depth];
+
+	CBS_init(&cbs, stream->buf + stream->buf_off, avail);
+	if (!asn1_get_object_cbs(&cbs, 1, &tag_class, &constructed,
+	    &tag_number, &indefinite, &length)) {
+		ASN1error(ASN1_R_BAD_OBJECT_HEADER);
+		goto err;
+	}
+	if (indefinite || tag_number > INT_MAX) {
+		ASN1error(ASN1_R_BAD_OBJECT_HEADER);
+		goto err;
+	}
+
+	stream->header_len = avail - CBS_len(&cbs);
+	if (length > SIZE_MAX - stream->header_len) {
+		ASN1error(ASN1_R_TOO_LONG);
+		goto err;
+	}
+	if (stream->depth > 0 &&
+	    length > stream->remaining[stream->depth] - stream->header_len) {
+		ASN1error(ASN1_R_TOO_LONG);
+		goto err;
+	}
+
+	stream->tag_class = tag_class;
+	stream->constructed = constructed;
+	stream->tag_number = tag_number;
+	stream->content_len = length;
+	stream->have_header = 1;
+
+ done:
+	if (out_tag != NULL)
+		*out_tag = stream->tag_number;
+	if (out_class != NULL)
+		*out_class = stream->tag_class << 6;
+	if (out_constructed != NULL)
+		*out_constructed = stream->constructed;
+
+	return 1;
+
+ err:
+	stream->error = 1;
+
+	return -1;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_peek);
+
+static int
+asn1_stream_next(ASN1_STREAM *stream)
+{
+	int ret;
+
+	if ((ret = ASN1_STREAM_peek(stream, NULL, NULL, NULL)) == 0)
+		ASN1error(ASN1_R_NOT_ENOUGH_DATA);
+
+	return ret == 1;
+}
+
+int
+ASN1_STREAM_enter(ASN1_STREAM *stream)
+{
+	size_t content_len;
+
+	if (!asn1_stream_next(stream))
+		return 0;
+
+	if (!stream->constructed) {
+		ASN1error(ASN1_R_TYPE_NOT_CONSTRUCTED);
+		return 0;
+	}
+	if (stream->depth >= ASN1_STREAM_MAX_DEPTH) {
+		ASN1error(ASN1_R_NESTED_TOO_DEEP);
+		return 0;
+	}
+
+	content_len = stream->content_len;
+	if (!asn1_stream_consume(stream, NULL, 1))
+		return 0;
+
+	stream->remaining[++stream->depth] = content_len;
+
+	return 1;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_enter);
+
+int
+ASN1_STREAM_leave(ASN1_STREAM *stream)
+{
+	if (stream->error)
+		return 0;
+
+	if (stream->depth == 0) {
+		ASN1error(ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+		return 0;
+	}
+
+	/* A peeked header is part of the remaining content. */
+	stream->have_header = 0;
+	if (!asn1_stream_read(stream, NULL, stream->remaining[stream->depth]))
+		return 0;
+
+	stream->remaining[stream->depth--] = 0;
+
+	return 1;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_leave);
+
+int
+ASN1_STREAM_skip(ASN1_STREAM *stream)
+{
+	if (!asn1_stream_next(stream))
+		return 0;
+
+	return asn1_stream_consume(stream, NULL, 0);
+}
+LCRYPTO_ALIAS(ASN1_STREAM_skip);
+
+void *
+ASN1_STREAM_d2i(ASN1_STREAM *stream, const ASN1_ITEM *it)
+{
+	ASN1_VALUE *val;
+	const uint8_t *p;
+	uint8_t *elem;
+	size_t len;
+
+	if (!asn1_stream_next(stream))
+		return NULL;
+
+	/* Oversized elements are left in place so they can be skipped. */
+	len = stream->header_len + stream->content_len;
+	if (len > stream->max_element) {
+		ASN1error(ASN1_R_TOO_LONG);
+		return NULL;
+	}
+
+	/* The element buffer is reused and only grows to the largest one. */
+	if (len > stream->elem_len) {
+		if ((elem = realloc(stream->elem, len)) == NULL) {
+			ASN1error(ERR_R_MALLOC_FAILURE);
+			return NULL;
+		}
+		stream->elem = elem;
+		stream->elem_len = len;
+	}
+
+	if (!asn1_stream_consume(stream, stream->elem, 0))
+		return NULL;
+
+	p = stream->elem;
+	if ((val = ASN1_item_d2i(NULL, &p, len, it)) == NULL)
+		return NULL;
+	if (p != stream->elem + len) {
+		ASN1error(ASN1_R_LENGTH_ERROR);
+		ASN1_item_free(val, it);
+		return NULL;
+	}
+
+	return val;
+}
+LCRYPTO_ALIAS(ASN1_STREAM_d2i);
@@ -86,7 +86,7 @@
 #endif
 
 static int asn1_template_d2i(ASN1_VALUE **pval, CBS *cbs,
-    const ASN1_TEMPLATE *at, int optional, int depth);
+    const ASN1_TEMPLATE *at, int optional, int depth, ASN1_ARENA *arena);
 
 static int
 asn1_check_eoc(CBS *cbs)
@@ -274,7 +274,8 @@ asn1_find_end(CBS *cbs, size_t length, int indefinite)
 }
 
 static int
-asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
+asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype,
+    const ASN1_ITEM *it, ASN1_ARENA *arena)
 {
 	ASN1_BOOLEAN *abool;
 	ASN1_STRING *astr;
@@ -289,7 +290,8 @@ asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *
 
 	switch (utype) {
 	case V_ASN1_OBJECT:
-		if (!c2i_ASN1_OBJECT_cbs((ASN1_OBJECT **)pval, content))
+		if (!c2i_ASN1_OBJECT_cbs((ASN1_OBJECT **)pval, content,
+		    arena))
 			goto err;
 		break;
 
@@ -313,17 +315,20 @@ asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *
 		break;
 
 	case V_ASN1_BIT_STRING:
-		if (!c2i_ASN1_BIT_STRING_cbs((ASN1_BIT_STRING **)pval, content))
+		if (!c2i_ASN1_BIT_STRING_cbs((ASN1_BIT_STRING **)pval,
+		    content, arena))
 			goto err;
 		break;
 
 	case V_ASN1_ENUMERATED:
-		if (!c2i_ASN1_ENUMERATED_cbs((ASN1_ENUMERATED **)pval, content))
+		if (!c2i_ASN1_ENUMERATED_cbs((ASN1_ENUMERATED **)pval,
+		    content, arena))
 			goto err;
 		break;
 
 	case V_ASN1_INTEGER:
-		if (!c2i_ASN1_INTEGER_cbs((ASN1_INTEGER **)pval, content))
+		if (!c2i_ASN1_INTEGER_cbs((ASN1_INTEGER **)pval, content,
+		    arena))
 			goto err;
 		break;
 
@@ -362,15 +367,15 @@ asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *
 		}
 		/* All based on ASN1_STRING and handled the same way. */
 		if (*pval != NULL) {
-			ASN1_STRING_free((ASN1_STRING *)*pval);
+			asn1_arena_string_free(arena, (ASN1_STRING *)*pval);
 			*pval = NULL;
 		}
-		if ((astr = ASN1_STRING_type_new(utype)) == NULL) {
+		if ((astr = asn1_arena_string_new(arena, utype)) == NULL) {
 			ASN1error(ERR_R_MALLOC_FAILURE);
 			goto err;
 		}
-		if (!ASN1_STRING_set(astr, CBS_data(content), CBS_len(content))) {
-			ASN1_STRING_free(astr);
+		if (!asn1_arena_string_set(arena, astr, content)) {
+			asn1_arena_string_free(arena, astr);
 			goto err;
 		}
 		*pval = (ASN1_VALUE *)astr;
@@ -384,7 +389,8 @@ asn1_c2i_primitive(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *
 }
 
 static int
-asn1_c2i_any(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
+asn1_c2i_any(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it,
+    ASN1_ARENA *arena)
 {
 	ASN1_TYPE *atype;
 
@@ -392,15 +398,17 @@ asn1_c2i_any(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
 		return 0;
 
 	if (*pval != NULL) {
-		ASN1_TYPE_free((ASN1_TYPE *)*pval);
+		asn1_item_ex_free_arena(pval, it, arena);
 		*pval = NULL;
 	}
 
-	if ((atype = ASN1_TYPE_new()) == NULL)
+	if ((atype = asn1_arena_calloc(arena, 1, sizeof(*atype))) == NULL)
 		return 0;
+	atype->type = -1;
 
-	if (!asn1_c2i_primitive(&atype->value.asn1_value, content, utype, it)) {
-		ASN1_TYPE_free(atype);
+	if (!asn1_c2i_primitive(&atype->value.asn1_value, content, utype, it,
+	    arena)) {
+		asn1_item_ex_free_arena((ASN1_VALUE **)&atype, it, arena);
 		return 0;
 	}
 	atype->type = utype;
@@ -415,7 +423,8 @@ asn1_c2i_any(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
 }
 
 static int
-asn1_c2i(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
+asn1_c2i(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it,
+    ASN1_ARENA *arena)
 {
 	if (CBS_len(content) > INT_MAX)
 		return 0;
@@ -432,9 +441,9 @@ asn1_c2i(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
 	}
 
 	if (it->utype == V_ASN1_ANY)
-		return asn1_c2i_any(pval, content, utype, it);
+		return asn1_c2i_any(pval, content, utype, it, arena);
 
-	return asn1_c2i_primitive(pval, content, utype, it);
+	return asn1_c2i_primitive(pval, content, utype, it, arena);
 }
 
 /*
@@ -452,7 +461,7 @@ asn1_c2i(ASN1_VALUE **pval, CBS *content, int utype, const ASN1_ITEM *it)
 static int
 asn1_d2i_primitive_content(ASN1_VALUE **pval, CBS *cbs, CBS *cbs_object,
     int utype, int constructed, int indefinite, size_t length,
-    const ASN1_ITEM *it)
+    const ASN1_ITEM *it, ASN1_ARENA *arena)
 {
 	CBS cbs_content, cbs_initial;
 	uint8_t *data = NULL;
@@ -504,7 +513,7 @@ asn1_d2i_primitive_content(ASN1_VALUE **pval, CBS *cbs, CBS *cbs_object,
 			goto err;
 	}
 
-	if (!asn1_c2i(pval, &cbs_content, utype, it))
+	if (!asn1_c2i(pval, &cbs_content, utype, it, arena))
 		goto err;
 
 	if (!CBS_skip(cbs, CBS_offset(cbs_object)))
@@ -521,7 +530,7 @@ asn1_d2i_primitive_content(ASN1_VALUE **pval, CBS *cbs, CBS *cbs_object,
 
 static int
 asn1_d2i_any(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional)
+    int tag_number, int tag_class, int optional, ASN1_ARENA *arena)
 {
 	int constructed, indefinite;
 	uint8_t object_class;
@@ -553,12 +562,12 @@ asn1_d2i_any(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 		object_type = V_ASN1_OTHER;
 
 	return asn1_d2i_primitive_content(pval, cbs, &cbs_object, object_type,
-	    constructed, indefinite, length, it);
+	    constructed, indefinite, length, it, arena);
 }
 
 static int
 asn1_d2i_mstring(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional)
+    int tag_number, int tag_class, int optional, ASN1_ARENA *arena)
 {
 	int constructed, indefinite;
 	uint8_t object_class;
@@ -599,12 +608,12 @@ asn1_d2i_mstring(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	}
 
 	return asn1_d2i_primitive_content(pval, cbs, &cbs_object,
-	    object_tag, constructed, indefinite, length, it);
+	    object_tag, constructed, indefinite, length, it, arena);
 }
 
 static int
 asn1_d2i_primitive(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional)
+    int tag_number, int tag_class, int optional, ASN1_ARENA *arena)
 {
 	CBS cbs_object;
 	int constructed, indefinite;
@@ -618,7 +627,8 @@ asn1_d2i_primitive(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 		return 0;
 
 	if (it->utype == V_ASN1_ANY)
-		return asn1_d2i_any(pval, cbs, it, tag_number, tag_class, optional);
+		return asn1_d2i_any(pval, cbs, it, tag_number, tag_class,
+		    optional, arena);
 
 	if (tag_number == -1) {
 		tag_number = it->utype;
@@ -635,12 +645,12 @@ asn1_d2i_primitive(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	}
 
 	return asn1_d2i_primitive_content(pval, cbs, &cbs_object, utype,
-	    constructed, indefinite, length, it);
+	    constructed, indefinite, length, it, arena);
 }
 
 static int
 asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional, int depth)
+    int tag_number, int tag_class, int optional, int depth, ASN1_ARENA *arena)
 {
 	const ASN1_TEMPLATE *at, *errat = NULL;
 	const ASN1_AUX *aux;
@@ -665,11 +675,11 @@ asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	}
 
 	if (*pval != NULL) {
-		ASN1_item_ex_free(pval, it);
+		asn1_item_ex_free_arena(pval, it, arena);
 		*pval = NULL;
 	}
 
-	if (!ASN1_item_ex_new(&achoice, it)) {
+	if (!asn1_item_ex_new_arena(&achoice, it, arena)) {
 		ASN1error(ERR_R_NESTED_ASN1_ERROR);
 		goto err;
 	}
@@ -686,7 +696,7 @@ asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 		pchptr = asn1_get_field_ptr(&achoice, at);
 
 		/* Mark field as OPTIONAL so its absence can be identified. */
-		ret = asn1_template_d2i(pchptr, cbs, at, 1, depth);
+		ret = asn1_template_d2i(pchptr, cbs, at, 1, depth, arena);
 		if (ret == -1)
 			continue;
 		if (ret != 1) {
@@ -703,7 +713,7 @@ asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	/* Did we fall off the end without reading anything? */
 	if (i == it->tcount) {
 		if (optional) {
-			ASN1_item_ex_free(&achoice, it);
+			asn1_item_ex_free_arena(&achoice, it, arena);
 			return -1;
 		}
 		ASN1error(ASN1_R_NO_MATCHING_CHOICE_TYPE);
@@ -721,7 +731,7 @@ asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	return 1;
 
  err:
-	ASN1_item_ex_free(&achoice, it);
+	asn1_item_ex_free_arena(&achoice, it, arena);
 
 	if (errat != NULL)
 		ERR_asprintf_error_data("Field=%s, Type=%s", errat->field_name,
@@ -734,7 +744,7 @@ asn1_item_d2i_choice(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 
 static int
 asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional, int depth)
+    int tag_number, int tag_class, int optional, int depth, ASN1_ARENA *arena)
 {
 	CBS cbs_seq, cbs_seq_content, cbs_object;
 	int constructed, indefinite, optional_field;
@@ -758,7 +768,7 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 		goto err;
 
 	if (*pval != NULL) {
-		ASN1_item_ex_free(pval, it);
+		asn1_item_ex_free_arena(pval, it, arena);
 		*pval = NULL;
 	}
 
@@ -792,7 +802,7 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 			goto err;
 	}
 
-	if (!ASN1_item_ex_new(&aseq, it)) {
+	if (!asn1_item_ex_new_arena(&aseq, it, arena)) {
 		ASN1error(ERR_R_NESTED_ASN1_ERROR);
 		goto err;
 	}
@@ -832,10 +842,10 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 			optional_field = 0;
 
 		ret = asn1_template_d2i(pseqval, &cbs_seq_content,
-		    seqat, optional_field, depth);
+		    seqat, optional_field, depth, arena);
 		if (ret == -1) {
 			/* Absent OPTIONAL component. */
-			ASN1_template_free(pseqval, seqat);
+			asn1_template_free_arena(pseqval, seqat, arena);
 			continue;
 		}
 		if (ret != 1) {
@@ -875,7 +885,7 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 
 		/* XXX - this is probably unnecessary with earlier free. */
 		pseqval = asn1_get_field_ptr(&aseq, seqat);
-		ASN1_template_free(pseqval, seqat);
+		asn1_template_free_arena(pseqval, seqat, arena);
 	}
 
 	if (!CBS_get_bytes(cbs, &cbs_object, CBS_offset(&cbs_seq)))
@@ -897,7 +907,7 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	return 1;
 
  err:
-	ASN1_item_ex_free(&aseq, it);
+	asn1_item_ex_free_arena(&aseq, it, arena);
 
 	if (errat != NULL)
 		ERR_asprintf_error_data("Field=%s, Type=%s", errat->field_name,
@@ -910,7 +920,7 @@ asn1_item_d2i_sequence(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 
 static int
 asn1_item_d2i_extern(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional)
+    int tag_number, int tag_class, int optional, ASN1_ARENA *arena)
 {
 	const ASN1_EXTERN_FUNCS *ef = it->funcs;
 	const unsigned char *p = NULL;
@@ -930,7 +940,7 @@ asn1_item_d2i_extern(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 	return ret;
 
  err:
-	ASN1_item_ex_free(pval, it);
+	asn1_item_ex_free_arena(pval, it, arena);
 
 	ERR_asprintf_error_data("Type=%s", it->sname);
 
@@ -939,7 +949,7 @@ asn1_item_d2i_extern(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 
 static int
 asn1_item_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
-    int tag_number, int tag_class, int optional, int depth)
+    int tag_number, int tag_class, int optional, int depth, ASN1_ARENA *arena)
 {
 	if (pval == NULL)
 		return 0;
@@ -964,34 +974,34 @@ asn1_item_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 				goto err;
 			}
 			return asn1_template_d2i(pval, cbs, it->templates,
-			    optional, depth);
+			    optional, depth, arena);
 		}
 		return asn1_d2i_primitive(pval, cbs, it, tag_number, tag_class,
-		    optional);
+		    optional, arena);
 
 	case ASN1_ITYPE_MSTRING:
 		return asn1_d2i_mstring(pval, cbs, it, tag_number, tag_class,
-		    optional);
+		    optional, arena);
 
 	case ASN1_ITYPE_EXTERN:
 		return asn1_item_d2i_extern(pval, cbs, it, tag_number,
-		    tag_class, optional);
+		    tag_class, optional, arena);
 
 	case ASN1_ITYPE_CHOICE:
 		return asn1_item_d2i_choice(pval, cbs, it, tag_number,
-		    tag_class, optional, depth);
+		    tag_class, optional, depth, arena);
 
 	case ASN1_ITYPE_NDEF_SEQUENCE:
 	case ASN1_ITYPE_SEQUENCE:
 		return asn1_item_d2i_sequence(pval, cbs, it, tag_number,
-		    tag_class, optional, depth);
+		    tag_class, optional, depth, arena);
 
 	default:
 		return 0;
 	}
 
  err:
-	ASN1_item_ex_free(pval, it);
+	asn1_item_ex_free_arena(pval, it, arena);
 
 	ERR_asprintf_error_data("Type=%s", it->sname);
 
@@ -1000,7 +1010,7 @@ asn1_item_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
 
 static void
 asn1_template_stack_of_free(STACK_OF(ASN1_VALUE) *avals,
-    const ASN1_TEMPLATE *at)
+    const ASN1_TEMPLATE *at, ASN1_ARENA *arena)
 {
 	ASN1_VALUE *aval;
 
@@ -1009,14 +1019,14 @@ asn1_template_stack_of_free(STACK_OF(ASN1_VALUE) *avals,
 
 	while (sk_ASN1_VALUE_num(avals) > 0) {
 		aval = sk_ASN1_VALUE_pop(avals);
-		ASN1_item_ex_free(&aval, at->item);
+		asn1_item_ex_free_arena(&aval, at->item, arena);
 	}
 	sk_ASN1_VALUE_free(avals);
 }
 
 static int
 asn1_template_stack_of_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
-    int optional, int depth)
+    int optional, int depth, ASN1_ARENA *arena)
 {
 	CBS cbs_object, cbs_object_content;
 	STACK_OF(ASN1_VALUE) *avals = NULL;
@@ -1032,7 +1042,7 @@ asn1_template_stack_of_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 	if (pval == NULL)
 		return 0;
 
-	asn1_template_stack_of_free((STACK_OF(ASN1_VALUE) *)*pval, at);
+	asn1_template_stack_of_free((STACK_OF(ASN1_VALUE) *)*pval, at, arena);
 	*pval = NULL;
 
 	tag_number = at->tag;
@@ -1082,7 +1092,7 @@ asn1_template_stack_of_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 			break;
 		}
 		if (!asn1_item_d2i(&aval, &cbs_object_content, at->item, -1, 0,
-		    0, depth)) {
+		    0, depth, arena)) {
 			ASN1error(ERR_R_NESTED_ASN1_ERROR);
 			goto err;
 		}
@@ -1111,15 +1121,15 @@ asn1_template_stack_of_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 	return 1;
 
  err:
-	asn1_template_stack_of_free(avals, at);
-	ASN1_item_ex_free(&aval, at->item);
+	asn1_template_stack_of_free(avals, at, arena);
+	asn1_item_ex_free_arena(&aval, at->item, arena);
 
 	return 0;
 }
 
 static int
 asn1_template_noexp_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
-    int optional, int depth)
+    int optional, int depth, ASN1_ARENA *arena)
 {
 	int tag_number, tag_class;
 	int ret;
@@ -1128,7 +1138,8 @@ asn1_template_noexp_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 		return 0;
 
 	if ((at->flags & ASN1_TFLG_SK_MASK) != 0)
-		return asn1_template_stack_of_d2i(pval, cbs, at, optional, depth);
+		return asn1_template_stack_of_d2i(pval, cbs, at, optional,
+		    depth, arena);
 
 	tag_number = -1;
 	tag_class = V_ASN1_UNIVERSAL;
@@ -1140,7 +1151,7 @@ asn1_template_noexp_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 	}
 
 	ret = asn1_item_d2i(pval, cbs, at->item, tag_number, tag_class,
-	    optional, depth);
+	    optional, depth, arena);
 	if (ret == -1)
 		return -1;
 	if (ret != 1) {
@@ -1152,13 +1163,13 @@ asn1_template_noexp_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 
  err:
 	/* XXX - The called function should have freed already. */
-	ASN1_template_free(pval, at);
+	asn1_template_free_arena(pval, at, arena);
 	return 0;
 }
 
 static int
 asn1_template_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
-    int optional, int depth)
+    int optional, int depth, ASN1_ARENA *arena)
 {
 	CBS cbs_exp, cbs_exp_content;
 	int constructed, indefinite;
@@ -1170,7 +1181,8 @@ asn1_template_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 
 	/* Check if EXPLICIT tag is expected. */
 	if ((at->flags & ASN1_TFLG_EXPTAG) == 0)
-		return asn1_template_noexp_d2i(pval, cbs, at, optional, depth);
+		return asn1_template_noexp_d2i(pval, cbs, at, optional, depth,
+		    arena);
 
 	CBS_init(&cbs_exp, CBS_data(cbs), CBS_len(cbs));
 
@@ -1197,7 +1209,7 @@ asn1_template_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 	}
 
 	if ((ret = asn1_template_noexp_d2i(pval, &cbs_exp_content, at, 0,
-	    depth)) != 1) {
+	    depth, arena)) != 1) {
 		ASN1error(ERR_R_NESTED_ASN1_ERROR);
 		return 0;
 	}
@@ -1220,7 +1232,7 @@ asn1_template_d2i(ASN1_VALUE **pval, CBS *cbs, const ASN1_TEMPLATE *at,
 	return 1;
 
  err:
-	ASN1_template_free(pval, at);
+	asn1_template_free_arena(pval, at, arena);
 	return 0;
 }
 
@@ -1252,7 +1264,7 @@ ASN1_item_ex_d2i(ASN1_VALUE **pval, const unsigned char **in, long inlen,
 
 	CBS_init(&cbs, *in, inlen);
 	if ((ret = asn1_item_d2i(pval, &cbs, it, tag_number, tag_class,
-	    (int)optional, 0)) == 1)
+	    (int)optional, 0, NULL)) == 1)
 		*in = CBS_data(&cbs);
 
 	return ret;
@@ -1270,9 +1282,16 @@ ASN1_template_d2i(ASN1_VALUE **pval, const unsigned char **in, long len,
 		return 0;
 
 	CBS_init(&cbs, *in, len);
-	if ((ret = asn1_template_d2i(pval, &cbs, at, 0, 0)) == 1)
+	if ((ret = asn1_template_d2i(pval, &cbs, at, 0, 0, NULL)) == 1)
 		*in = CBS_data(&cbs);
 
 	return ret;
 }
 LCRYPTO_ALIAS(ASN1_template_d2i);
+
+int
+asn1_item_d2i_cbs(ASN1_VALUE **pval, CBS *cbs, const ASN1_ITEM *it,
+    ASN1_ARENA *arena)
+{
+	return asn1_item_d2i(pval, cbs, it, -1, 0, 0, 0, arena);
+}
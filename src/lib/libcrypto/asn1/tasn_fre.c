@@ -64,26 +64,40 @@
 
 #include "asn1_local.h"
 
-static void asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it);
+static void asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena);
+static void asn1_primitive_free(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena);
 
 /* Free up an ASN1 structure */
 
 void
 ASN1_item_free(ASN1_VALUE *val, const ASN1_ITEM *it)
 {
-	asn1_item_free(&val, it);
+	asn1_item_free(&val, it, NULL);
 }
 LCRYPTO_ALIAS(ASN1_item_free);
 
 void
 ASN1_item_ex_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 {
-	asn1_item_free(pval, it);
+	asn1_item_free(pval, it, NULL);
 }
 LCRYPTO_ALIAS(ASN1_item_ex_free);
 
+/*
+ * Free a value that may have been decoded into an arena. Memory owned by
+ * the arena is left alone, everything else is freed as usual.
+ */
+void
+asn1_item_ex_free_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena)
+{
+	asn1_item_free(pval, it, arena);
+}
+
 static void
-asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
+asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it, ASN1_ARENA *arena)
 {
 	const ASN1_TEMPLATE *tt = NULL, *seqtt;
 	const ASN1_EXTERN_FUNCS *ef;
@@ -103,13 +117,13 @@ asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	switch (it->itype) {
 	case ASN1_ITYPE_PRIMITIVE:
 		if (it->templates)
-			ASN1_template_free(pval, it->templates);
+			asn1_template_free_arena(pval, it->templates, arena);
 		else
-			ASN1_primitive_free(pval, it);
+			asn1_primitive_free(pval, it, arena);
 		break;
 
 	case ASN1_ITYPE_MSTRING:
-		ASN1_primitive_free(pval, it);
+		asn1_primitive_free(pval, it, arena);
 		break;
 
 	case ASN1_ITYPE_CHOICE:
@@ -123,11 +137,12 @@ asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 			ASN1_VALUE **pchval;
 			tt = it->templates + i;
 			pchval = asn1_get_field_ptr(pval, tt);
-			ASN1_template_free(pchval, tt);
+			asn1_template_free_arena(pchval, tt, arena);
 		}
 		if (asn1_cb)
 			asn1_cb(ASN1_OP_FREE_POST, pval, it, NULL);
-		free(*pval);
+		if (!asn1_arena_owns(arena, *pval))
+			free(*pval);
 		*pval = NULL;
 		break;
 
@@ -139,6 +154,8 @@ asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 
 	case ASN1_ITYPE_NDEF_SEQUENCE:
 	case ASN1_ITYPE_SEQUENCE:
+		if (asn1_arena_hold(arena, pval, it))
+			return;
 		if (asn1_do_lock(pval, -1, it) > 0)
 			return;
 		if (asn1_cb) {
@@ -159,11 +176,12 @@ asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 			if (!seqtt)
 				continue;
 			pseqval = asn1_get_field_ptr(pval, seqtt);
-			ASN1_template_free(pseqval, seqtt);
+			asn1_template_free_arena(pseqval, seqtt, arena);
 		}
 		if (asn1_cb)
 			asn1_cb(ASN1_OP_FREE_POST, pval, it, NULL);
-		free(*pval);
+		if (!asn1_arena_owns(arena, *pval))
+			free(*pval);
 		*pval = NULL;
 		break;
 	}
@@ -171,6 +189,14 @@ asn1_item_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 
 void
 ASN1_template_free(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt)
+{
+	asn1_template_free_arena(pval, tt, NULL);
+}
+LCRYPTO_ALIAS(ASN1_template_free);
+
+void
+asn1_template_free_arena(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt,
+    ASN1_ARENA *arena)
 {
 	int i;
 	if (tt->flags & ASN1_TFLG_SK_MASK) {
@@ -178,17 +204,23 @@ ASN1_template_free(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt)
 		for (i = 0; i < sk_ASN1_VALUE_num(sk); i++) {
 			ASN1_VALUE *vtmp;
 			vtmp = sk_ASN1_VALUE_value(sk, i);
-			asn1_item_free(&vtmp, tt->item);
+			asn1_item_free(&vtmp, tt->item, arena);
 		}
 		sk_ASN1_VALUE_free(sk);
 		*pval = NULL;
 	} else
-		asn1_item_free(pval, tt->item);
+		asn1_item_free(pval, tt->item, arena);
 }
-LCRYPTO_ALIAS(ASN1_template_free);
 
 void
 ASN1_primitive_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
+{
+	asn1_primitive_free(pval, it, NULL);
+}
+LCRYPTO_ALIAS(ASN1_primitive_free);
+
+static void
+asn1_primitive_free(ASN1_VALUE **pval, const ASN1_ITEM *it, ASN1_ARENA *arena)
 {
 	int utype;
 
@@ -232,14 +264,14 @@ ASN1_primitive_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 		break;
 
 	case V_ASN1_ANY:
-		ASN1_primitive_free(pval, NULL);
-		free(*pval);
+		asn1_primitive_free(pval, NULL, arena);
+		if (!asn1_arena_owns(arena, *pval))
+			free(*pval);
 		break;
 
 	default:
-		ASN1_STRING_free((ASN1_STRING *)*pval);
+		asn1_arena_string_free(arena, (ASN1_STRING *)*pval);
 		break;
 	}
 	*pval = NULL;
 }
-LCRYPTO_ALIAS(ASN1_primitive_free);
@@ -90,6 +90,60 @@ ASN1_item_ex_new(ASN1_VALUE **pval, const ASN1_ITEM *it)
 }
 LCRYPTO_ALIAS(ASN1_item_ex_new);
 
+/*
+ * Allocate a CHOICE or SEQUENCE from an arena for the decoder. The fields
+ * are cleared as if they were OPTIONAL instead of being allocated, since
+ * the decoder replaces them anyway. Other types are allocated as usual.
+ */
+int
+asn1_item_ex_new_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+    ASN1_ARENA *arena)
+{
+	const ASN1_TEMPLATE *tt;
+	const ASN1_AUX *aux = it->funcs;
+	ASN1_aux_cb *asn1_cb = NULL;
+	int i;
+
+	if (arena == NULL || (it->itype != ASN1_ITYPE_CHOICE &&
+	    it->itype != ASN1_ITYPE_SEQUENCE &&
+	    it->itype != ASN1_ITYPE_NDEF_SEQUENCE))
+		return asn1_item_ex_new(pval, it);
+
+	if (aux != NULL && aux->asn1_cb != NULL)
+		asn1_cb = aux->asn1_cb;
+
+	*pval = NULL;
+
+	if (asn1_cb) {
+		i = asn1_cb(ASN1_OP_NEW_PRE, pval, it, NULL);
+		if (!i)
+			goto auxerr;
+		if (i == 2)
+			return 1;
+	}
+	if ((*pval = asn1_arena_calloc(arena, 1, it->size)) == NULL) {
+		ASN1error(ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	if (it->itype == ASN1_ITYPE_CHOICE) {
+		asn1_set_choice_selector(pval, -1, it);
+	} else {
+		asn1_do_lock(pval, 0, it);
+		asn1_enc_init(pval, it);
+		for (i = 0, tt = it->templates; i < it->tcount; tt++, i++)
+			asn1_template_clear(asn1_get_field_ptr(pval, tt), tt);
+	}
+	if (asn1_cb && !asn1_cb(ASN1_OP_NEW_POST, pval, it, NULL))
+		goto auxerr;
+
+	return 1;
+
+ auxerr:
+	ASN1error(ASN1_R_AUX_ERROR);
+	asn1_item_ex_free_arena(pval, it, arena);
+	return 0;
+}
+
 static int
 asn1_item_ex_new(ASN1_VALUE **pval, const ASN1_ITEM *it)
 {
@@ -175,7 +175,7 @@ bn_c2i(ASN1_VALUE **pval, const unsigned char *content, int len, int utype,
 	if (len < 0)
 		goto err;
 	CBS_init(&cbs, content, len);
-	if (!c2i_ASN1_INTEGER_cbs(&aint, &cbs))
+	if (!c2i_ASN1_INTEGER_cbs(&aint, &cbs, NULL))
 		goto err;
 
 	if ((bn = ASN1_INTEGER_to_BN(aint, NULL)) == NULL)
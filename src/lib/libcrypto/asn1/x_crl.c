@@ -285,6 +285,8 @@ crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it, void *exarg)
 		crl->issuers = NULL;
 		crl->crl_number = NULL;
 		crl->base_crl_number = NULL;
+		crl->index = NULL;
+		crl->no_index = 0;
 		break;
 
 	case ASN1_OP_D2I_POST:
@@ -354,6 +356,7 @@ crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it, void *exarg)
 		ASN1_INTEGER_free(crl->crl_number);
 		ASN1_INTEGER_free(crl->base_crl_number);
 		sk_GENERAL_NAMES_pop_free(crl->issuers, GENERAL_NAMES_free);
+		X509_CRL_INDEX_free(crl->index);
 		break;
 	}
 	return rc;
@@ -605,6 +608,80 @@ crl_revoked_issuer_match(X509_CRL *crl, X509_NAME *nm, X509_REVOKED *rev)
 
 }
 
+/*
+ * Return the revocation index of the CRL, building it from the encoding on
+ * first use. The index is never replaced once set, so it can be used without
+ * holding the lock.
+ */
+static X509_CRL_INDEX *
+crl_get_index(X509_CRL *crl)
+{
+	X509_CRL_INDEX *index, *new_index;
+	int no_index;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_CRL);
+	index = crl->index;
+	no_index = crl->no_index;
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_CRL);
+
+	if (index != NULL || no_index)
+		return index;
+
+	new_index = x509_crl_index_new_crl(crl);
+
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_CRL);
+	if (crl->index == NULL) {
+		crl->index = new_index;
+		new_index = NULL;
+	}
+	if (crl->index == NULL)
+		crl->no_index = 1;
+	index = crl->index;
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_CRL);
+
+	/* Lost the race against another thread. */
+	X509_CRL_INDEX_free(new_index);
+
+	return index;
+}
+
+/*
+ * Look up serial in the revocation index. Returns -1 if the index cannot
+ * answer, in which case the revoked stack is searched instead.
+ */
+static int
+crl_index_lookup(X509_CRL *crl, X509_REVOKED **ret, ASN1_INTEGER *serial,
+    X509_NAME *issuer)
+{
+	X509_CRL_INDEX *index;
+	X509_REVOKED *rev;
+	uint32_t position;
+	int removed;
+
+	/* The encoding no longer matches the revoked entries. */
+	if (crl->crl->enc.modified)
+		return -1;
+	if ((index = crl_get_index(crl)) == NULL)
+		return -1;
+
+	if (!x509_crl_index_find(index, serial, &position, &removed))
+		return 0;
+
+	if (position >= (uint32_t)sk_X509_REVOKED_num(crl->crl->revoked))
+		return -1;
+	rev = sk_X509_REVOKED_value(crl->crl->revoked, position);
+	if (ASN1_INTEGER_cmp(rev->serialNumber, serial) != 0)
+		return -1;
+	if (!crl_revoked_issuer_match(crl, issuer, rev))
+		return 0;
+
+	if (ret)
+		*ret = rev;
+	if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
+		return 2;
+	return 1;
+}
+
 static int
 def_crl_lookup(X509_CRL *crl, X509_REVOKED **ret, ASN1_INTEGER *serial,
     X509_NAME *issuer)
@@ -612,6 +689,9 @@ def_crl_lookup(X509_CRL *crl, X509_REVOKED **ret, ASN1_INTEGER *serial,
 	X509_REVOKED rtmp, *rev;
 	int idx;
 
+	if ((idx = crl_index_lookup(crl, ret, serial, issuer)) != -1)
+		return idx;
+
 	rtmp.serialNumber = serial;
 	/* Sort revoked into serial number order if not already sorted.
 	 * Do this under a lock to avoid race condition.
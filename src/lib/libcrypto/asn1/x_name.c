@@ -57,6 +57,7 @@
  */
 
 #include <ctype.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -88,6 +89,9 @@ static int i2d_name_canon(STACK_OF(STACK_OF_X509_NAME_ENTRY) *intname,
 static int x509_name_ex_print(BIO *out, ASN1_VALUE **pval, int indent,
     const char *fname, const ASN1_PCTX *pctx);
 
+/* Serialises lazy generation of the canonical encoding of decoded names. */
+static pthread_mutex_t x509_name_canon_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static const ASN1_TEMPLATE X509_NAME_ENTRY_seq_tt[] = {
 	{
 		.offset = offsetof(X509_NAME_ENTRY, object),
@@ -253,6 +257,7 @@ x509_name_ex_new(ASN1_VALUE **val, const ASN1_ITEM *it)
 		goto memerr;
 	ret->canon_enc = NULL;
 	ret->canon_enclen = 0;
+	atomic_init(&ret->canon_valid, 0);
 	ret->modified = 1;
 	*val = (ASN1_VALUE *)ret;
 	return 1;
@@ -329,9 +334,10 @@ x509_name_ex_d2i(ASN1_VALUE **val, const unsigned char **in, long len,
 		sk_X509_NAME_ENTRY_free(entries);
 	}
 	sk_STACK_OF_X509_NAME_ENTRY_free(intname.s);
-	ret = x509_name_canon(nm.x);
-	if (!ret)
-		goto err;
+	/*
+	 * The canonical encoding is only needed to compare or hash names,
+	 * so it is generated on first use by x509_name_ensure_canon().
+	 */
 	nm.x->modified = 0;
 	*val = nm.a;
 	*in = p;
@@ -465,9 +471,12 @@ x509_name_canon(X509_NAME *a)
 		free(a->canon_enc);
 		a->canon_enc = NULL;
 	}
+	atomic_store_explicit(&a->canon_valid, 0, memory_order_release);
 	/* Special case: empty X509_NAME => null encoding */
 	if (sk_X509_NAME_ENTRY_num(a->entries) == 0) {
 		a->canon_enclen = 0;
+		atomic_store_explicit(&a->canon_valid, 1,
+		    memory_order_release);
 		return 1;
 	}
 	intname = sk_STACK_OF_X509_NAME_ENTRY_new_null();
@@ -510,6 +519,8 @@ x509_name_canon(X509_NAME *a)
 	a->canon_enc = p;
 	a->canon_enclen = len;
 	i2d_name_canon(intname, &p);
+	/* Publish the encoding to lockless readers of canon_valid. */
+	atomic_store_explicit(&a->canon_valid, 1, memory_order_release);
 	ret = 1;
 
  err:
@@ -521,6 +532,30 @@ x509_name_canon(X509_NAME *a)
 	return ret;
 }
 
+/*
+ * Ensure the cached encoding and the canonical encoding of the name are
+ * present and up to date. Names shared between threads are only ever
+ * decoded, never modified, so only the canonical encoding is generated
+ * under the lock.
+ */
+int
+x509_name_ensure_canon(X509_NAME *a)
+{
+	int ret = 1;
+
+	if (a->modified)
+		return i2d_X509_NAME(a, NULL) >= 0;
+	if (atomic_load_explicit(&a->canon_valid, memory_order_acquire))
+		return 1;
+
+	(void)pthread_mutex_lock(&x509_name_canon_lock);
+	if (!atomic_load_explicit(&a->canon_valid, memory_order_relaxed))
+		ret = x509_name_canon(a);
+	(void)pthread_mutex_unlock(&x509_name_canon_lock);
+
+	return ret;
+}
+
 /* Bitmap of all the types of string that will be canonicalized. */
 
 #define ASN1_MASK_CANON	\
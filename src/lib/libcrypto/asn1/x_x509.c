@@ -178,7 +178,6 @@ x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it, void *exarg)
 
 	case ASN1_OP_NEW_POST:
 		ret->valid = 0;
-		ret->name = NULL;
 		ret->ex_flags = 0;
 		ret->ex_pathlen = -1;
 		ret->skid = NULL;
@@ -192,11 +191,6 @@ x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it, void *exarg)
 		CRYPTO_new_ex_data(CRYPTO_EX_INDEX_X509, ret, &ret->ex_data);
 		break;
 
-	case ASN1_OP_D2I_POST:
-		free(ret->name);
-		ret->name = X509_NAME_oneline(ret->cert_info->subject, NULL, 0);
-		break;
-
 	case ASN1_OP_FREE_POST:
 		CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509, ret, &ret->ex_data);
 		X509_CERT_AUX_free(ret->aux);
@@ -205,12 +199,11 @@ x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it, void *exarg)
 		CRL_DIST_POINTS_free(ret->crldp);
 		GENERAL_NAMES_free(ret->altname);
 		NAME_CONSTRAINTS_free(ret->nc);
+		x509_constraints_index_free(ret->nc_index);
 #ifndef OPENSSL_NO_RFC3779
 		sk_IPAddressFamily_pop_free(ret->rfc3779_addr, IPAddressFamily_free);
 		ASIdentifiers_free(ret->rfc3779_asid);
 #endif
-		free(ret->name);
-		ret->name = NULL;
 		break;
 	}
 
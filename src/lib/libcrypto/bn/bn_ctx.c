@@ -15,7 +15,9 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <openssl/opensslconf.h>
@@ -25,6 +27,19 @@
 
 #define BN_CTX_INITIAL_LEN	8
 
+/*
+ * Once bn_ctx_reserve() has been called, BIGNUMs are added to the pool in
+ * slabs that hold the BIGNUMs together with words for each of them.
+ */
+struct bn_ctx_slab {
+	struct bn_ctx_slab *next;
+	size_t size;
+};
+
+#define BN_CTX_SLAB_HEADER \
+    ((sizeof(struct bn_ctx_slab) + sizeof(BN_ULONG) - 1) & \
+    ~(sizeof(BN_ULONG) - 1))
+
 struct bignum_ctx {
 	BIGNUM **bignums;
 	uint8_t *groups;
@@ -32,6 +47,10 @@ struct bignum_ctx {
 	size_t index;
 	size_t len;
 
+	struct bn_ctx_slab *slabs;
+	int words;
+	size_t used;
+
 	int error;
 };
 
@@ -65,6 +84,41 @@ bn_ctx_grow(BN_CTX *bctx)
 	return 1;
 }
 
+/*
+ * Fill the empty slots of the pool with BIGNUMs that use words from a
+ * single allocation.
+ */
+static int
+bn_ctx_slab_new(BN_CTX *bctx)
+{
+	struct bn_ctx_slab *slab;
+	BN_ULONG *words;
+	BIGNUM *bn;
+	size_t count, i, size;
+
+	count = bctx->len - bctx->index;
+	if (count > (SIZE_MAX - BN_CTX_SLAB_HEADER) /
+	    (sizeof(BIGNUM) + bctx->words * sizeof(BN_ULONG)))
+		return 0;
+	size = BN_CTX_SLAB_HEADER +
+	    count * (sizeof(BIGNUM) + bctx->words * sizeof(BN_ULONG));
+
+	if ((slab = calloc(1, size)) == NULL)
+		return 0;
+	slab->size = size;
+	slab->next = bctx->slabs;
+	bctx->slabs = slab;
+
+	words = (BN_ULONG *)((uint8_t *)slab + BN_CTX_SLAB_HEADER);
+	bn = (BIGNUM *)(words + count * bctx->words);
+	for (i = 0; i < count; i++) {
+		bn_init_inline(&bn[i], &words[i * bctx->words], bctx->words);
+		bctx->bignums[bctx->index + i] = &bn[i];
+	}
+
+	return 1;
+}
+
 BN_CTX *
 BN_CTX_new(void)
 {
@@ -75,6 +129,7 @@ LCRYPTO_ALIAS(BN_CTX_new);
 void
 BN_CTX_free(BN_CTX *bctx)
 {
+	struct bn_ctx_slab *slab;
 	size_t i;
 
 	if (bctx == NULL)
@@ -85,6 +140,11 @@ BN_CTX_free(BN_CTX *bctx)
 		bctx->bignums[i] = NULL;
 	}
 
+	while ((slab = bctx->slabs) != NULL) {
+		bctx->slabs = slab->next;
+		freezero(slab, slab->size);
+	}
+
 	free(bctx->bignums);
 	free(bctx->groups);
 
@@ -127,6 +187,14 @@ BN_CTX_get(BN_CTX *bctx)
 		}
 	}
 
+	if (bctx->bignums[bctx->index] == NULL && bctx->words > 0) {
+		if (!bn_ctx_slab_new(bctx)) {
+			BNerror(BN_R_TOO_MANY_TEMPORARY_VARIABLES);
+			bctx->error = 1;
+			return NULL;
+		}
+	}
+
 	if ((bn = bctx->bignums[bctx->index]) == NULL) {
 		if ((bn = BN_new()) == NULL) {
 			BNerror(BN_R_TOO_MANY_TEMPORARY_VARIABLES);
@@ -137,6 +205,8 @@ BN_CTX_get(BN_CTX *bctx)
 	}
 	bctx->groups[bctx->index] = bctx->group;
 	bctx->index++;
+	if (bctx->used < bctx->index)
+		bctx->used = bctx->index;
 
 	BN_zero(bn);
 
@@ -159,3 +229,124 @@ BN_CTX_end(BN_CTX *bctx)
 	bctx->group--;
 }
 LCRYPTO_ALIAS(BN_CTX_end);
+
+/*
+ * Size BIGNUMs that are added to the pool from now on for arithmetic modulo
+ * a number of the given size, so that double width products fit without
+ * being expanded.
+ */
+void
+bn_ctx_reserve(BN_CTX *bctx, int bits)
+{
+	int words;
+
+	if (bits <= 0 || bits > 16 * 1024)
+		return;
+
+	words = 2 * ((bits + BN_BITS2 - 1) / BN_BITS2) + 2;
+	if (bctx->words < words)
+		bctx->words = words;
+}
+
+/*
+ * Each thread keeps a few released contexts around, so that operations that
+ * acquire and release a context, such as RSA, DH and ECDSA, reuse their
+ * BIGNUMs and do not allocate once the pools have grown large enough. More
+ * than one context is kept since operations may be nested. Contexts are
+ * cleared when they are released and freed by the key destructor when the
+ * thread exits.
+ */
+#define BN_CTX_CACHE_LEN	4
+
+struct bn_ctx_cache {
+	BN_CTX *bctx[BN_CTX_CACHE_LEN];
+	size_t len;
+};
+
+static pthread_once_t bn_ctx_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t bn_ctx_cache_key;
+static int bn_ctx_cache_key_valid;
+
+static void
+bn_ctx_cache_key_destructor(void *arg)
+{
+	struct bn_ctx_cache *cache = arg;
+
+	while (cache->len > 0)
+		BN_CTX_free(cache->bctx[--cache->len]);
+	free(cache);
+}
+
+static void
+bn_ctx_cache_key_init(void)
+{
+	if (pthread_key_create(&bn_ctx_cache_key,
+	    bn_ctx_cache_key_destructor) == 0)
+		bn_ctx_cache_key_valid = 1;
+}
+
+static struct bn_ctx_cache *
+bn_ctx_cache_get(void)
+{
+	struct bn_ctx_cache *cache;
+
+	if (pthread_once(&bn_ctx_cache_once, bn_ctx_cache_key_init) != 0)
+		return NULL;
+	if (!bn_ctx_cache_key_valid)
+		return NULL;
+
+	if ((cache = pthread_getspecific(bn_ctx_cache_key)) != NULL)
+		return cache;
+
+	if ((cache = calloc(1, sizeof(*cache))) == NULL)
+		return NULL;
+	if (pthread_setspecific(bn_ctx_cache_key, cache) != 0) {
+		free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+/*
+ * Return a context for arithmetic modulo a number of the given size, which
+ * must be released with bn_ctx_release().
+ */
+BN_CTX *
+bn_ctx_acquire(int bits)
+{
+	struct bn_ctx_cache *cache;
+	BN_CTX *bctx;
+
+	if ((cache = bn_ctx_cache_get()) != NULL && cache->len > 0)
+		bctx = cache->bctx[--cache->len];
+	else if ((bctx = BN_CTX_new()) == NULL)
+		return NULL;
+
+	bn_ctx_reserve(bctx, bits);
+
+	return bctx;
+}
+
+void
+bn_ctx_release(BN_CTX *bctx)
+{
+	struct bn_ctx_cache *cache;
+	size_t i;
+
+	if (bctx == NULL)
+		return;
+
+	if (bctx->error || bctx->group != 0 ||
+	    (cache = bn_ctx_cache_get()) == NULL ||
+	    cache->len == BN_CTX_CACHE_LEN) {
+		BN_CTX_free(bctx);
+		return;
+	}
+
+	for (i = 0; i < bctx->used; i++)
+		BN_clear(bctx->bignums[i]);
+	bctx->used = 0;
+
+	cache->bctx[cache->len++] = bctx;
+}
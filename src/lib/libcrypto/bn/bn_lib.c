@@ -89,6 +89,21 @@ BN_init(BIGNUM *a)
 	memset(a, 0, sizeof(BIGNUM));
 }
 
+/*
+ * Initialise a BIGNUM that uses the given words until it needs more than
+ * nwords, after which it moves to the heap. The words must remain valid
+ * until the BIGNUM is freed.
+ */
+void
+bn_init_inline(BIGNUM *bn, BN_ULONG *words, int nwords)
+{
+	memset(words, 0, nwords * sizeof(words[0]));
+	memset(bn, 0, sizeof(*bn));
+	bn->d = words;
+	bn->dmax = nwords;
+	bn->flags = BN_FLG_INLINE_DATA;
+}
+
 void
 BN_clear(BIGNUM *a)
 {
@@ -105,7 +120,9 @@ BN_free(BIGNUM *bn)
 	if (bn == NULL)
 		return;
 
-	if (!BN_get_flags(bn, BN_FLG_STATIC_DATA))
+	if (BN_get_flags(bn, BN_FLG_INLINE_DATA))
+		explicit_bzero(bn->d, bn->dmax * sizeof(bn->d[0]));
+	else if (!BN_get_flags(bn, BN_FLG_STATIC_DATA))
 		freezero(bn->d, bn->dmax * sizeof(bn->d[0]));
 
 	if (!BN_get_flags(bn, BN_FLG_MALLOCED)) {
@@ -144,7 +161,8 @@ BN_with_flags(BIGNUM *dest, const BIGNUM *b, int flags)
 	int dest_flags;
 
 	dest_flags = (dest->flags & BN_FLG_MALLOCED) |
-	    (b->flags & ~BN_FLG_MALLOCED) | BN_FLG_STATIC_DATA | flags;
+	    (b->flags & ~(BN_FLG_MALLOCED | BN_FLG_INLINE_DATA)) |
+	    BN_FLG_STATIC_DATA | flags;
 
 	*dest = *b;
 	dest->flags = dest_flags;
@@ -207,10 +225,20 @@ bn_expand_internal(BIGNUM *bn, int words)
 		return 0;
 	}
 
-	d = recallocarray(bn->d, bn->dmax, words, sizeof(BN_ULONG));
-	if (d == NULL) {
-		BNerror(ERR_R_MALLOC_FAILURE);
-		return 0;
+	if (BN_get_flags(bn, BN_FLG_INLINE_DATA)) {
+		if ((d = calloc(words, sizeof(BN_ULONG))) == NULL) {
+			BNerror(ERR_R_MALLOC_FAILURE);
+			return 0;
+		}
+		memcpy(d, bn->d, bn->dmax * sizeof(BN_ULONG));
+		explicit_bzero(bn->d, bn->dmax * sizeof(BN_ULONG));
+		bn->flags &= ~BN_FLG_INLINE_DATA;
+	} else {
+		d = recallocarray(bn->d, bn->dmax, words, sizeof(BN_ULONG));
+		if (d == NULL) {
+			BNerror(ERR_R_MALLOC_FAILURE);
+			return 0;
+		}
 	}
 	bn->d = d;
 	bn->dmax = words;
@@ -310,7 +338,6 @@ BN_swap(BIGNUM *a, BIGNUM *b)
 	BN_ULONG *tmp_d;
 	int tmp_top, tmp_dmax, tmp_neg;
 
-
 	flags_old_a = a->flags;
 	flags_old_b = b->flags;
 
@@ -329,10 +356,14 @@ BN_swap(BIGNUM *a, BIGNUM *b)
 	b->dmax = tmp_dmax;
 	b->neg = tmp_neg;
 
+	/*
+	 * Inline words move with the value, so that swapping never has to
+	 * allocate. They remain owned by whatever provided them.
+	 */
 	a->flags = (flags_old_a & BN_FLG_MALLOCED) |
-	    (flags_old_b & BN_FLG_STATIC_DATA);
+	    (flags_old_b & (BN_FLG_STATIC_DATA | BN_FLG_INLINE_DATA));
 	b->flags = (flags_old_b & BN_FLG_MALLOCED) |
-	    (flags_old_a & BN_FLG_STATIC_DATA);
+	    (flags_old_a & (BN_FLG_STATIC_DATA | BN_FLG_INLINE_DATA));
 }
 LCRYPTO_ALIAS(BN_swap);
 
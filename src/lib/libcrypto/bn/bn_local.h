@@ -127,6 +127,15 @@ struct bignum_st {
 	int flags;
 };
 
+/*
+ * The words of a BIGNUM with BN_FLG_INLINE_DATA are provided by whatever
+ * owns the BIGNUM, such as an enclosing structure or a BN_CTX, and are
+ * never freed. Expanding such a BIGNUM moves its value to the heap, while
+ * BN_swap() hands the words to the other BIGNUM, which must then not be
+ * used after their owner is gone.
+ */
+#define BN_FLG_INLINE_DATA	0x10
+
 struct bn_mont_ctx_st {
 	int ri;		/* Number of bits in R */
 	BIGNUM RR;	/* Used to convert to Montgomery form */
@@ -277,6 +286,11 @@ int BN_bntest_rand(BIGNUM *rnd, int bits, int top, int bottom);
 int bn_rand_interval(BIGNUM *rnd, const BIGNUM *lower_inc, const BIGNUM *upper_exc);
 
 void	BN_init(BIGNUM *);
+void	bn_init_inline(BIGNUM *bn, BN_ULONG *words, int nwords);
+
+BN_CTX *bn_ctx_acquire(int bits);
+void	bn_ctx_release(BN_CTX *bctx);
+void	bn_ctx_reserve(BN_CTX *bctx, int bits);
 
 int	BN_reciprocal(BIGNUM *r, const BIGNUM *m, int len, BN_CTX *ctx);
 
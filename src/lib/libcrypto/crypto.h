@@ -357,6 +357,7 @@ void CRYPTO_cleanup_all_ex_data(void);
 void CRYPTO_lock(int mode, int type, const char *file, int line);
 int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
     int line);
+uint64_t CRYPTO_lock_contention(int type);
 
 /* Don't use this structure directly. */
 typedef struct crypto_threadid_st {
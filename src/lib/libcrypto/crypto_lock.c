@@ -1,6 +1,7 @@
 /* $OpenBSD: crypto_lock.c,v 1.6 2023/07/08 08:28:23 beck Exp $ */
 /*
  * Copyright (c) 2018 Brent Cook <bcook@openbsd.org>
+ * Copyright (c) 2026 agent <agent@local>
  *
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,53 +17,69 @@
  */
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 #include <openssl/crypto.h>
 
 #include "crypto_internal.h"
 
-static pthread_mutex_t locks[] = {
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
-	PTHREAD_MUTEX_INITIALIZER,
+/*
+ * Each lock is a reader-writer lock, so that CRYPTO_r_lock() callers that
+ * only look things up no longer exclude each other. Nothing may be modified
+ * under a read lock, including lazily sorted stacks and lookup statistics.
+ * A lock is first tried without blocking, and every acquisition that had to
+ * wait is counted.
+ */
+struct crypto_lock {
+	pthread_rwlock_t rwlock;
+	_Atomic uint64_t contended;
+};
+
+#define CRYPTO_LOCK_INITIALIZER	{ PTHREAD_RWLOCK_INITIALIZER, 0 }
+
+static struct crypto_lock locks[] = {
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
+	CRYPTO_LOCK_INITIALIZER,
 };
 
 CTASSERT((sizeof(locks) / sizeof(*locks)) == CRYPTO_NUM_LOCKS);
@@ -70,27 +87,55 @@ CTASSERT((sizeof(locks) / sizeof(*locks)) == CRYPTO_NUM_LOCKS);
 void
 CRYPTO_lock(int mode, int type, const char *file, int line)
 {
+	struct crypto_lock *lock;
+
 	if (type < 0 || type >= CRYPTO_NUM_LOCKS)
 		return;
 
-	if (mode & CRYPTO_LOCK)
-		(void) pthread_mutex_lock(&locks[type]);
-	else if (mode & CRYPTO_UNLOCK)
-		(void) pthread_mutex_unlock(&locks[type]);
+	lock = &locks[type];
+
+	if (mode & CRYPTO_LOCK) {
+		if (mode & CRYPTO_READ) {
+			if (pthread_rwlock_tryrdlock(&lock->rwlock) == 0)
+				return;
+			atomic_fetch_add_explicit(&lock->contended, 1,
+			    memory_order_relaxed);
+			(void) pthread_rwlock_rdlock(&lock->rwlock);
+		} else {
+			if (pthread_rwlock_trywrlock(&lock->rwlock) == 0)
+				return;
+			atomic_fetch_add_explicit(&lock->contended, 1,
+			    memory_order_relaxed);
+			(void) pthread_rwlock_wrlock(&lock->rwlock);
+		}
+	} else if (mode & CRYPTO_UNLOCK)
+		(void) pthread_rwlock_unlock(&lock->rwlock);
 }
 LCRYPTO_ALIAS(CRYPTO_lock);
 
+uint64_t
+CRYPTO_lock_contention(int type)
+{
+	if (type < 0 || type >= CRYPTO_NUM_LOCKS)
+		return 0;
+
+	return atomic_load_explicit(&locks[type].contended,
+	    memory_order_relaxed);
+}
+LCRYPTO_ALIAS(CRYPTO_lock_contention);
+
+/*
+ * Reference counts do not need the lock at all. The pointer comes from the
+ * public API as a plain int, which has the same representation as an
+ * atomic int on all supported platforms.
+ */
+CTASSERT(sizeof(atomic_int) == sizeof(int));
+
 int
 CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
     int line)
 {
-	int ret;
-
-	CRYPTO_lock(CRYPTO_LOCK|CRYPTO_WRITE, type, file, line);
-	ret = *pointer + amount;
-	*pointer = ret;
-	CRYPTO_lock(CRYPTO_UNLOCK|CRYPTO_WRITE, type, file, line);
-
-	return (ret);
+	return atomic_fetch_add_explicit((atomic_int *)pointer, amount,
+	    memory_order_acq_rel) + amount;
 }
 LCRYPTO_ALIAS(CRYPTO_add_lock);
@@ -256,7 +256,7 @@ DH_check_pub_key(const DH *dh, const BIGNUM *pub_key, int *flags)
 
 	*flags = 0;
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((ctx = bn_ctx_acquire(BN_num_bits(dh->p))) == NULL)
 		goto err;
 	BN_CTX_start(ctx);
 	if ((max_pub_key = BN_CTX_get(ctx)) == NULL)
@@ -296,7 +296,7 @@ DH_check_pub_key(const DH *dh, const BIGNUM *pub_key, int *flags)
 
  err:
 	BN_CTX_end(ctx);
-	BN_CTX_free(ctx);
+	bn_ctx_release(ctx);
 
 	return ok;
 }
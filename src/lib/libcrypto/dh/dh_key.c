@@ -116,7 +116,7 @@ generate_key(DH *dh)
 		return 0;
 	}
 
-	ctx = BN_CTX_new();
+	ctx = bn_ctx_acquire(BN_num_bits(dh->p));
 	if (ctx == NULL)
 		goto err;
 
@@ -168,7 +168,7 @@ generate_key(DH *dh)
 		BN_free(pub_key);
 	if (dh->priv_key == NULL)
 		BN_free(priv_key);
-	BN_CTX_free(ctx);
+	bn_ctx_release(ctx);
 	BN_free(two);
 	return ok;
 }
@@ -187,7 +187,7 @@ compute_key(unsigned char *key, const BIGNUM *pub_key, DH *dh)
 		goto err;
 	}
 
-	ctx = BN_CTX_new();
+	ctx = bn_ctx_acquire(BN_num_bits(dh->p));
 	if (ctx == NULL)
 		goto err;
 	BN_CTX_start(ctx);
@@ -224,7 +224,7 @@ compute_key(unsigned char *key, const BIGNUM *pub_key, DH *dh)
  err:
 	if (ctx != NULL) {
 		BN_CTX_end(ctx);
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	}
 	return ret;
 }
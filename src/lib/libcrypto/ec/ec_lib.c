@@ -550,6 +550,16 @@ EC_GROUP_get_curve_GFp(const EC_GROUP *group, BIGNUM *p, BIGNUM *a, BIGNUM *b,
 	return EC_GROUP_get_curve(group, p, a, b, ctx);
 }
 
+/*
+ * Contexts for point arithmetic that are not passed in by the caller come
+ * from the per-thread cache and are sized for the field of the group.
+ */
+BN_CTX *
+ec_ctx_acquire(const EC_GROUP *group)
+{
+	return bn_ctx_acquire(BN_num_bits(&group->field));
+}
+
 int
 EC_GROUP_get_degree(const EC_GROUP *group)
 {
@@ -796,7 +806,7 @@ EC_POINT_set_Jprojective_coordinates(const EC_GROUP *group, EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -821,7 +831,7 @@ EC_POINT_set_Jprojective_coordinates(const EC_GROUP *group, EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -834,7 +844,7 @@ EC_POINT_get_Jprojective_coordinates(const EC_GROUP *group,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -851,7 +861,7 @@ EC_POINT_get_Jprojective_coordinates(const EC_GROUP *group,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -878,7 +888,7 @@ EC_POINT_set_affine_coordinates(const EC_GROUP *group, EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -902,7 +912,7 @@ EC_POINT_set_affine_coordinates(const EC_GROUP *group, EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -923,7 +933,7 @@ EC_POINT_get_affine_coordinates(const EC_GROUP *group, const EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -939,7 +949,7 @@ EC_POINT_get_affine_coordinates(const EC_GROUP *group, const EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -960,7 +970,7 @@ EC_POINT_add(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -977,7 +987,7 @@ EC_POINT_add(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -991,7 +1001,7 @@ EC_POINT_dbl(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1007,7 +1017,7 @@ EC_POINT_dbl(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1020,7 +1030,7 @@ EC_POINT_invert(const EC_GROUP *group, EC_POINT *a, BN_CTX *ctx_in)
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1036,7 +1046,7 @@ EC_POINT_invert(const EC_GROUP *group, EC_POINT *a, BN_CTX *ctx_in)
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1065,7 +1075,7 @@ EC_POINT_is_on_curve(const EC_GROUP *group, const EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1081,7 +1091,7 @@ EC_POINT_is_on_curve(const EC_GROUP *group, const EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1095,7 +1105,7 @@ EC_POINT_cmp(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *b,
 	int ret = -1;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1111,7 +1121,7 @@ EC_POINT_cmp(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *b,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1124,7 +1134,7 @@ EC_POINT_make_affine(const EC_GROUP *group, EC_POINT *point, BN_CTX *ctx_in)
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1140,7 +1150,7 @@ EC_POINT_make_affine(const EC_GROUP *group, EC_POINT *point, BN_CTX *ctx_in)
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1155,7 +1165,7 @@ EC_POINTs_make_affine(const EC_GROUP *group, size_t num, EC_POINT *points[],
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1173,7 +1183,7 @@ EC_POINTs_make_affine(const EC_GROUP *group, size_t num, EC_POINT *points[],
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1188,7 +1198,7 @@ EC_POINTs_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1215,7 +1225,7 @@ EC_POINTs_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -1229,7 +1239,7 @@ EC_POINT_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *g_scalar,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -1277,7 +1287,7 @@ EC_POINT_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *g_scalar,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
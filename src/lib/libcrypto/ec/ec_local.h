@@ -242,6 +242,9 @@ struct ec_key_st {
 	CRYPTO_EX_DATA ex_data;
 } /* EC_KEY */;
 
+/* Coordinates of points on curves up to 521 bits fit without expanding. */
+#define EC_POINT_INLINE_WORDS	((521 + BN_BITS2 - 1) / BN_BITS2 + 2)
+
 struct ec_point_st {
 	const EC_METHOD *meth;
 
@@ -258,6 +261,9 @@ struct ec_point_st {
 	BIGNUM Y;
 	BIGNUM Z;
 	int Z_is_one; /* enable optimized point arithmetics for special case */
+
+	/* Inline words for X, Y and Z, so that points need no more mallocs. */
+	BN_ULONG words[3][EC_POINT_INLINE_WORDS];
 } /* EC_POINT */;
 
 /* method functions in ec_mult.c
@@ -341,6 +347,8 @@ struct ec_key_method_st {
 
 #define EC_KEY_METHOD_DYNAMIC   1
 
+BN_CTX *ec_ctx_acquire(const EC_GROUP *group);
+
 int ec_key_gen(EC_KEY *eckey);
 int ecdh_compute_key(void *out, size_t outlen, const EC_POINT *pub_key, EC_KEY *ecdh,
     void *(*KDF) (const void *in, size_t inlen, void *out, size_t *outlen));
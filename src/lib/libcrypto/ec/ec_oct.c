@@ -78,7 +78,7 @@ EC_POINT_set_compressed_coordinates(const EC_GROUP *group, EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -95,7 +95,7 @@ EC_POINT_set_compressed_coordinates(const EC_GROUP *group, EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -117,7 +117,7 @@ EC_POINT_point2oct(const EC_GROUP *group, const EC_POINT *point,
 	size_t ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -133,7 +133,7 @@ EC_POINT_point2oct(const EC_GROUP *group, const EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
@@ -147,7 +147,7 @@ EC_POINT_oct2point(const EC_GROUP *group, EC_POINT *point,
 	int ret = 0;
 
 	if ((ctx = ctx_in) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL)
 		goto err;
 
@@ -163,7 +163,7 @@ EC_POINT_oct2point(const EC_GROUP *group, EC_POINT *point,
 
  err:
 	if (ctx != ctx_in)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 
 	return ret;
 }
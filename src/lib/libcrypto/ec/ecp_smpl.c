@@ -272,9 +272,9 @@ ec_GFp_simple_group_check_discriminant(const EC_GROUP *group, BN_CTX *ctx)
 int
 ec_GFp_simple_point_init(EC_POINT * point)
 {
-	BN_init(&point->X);
-	BN_init(&point->Y);
-	BN_init(&point->Z);
+	bn_init_inline(&point->X, point->words[0], EC_POINT_INLINE_WORDS);
+	bn_init_inline(&point->Y, point->words[1], EC_POINT_INLINE_WORDS);
+	bn_init_inline(&point->Z, point->words[2], EC_POINT_INLINE_WORDS);
 	point->Z_is_one = 0;
 
 	return 1;
@@ -165,7 +165,10 @@ ecdh_compute_key(void *out, size_t outlen, const EC_POINT *pub_key, EC_KEY *ecdh
 		return -1;
 	}
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((group = EC_KEY_get0_group(ecdh)) == NULL)
+		return -1;
+
+	if ((ctx = ec_ctx_acquire(group)) == NULL)
 		goto err;
 
 	BN_CTX_start(ctx);
@@ -173,9 +176,6 @@ ecdh_compute_key(void *out, size_t outlen, const EC_POINT *pub_key, EC_KEY *ecdh
 	if ((x = BN_CTX_get(ctx)) == NULL)
 		goto err;
 
-	if ((group = EC_KEY_get0_group(ecdh)) == NULL)
-		goto err;
-
 	if (EC_POINT_is_on_curve(group, pub_key, ctx) <= 0)
 		goto err;
 
@@ -233,7 +233,7 @@ ecdh_compute_key(void *out, size_t outlen, const EC_POINT *pub_key, EC_KEY *ecdh
  err:
 	EC_POINT_free(point);
 	BN_CTX_end(ctx);
-	BN_CTX_free(ctx);
+	bn_ctx_release(ctx);
 	free(buf);
 
 	return ret;
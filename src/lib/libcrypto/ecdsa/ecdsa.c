@@ -284,7 +284,7 @@ ecdsa_sign_setup(EC_KEY *key, BN_CTX *in_ctx, BIGNUM **out_kinv, BIGNUM **out_r)
 		goto err;
 
 	if ((ctx = in_ctx) == NULL)
-		ctx = BN_CTX_new();
+		ctx = ec_ctx_acquire(group);
 	if (ctx == NULL) {
 		ECerror(ERR_R_MALLOC_FAILURE);
 		goto err;
@@ -383,7 +383,7 @@ ecdsa_sign_setup(EC_KEY *key, BN_CTX *in_ctx, BIGNUM **out_kinv, BIGNUM **out_r)
  err:
 	BN_CTX_end(ctx);
 	if (ctx != in_ctx)
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	BN_free(k);
 	BN_free(r);
 	EC_POINT_free(point);
@@ -516,6 +516,7 @@ ECDSA_SIG *
 ecdsa_sign_sig(const unsigned char *digest, int digest_len,
     const BIGNUM *in_kinv, const BIGNUM *in_r, EC_KEY *key)
 {
+	const EC_GROUP *group;
 	BN_CTX *ctx = NULL;
 	BIGNUM *kinv = NULL, *r = NULL, *s = NULL;
 	BIGNUM *e;
@@ -523,7 +524,11 @@ ecdsa_sign_sig(const unsigned char *digest, int digest_len,
 	int attempts = 0;
 	ECDSA_SIG *sig = NULL;
 
-	if ((ctx = BN_CTX_new()) == NULL) {
+	if ((group = EC_KEY_get0_group(key)) == NULL) {
+		ECerror(ERR_R_PASSED_NULL_PARAMETER);
+		goto err;
+	}
+	if ((ctx = ec_ctx_acquire(group)) == NULL) {
 		ECerror(ERR_R_MALLOC_FAILURE);
 		goto err;
 	}
@@ -597,7 +602,7 @@ ecdsa_sign_sig(const unsigned char *digest, int digest_len,
 
  err:
 	BN_CTX_end(ctx);
-	BN_CTX_free(ctx);
+	bn_ctx_release(ctx);
 	BN_free(kinv);
 	BN_free(r);
 	BN_free(s);
@@ -667,7 +672,7 @@ ecdsa_verify_sig(const unsigned char *digest, int digest_len,
 		goto err;
 	}
 
-	if ((ctx = BN_CTX_new()) == NULL) {
+	if ((ctx = ec_ctx_acquire(group)) == NULL) {
 		ECerror(ERR_R_MALLOC_FAILURE);
 		goto err;
 	}
@@ -749,7 +754,7 @@ ecdsa_verify_sig(const unsigned char *digest, int digest_len,
 
  err:
 	BN_CTX_end(ctx);
-	BN_CTX_free(ctx);
+	bn_ctx_release(ctx);
 	EC_POINT_free(point);
 
 	return ret;
@@ -286,6 +286,18 @@ static int int_err_library_number = ERR_LIB_USER;
 
 static pthread_t err_init_thread;
 
+/*
+ * With the default implementation, each thread's ERR_STATE lives in
+ * thread-specific data and is freed by the key destructor when the thread
+ * exits, so that neither lookups nor the first error in a thread need to
+ * take CRYPTO_LOCK_ERR. The thread hash is only used if an implementation
+ * has been installed with ERR_set_implementation() or if the key could not
+ * be created.
+ */
+static pthread_once_t err_state_once = PTHREAD_ONCE_INIT;
+static pthread_key_t err_state_key;
+static int err_state_key_valid;
+
 /* Internal function that checks whether "err_fns" is set and if not, sets it to
  * the defaults. */
 static void
@@ -462,7 +474,7 @@ LHASH_OF(ERR_STATE) *int_thread_get(int create)
 		CRYPTO_pop_info();
 	}
 	if (int_thread_hash) {
-		int_thread_hash_references++;
+		CRYPTO_add(&int_thread_hash_references, 1, CRYPTO_LOCK_ERR);
 		ret = int_thread_hash;
 	}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ERR);
@@ -659,6 +671,49 @@ ERR_STATE_free(ERR_STATE *s)
 	free(s);
 }
 
+static void
+err_state_key_destructor(void *arg)
+{
+	ERR_STATE_free(arg);
+}
+
+static void
+err_state_key_init(void)
+{
+	if (pthread_key_create(&err_state_key, err_state_key_destructor) == 0)
+		err_state_key_valid = 1;
+}
+
+static int
+err_state_use_key(void)
+{
+	if (err_fns != &err_defaults)
+		return 0;
+	if (pthread_once(&err_state_once, err_state_key_init) != 0)
+		return 0;
+
+	return err_state_key_valid;
+}
+
+static ERR_STATE *
+err_state_new(const CRYPTO_THREADID *tid)
+{
+	ERR_STATE *es;
+	int i;
+
+	if ((es = malloc(sizeof(*es))) == NULL)
+		return NULL;
+	CRYPTO_THREADID_cpy(&es->tid, tid);
+	es->top = 0;
+	es->bottom = 0;
+	for (i = 0; i < ERR_NUM_ERRORS; i++) {
+		es->err_data[i] = NULL;
+		es->err_data_flags[i] = 0;
+	}
+
+	return es;
+}
+
 void
 ERR_load_ERR_strings_internal(void)
 {
@@ -1053,13 +1108,30 @@ LCRYPTO_ALIAS(ERR_reason_error_string);
 void
 ERR_remove_thread_state(const CRYPTO_THREADID *id)
 {
-	ERR_STATE tmp;
+	ERR_STATE *es, tmp;
+	CRYPTO_THREADID tid;
 
+	CRYPTO_THREADID_current(&tid);
 	if (id)
 		CRYPTO_THREADID_cpy(&tmp.tid, id);
 	else
-		CRYPTO_THREADID_current(&tmp.tid);
+		CRYPTO_THREADID_cpy(&tmp.tid, &tid);
 	err_fns_check();
+
+	/*
+	 * Thread-specific state can only be removed by its own thread, the
+	 * state of other threads is freed when they exit.
+	 */
+	if (err_state_use_key()) {
+		if (CRYPTO_THREADID_cmp(&tmp.tid, &tid) != 0)
+			return;
+		if ((es = pthread_getspecific(err_state_key)) != NULL) {
+			pthread_setspecific(err_state_key, NULL);
+			ERR_STATE_free(es);
+		}
+		return;
+	}
+
 	/* thread_del_item automatically destroys the LHASH if the number of
 	 * items reaches zero. */
 	ERRFN(thread_del_item)(&tmp);
@@ -1078,26 +1150,32 @@ ERR_get_state(void)
 {
 	static ERR_STATE fallback;
 	ERR_STATE *ret, tmp, *tmpp = NULL;
-	int i;
 	CRYPTO_THREADID tid;
 
 	err_fns_check();
+
+	if (err_state_use_key()) {
+		if ((ret = pthread_getspecific(err_state_key)) != NULL)
+			return ret;
+		CRYPTO_THREADID_current(&tid);
+		if ((ret = err_state_new(&tid)) == NULL)
+			return (&fallback);
+		if (pthread_setspecific(err_state_key, ret) != 0) {
+			ERR_STATE_free(ret);
+			return (&fallback);
+		}
+		return ret;
+	}
+
 	CRYPTO_THREADID_current(&tid);
 	CRYPTO_THREADID_cpy(&tmp.tid, &tid);
 	ret = ERRFN(thread_get_item)(&tmp);
 
 	/* ret == the error state, if NULL, make a new one */
 	if (ret == NULL) {
-		ret = malloc(sizeof(ERR_STATE));
+		ret = err_state_new(&tid);
 		if (ret == NULL)
 			return (&fallback);
-		CRYPTO_THREADID_cpy(&ret->tid, &tid);
-		ret->top = 0;
-		ret->bottom = 0;
-		for (i = 0; i < ERR_NUM_ERRORS; i++) {
-			ret->err_data[i] = NULL;
-			ret->err_data_flags[i] = 0;
-		}
 		tmpp = ERRFN(thread_set_item)(ret);
 		/* To check if insertion failed, do a get. */
 		if (ERRFN(thread_get_item)(ret) != ret) {
@@ -123,6 +123,92 @@ conv_ascii2bin(unsigned char a)
 	return data_ascii2bin[a];
 }
 
+/*
+ * Like data_ascii2bin, but everything that is not in the base64 alphabet,
+ * including padding and white space, maps to B64_ERROR.
+ */
+static const unsigned char data_ascii2bin_strict[128] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,
+	0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+	0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20,
+	0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+	0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static unsigned char
+conv_ascii2bin_strict(unsigned char a)
+{
+	return data_ascii2bin_strict[a & 0x7f] | (a & 0x80);
+}
+
+/*
+ * Decode complete lines of 64 base64 characters without padding, as found
+ * in the body of PEM files, directly from the input. For such lines this
+ * gives the same result as passing each character through the context.
+ * Returns the number of input bytes consumed and stops at the first line
+ * that does not have this form. Output may overlap input that has already
+ * been consumed, since PEM_read_bio() decodes in place.
+ */
+static int
+evp_decode_lines(unsigned char *out, int *outl, const unsigned char *in,
+    int inl)
+{
+	unsigned char buf[48], *p;
+	const unsigned char *f;
+	unsigned long a, b, c, d, l, bad;
+	int consumed = 0, eol, i;
+
+	*outl = 0;
+
+	while (inl - consumed > 64) {
+		f = &in[consumed];
+
+		if (f[64] == '\n')
+			eol = 1;
+		else if (f[64] == '\r' && inl - consumed > 65 && f[65] == '\n')
+			eol = 2;
+		else
+			break;
+
+		bad = 0;
+		p = buf;
+		for (i = 0; i < 64; i += 4) {
+			a = conv_ascii2bin_strict(f[i]);
+			b = conv_ascii2bin_strict(f[i + 1]);
+			c = conv_ascii2bin_strict(f[i + 2]);
+			d = conv_ascii2bin_strict(f[i + 3]);
+			bad |= a | b | c | d;
+			l = (a << 18) | (b << 12) | (c << 6) | d;
+			p[0] = (l >> 16) & 0xff;
+			p[1] = (l >> 8) & 0xff;
+			p[2] = l & 0xff;
+			p += 3;
+		}
+		if ((bad & 0x80) != 0)
+			break;
+
+		memcpy(out, buf, sizeof(buf));
+		out += sizeof(buf);
+		*outl += sizeof(buf);
+		consumed += 64 + eol;
+	}
+
+	explicit_bzero(buf, sizeof(buf));
+
+	return consumed;
+}
+
 EVP_ENCODE_CTX *
 EVP_ENCODE_CTX_new(void)
 {
@@ -252,7 +338,7 @@ int
 EVP_DecodeUpdate(EVP_ENCODE_CTX *ctx, unsigned char *out, int *outl,
     const unsigned char *in, int inl)
 {
-	int seof = 0, eof = 0, rv = -1, ret = 0, i, v, tmp, n, decoded_len;
+	int seof = 0, eof = 0, rv = -1, ret = 0, i, j, v, tmp, n, decoded_len;
 	unsigned char *d;
 
 	n = ctx->num;
@@ -271,6 +357,17 @@ EVP_DecodeUpdate(EVP_ENCODE_CTX *ctx, unsigned char *out, int *outl,
 	}
 
 	for (i = 0; i < inl; i++) {
+		/* Take whole lines at once if nothing is buffered. */
+		if (n == 0 && eof == 0 && (i == 0 || in[-1] == '\n')) {
+			j = evp_decode_lines(out, &decoded_len, in, inl - i);
+			in += j;
+			i += j;
+			out += decoded_len;
+			ret += decoded_len;
+			if (i == inl)
+				break;
+		}
+
 		tmp = *(in++);
 		v = conv_ascii2bin(tmp);
 		if (v == B64_ERROR) {
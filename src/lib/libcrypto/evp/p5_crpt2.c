@@ -67,8 +67,10 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 
+#include "crypto_internal.h"
 #include "evp_local.h"
 #include "hmac_local.h"
 
@@ -78,6 +80,226 @@
  * <pgut001@cs.auckland.ac.nz> to the PKCS-TNG <pkcs-tng@rsa.com> mailing list.
  */
 
+/*
+ * Nearly all of the time spent in PBKDF2 goes into iterations that
+ * authenticate a single digest. With HMAC-SHA256 and HMAC-SHA512 such an
+ * iteration is exactly one compression of an inner and one of an outer
+ * block, so these run directly on the hash state with the padding of both
+ * blocks prepared once, instead of going through the EVP and HMAC layers.
+ */
+
+#ifndef OPENSSL_NO_SHA256
+static void
+pbkdf2_hmac_sha256_pads(const char *pass, int passlen, SHA256_CTX *ictx,
+    SHA256_CTX *octx)
+{
+	unsigned char key[SHA256_CBLOCK], pad[SHA256_CBLOCK];
+	int i;
+
+	memset(key, 0, sizeof(key));
+	if (passlen > SHA256_CBLOCK)
+		SHA256((const unsigned char *)pass, passlen, key);
+	else if (passlen > 0)
+		memcpy(key, pass, passlen);
+
+	for (i = 0; i < SHA256_CBLOCK; i++)
+		pad[i] = key[i] ^ 0x36;
+	SHA256_Init(ictx);
+	SHA256_Update(ictx, pad, sizeof(pad));
+
+	for (i = 0; i < SHA256_CBLOCK; i++)
+		pad[i] = key[i] ^ 0x5c;
+	SHA256_Init(octx);
+	SHA256_Update(octx, pad, sizeof(pad));
+
+	explicit_bzero(key, sizeof(key));
+	explicit_bzero(pad, sizeof(pad));
+}
+
+static int
+pbkdf2_hmac_sha256(const char *pass, int passlen, const unsigned char *salt,
+    int saltlen, int iter, int keylen, unsigned char *out)
+{
+	SHA256_CTX ictx, octx, ctx;
+	unsigned char block[SHA256_CBLOCK], digest[SHA256_DIGEST_LENGTH];
+	unsigned char itmp[4];
+	SHA_LONG acc[8];
+	unsigned long i = 1;
+	int cplen, j, k;
+
+	/* Like HMAC_Init_ex(), require a key. */
+	if (pass == NULL || passlen < 0 || saltlen < 0)
+		return 0;
+
+	pbkdf2_hmac_sha256_pads(pass, passlen, &ictx, &octx);
+
+	/* A digest followed by the padding of a message of two blocks. */
+	memset(block, 0, sizeof(block));
+	block[SHA256_DIGEST_LENGTH] = 0x80;
+	crypto_store_htobe32(&block[SHA256_CBLOCK - 4],
+	    (SHA256_CBLOCK + SHA256_DIGEST_LENGTH) * 8);
+
+	while (keylen > 0) {
+		cplen = keylen;
+		if (cplen > SHA256_DIGEST_LENGTH)
+			cplen = SHA256_DIGEST_LENGTH;
+
+		itmp[0] = (unsigned char)((i >> 24) & 0xff);
+		itmp[1] = (unsigned char)((i >> 16) & 0xff);
+		itmp[2] = (unsigned char)((i >> 8) & 0xff);
+		itmp[3] = (unsigned char)(i & 0xff);
+
+		ctx = ictx;
+		SHA256_Update(&ctx, salt, saltlen);
+		SHA256_Update(&ctx, itmp, sizeof(itmp));
+		SHA256_Final(digest, &ctx);
+		ctx = octx;
+		SHA256_Update(&ctx, digest, sizeof(digest));
+		SHA256_Final(block, &ctx);
+
+		for (k = 0; k < 8; k++)
+			acc[k] = crypto_load_be32toh(&block[k * 4]);
+
+		for (j = 1; j < iter; j++) {
+			memcpy(ctx.h, ictx.h, sizeof(ctx.h));
+			SHA256_Transform(&ctx, block);
+			for (k = 0; k < 8; k++)
+				crypto_store_htobe32(&block[k * 4], ctx.h[k]);
+
+			memcpy(ctx.h, octx.h, sizeof(ctx.h));
+			SHA256_Transform(&ctx, block);
+			for (k = 0; k < 8; k++) {
+				crypto_store_htobe32(&block[k * 4], ctx.h[k]);
+				acc[k] ^= ctx.h[k];
+			}
+		}
+
+		for (k = 0; k < 8; k++)
+			crypto_store_htobe32(&digest[k * 4], acc[k]);
+		memcpy(out, digest, cplen);
+
+		keylen -= cplen;
+		out += cplen;
+		i++;
+	}
+
+	explicit_bzero(&ictx, sizeof(ictx));
+	explicit_bzero(&octx, sizeof(octx));
+	explicit_bzero(&ctx, sizeof(ctx));
+	explicit_bzero(block, sizeof(block));
+	explicit_bzero(digest, sizeof(digest));
+	explicit_bzero(acc, sizeof(acc));
+
+	return 1;
+}
+#endif
+
+#ifndef OPENSSL_NO_SHA512
+static void
+pbkdf2_hmac_sha512_pads(const char *pass, int passlen, SHA512_CTX *ictx,
+    SHA512_CTX *octx)
+{
+	unsigned char key[SHA512_CBLOCK], pad[SHA512_CBLOCK];
+	int i;
+
+	memset(key, 0, sizeof(key));
+	if (passlen > SHA512_CBLOCK)
+		SHA512((const unsigned char *)pass, passlen, key);
+	else if (passlen > 0)
+		memcpy(key, pass, passlen);
+
+	for (i = 0; i < SHA512_CBLOCK; i++)
+		pad[i] = key[i] ^ 0x36;
+	SHA512_Init(ictx);
+	SHA512_Update(ictx, pad, sizeof(pad));
+
+	for (i = 0; i < SHA512_CBLOCK; i++)
+		pad[i] = key[i] ^ 0x5c;
+	SHA512_Init(octx);
+	SHA512_Update(octx, pad, sizeof(pad));
+
+	explicit_bzero(key, sizeof(key));
+	explicit_bzero(pad, sizeof(pad));
+}
+
+static int
+pbkdf2_hmac_sha512(const char *pass, int passlen, const unsigned char *salt,
+    int saltlen, int iter, int keylen, unsigned char *out)
+{
+	SHA512_CTX ictx, octx, ctx;
+	unsigned char block[SHA512_CBLOCK], digest[SHA512_DIGEST_LENGTH];
+	unsigned char itmp[4];
+	SHA_LONG64 acc[8];
+	unsigned long i = 1;
+	int cplen, j, k;
+
+	/* Like HMAC_Init_ex(), require a key. */
+	if (pass == NULL || passlen < 0 || saltlen < 0)
+		return 0;
+
+	pbkdf2_hmac_sha512_pads(pass, passlen, &ictx, &octx);
+
+	/* A digest followed by the padding of a message of two blocks. */
+	memset(block, 0, sizeof(block));
+	block[SHA512_DIGEST_LENGTH] = 0x80;
+	crypto_store_htobe64(&block[SHA512_CBLOCK - 8],
+	    (SHA512_CBLOCK + SHA512_DIGEST_LENGTH) * 8);
+
+	while (keylen > 0) {
+		cplen = keylen;
+		if (cplen > SHA512_DIGEST_LENGTH)
+			cplen = SHA512_DIGEST_LENGTH;
+
+		itmp[0] = (unsigned char)((i >> 24) & 0xff);
+		itmp[1] = (unsigned char)((i >> 16) & 0xff);
+		itmp[2] = (unsigned char)((i >> 8) & 0xff);
+		itmp[3] = (unsigned char)(i & 0xff);
+
+		ctx = ictx;
+		SHA512_Update(&ctx, salt, saltlen);
+		SHA512_Update(&ctx, itmp, sizeof(itmp));
+		SHA512_Final(digest, &ctx);
+		ctx = octx;
+		SHA512_Update(&ctx, digest, sizeof(digest));
+		SHA512_Final(block, &ctx);
+
+		for (k = 0; k < 8; k++)
+			acc[k] = crypto_load_be64toh(&block[k * 8]);
+
+		for (j = 1; j < iter; j++) {
+			memcpy(ctx.h, ictx.h, sizeof(ctx.h));
+			SHA512_Transform(&ctx, block);
+			for (k = 0; k < 8; k++)
+				crypto_store_htobe64(&block[k * 8], ctx.h[k]);
+
+			memcpy(ctx.h, octx.h, sizeof(ctx.h));
+			SHA512_Transform(&ctx, block);
+			for (k = 0; k < 8; k++) {
+				crypto_store_htobe64(&block[k * 8], ctx.h[k]);
+				acc[k] ^= ctx.h[k];
+			}
+		}
+
+		for (k = 0; k < 8; k++)
+			crypto_store_htobe64(&digest[k * 8], acc[k]);
+		memcpy(out, digest, cplen);
+
+		keylen -= cplen;
+		out += cplen;
+		i++;
+	}
+
+	explicit_bzero(&ictx, sizeof(ictx));
+	explicit_bzero(&octx, sizeof(octx));
+	explicit_bzero(&ctx, sizeof(ctx));
+	explicit_bzero(block, sizeof(block));
+	explicit_bzero(digest, sizeof(digest));
+	explicit_bzero(acc, sizeof(acc));
+
+	return 1;
+}
+#endif
+
 int
 PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
     int saltlen, int iter, const EVP_MD *digest, int keylen, unsigned char *out)
@@ -85,23 +307,34 @@ PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
 	unsigned char digtmp[EVP_MAX_MD_SIZE], *p, itmp[4];
 	int cplen, j, k, tkeylen, mdlen;
 	unsigned long i = 1;
-	HMAC_CTX hctx_tpl, hctx;
+	HMAC_CTX hctx;
+	int ret = 0;
 
 	mdlen = EVP_MD_size(digest);
 	if (mdlen < 0)
 		return 0;
 
-	HMAC_CTX_init(&hctx_tpl);
+	HMAC_CTX_init(&hctx);
 	p = out;
 	tkeylen = keylen;
 	if (!pass)
 		passlen = 0;
 	else if (passlen == -1)
 		passlen = strlen(pass);
-	if (!HMAC_Init_ex(&hctx_tpl, pass, passlen, digest, NULL)) {
-		HMAC_CTX_cleanup(&hctx_tpl);
-		return 0;
-	}
+
+#ifndef OPENSSL_NO_SHA256
+	if (EVP_MD_type(digest) == NID_sha256)
+		return pbkdf2_hmac_sha256(pass, passlen, salt, saltlen, iter,
+		    keylen, out);
+#endif
+#ifndef OPENSSL_NO_SHA512
+	if (EVP_MD_type(digest) == NID_sha512)
+		return pbkdf2_hmac_sha512(pass, passlen, salt, saltlen, iter,
+		    keylen, out);
+#endif
+
+	if (!HMAC_Init_ex(&hctx, pass, passlen, digest, NULL))
+		goto err;
 	while (tkeylen) {
 		if (tkeylen > mdlen)
 			cplen = mdlen;
@@ -114,31 +347,22 @@ PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
 		itmp[1] = (unsigned char)((i >> 16) & 0xff);
 		itmp[2] = (unsigned char)((i >> 8) & 0xff);
 		itmp[3] = (unsigned char)(i & 0xff);
-		if (!HMAC_CTX_copy(&hctx, &hctx_tpl)) {
-			HMAC_CTX_cleanup(&hctx_tpl);
-			return 0;
-		}
-		if (!HMAC_Update(&hctx, salt, saltlen) ||
+		/*
+		 * Restarting the context reuses the inner and outer pad states
+		 * of the password, so iterations neither hash the key again
+		 * nor allocate.
+		 */
+		if (!HMAC_Init_ex(&hctx, NULL, 0, NULL, NULL) ||
+		    !HMAC_Update(&hctx, salt, saltlen) ||
 		    !HMAC_Update(&hctx, itmp, 4) ||
-		    !HMAC_Final(&hctx, digtmp, NULL)) {
-			HMAC_CTX_cleanup(&hctx_tpl);
-			HMAC_CTX_cleanup(&hctx);
-			return 0;
-		}
-		HMAC_CTX_cleanup(&hctx);
+		    !HMAC_Final(&hctx, digtmp, NULL))
+			goto err;
 		memcpy(p, digtmp, cplen);
 		for (j = 1; j < iter; j++) {
-			if (!HMAC_CTX_copy(&hctx, &hctx_tpl)) {
-				HMAC_CTX_cleanup(&hctx_tpl);
-				return 0;
-			}
-			if (!HMAC_Update(&hctx, digtmp, mdlen) ||
-			    !HMAC_Final(&hctx, digtmp, NULL)) {
-				HMAC_CTX_cleanup(&hctx_tpl);
-				HMAC_CTX_cleanup(&hctx);
-				return 0;
-			}
-			HMAC_CTX_cleanup(&hctx);
+			if (!HMAC_Init_ex(&hctx, NULL, 0, NULL, NULL) ||
+			    !HMAC_Update(&hctx, digtmp, mdlen) ||
+			    !HMAC_Final(&hctx, digtmp, NULL))
+				goto err;
 			for (k = 0; k < cplen; k++)
 				p[k] ^= digtmp[k];
 		}
@@ -146,8 +370,14 @@ PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
 		i++;
 		p += cplen;
 	}
-	HMAC_CTX_cleanup(&hctx_tpl);
-	return 1;
+
+	ret = 1;
+
+ err:
+	HMAC_CTX_cleanup(&hctx);
+	explicit_bzero(digtmp, sizeof(digtmp));
+
+	return ret;
 }
 
 int
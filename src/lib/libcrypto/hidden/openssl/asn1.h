@@ -203,6 +203,18 @@ LCRYPTO_USED(ASN1_d2i_bio);
 LCRYPTO_USED(ASN1_item_d2i_bio);
 LCRYPTO_USED(ASN1_i2d_bio);
 LCRYPTO_USED(ASN1_item_i2d_bio);
+LCRYPTO_USED(ASN1_STREAM_new);
+LCRYPTO_USED(ASN1_STREAM_free);
+LCRYPTO_USED(ASN1_STREAM_set_max_element);
+LCRYPTO_USED(ASN1_STREAM_get_depth);
+LCRYPTO_USED(ASN1_STREAM_peek);
+LCRYPTO_USED(ASN1_STREAM_enter);
+LCRYPTO_USED(ASN1_STREAM_leave);
+LCRYPTO_USED(ASN1_STREAM_skip);
+LCRYPTO_USED(ASN1_STREAM_d2i);
+LCRYPTO_USED(ASN1_ARENA_new);
+LCRYPTO_USED(ASN1_ARENA_free);
+LCRYPTO_USED(ASN1_item_d2i_arena);
 LCRYPTO_USED(ASN1_UTCTIME_print);
 LCRYPTO_USED(ASN1_GENERALIZEDTIME_print);
 LCRYPTO_USED(ASN1_TIME_print);
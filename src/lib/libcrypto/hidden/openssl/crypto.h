@@ -41,6 +41,7 @@ LCRYPTO_USED(CRYPTO_get_ex_data);
 LCRYPTO_USED(CRYPTO_cleanup_all_ex_data);
 LCRYPTO_USED(CRYPTO_lock);
 LCRYPTO_USED(CRYPTO_add_lock);
+LCRYPTO_USED(CRYPTO_lock_contention);
 LCRYPTO_USED(CRYPTO_THREADID_current);
 LCRYPTO_USED(CRYPTO_THREADID_cmp);
 LCRYPTO_USED(CRYPTO_THREADID_cpy);
@@ -48,6 +48,7 @@ LCRYPTO_USED(OCSP_request_add1_cert);
 LCRYPTO_USED(OCSP_request_sign);
 LCRYPTO_USED(OCSP_response_status);
 LCRYPTO_USED(OCSP_response_get1_basic);
+LCRYPTO_USED(OCSP_response_get0_basic_arena);
 LCRYPTO_USED(OCSP_resp_get0_signature);
 LCRYPTO_USED(OCSP_resp_get0_tbs_sigalg);
 LCRYPTO_USED(OCSP_resp_get0_respdata);
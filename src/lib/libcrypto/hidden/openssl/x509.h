@@ -27,6 +27,13 @@
 
 LCRYPTO_USED(X509_CRL_up_ref);
 LCRYPTO_USED(i2d_re_X509_CRL_tbs);
+LCRYPTO_USED(X509_CRL_INDEX_new);
+LCRYPTO_USED(X509_CRL_INDEX_load_file);
+LCRYPTO_USED(X509_CRL_INDEX_write_bio);
+LCRYPTO_USED(X509_CRL_INDEX_up_ref);
+LCRYPTO_USED(X509_CRL_INDEX_free);
+LCRYPTO_USED(X509_CRL_INDEX_lookup);
+LCRYPTO_USED(X509_CRL_set1_index);
 LCRYPTO_USED(X509_get_X509_PUBKEY);
 LCRYPTO_USED(X509_verify_cert_error_string);
 LCRYPTO_USED(X509_verify);
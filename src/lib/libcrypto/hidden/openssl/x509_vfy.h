@@ -26,6 +26,7 @@
 #include "crypto_namespace.h"
 
 LCRYPTO_USED(X509_STORE_set_depth);
+LCRYPTO_USED(X509_STORE_set_chain_cache_size);
 LCRYPTO_USED(X509_STORE_CTX_set_depth);
 LCRYPTO_USED(X509_OBJECT_new);
 LCRYPTO_USED(X509_OBJECT_free);
@@ -52,6 +53,7 @@ LCRYPTO_USED(X509_STORE_set_verify_cb);
 LCRYPTO_USED(X509_STORE_get_check_issued);
 LCRYPTO_USED(X509_STORE_set_check_issued);
 LCRYPTO_USED(X509_STORE_CTX_get_check_issued);
+LCRYPTO_USED(X509_STORE_set_dispatch);
 LCRYPTO_USED(X509_STORE_CTX_new);
 LCRYPTO_USED(X509_STORE_CTX_get1_issuer);
 LCRYPTO_USED(X509_STORE_CTX_free);
@@ -70,6 +72,12 @@ LCRYPTO_USED(X509_STORE_add_lookup);
 LCRYPTO_USED(X509_LOOKUP_hash_dir);
 LCRYPTO_USED(X509_LOOKUP_file);
 LCRYPTO_USED(X509_LOOKUP_mem);
+LCRYPTO_USED(X509_LOOKUP_index);
+LCRYPTO_USED(X509_LOOKUP_write_index);
+LCRYPTO_USED(X509_issuer_cache_set_max);
+LCRYPTO_USED(X509_issuer_cache_set_shard_max);
+LCRYPTO_USED(X509_issuer_cache_shards);
+LCRYPTO_USED(X509_issuer_cache_stats);
 LCRYPTO_USED(X509_STORE_add_cert);
 LCRYPTO_USED(X509_STORE_add_crl);
 LCRYPTO_USED(X509_STORE_CTX_get_by_subject);
@@ -139,6 +147,10 @@ LCRYPTO_USED(X509_VERIFY_PARAM_set_time);
 LCRYPTO_USED(X509_VERIFY_PARAM_add0_policy);
 LCRYPTO_USED(X509_VERIFY_PARAM_set1_policies);
 LCRYPTO_USED(X509_VERIFY_PARAM_get_depth);
+LCRYPTO_USED(X509_VERIFY_PARAM_set_max_signatures);
+LCRYPTO_USED(X509_VERIFY_PARAM_get_max_signatures);
+LCRYPTO_USED(X509_VERIFY_PARAM_set_max_chains);
+LCRYPTO_USED(X509_VERIFY_PARAM_get_max_chains);
 LCRYPTO_USED(X509_VERIFY_PARAM_set1_host);
 LCRYPTO_USED(X509_VERIFY_PARAM_add1_host);
 LCRYPTO_USED(X509_VERIFY_PARAM_set_hostflags);
@@ -24,29 +24,9 @@
 #include "evp_local.h"
 #include "hmac_local.h"
 
-/* https://tools.ietf.org/html/rfc5869#section-2 */
-int
-HKDF(uint8_t *out_key, size_t out_len, const EVP_MD *digest,
-    const uint8_t *secret, size_t secret_len, const uint8_t *salt,
-    size_t salt_len, const uint8_t *info, size_t info_len)
-{
-	uint8_t prk[EVP_MAX_MD_SIZE];
-	size_t prk_len;
-
-	if (!HKDF_extract(prk, &prk_len, digest, secret, secret_len, salt,
-	    salt_len))
-		return 0;
-	if (!HKDF_expand(out_key, out_len, digest, prk, prk_len, info,
-	    info_len))
-		return 0;
-
-	return 1;
-}
-LCRYPTO_ALIAS(HKDF);
-
 /* https://tools.ietf.org/html/rfc5869#section-2.2 */
-int
-HKDF_extract(uint8_t *out_key, size_t *out_len,
+static int
+hkdf_extract(HMAC_CTX *hmac, uint8_t *out_key, size_t *out_len,
     const EVP_MD *digest, const uint8_t *secret, size_t secret_len,
     const uint8_t *salt, size_t salt_len)
 {
@@ -54,21 +34,28 @@ HKDF_extract(uint8_t *out_key, size_t *out_len,
 
 	/*
 	 * If salt is not given, HashLength zeros are used. However, HMAC does
-	 * that internally already so we can ignore it.
+	 * that internally already so an empty key can be used instead.
 	 */
-	if (HMAC(digest, salt, salt_len, secret, secret_len, out_key, &len) ==
-	    NULL) {
+	if (salt == NULL) {
+		salt = (const uint8_t *)"";
+		salt_len = 0;
+	}
+
+	if (!HMAC_Init_ex(hmac, salt, salt_len, digest, NULL) ||
+	    !HMAC_Update(hmac, secret, secret_len) ||
+	    !HMAC_Final(hmac, out_key, &len)) {
 		CRYPTOerror(ERR_R_CRYPTO_LIB);
 		return 0;
 	}
+
 	*out_len = len;
+
 	return 1;
 }
-LCRYPTO_ALIAS(HKDF_extract);
 
 /* https://tools.ietf.org/html/rfc5869#section-2.3 */
-int
-HKDF_expand(uint8_t *out_key, size_t out_len,
+static int
+hkdf_expand(HMAC_CTX *hmac, uint8_t *out_key, size_t out_len,
     const EVP_MD *digest, const uint8_t *prk, size_t prk_len,
     const uint8_t *info, size_t info_len)
 {
@@ -77,7 +64,6 @@ HKDF_expand(uint8_t *out_key, size_t out_len,
 	size_t n, done = 0;
 	unsigned int i;
 	int ret = 0;
-	HMAC_CTX hmac;
 
 	/* Expand key material to desired length. */
 	n = (out_len + digest_len - 1) / digest_len;
@@ -86,21 +72,24 @@ HKDF_expand(uint8_t *out_key, size_t out_len,
 		return 0;
 	}
 
-	HMAC_CTX_init(&hmac);
-	if (!HMAC_Init_ex(&hmac, prk, prk_len, digest, NULL))
+	/*
+	 * The pad states for the PRK are computed once, each block restarts
+	 * the context from them.
+	 */
+	if (!HMAC_Init_ex(hmac, prk, prk_len, digest, NULL))
 		goto out;
 
 	for (i = 0; i < n; i++) {
 		uint8_t ctr = i + 1;
 		size_t todo;
 
-		if (i != 0 && (!HMAC_Init_ex(&hmac, NULL, 0, NULL, NULL) ||
-		    !HMAC_Update(&hmac, previous, digest_len)))
+		if (i != 0 && (!HMAC_Init_ex(hmac, NULL, 0, NULL, NULL) ||
+		    !HMAC_Update(hmac, previous, digest_len)))
 			goto out;
 
-		if (!HMAC_Update(&hmac, info, info_len) ||
-		    !HMAC_Update(&hmac, &ctr, 1) ||
-		    !HMAC_Final(&hmac, previous, NULL))
+		if (!HMAC_Update(hmac, info, info_len) ||
+		    !HMAC_Update(hmac, &ctr, 1) ||
+		    !HMAC_Final(hmac, previous, NULL))
 			goto out;
 
 		todo = digest_len;
@@ -114,10 +103,74 @@ HKDF_expand(uint8_t *out_key, size_t out_len,
 	ret = 1;
 
  out:
-	HMAC_CTX_cleanup(&hmac);
 	explicit_bzero(previous, sizeof(previous));
 	if (ret != 1)
 		CRYPTOerror(ERR_R_CRYPTO_LIB);
+
+	return ret;
+}
+
+/* https://tools.ietf.org/html/rfc5869#section-2 */
+int
+HKDF(uint8_t *out_key, size_t out_len, const EVP_MD *digest,
+    const uint8_t *secret, size_t secret_len, const uint8_t *salt,
+    size_t salt_len, const uint8_t *info, size_t info_len)
+{
+	uint8_t prk[EVP_MAX_MD_SIZE];
+	size_t prk_len;
+	HMAC_CTX hmac;
+	int ret = 0;
+
+	/* Extract and expand share the digest state of one context. */
+	HMAC_CTX_init(&hmac);
+
+	if (!hkdf_extract(&hmac, prk, &prk_len, digest, secret, secret_len,
+	    salt, salt_len))
+		goto err;
+	if (!hkdf_expand(&hmac, out_key, out_len, digest, prk, prk_len, info,
+	    info_len))
+		goto err;
+
+	ret = 1;
+
+ err:
+	HMAC_CTX_cleanup(&hmac);
+	explicit_bzero(prk, sizeof(prk));
+
+	return ret;
+}
+LCRYPTO_ALIAS(HKDF);
+
+int
+HKDF_extract(uint8_t *out_key, size_t *out_len,
+    const EVP_MD *digest, const uint8_t *secret, size_t secret_len,
+    const uint8_t *salt, size_t salt_len)
+{
+	HMAC_CTX hmac;
+	int ret;
+
+	HMAC_CTX_init(&hmac);
+	ret = hkdf_extract(&hmac, out_key, out_len, digest, secret, secret_len,
+	    salt, salt_len);
+	HMAC_CTX_cleanup(&hmac);
+
+	return ret;
+}
+LCRYPTO_ALIAS(HKDF_extract);
+
+int
+HKDF_expand(uint8_t *out_key, size_t out_len,
+    const EVP_MD *digest, const uint8_t *prk, size_t prk_len,
+    const uint8_t *info, size_t info_len)
+{
+	HMAC_CTX hmac;
+	int ret;
+
+	HMAC_CTX_init(&hmac);
+	ret = hkdf_expand(&hmac, out_key, out_len, digest, prk, prk_len, info,
+	    info_len);
+	HMAC_CTX_cleanup(&hmac);
+
 	return ret;
 }
 LCRYPTO_ALIAS(HKDF_expand);
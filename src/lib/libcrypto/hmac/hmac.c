@@ -220,14 +220,19 @@ HMAC_CTX_init(HMAC_CTX *ctx)
 	ctx->md = NULL;
 }
 
+/*
+ * The destination must have been initialised. If it uses the same digest as
+ * the source, its digest state is overwritten in place, so that copying a
+ * keyed template into a work context for each message does not allocate.
+ */
 int
 HMAC_CTX_copy(HMAC_CTX *dctx, HMAC_CTX *sctx)
 {
-	if (!EVP_MD_CTX_copy(&dctx->i_ctx, &sctx->i_ctx))
+	if (!EVP_MD_CTX_copy_ex(&dctx->i_ctx, &sctx->i_ctx))
 		goto err;
-	if (!EVP_MD_CTX_copy(&dctx->o_ctx, &sctx->o_ctx))
+	if (!EVP_MD_CTX_copy_ex(&dctx->o_ctx, &sctx->o_ctx))
 		goto err;
-	if (!EVP_MD_CTX_copy(&dctx->md_ctx, &sctx->md_ctx))
+	if (!EVP_MD_CTX_copy_ex(&dctx->md_ctx, &sctx->md_ctx))
 		goto err;
 	memcpy(dctx->key, sctx->key, HMAC_MAX_MD_CBLOCK);
 	dctx->key_length = sctx->key_length;
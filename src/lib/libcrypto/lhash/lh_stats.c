@@ -67,6 +67,16 @@
 #endif
 #include <openssl/lhash.h>
 
+#include "lhash_local.h"
+
+/* Number of slots probed to find the entry in slot i. */
+static unsigned int
+lh_probe_length(const _LHASH *lh, unsigned int i)
+{
+	return ((i - lh_home(lh, lh_mix(lh->b[i].hash))) &
+	    (lh->num_nodes - 1)) + 1;
+}
+
 #ifdef OPENSSL_NO_BIO
 
 void
@@ -74,7 +84,7 @@ lh_stats(LHASH *lh, FILE *out)
 {
 	fprintf(out, "num_items             = %lu\n", lh->num_items);
 	fprintf(out, "num_nodes             = %u\n", lh->num_nodes);
-	fprintf(out, "num_alloc_nodes       = %u\n", lh->num_alloc_nodes);
+	fprintf(out, "num_deleted           = %u\n", lh->num_deleted);
 	fprintf(out, "num_expands           = %lu\n", lh->num_expands);
 	fprintf(out, "num_expand_reallocs   = %lu\n", lh->num_expand_reallocs);
 	fprintf(out, "num_contracts         = %lu\n", lh->num_contracts);
@@ -90,8 +100,6 @@ lh_stats(LHASH *lh, FILE *out)
 	fprintf(out, "num_retrieve_miss     = %lu\n", lh->num_retrieve_miss);
 	fprintf(out, "num_hash_comps        = %lu\n", lh->num_hash_comps);
 #if 0
-	fprintf(out, "p                     = %u\n", lh->p);
-	fprintf(out, "pmax                  = %u\n", lh->pmax);
 	fprintf(out, "up_load               = %lu\n", lh->up_load);
 	fprintf(out, "down_load             = %lu\n", lh->down_load);
 #endif
@@ -101,13 +109,13 @@ LCRYPTO_ALIAS(lh_stats);
 void
 lh_node_stats(LHASH *lh, FILE *out)
 {
-	LHASH_NODE *n;
-	unsigned int i, num;
+	unsigned int i;
 
 	for (i = 0; i < lh->num_nodes; i++) {
-		for (n = lh->b[i], num = 0; n != NULL; n = n->next)
-			num++;
-		fprintf(out, "node %6u -> %3u\n", i, num);
+		if (!LH_CTRL_IS_FULL(lh->ctrl[i]))
+			continue;
+		fprintf(out, "node %6u -> probe %3u\n", i,
+		    lh_probe_length(lh, i));
 	}
 }
 LCRYPTO_ALIAS(lh_node_stats);
@@ -115,26 +123,22 @@ LCRYPTO_ALIAS(lh_node_stats);
 void
 lh_node_usage_stats(LHASH *lh, FILE *out)
 {
-	LHASH_NODE *n;
-	unsigned long num;
-	unsigned int i;
 	unsigned long total = 0, n_used = 0;
+	unsigned int i;
 
 	for (i = 0; i < lh->num_nodes; i++) {
-		for (n = lh->b[i], num = 0; n != NULL; n = n->next)
-			num++;
-		if (num != 0) {
-			n_used++;
-			total += num;
-		}
+		if (!LH_CTRL_IS_FULL(lh->ctrl[i]))
+			continue;
+		n_used++;
+		total += lh_probe_length(lh, i);
 	}
 	fprintf(out, "%lu nodes used out of %u\n", n_used, lh->num_nodes);
-	fprintf(out, "%lu items\n", total);
+	fprintf(out, "%lu items\n", n_used);
 	if (n_used == 0)
 		return;
-	fprintf(out, "load %d.%02d  actual load %d.%02d\n",
-	    (int)(total / lh->num_nodes),
-	    (int)((total % lh->num_nodes) * 100 / lh->num_nodes),
+	fprintf(out, "load %d.%02d  average probe %d.%02d\n",
+	    (int)(n_used / lh->num_nodes),
+	    (int)((n_used % lh->num_nodes) * 100 / lh->num_nodes),
 	    (int)(total / n_used),
 	    (int)((total % n_used) * 100 / n_used));
 }
@@ -193,7 +197,7 @@ lh_stats_bio(const _LHASH *lh, BIO *out)
 {
 	BIO_printf(out, "num_items             = %lu\n", lh->num_items);
 	BIO_printf(out, "num_nodes             = %u\n", lh->num_nodes);
-	BIO_printf(out, "num_alloc_nodes       = %u\n", lh->num_alloc_nodes);
+	BIO_printf(out, "num_deleted           = %u\n", lh->num_deleted);
 	BIO_printf(out, "num_expands           = %lu\n", lh->num_expands);
 	BIO_printf(out, "num_expand_reallocs   = %lu\n",
 	    lh->num_expand_reallocs);
@@ -210,8 +214,6 @@ lh_stats_bio(const _LHASH *lh, BIO *out)
 	BIO_printf(out, "num_retrieve_miss     = %lu\n", lh->num_retrieve_miss);
 	BIO_printf(out, "num_hash_comps        = %lu\n", lh->num_hash_comps);
 #if 0
-	BIO_printf(out, "p                     = %u\n", lh->p);
-	BIO_printf(out, "pmax                  = %u\n", lh->pmax);
 	BIO_printf(out, "up_load               = %lu\n", lh->up_load);
 	BIO_printf(out, "down_load             = %lu\n", lh->down_load);
 #endif
@@ -221,13 +223,13 @@ LCRYPTO_ALIAS(lh_stats_bio);
 void
 lh_node_stats_bio(const _LHASH *lh, BIO *out)
 {
-	LHASH_NODE *n;
-	unsigned int i, num;
+	unsigned int i;
 
 	for (i = 0; i < lh->num_nodes; i++) {
-		for (n = lh->b[i], num = 0; n != NULL; n = n->next)
-			num++;
-		BIO_printf(out, "node %6u -> %3u\n", i, num);
+		if (!LH_CTRL_IS_FULL(lh->ctrl[i]))
+			continue;
+		BIO_printf(out, "node %6u -> probe %3u\n", i,
+		    lh_probe_length(lh, i));
 	}
 }
 LCRYPTO_ALIAS(lh_node_stats_bio);
@@ -235,26 +237,22 @@ LCRYPTO_ALIAS(lh_node_stats_bio);
 void
 lh_node_usage_stats_bio(const _LHASH *lh, BIO *out)
 {
-	LHASH_NODE *n;
-	unsigned long num;
-	unsigned int i;
 	unsigned long total = 0, n_used = 0;
+	unsigned int i;
 
 	for (i = 0; i < lh->num_nodes; i++) {
-		for (n = lh->b[i], num = 0; n != NULL; n = n->next)
-			num++;
-		if (num != 0) {
-			n_used++;
-			total += num;
-		}
+		if (!LH_CTRL_IS_FULL(lh->ctrl[i]))
+			continue;
+		n_used++;
+		total += lh_probe_length(lh, i);
 	}
 	BIO_printf(out, "%lu nodes used out of %u\n", n_used, lh->num_nodes);
-	BIO_printf(out, "%lu items\n", total);
+	BIO_printf(out, "%lu items\n", n_used);
 	if (n_used == 0)
 		return;
-	BIO_printf(out, "load %d.%02d  actual load %d.%02d\n",
-	    (int)(total / lh->num_nodes),
-	    (int)((total % lh->num_nodes) * 100 / lh->num_nodes),
+	BIO_printf(out, "load %d.%02d  average probe %d.%02d\n",
+	    (int)(n_used / lh->num_nodes),
+	    (int)((n_used % lh->num_nodes) * 100 / lh->num_nodes),
 	    (int)(total / n_used),
 	    (int)((total % n_used) * 100 / n_used));
 }
@@ -94,6 +94,7 @@
  *
  * 1.0 eay - First version
  */
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -103,14 +104,116 @@
 #include <openssl/crypto.h>
 #include <openssl/lhash.h>
 
+#include "crypto_internal.h"
+#include "lhash_local.h"
+
+/*
+ * Open addressing with linear probing. Entries are stored inline with their
+ * full hash, so there is no allocation per entry and rehashing does not call
+ * the hash function. Deleted entries leave a tombstone behind, so that
+ * lh_delete() can be called from within lh_doall() without moving other
+ * entries; the table is only resized by lh_insert(), or by lh_delete() when
+ * no lh_doall() is in progress.
+ */
+
 #undef MIN_NODES
 #define MIN_NODES	16
-#define UP_LOAD		(2*LH_LOAD_MULT) /* load times 256  (default 2) */
-#define DOWN_LOAD	(LH_LOAD_MULT)   /* load times 256  (default 1) */
+#define UP_LOAD		(3*LH_LOAD_MULT/4) /* load times 256 (default 0.75) */
+#define DOWN_LOAD	(LH_LOAD_MULT/8)   /* load times 256 (default 0.125) */
+
+static int
+lh_resize(_LHASH *lh, unsigned int num_nodes)
+{
+	struct lhash_slot_st *b, *old_b = lh->b;
+	unsigned char *ctrl, *old_ctrl = lh->ctrl;
+	unsigned int i, j, old_num_nodes = lh->num_nodes;
+	uint32_t mixed;
+
+	if ((b = calloc(num_nodes, sizeof(*b))) == NULL)
+		return 0;
+	if ((ctrl = malloc(num_nodes)) == NULL) {
+		free(b);
+		return 0;
+	}
+	memset(ctrl, LH_CTRL_EMPTY, num_nodes);
+
+	lh->b = b;
+	lh->ctrl = ctrl;
+	lh->num_nodes = num_nodes;
+	lh->num_deleted = 0;
+
+	for (i = 0; i < old_num_nodes; i++) {
+		if (!LH_CTRL_IS_FULL(old_ctrl[i]))
+			continue;
+		mixed = lh_mix(old_b[i].hash);
+		for (j = lh_home(lh, mixed); ctrl[j] != LH_CTRL_EMPTY;
+		    j = (j + 1) & (num_nodes - 1))
+			;
+		ctrl[j] = lh_ctrl(mixed);
+		b[j] = old_b[i];
+	}
+
+	free(old_b);
+	free(old_ctrl);
+
+	return 1;
+}
+
+/*
+ * Statistics are also updated by lh_retrieve(), which callers run
+ * concurrently under a read lock, so they are counted atomically. The
+ * fields are plain integers in the public structure, which have the same
+ * representation as the atomic types on all supported platforms.
+ */
+CTASSERT(sizeof(atomic_ulong) == sizeof(unsigned long));
+CTASSERT(sizeof(atomic_int) == sizeof(int));
+
+#define LH_STAT_INC(stat) \
+	atomic_fetch_add_explicit((atomic_ulong *)&(stat), 1, \
+	    memory_order_relaxed)
+
+/*
+ * Returns the slot holding an entry equal to data, or -1. If a free slot is
+ * wanted, the first empty or deleted slot on the probe sequence is stored in
+ * *free_slot.
+ */
+static long
+lh_find(_LHASH *lh, const void *data, unsigned long hash, long *free_slot)
+{
+	unsigned int i, n, mask = lh->num_nodes - 1;
+	unsigned char c;
+	uint32_t mixed;
+
+	if (free_slot != NULL)
+		*free_slot = -1;
 
-static void expand(_LHASH *lh);
-static void contract(_LHASH *lh);
-static LHASH_NODE **getrn(_LHASH *lh, const void *data, unsigned long *rhash);
+	mixed = lh_mix(hash);
+	c = lh_ctrl(mixed);
+
+	for (i = lh_home(lh, mixed), n = 0; n < lh->num_nodes;
+	    i = (i + 1) & mask, n++) {
+		if (lh->ctrl[i] == LH_CTRL_EMPTY) {
+			if (free_slot != NULL && *free_slot == -1)
+				*free_slot = i;
+			break;
+		}
+		if (lh->ctrl[i] == LH_CTRL_DELETED) {
+			if (free_slot != NULL && *free_slot == -1)
+				*free_slot = i;
+			continue;
+		}
+		if (lh->ctrl[i] != c)
+			continue;
+		LH_STAT_INC(lh->num_hash_comps);
+		if (lh->b[i].hash != hash)
+			continue;
+		LH_STAT_INC(lh->num_comp_calls);
+		if (lh->comp(lh->b[i].data, data) == 0)
+			return i;
+	}
+
+	return -1;
+}
 
 _LHASH *
 lh_new(LHASH_HASH_FN_TYPE h, LHASH_COMP_FN_TYPE c)
@@ -119,15 +222,12 @@ lh_new(LHASH_HASH_FN_TYPE h, LHASH_COMP_FN_TYPE c)
 
 	if ((ret = calloc(1, sizeof(_LHASH))) == NULL)
 		return NULL;
-	if ((ret->b = calloc(MIN_NODES, sizeof(LHASH_NODE *))) == NULL) {
+	if (!lh_resize(ret, MIN_NODES)) {
 		free(ret);
 		return NULL;
 	}
 	ret->comp = ((c == NULL) ? (LHASH_COMP_FN_TYPE)strcmp : c);
 	ret->hash = ((h == NULL) ? (LHASH_HASH_FN_TYPE)lh_strhash : h);
-	ret->num_nodes = MIN_NODES / 2;
-	ret->num_alloc_nodes = MIN_NODES;
-	ret->pmax = MIN_NODES / 2;
 	ret->up_load = UP_LOAD;
 	ret->down_load = DOWN_LOAD;
 
@@ -138,21 +238,11 @@ LCRYPTO_ALIAS(lh_new);
 void
 lh_free(_LHASH *lh)
 {
-	unsigned int i;
-	LHASH_NODE *n, *nn;
-
 	if (lh == NULL)
 		return;
 
-	for (i = 0; i < lh->num_nodes; i++) {
-		n = lh->b[i];
-		while (n != NULL) {
-			nn = n->next;
-			free(n);
-			n = nn;
-		}
-	}
 	free(lh->b);
+	free(lh->ctrl);
 	free(lh);
 }
 LCRYPTO_ALIAS(lh_free);
@@ -161,37 +251,56 @@ void *
 lh_insert(_LHASH *lh, void *data)
 {
 	unsigned long hash;
-	LHASH_NODE *nn, **rn;
+	unsigned int num_nodes;
+	long i, free_slot;
 	void *ret;
 
 	lh->error = 0;
-	if (lh->up_load <= (lh->num_items * LH_LOAD_MULT / lh->num_nodes))
-		expand(lh);
 
-	rn = getrn(lh, data, &hash);
+	hash = lh->hash(data);
+	lh->num_hash_calls++;
 
-	if (*rn == NULL) {
-		if ((nn = malloc(sizeof(LHASH_NODE))) == NULL) {
-			lh->error++;
-			return (NULL);
+	if ((i = lh_find(lh, data, hash, &free_slot)) != -1) {
+		/* replace same key */
+		ret = lh->b[i].data;
+		lh->b[i].data = data;
+		lh->num_replace++;
+		return (ret);
+	}
+
+	/*
+	 * Grow the table, or just drop the tombstones, once the slots in use
+	 * exceed the maximum load. If this fails, carry on for as long as
+	 * there is still a free slot.
+	 */
+	if ((lh->num_items + lh->num_deleted + 1) * LH_LOAD_MULT >
+	    lh->up_load * lh->num_nodes) {
+		num_nodes = lh->num_nodes;
+		if ((lh->num_items + 1) * LH_LOAD_MULT * 2 >
+		    lh->up_load * num_nodes) {
+			num_nodes *= 2;
+			lh->num_expands++;
+		}
+		if (num_nodes != 0 && lh_resize(lh, num_nodes)) {
+			lh->num_expand_reallocs++;
+			lh_find(lh, data, hash, &free_slot);
 		}
-		nn->data = data;
-		nn->next = NULL;
-#ifndef OPENSSL_NO_HASH_COMP
-		nn->hash = hash;
-#endif
-		*rn = nn;
-		ret = NULL;
-		lh->num_insert++;
-		lh->num_items++;
 	}
-	else /* replace same key */
-	{
-		ret = (*rn)->data;
-		(*rn)->data = data;
-		lh->num_replace++;
+	if (free_slot == -1) {
+		lh->error++;
+		return (NULL);
 	}
-	return (ret);
+
+	if (lh->ctrl[free_slot] == LH_CTRL_DELETED)
+		lh->num_deleted--;
+	lh->ctrl[free_slot] = lh_ctrl(lh_mix(hash));
+	lh->b[free_slot].data = data;
+	lh->b[free_slot].hash = hash;
+
+	lh->num_insert++;
+	lh->num_items++;
+
+	return (NULL);
 }
 LCRYPTO_ALIAS(lh_insert);
 
@@ -199,27 +308,50 @@ void *
 lh_delete(_LHASH *lh, const void *data)
 {
 	unsigned long hash;
-	LHASH_NODE *nn, **rn;
+	unsigned int mask = lh->num_nodes - 1;
+	long i;
 	void *ret;
 
 	lh->error = 0;
-	rn = getrn(lh, data, &hash);
 
-	if (*rn == NULL) {
+	hash = lh->hash(data);
+	lh->num_hash_calls++;
+
+	if ((i = lh_find(lh, data, hash, NULL)) == -1) {
 		lh->num_no_delete++;
 		return (NULL);
-	} else {
-		nn= *rn;
-		*rn = nn->next;
-		ret = nn->data;
-		free(nn);
-		lh->num_delete++;
 	}
 
+	ret = lh->b[i].data;
+	lh->b[i].data = NULL;
+	lh->num_delete++;
 	lh->num_items--;
-	if ((lh->num_nodes > MIN_NODES) &&
-	    (lh->down_load >= (lh->num_items * LH_LOAD_MULT / lh->num_nodes)))
-		contract(lh);
+
+	/*
+	 * A tombstone is only needed if a probe sequence may continue past
+	 * this slot. If the next slot is empty, this one and any tombstones
+	 * before it can be emptied as well.
+	 */
+	if (lh->ctrl[(i + 1) & mask] == LH_CTRL_EMPTY) {
+		lh->ctrl[i] = LH_CTRL_EMPTY;
+		for (i = (i - 1) & mask; lh->ctrl[i] == LH_CTRL_DELETED;
+		    i = (i - 1) & mask) {
+			lh->ctrl[i] = LH_CTRL_EMPTY;
+			lh->num_deleted--;
+		}
+	} else {
+		lh->ctrl[i] = LH_CTRL_DELETED;
+		lh->num_deleted++;
+	}
+
+	if (lh->doall == 0 && lh->num_nodes > MIN_NODES &&
+	    lh->num_items * LH_LOAD_MULT < lh->down_load * lh->num_nodes) {
+		if (lh_resize(lh, lh->num_nodes / 2)) {
+			lh->num_contracts++;
+			lh->num_contract_reallocs++;
+		} else
+			lh->error++;
+	}
 
 	return (ret);
 }
@@ -229,20 +361,21 @@ void *
 lh_retrieve(_LHASH *lh, const void *data)
 {
 	unsigned long hash;
-	LHASH_NODE **rn;
-	void *ret;
+	long i;
 
-	lh->error = 0;
-	rn = getrn(lh, data, &hash);
+	atomic_store_explicit((atomic_int *)&lh->error, 0,
+	    memory_order_relaxed);
 
-	if (*rn == NULL) {
-		lh->num_retrieve_miss++;
+	hash = lh->hash(data);
+	LH_STAT_INC(lh->num_hash_calls);
+
+	if ((i = lh_find(lh, data, hash, NULL)) == -1) {
+		LH_STAT_INC(lh->num_retrieve_miss);
 		return (NULL);
-	} else {
-		ret = (*rn)->data;
-		lh->num_retrieve++;
 	}
-	return (ret);
+	LH_STAT_INC(lh->num_retrieve);
+
+	return (lh->b[i].data);
 }
 LCRYPTO_ALIAS(lh_retrieve);
 
@@ -250,29 +383,27 @@ static void
 doall_util_fn(_LHASH *lh, int use_arg, LHASH_DOALL_FN_TYPE func,
     LHASH_DOALL_ARG_FN_TYPE func_arg, void *arg)
 {
-	int i;
-	LHASH_NODE *a, *n;
+	unsigned int i;
+	void *data;
 
 	if (lh == NULL)
 		return;
 
-	/* reverse the order so we search from 'top to bottom'
-	 * We were having memory leaks otherwise */
-	for (i = lh->num_nodes - 1; i >= 0; i--) {
-		a = lh->b[i];
-		while (a != NULL) {
-			/* 28/05/91 - eay - n added so items can be deleted
-			 * via lh_doall */
-			/* 22/05/08 - ben - eh? since a is not passed,
-			 * this should not be needed */
-			n = a->next;
-			if (use_arg)
-				func_arg(a->data, arg);
-			else
-				func(a->data);
-			a = n;
-		}
+	/*
+	 * The callback may delete the entry it is given, which leaves all
+	 * other entries in place as long as the table is not contracted.
+	 */
+	lh->doall++;
+	for (i = lh->num_nodes; i-- > 0; ) {
+		if (i >= lh->num_nodes || !LH_CTRL_IS_FULL(lh->ctrl[i]))
+			continue;
+		data = lh->b[i].data;
+		if (use_arg)
+			func_arg(data, arg);
+		else
+			func(data);
 	}
+	lh->doall--;
 }
 
 void
@@ -289,124 +420,6 @@ lh_doall_arg(_LHASH *lh, LHASH_DOALL_ARG_FN_TYPE func, void *arg)
 }
 LCRYPTO_ALIAS(lh_doall_arg);
 
-static void
-expand(_LHASH *lh)
-{
-	LHASH_NODE **n, **n1, **n2, *np;
-	unsigned int p, i, j;
-	unsigned long hash, nni;
-
-	lh->num_nodes++;
-	lh->num_expands++;
-	p = (int)lh->p++;
-	n1 = &(lh->b[p]);
-	n2 = &(lh->b[p + (int)lh->pmax]);
-	*n2 = NULL;        /* 27/07/92 - eay - undefined pointer bug */
-	nni = lh->num_alloc_nodes;
-
-	for (np = *n1; np != NULL; ) {
-#ifndef OPENSSL_NO_HASH_COMP
-		hash = np->hash;
-#else
-		hash = lh->hash(np->data);
-		lh->num_hash_calls++;
-#endif
-		if ((hash % nni) != p) { /* move it */
-			*n1 = (*n1)->next;
-			np->next= *n2;
-			*n2 = np;
-		} else
-			n1 = &((*n1)->next);
-		np= *n1;
-	}
-
-	if ((lh->p) >= lh->pmax) {
-		j = (int)lh->num_alloc_nodes * 2;
-		n = reallocarray(lh->b, j, sizeof(LHASH_NODE *));
-		if (n == NULL) {
-/*			fputs("realloc error in lhash", stderr); */
-			lh->error++;
-			lh->p = 0;
-			return;
-		}
-		/* else */
-		for (i = (int)lh->num_alloc_nodes; i < j; i++)/* 26/02/92 eay */
-			n[i] = NULL;			  /* 02/03/92 eay */
-		lh->pmax = lh->num_alloc_nodes;
-		lh->num_alloc_nodes = j;
-		lh->num_expand_reallocs++;
-		lh->p = 0;
-		lh->b = n;
-	}
-}
-
-static void
-contract(_LHASH *lh)
-{
-	LHASH_NODE **n, *n1, *np;
-
-	np = lh->b[lh->p + lh->pmax - 1];
-	lh->b[lh->p+lh->pmax - 1] = NULL; /* 24/07-92 - eay - weird but :-( */
-	if (lh->p == 0) {
-		n = reallocarray(lh->b, lh->pmax, sizeof(LHASH_NODE *));
-		if (n == NULL) {
-/*			fputs("realloc error in lhash", stderr); */
-			lh->error++;
-			return;
-		}
-		lh->num_contract_reallocs++;
-		lh->num_alloc_nodes /= 2;
-		lh->pmax /= 2;
-		lh->p = lh->pmax - 1;
-		lh->b = n;
-	} else
-		lh->p--;
-
-	lh->num_nodes--;
-	lh->num_contracts++;
-
-	n1 = lh->b[(int)lh->p];
-	if (n1 == NULL)
-		lh->b[(int)lh->p] = np;
-	else {
-		while (n1->next != NULL)
-			n1 = n1->next;
-		n1->next = np;
-	}
-}
-
-static LHASH_NODE **getrn(_LHASH *lh, const void *data, unsigned long *rhash)
-{
-	LHASH_NODE **ret, *n1;
-	unsigned long hash, nn;
-	LHASH_COMP_FN_TYPE cf;
-
-	hash = (*(lh->hash))(data);
-	lh->num_hash_calls++;
-	*rhash = hash;
-
-	nn = hash % lh->pmax;
-	if (nn < lh->p)
-		nn = hash % lh->num_alloc_nodes;
-
-	cf = lh->comp;
-	ret = &(lh->b[(int)nn]);
-	for (n1 = *ret; n1 != NULL; n1 = n1->next) {
-#ifndef OPENSSL_NO_HASH_COMP
-		lh->num_hash_comps++;
-		if (n1->hash != hash) {
-			ret = &(n1->next);
-			continue;
-		}
-#endif
-		lh->num_comp_calls++;
-		if (cf(n1->data, data) == 0)
-			break;
-		ret = &(n1->next);
-	}
-	return (ret);
-}
-
 /* The following hash seems to work very well on normal text strings
  * no collisions on /usr/dict/words and it distributes on %2^n quite
  * well, not as good as MD5, but still good.
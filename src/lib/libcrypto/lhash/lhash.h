@@ -133,14 +133,16 @@ typedef void (*LHASH_DOALL_ARG_FN_TYPE)(void *, void *);
 		name##_doall_arg(a, b); }
 #define LHASH_DOALL_ARG_FN(name) name##_LHASH_DOALL_ARG
 
+struct lhash_slot_st;
+
 typedef struct lhash_st {
-	LHASH_NODE **b;
+	struct lhash_slot_st *b;
+	unsigned char *ctrl;
 	LHASH_COMP_FN_TYPE comp;
 	LHASH_HASH_FN_TYPE hash;
-	unsigned int num_nodes;
-	unsigned int num_alloc_nodes;
-	unsigned int p;
-	unsigned int pmax;
+	unsigned int num_nodes;		/* number of slots, a power of two */
+	unsigned int num_deleted;	/* slots holding a deleted entry */
+	unsigned int doall;		/* nesting level of lh_doall() */
 	unsigned long up_load; /* load times 256 */
 	unsigned long down_load; /* load times 256 */
 	unsigned long num_items;
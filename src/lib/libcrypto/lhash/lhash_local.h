@@ -0,0 +1,71 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef HEADER_LHASH_LOCAL_H
+#define HEADER_LHASH_LOCAL_H
+
+#include <stdint.h>
+
+#include <openssl/lhash.h>
+
+__BEGIN_HIDDEN_DECLS
+
+/*
+ * Each slot has a control byte. The high bit is set for empty and deleted
+ * slots, otherwise the low seven bits hold seven bits of the entry's hash,
+ * so that most probes that do not match are rejected without touching the
+ * slot itself.
+ */
+#define LH_CTRL_EMPTY		0x80
+#define LH_CTRL_DELETED		0xfe
+
+#define LH_CTRL_IS_FULL(c)	(((c) & 0x80) == 0)
+
+struct lhash_slot_st {
+	void *data;
+	unsigned long hash;
+};
+
+/*
+ * The hash functions in use vary a lot in quality, so the hash is mixed
+ * before picking the home slot (low bits) and the control byte (high bits).
+ */
+static inline uint32_t
+lh_mix(unsigned long hash)
+{
+	uint64_t h = hash;
+
+	h ^= h >> 32;
+
+	return (h * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+static inline unsigned int
+lh_home(const _LHASH *lh, uint32_t mixed)
+{
+	return mixed & (lh->num_nodes - 1);
+}
+
+static inline unsigned char
+lh_ctrl(uint32_t mixed)
+{
+	return mixed >> 25;
+}
+
+__END_HIDDEN_DECLS
+
+#endif /* HEADER_LHASH_LOCAL_H */
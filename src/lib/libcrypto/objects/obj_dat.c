@@ -58,6 +58,7 @@
 
 #include <ctype.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -74,16 +75,6 @@
 /* obj_dat.h is generated from objects.h by obj_dat.pl */
 #include "obj_dat.h"
 
-static int sn_cmp_BSEARCH_CMP_FN(const void *, const void *);
-static int sn_cmp(const ASN1_OBJECT * const *, unsigned int const *);
-static unsigned int *OBJ_bsearch_sn(const ASN1_OBJECT * *key, unsigned int const *base, int num);
-static int ln_cmp_BSEARCH_CMP_FN(const void *, const void *);
-static int ln_cmp(const ASN1_OBJECT * const *, unsigned int const *);
-static unsigned int *OBJ_bsearch_ln(const ASN1_OBJECT * *key, unsigned int const *base, int num);
-static int obj_cmp_BSEARCH_CMP_FN(const void *, const void *);
-static int obj_cmp(const ASN1_OBJECT * const *, unsigned int const *);
-static unsigned int *OBJ_bsearch_obj(const ASN1_OBJECT * *key, unsigned int const *base, int num);
-
 #define ADDED_DATA	0
 #define ADDED_SNAME	1
 #define ADDED_LNAME	2
@@ -98,46 +89,48 @@ DECLARE_LHASH_OF(ADDED_OBJ);
 static int new_nid = NUM_NID;
 static LHASH_OF(ADDED_OBJ) *added = NULL;
 
-static int sn_cmp(const ASN1_OBJECT * const *a, const unsigned int *b)
+/*
+ * The built-in objects are looked up through minimal perfect hash tables
+ * generated by obj_dat.pl: the hash of the key selects a displacement, which
+ * mixed with the hash gives the only slot that can hold the key. The hash
+ * functions must match phf_hash() and phf_mix() in obj_dat.pl.
+ */
+static uint32_t
+obj_hash_bytes(const unsigned char *p, size_t len)
 {
-	return (strcmp((*a)->sn, nid_objs[*b].sn));
-}
+	uint32_t h = 2166136261U;
+	size_t i;
 
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 16777619U;
+	}
 
-static int
-sn_cmp_BSEARCH_CMP_FN(const void *a_, const void *b_)
-{
-	const ASN1_OBJECT * const *a = a_;
-	unsigned int const *b = b_;
-	return sn_cmp(a, b);
+	return h;
 }
 
-static unsigned int *
-OBJ_bsearch_sn(const ASN1_OBJECT * *key, unsigned int const *base, int num)
+static uint32_t
+obj_hash_mix(uint32_t x)
 {
-	return (unsigned int *)OBJ_bsearch_(key, base, num, sizeof(unsigned int),
-	    sn_cmp_BSEARCH_CMP_FN);
-}
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
 
-static int ln_cmp(const ASN1_OBJECT * const *a, const unsigned int *b)
-{
-	return (strcmp((*a)->ln, nid_objs[*b].ln));
+	return x;
 }
 
-
-static int
-ln_cmp_BSEARCH_CMP_FN(const void *a_, const void *b_)
+static const ASN1_OBJECT *
+obj_phf_lookup(const uint16_t *disp, size_t num_disp, const uint16_t *phf,
+    size_t num, const unsigned char *key, size_t key_len)
 {
-	const ASN1_OBJECT * const *a = a_;
-	unsigned int const *b = b_;
-	return ln_cmp(a, b);
-}
+	uint32_t h;
 
-static unsigned int *
-OBJ_bsearch_ln(const ASN1_OBJECT * *key, unsigned int const *base, int num)
-{
-	return (unsigned int *)OBJ_bsearch_(key, base, num, sizeof(unsigned int),
-	    ln_cmp_BSEARCH_CMP_FN);
+	h = obj_hash_bytes(key, key_len);
+	h = obj_hash_mix(h ^ disp[h % num_disp]);
+
+	return &nid_objs[phf[h % num]];
 }
 
 static unsigned long
@@ -429,39 +422,10 @@ OBJ_nid2ln(int n)
 }
 LCRYPTO_ALIAS(OBJ_nid2ln);
 
-static int
-obj_cmp(const ASN1_OBJECT * const *ap, const unsigned int *bp)
-{
-	int j;
-	const ASN1_OBJECT *a= *ap;
-	const ASN1_OBJECT *b = &nid_objs[*bp];
-
-	j = (a->length - b->length);
-	if (j)
-		return (j);
-	return (memcmp(a->data, b->data, a->length));
-}
-
-
-static int
-obj_cmp_BSEARCH_CMP_FN(const void *a_, const void *b_)
-{
-	const ASN1_OBJECT * const *a = a_;
-	unsigned int const *b = b_;
-	return obj_cmp(a, b);
-}
-
-static unsigned int *
-OBJ_bsearch_obj(const ASN1_OBJECT * *key, unsigned int const *base, int num)
-{
-	return (unsigned int *)OBJ_bsearch_(key, base, num, sizeof(unsigned int),
-	    obj_cmp_BSEARCH_CMP_FN);
-}
-
 int
 OBJ_obj2nid(const ASN1_OBJECT *a)
 {
-	const unsigned int *op;
+	const ASN1_OBJECT *o;
 	ADDED_OBJ ad, *adp;
 
 	if (a == NULL || a->length == 0)
@@ -476,10 +440,11 @@ OBJ_obj2nid(const ASN1_OBJECT *a)
 		if (adp != NULL)
 			return (adp->obj->nid);
 	}
-	op = OBJ_bsearch_obj(&a, obj_objs, NUM_OBJ);
-	if (op == NULL)
+	o = obj_phf_lookup(obj_disp, NUM_OBJ_DISP, obj_phf, NUM_OBJ,
+	    a->data, a->length);
+	if (o->length != a->length || memcmp(o->data, a->data, a->length) != 0)
 		return (NID_undef);
-	return (nid_objs[*op].nid);
+	return (o->nid);
 }
 LCRYPTO_ALIAS(OBJ_obj2nid);
 
@@ -528,9 +493,8 @@ int
 OBJ_ln2nid(const char *s)
 {
 	ASN1_OBJECT o;
-	const ASN1_OBJECT *oo = &o;
+	const ASN1_OBJECT *oo;
 	ADDED_OBJ ad, *adp;
-	const unsigned int *op;
 
 	o.ln = s;
 	if (added != NULL) {
@@ -540,10 +504,11 @@ OBJ_ln2nid(const char *s)
 		if (adp != NULL)
 			return (adp->obj->nid);
 	}
-	op = OBJ_bsearch_ln(&oo, ln_objs, NUM_LN);
-	if (op == NULL)
+	oo = obj_phf_lookup(ln_disp, NUM_LN_DISP, ln_phf, NUM_LN,
+	    (const unsigned char *)s, strlen(s));
+	if (strcmp(oo->ln, s) != 0)
 		return (NID_undef);
-	return (nid_objs[*op].nid);
+	return (oo->nid);
 }
 LCRYPTO_ALIAS(OBJ_ln2nid);
 
@@ -551,9 +516,8 @@ int
 OBJ_sn2nid(const char *s)
 {
 	ASN1_OBJECT o;
-	const ASN1_OBJECT *oo = &o;
+	const ASN1_OBJECT *oo;
 	ADDED_OBJ ad, *adp;
-	const unsigned int *op;
 
 	o.sn = s;
 	if (added != NULL) {
@@ -563,10 +527,11 @@ OBJ_sn2nid(const char *s)
 		if (adp != NULL)
 			return (adp->obj->nid);
 	}
-	op = OBJ_bsearch_sn(&oo, sn_objs, NUM_SN);
-	if (op == NULL)
+	oo = obj_phf_lookup(sn_disp, NUM_SN_DISP, sn_phf, NUM_SN,
+	    (const unsigned char *)s, strlen(s));
+	if (strcmp(oo->sn, s) != 0)
 		return (NID_undef);
-	return (nid_objs[*op].nid);
+	return (oo->nid);
 }
 LCRYPTO_ALIAS(OBJ_sn2nid);
 
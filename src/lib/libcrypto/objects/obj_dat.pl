@@ -42,6 +42,149 @@ sub expand_obj
 	return(%objn);
 	}
 
+# 32 bit multiplication, split so that no intermediate result exceeds 48 bits.
+sub mul32
+	{
+	local($x,$y)=@_;
+
+	return((($x*($y&0xffff))+((($x*($y>>16))&0xffff)<<16))&0xffffffff);
+	}
+
+# Must match obj_hash_bytes() in obj_dat.c (FNV-1a).
+sub phf_hash
+	{
+	local($h)=2166136261;
+
+	foreach (unpack("C*",$_[0]))
+		{ $h=&mul32($h^$_,16777619); }
+	return($h);
+	}
+
+# Must match obj_hash_mix() in obj_dat.c.
+sub phf_mix
+	{
+	local($x)=@_;
+
+	$x^=$x>>16;
+	$x=&mul32($x,0x7feb352d);
+	$x^=$x>>15;
+	$x=&mul32($x,0x846ca68b);
+	$x^=$x>>16;
+	return($x);
+	}
+
+# Build a minimal perfect hash over the keys of %keys (key bytes => nid)
+# using hash and displace: keys are split into buckets by their hash and,
+# starting with the largest bucket, each bucket is given the smallest
+# displacement that moves all of its keys to free slots. Returns references
+# to the displacement and slot tables.
+sub phf_build
+	{
+	local(%keys)=@_;
+	local(@k)=sort keys %keys;
+	local($n)=$#k+1;
+	local($nb)=int(($n+3)/4);
+	local(@buckets,@disp,@slots,%used,%seen,%hkey,%try,$h,$b,$d,$s,$ok);
+
+	foreach (@k)
+		{
+		$h=&phf_hash($_);
+		die "hash collision" if defined($seen{$h});
+		$seen{$h}=1;
+		push(@{$buckets[$h%$nb]},$h);
+		}
+	@slots=(0) x $n;
+	@disp=(0) x $nb;
+	foreach (@k)
+		{ $hkey{&phf_hash($_)}=$keys{$_}; }
+	foreach $b (sort { $#{$buckets[$b]} <=> $#{$buckets[$a]} || $a <=> $b }
+	    (0 .. $nb-1))
+		{
+		next unless defined($buckets[$b]);
+		for ($d=0; ; $d++)
+			{
+			die "no displacement found" if $d > 65535;
+			%try=();
+			$ok=1;
+			foreach $h (@{$buckets[$b]})
+				{
+				$s=&phf_mix($h^$d)%$n;
+				if (defined($used{$s}) || defined($try{$s}))
+					{ $ok=0; last; }
+				$try{$s}=$h;
+				}
+			last if $ok;
+			}
+		$disp[$b]=$d;
+		foreach $s (keys %try)
+			{
+			$used{$s}=1;
+			$slots[$s]=$hkey{$try{$s}};
+			}
+		}
+	return(\@disp,\@slots);
+	}
+
+# Objects with a single arc have no encoding.
+sub obj_key
+	{
+	local($v)=$objd{$obj{$nid{$_[0]}}};
+
+	return("") unless $v =~ /,/;
+	$v =~ s/L//g;
+	$v =~ s/,/ /g;
+	return(&der_it($v));
+	}
+
+# Map each key to a nid. Where several nids share a key, pick the one that
+# the binary search over the sorted table used to find, so that lookups
+# return the same nid as before.
+sub phf_keys
+	{
+	local($key,$cmp,@sorted)=@_;
+	local(%keys,$k,$l,$h,$i,$c);
+
+	foreach (@sorted)
+		{
+		$k=&$key($_);
+		next if defined($keys{$k});
+		($l,$h)=(0,$#sorted+1);
+		while ($l < $h)
+			{
+			$i=($l+$h)/2;
+			$c=&$cmp($k,&$key($sorted[$i]));
+			last if $c == 0;
+			if ($c < 0) { $h=$i; } else { $l=$i+1; }
+			}
+		$keys{$k}=$sorted[$i];
+		}
+	return(%keys);
+	}
+
+sub phf_print
+	{
+	local($name,$disp,$slots)=@_;
+	local($i,$line);
+
+	printf OUT "#define NUM_%s_DISP %d\n\n",uc($name),$#{$disp}+1;
+	foreach $t (["${name}_disp",$disp],["${name}_phf",$slots])
+		{
+		printf OUT "static const uint16_t %s[%d]={\n",$t->[0],
+		    $#{$t->[1]}+1;
+		$line="";
+		for ($i=0; $i<=$#{$t->[1]}; $i++)
+			{
+			$line.=sprintf("%d,",$t->[1][$i]);
+			if (length($line) > 64 || $i == $#{$t->[1]})
+				{
+				print OUT "\t$line\n";
+				$line="";
+				}
+			}
+		print OUT "};\n\n";
+		}
+	}
+
 open (IN,"$ARGV[0]") || die "Can't open input file $ARGV[0]";
 open (OUT,">$ARGV[1]") || die "Can't open output file $ARGV[1]";
 
@@ -146,26 +289,21 @@ for ($i=0; $i<$n; $i++)
 	}
 
 @a=grep(defined($sn{$nid{$_}}),0 .. $n);
-foreach (sort { $sn{$nid{$a}} cmp $sn{$nid{$b}} } @a)
-	{
-	push(@sn,sprintf("%2d,\t/* \"$sn{$nid{$_}}\" */\n",$_));
-	}
+@sn_sorted=sort { $sn{$nid{$a}} cmp $sn{$nid{$b}} } @a;
+%sn_keys=&phf_keys(sub { $sn{$nid{$_[0]}} }, sub { $_[0] cmp $_[1] },
+    @sn_sorted);
 
 @a=grep(defined($ln{$nid{$_}}),0 .. $n);
-foreach (sort { $ln{$nid{$a}} cmp $ln{$nid{$b}} } @a)
-	{
-	push(@ln,sprintf("%2d,\t/* \"$ln{$nid{$_}}\" */\n",$_));
-	}
+@ln_sorted=sort { $ln{$nid{$a}} cmp $ln{$nid{$b}} } @a;
+%ln_keys=&phf_keys(sub { $ln{$nid{$_[0]}} }, sub { $_[0] cmp $_[1] },
+    @ln_sorted);
 
 @a=grep(defined($obj{$nid{$_}}),0 .. $n);
-foreach (sort obj_cmp @a)
-	{
-	$m=$obj{$nid{$_}};
-	$v=$objd{$m};
-	$v =~ s/L//g;
-	$v =~ s/,/ /g;
-	push(@ob,sprintf("%2d,\t/* %-32s %s */\n",$_,$m,$v));
-	}
+@ob_sorted=sort obj_cmp @a;
+%obj_keys=&phf_keys(sub { &obj_key($_[0]) },
+    sub { length($_[0]) <=> length($_[1]) || $_[0] cmp $_[1] }, @ob_sorted);
+# Empty encodings are never looked up.
+delete $obj_keys{""};
 
 print OUT <<'EOF';
 /* crypto/objects/obj_dat.h */
@@ -235,9 +373,9 @@ print OUT <<'EOF';
 EOF
 
 printf OUT "#define NUM_NID %d\n",$n;
-printf OUT "#define NUM_SN %d\n",$#sn+1;
-printf OUT "#define NUM_LN %d\n",$#ln+1;
-printf OUT "#define NUM_OBJ %d\n\n",$#ob+1;
+printf OUT "#define NUM_SN %d\n",scalar(keys %sn_keys);
+printf OUT "#define NUM_LN %d\n",scalar(keys %ln_keys);
+printf OUT "#define NUM_OBJ %d\n\n",scalar(keys %obj_keys);
 
 printf OUT "static const unsigned char lvalues[%d]={\n",$lvalues+1;
 print OUT @lvalues;
@@ -267,17 +405,11 @@ foreach (@out)
 	}
 print  OUT "};\n\n";
 
-printf OUT "static const unsigned int sn_objs[NUM_SN]={\n";
-print  OUT @sn;
-print  OUT "};\n\n";
+die "too many NIDs" if $n > 65535;
 
-printf OUT "static const unsigned int ln_objs[NUM_LN]={\n";
-print  OUT @ln;
-print  OUT "};\n\n";
-
-printf OUT "static const unsigned int obj_objs[NUM_OBJ]={\n";
-print  OUT @ob;
-print  OUT "};\n\n";
+&phf_print("sn",&phf_build(%sn_keys));
+&phf_print("ln",&phf_build(%ln_keys));
+&phf_print("obj",&phf_build(%obj_keys));
 
 close OUT;
 
@@ -202,8 +202,8 @@ LCRYPTO_ALIAS(OCSP_response_status);
 /* Extract basic response from OCSP_RESPONSE or NULL if
  * no basic response present.
  */
-OCSP_BASICRESP *
-OCSP_response_get1_basic(OCSP_RESPONSE *resp)
+static ASN1_OCTET_STRING *
+ocsp_response_basic_bytes(OCSP_RESPONSE *resp)
 {
 	OCSP_RESPBYTES *rb;
 
@@ -217,10 +217,37 @@ OCSP_response_get1_basic(OCSP_RESPONSE *resp)
 		return NULL;
 	}
 
-	return ASN1_item_unpack(rb->response, &OCSP_BASICRESP_it);
+	return rb->response;
+}
+
+OCSP_BASICRESP *
+OCSP_response_get1_basic(OCSP_RESPONSE *resp)
+{
+	ASN1_OCTET_STRING *response;
+
+	if ((response = ocsp_response_basic_bytes(resp)) == NULL)
+		return NULL;
+
+	return ASN1_item_unpack(response, &OCSP_BASICRESP_it);
 }
 LCRYPTO_ALIAS(OCSP_response_get1_basic);
 
+/* As above, but the basic response is decoded into and owned by arena. */
+OCSP_BASICRESP *
+OCSP_response_get0_basic_arena(OCSP_RESPONSE *resp, ASN1_ARENA *arena)
+{
+	ASN1_OCTET_STRING *response;
+	const unsigned char *p;
+
+	if ((response = ocsp_response_basic_bytes(resp)) == NULL)
+		return NULL;
+
+	p = response->data;
+	return (OCSP_BASICRESP *)ASN1_item_d2i_arena(arena, &p,
+	    response->length, &OCSP_BASICRESP_it);
+}
+LCRYPTO_ALIAS(OCSP_response_get0_basic_arena);
+
 /* Return number of OCSP_SINGLERESP responses present in
  * a basic response.
  */
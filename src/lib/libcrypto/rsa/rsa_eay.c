@@ -148,7 +148,7 @@ rsa_public_encrypt(int flen, const unsigned char *from, unsigned char *to,
 		}
 	}
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((ctx = bn_ctx_acquire(BN_num_bits(rsa->n))) == NULL)
 		goto err;
 
 	BN_CTX_start(ctx);
@@ -211,7 +211,7 @@ rsa_public_encrypt(int flen, const unsigned char *from, unsigned char *to,
 err:
 	if (ctx != NULL) {
 		BN_CTX_end(ctx);
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	}
 	freezero(buf, num);
 	return r;
@@ -328,7 +328,7 @@ rsa_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
 	BIGNUM *unblind = NULL;
 	BN_BLINDING *blinding = NULL;
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((ctx = bn_ctx_acquire(BN_num_bits(rsa->n))) == NULL)
 		goto err;
 
 	BN_CTX_start(ctx);
@@ -433,7 +433,7 @@ rsa_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
 err:
 	if (ctx != NULL) {
 		BN_CTX_end(ctx);
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	}
 	freezero(buf, num);
 	return r;
@@ -457,7 +457,7 @@ rsa_private_decrypt(int flen, const unsigned char *from, unsigned char *to,
 	BIGNUM *unblind = NULL;
 	BN_BLINDING *blinding = NULL;
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((ctx = bn_ctx_acquire(BN_num_bits(rsa->n))) == NULL)
 		goto err;
 
 	BN_CTX_start(ctx);
@@ -557,7 +557,7 @@ rsa_private_decrypt(int flen, const unsigned char *from, unsigned char *to,
 err:
 	if (ctx != NULL) {
 		BN_CTX_end(ctx);
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	}
 	freezero(buf, num);
 	return r;
@@ -592,7 +592,7 @@ rsa_public_decrypt(int flen, const unsigned char *from, unsigned char *to,
 		}
 	}
 
-	if ((ctx = BN_CTX_new()) == NULL)
+	if ((ctx = bn_ctx_acquire(BN_num_bits(rsa->n))) == NULL)
 		goto err;
 
 	BN_CTX_start(ctx);
@@ -658,7 +658,7 @@ rsa_public_decrypt(int flen, const unsigned char *from, unsigned char *to,
 err:
 	if (ctx != NULL) {
 		BN_CTX_end(ctx);
-		BN_CTX_free(ctx);
+		bn_ctx_release(ctx);
 	}
 	freezero(buf, num);
 	return r;
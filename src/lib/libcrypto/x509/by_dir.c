@@ -249,6 +249,11 @@ add_cert_dir(BY_DIR *ctx, const char *dir, int type)
 				by_dir_entry_free(ent);
 				return 0;
 			}
+			/*
+			 * Lookups search the hashes under the read lock, so
+			 * the stack must never need sorting in sk_find().
+			 */
+			sk_BY_DIR_HASH_sort(ent->hashes);
 			if (!sk_BY_DIR_ENTRY_push(ctx->dirs, ent)) {
 				X509error(ERR_R_MALLOC_FAILURE);
 				by_dir_entry_free(ent);
@@ -393,6 +398,7 @@ get_cert_by_subject(X509_LOOKUP *xl, int type, X509_NAME *name,
 					ok = 0;
 					goto finish;
 				}
+				sk_BY_DIR_HASH_sort(ent->hashes);
 			} else if (hent->suffix < k)
 				hent->suffix = k;
 
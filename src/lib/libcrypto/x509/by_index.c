@@ -0,0 +1,562 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Indexed trust store lookup method.
+ *
+ * An index file holds DER encoded certificates, preceded by a table sorted
+ * by subject name hash. The file is mapped read-only, so that the pages are
+ * shared between all processes using the same index, and certificates are
+ * only decoded and added to the store when they are first looked up.
+ *
+ * All integers are stored in network byte order:
+ *
+ *	header		magic "X509IDX2"
+ *			u32 number of certificates
+ *			u32 offset of subject table
+ *			u32 offset of certificate data
+ *			u32 length of certificate data
+ *	subject		u32 subject name hash
+ *			u32 certificate offset, relative to certificate data
+ *			u32 certificate length
+ *
+ * Certificates are numbered in subject table order.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "bytestring.h"
+#include "x509_internal.h"
+#include "x509_local.h"
+
+#define X509_INDEX_MAGIC	"X509IDX2"
+#define X509_INDEX_MAGIC_LEN	8
+#define X509_INDEX_HEADER_LEN	(X509_INDEX_MAGIC_LEN + 4 * 4)
+#define X509_INDEX_SUBJECT_LEN	12
+#define X509_INDEX_MAX_CERTS	(1 << 20)
+
+/*
+ * A mapped index. Lookups hold a reference, so that loading a new index
+ * does not unmap the previous one while it is being used. The reference
+ * count is atomic, since references are taken under the store read lock.
+ */
+struct index_map {
+	atomic_int references;
+	uint8_t *mem;
+	size_t mem_len;
+	CBS subjects;
+	uint32_t num_certs;
+	CBS data;
+
+	/* Decoded certificates, protected by CRYPTO_LOCK_X509_STORE. */
+	X509 **certs;
+};
+
+struct by_index {
+	/* Current index, protected by CRYPTO_LOCK_X509_STORE. */
+	struct index_map *map;
+};
+
+static int index_new(X509_LOOKUP *lu);
+static void index_free(X509_LOOKUP *lu);
+static int index_ctrl(X509_LOOKUP *lu, int cmd, const char *argp, long argl,
+    char **ret);
+static int index_get_by_subject(X509_LOOKUP *lu, int type, X509_NAME *name,
+    X509_OBJECT *ret);
+
+static X509_LOOKUP_METHOD x509_index_lookup = {
+	.name = "Load certs from an indexed trust store",
+	.new_item = index_new,
+	.free = index_free,
+	.init = NULL,
+	.shutdown = NULL,
+	.ctrl = index_ctrl,
+	.get_by_subject = index_get_by_subject,
+	.get_by_issuer_serial = NULL,
+	.get_by_fingerprint = NULL,
+	.get_by_alias = NULL,
+};
+
+X509_LOOKUP_METHOD *
+X509_LOOKUP_index(void)
+{
+	return &x509_index_lookup;
+}
+LCRYPTO_ALIAS(X509_LOOKUP_index);
+
+static void
+index_map_free(struct index_map *map)
+{
+	uint32_t i;
+
+	if (map == NULL)
+		return;
+	if (atomic_fetch_sub_explicit(&map->references, 1,
+	    memory_order_acq_rel) > 1)
+		return;
+
+	if (map->certs != NULL) {
+		for (i = 0; i < map->num_certs; i++)
+			X509_free(map->certs[i]);
+		free(map->certs);
+	}
+	if (map->mem != NULL)
+		munmap(map->mem, map->mem_len);
+
+	free(map);
+}
+
+/* Return a reference to the current index, if any. */
+static struct index_map *
+index_map_get(struct by_index *bi)
+{
+	struct index_map *map;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+	if ((map = bi->map) != NULL)
+		atomic_fetch_add_explicit(&map->references, 1,
+		    memory_order_relaxed);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+
+	return map;
+}
+
+static int
+index_new(X509_LOOKUP *lu)
+{
+	struct by_index *bi;
+
+	if ((bi = calloc(1, sizeof(*bi))) == NULL) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	lu->method_data = (void *)bi;
+
+	return 1;
+}
+
+static void
+index_free(X509_LOOKUP *lu)
+{
+	struct by_index *bi;
+
+	if ((bi = (struct by_index *)lu->method_data) == NULL)
+		return;
+
+	index_map_free(bi->map);
+	free(bi);
+	lu->method_data = NULL;
+}
+
+static int
+index_table(CBS *index, uint32_t offset, size_t len, CBS *out_table)
+{
+	CBS cbs;
+
+	CBS_dup(index, &cbs);
+	if (!CBS_skip(&cbs, offset))
+		return 0;
+	if (!CBS_get_bytes(&cbs, out_table, len))
+		return 0;
+
+	return 1;
+}
+
+static struct index_map *
+index_map_new(const char *path)
+{
+	uint32_t subjects_off, data_off, data_len;
+	struct index_map *map;
+	CBS index, cbs, magic;
+	struct stat sb;
+	void *mem;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		X509error(ERR_R_SYS_LIB);
+		return NULL;
+	}
+	if (fstat(fd, &sb) == -1) {
+		X509error(ERR_R_SYS_LIB);
+		close(fd);
+		return NULL;
+	}
+	if (sb.st_size < X509_INDEX_HEADER_LEN || sb.st_size > UINT32_MAX) {
+		X509error(X509_R_BAD_X509_FILETYPE);
+		close(fd);
+		return NULL;
+	}
+	mem = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		X509error(ERR_R_SYS_LIB);
+		return NULL;
+	}
+
+	if ((map = calloc(1, sizeof(*map))) == NULL) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		munmap(mem, sb.st_size);
+		return NULL;
+	}
+	atomic_init(&map->references, 1);
+	map->mem = mem;
+	map->mem_len = sb.st_size;
+
+	CBS_init(&index, map->mem, map->mem_len);
+	CBS_dup(&index, &cbs);
+
+	if (!CBS_get_bytes(&cbs, &magic, X509_INDEX_MAGIC_LEN))
+		goto err;
+	if (!CBS_mem_equal(&magic, X509_INDEX_MAGIC, X509_INDEX_MAGIC_LEN))
+		goto err;
+	if (!CBS_get_u32(&cbs, &map->num_certs))
+		goto err;
+	if (!CBS_get_u32(&cbs, &subjects_off))
+		goto err;
+	if (!CBS_get_u32(&cbs, &data_off))
+		goto err;
+	if (!CBS_get_u32(&cbs, &data_len))
+		goto err;
+
+	if (map->num_certs > X509_INDEX_MAX_CERTS)
+		goto err;
+	if (!index_table(&index, subjects_off,
+	    (size_t)map->num_certs * X509_INDEX_SUBJECT_LEN, &map->subjects))
+		goto err;
+	if (!index_table(&index, data_off, data_len, &map->data))
+		goto err;
+
+	if (map->num_certs > 0) {
+		if ((map->certs = calloc(map->num_certs,
+		    sizeof(*map->certs))) == NULL) {
+			X509error(ERR_R_MALLOC_FAILURE);
+			index_map_free(map);
+			return NULL;
+		}
+	}
+
+	return map;
+
+ err:
+	X509error(X509_R_BAD_X509_FILETYPE);
+	index_map_free(map);
+
+	return NULL;
+}
+
+static int
+index_ctrl(X509_LOOKUP *lu, int cmd, const char *argp, long argl, char **ret)
+{
+	struct by_index *bi = (struct by_index *)lu->method_data;
+	struct index_map *map, *old;
+
+	if (cmd != X509_L_INDEX_LOAD || argp == NULL)
+		return 0;
+
+	if ((map = index_map_new(argp)) == NULL)
+		return 0;
+
+	/*
+	 * Certificates that have already been decoded remain in the store.
+	 * The previous index is released once lookups using it are done.
+	 */
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	old = bi->map;
+	bi->map = map;
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+
+	index_map_free(old);
+
+	return 1;
+}
+
+static int
+index_subject(struct index_map *map, uint32_t idx, uint32_t *out_hash,
+    CBS *out_der)
+{
+	uint32_t hash, offset, len;
+	CBS cbs, data;
+
+	CBS_dup(&map->subjects, &cbs);
+	if (!CBS_skip(&cbs, idx * X509_INDEX_SUBJECT_LEN))
+		return 0;
+	if (!CBS_get_u32(&cbs, &hash))
+		return 0;
+	if (!CBS_get_u32(&cbs, &offset))
+		return 0;
+	if (!CBS_get_u32(&cbs, &len))
+		return 0;
+
+	*out_hash = hash;
+
+	if (out_der == NULL)
+		return 1;
+
+	CBS_dup(&map->data, &data);
+	if (!CBS_skip(&data, offset))
+		return 0;
+	if (!CBS_get_bytes(&data, out_der, len))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Return the certificate with the given number, decoding it from the mapping
+ * and adding it to the store the first time it is needed.
+ */
+static X509 *
+index_cert(X509_LOOKUP *lu, struct index_map *map, uint32_t idx)
+{
+	const unsigned char *p;
+	uint32_t hash;
+	X509 *x509;
+	CBS der;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+	x509 = map->certs[idx];
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+
+	if (x509 != NULL)
+		return x509;
+
+	if (!index_subject(map, idx, &hash, &der))
+		return NULL;
+
+	p = CBS_data(&der);
+	if ((x509 = d2i_X509(NULL, &p, CBS_len(&der))) == NULL)
+		return NULL;
+	if (p != CBS_data(&der) + CBS_len(&der)) {
+		X509_free(x509);
+		return NULL;
+	}
+
+	/*
+	 * Another thread may have decoded the same certificate while the
+	 * lock was dropped - the store ignores the duplicate.
+	 */
+	if (!X509_STORE_add_cert(lu->store_ctx, x509)) {
+		X509_free(x509);
+		return NULL;
+	}
+
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	if (map->certs[idx] == NULL)
+		map->certs[idx] = x509;
+	else {
+		X509_free(x509);
+		x509 = map->certs[idx];
+	}
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+
+	return x509;
+}
+
+/*
+ * Load every certificate with a matching subject into the store, since the
+ * verifier looks for issuers in the store, and return the first of them.
+ */
+static int
+index_get_by_subject(X509_LOOKUP *lu, int type, X509_NAME *name,
+    X509_OBJECT *ret)
+{
+	struct by_index *bi = (struct by_index *)lu->method_data;
+	struct index_map *map;
+	uint32_t lo, hi, mid, hash, h;
+	X509 *x509;
+	int ok = 0;
+
+	if (type != X509_LU_X509 || name == NULL)
+		return 0;
+	if ((map = index_map_get(bi)) == NULL)
+		return 0;
+
+	h = (uint32_t)X509_NAME_hash(name);
+
+	/* Find the first entry with a matching hash. */
+	lo = 0;
+	hi = map->num_certs;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (!index_subject(map, mid, &hash, NULL))
+			goto done;
+		if (hash < h)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < map->num_certs; lo++) {
+		if (!index_subject(map, lo, &hash, NULL))
+			break;
+		if (hash != h)
+			break;
+		if ((x509 = index_cert(lu, map, lo)) == NULL)
+			continue;
+		if (X509_NAME_cmp(X509_get_subject_name(x509), name) != 0)
+			continue;
+		if (ok)
+			continue;
+
+		ret->type = X509_LU_X509;
+		ret->data.x509 = x509;
+		ok = 1;
+	}
+
+ done:
+	index_map_free(map);
+
+	return ok;
+}
+
+struct index_entry {
+	uint32_t hash;
+	unsigned char *der;
+	int der_len;
+};
+
+static int
+index_entry_cmp(const void *a, const void *b)
+{
+	const struct index_entry *ea = a, *eb = b;
+
+	if (ea->hash != eb->hash)
+		return ea->hash < eb->hash ? -1 : 1;
+	if (ea->der_len != eb->der_len)
+		return ea->der_len < eb->der_len ? -1 : 1;
+
+	return memcmp(ea->der, eb->der, ea->der_len);
+}
+
+int
+X509_LOOKUP_write_index(BIO *bio, STACK_OF(X509) *certs)
+{
+	struct index_entry *entries = NULL;
+	uint32_t num_certs = 0, data_len = 0;
+	uint32_t subjects_off, data_off;
+	uint8_t *out = NULL;
+	size_t out_len = 0;
+	X509 *x509;
+	CBB cbb;
+	int i, n;
+	int ret = 0;
+
+	memset(&cbb, 0, sizeof(cbb));
+
+	if ((n = sk_X509_num(certs)) < 0 || n > X509_INDEX_MAX_CERTS)
+		goto err;
+
+	if (n > 0) {
+		if ((entries = calloc(n, sizeof(*entries))) == NULL)
+			goto err;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct index_entry *e = &entries[i];
+
+		x509 = sk_X509_value(certs, i);
+		if ((e->der_len = i2d_X509(x509, &e->der)) <= 0)
+			goto err;
+		num_certs++;
+		e->hash = (uint32_t)X509_NAME_hash(X509_get_subject_name(x509));
+	}
+
+	qsort(entries, num_certs, sizeof(*entries), index_entry_cmp);
+
+	/* Drop duplicates. */
+	for (i = 0, n = 0; i < (int)num_certs; i++) {
+		if (n > 0 && index_entry_cmp(&entries[n - 1], &entries[i]) == 0) {
+			free(entries[i].der);
+			continue;
+		}
+		if (entries[i].der_len > UINT32_MAX - data_len) {
+			free(entries[i].der);
+			continue;
+		}
+		entries[n] = entries[i];
+		data_len += entries[n].der_len;
+		n++;
+	}
+	num_certs = n;
+
+	subjects_off = X509_INDEX_HEADER_LEN;
+	data_off = subjects_off + num_certs * X509_INDEX_SUBJECT_LEN;
+	if (data_len > UINT32_MAX - data_off)
+		goto err;
+
+	if (!CBB_init(&cbb, data_off + data_len))
+		goto err;
+	if (!CBB_add_bytes(&cbb, X509_INDEX_MAGIC, X509_INDEX_MAGIC_LEN))
+		goto err;
+	if (!CBB_add_u32(&cbb, num_certs))
+		goto err;
+	if (!CBB_add_u32(&cbb, subjects_off))
+		goto err;
+	if (!CBB_add_u32(&cbb, data_off))
+		goto err;
+	if (!CBB_add_u32(&cbb, data_len))
+		goto err;
+
+	data_len = 0;
+	for (i = 0; i < (int)num_certs; i++) {
+		if (!CBB_add_u32(&cbb, entries[i].hash))
+			goto err;
+		if (!CBB_add_u32(&cbb, data_len))
+			goto err;
+		if (!CBB_add_u32(&cbb, entries[i].der_len))
+			goto err;
+		data_len += entries[i].der_len;
+	}
+
+	for (i = 0; i < (int)num_certs; i++) {
+		if (!CBB_add_bytes(&cbb, entries[i].der, entries[i].der_len))
+			goto err;
+	}
+
+	if (!CBB_finish(&cbb, &out, &out_len))
+		goto err;
+	if (out_len > INT_MAX)
+		goto err;
+	if (BIO_write(bio, out, out_len) != (int)out_len)
+		goto err;
+
+	ret = 1;
+
+ err:
+	if (!ret)
+		X509error(X509_R_ERR_ASN1_LIB);
+	CBB_cleanup(&cbb);
+	for (i = 0; i < (int)num_certs; i++)
+		free(entries[i].der);
+	free(entries);
+	free(out);
+
+	return ret;
+}
+LCRYPTO_ALIAS(X509_LOOKUP_write_index);
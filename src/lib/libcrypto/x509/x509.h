@@ -406,6 +406,17 @@ void X509_CRL_METHOD_free(X509_CRL_METHOD *m);
 void X509_CRL_set_meth_data(X509_CRL *crl, void *dat);
 void *X509_CRL_get_meth_data(X509_CRL *crl);
 
+typedef struct x509_crl_index_st X509_CRL_INDEX;
+
+X509_CRL_INDEX *X509_CRL_INDEX_new(const unsigned char *der, size_t der_len);
+X509_CRL_INDEX *X509_CRL_INDEX_load_file(const char *path);
+int X509_CRL_INDEX_write_bio(BIO *bio, const X509_CRL_INDEX *index);
+int X509_CRL_INDEX_up_ref(X509_CRL_INDEX *index);
+void X509_CRL_INDEX_free(X509_CRL_INDEX *index);
+int X509_CRL_INDEX_lookup(const X509_CRL_INDEX *index,
+    const ASN1_INTEGER *serial);
+int X509_CRL_set1_index(X509_CRL *crl, X509_CRL_INDEX *index);
+
 X509_PUBKEY	*X509_get_X509_PUBKEY(const X509 *x);
 
 const char *X509_verify_cert_error_string(long n);
@@ -0,0 +1,240 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* x509_chain_cache */
+
+/*
+ * The chain cache maps a digest of a presented certificate chain and the
+ * verification parameters to the chain that was built and validated for
+ * it. Entries expire at the earliest notAfter of the certificates in the
+ * validated chain.
+ *
+ * A cached chain only allows chain building to be skipped. The caller is
+ * still responsible for the checks that depend on the time of use or on
+ * state outside the chain (hostname, revocation, policy, trust).
+ */
+
+#include <sys/tree.h>
+#include <sys/queue.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x509_chain_cache.h"
+#include "x509_local.h"
+
+struct x509_chain_cache_entry {
+	RB_ENTRY(x509_chain_cache_entry) entry;
+	TAILQ_ENTRY(x509_chain_cache_entry) queue;	/* LRU of entries */
+	unsigned char key[X509_CHAIN_CACHE_KEY_LEN];
+	STACK_OF(X509) *chain;		/* Validated chain, leaf first. */
+	time_t expires;			/* Earliest notAfter in the chain. */
+};
+
+RB_HEAD(x509_chain_cache_tree, x509_chain_cache_entry);
+TAILQ_HEAD(x509_chain_cache_lru, x509_chain_cache_entry);
+
+struct x509_chain_cache {
+	pthread_mutex_t mutex;
+	struct x509_chain_cache_tree tree;
+	struct x509_chain_cache_lru lru;
+	size_t count;
+	size_t max;
+};
+
+static int
+x509_chain_cache_cmp(struct x509_chain_cache_entry *e1,
+    struct x509_chain_cache_entry *e2)
+{
+	return memcmp(e1->key, e2->key, X509_CHAIN_CACHE_KEY_LEN);
+}
+
+RB_PROTOTYPE_STATIC(x509_chain_cache_tree, x509_chain_cache_entry, entry,
+    x509_chain_cache_cmp);
+RB_GENERATE_STATIC(x509_chain_cache_tree, x509_chain_cache_entry, entry,
+    x509_chain_cache_cmp);
+
+struct x509_chain_cache *
+x509_chain_cache_new(size_t max)
+{
+	struct x509_chain_cache *cache;
+
+	if ((cache = calloc(1, sizeof(*cache))) == NULL)
+		return NULL;
+	if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+		free(cache);
+		return NULL;
+	}
+	RB_INIT(&cache->tree);
+	TAILQ_INIT(&cache->lru);
+	cache->max = max;
+
+	return cache;
+}
+
+static void
+x509_chain_cache_entry_free(struct x509_chain_cache_entry *entry)
+{
+	if (entry == NULL)
+		return;
+	sk_X509_pop_free(entry->chain, X509_free);
+	free(entry);
+}
+
+/*
+ * Remove an entry from the cache. Must be called with the cache mutex held.
+ */
+static void
+x509_chain_cache_unlink(struct x509_chain_cache *cache,
+    struct x509_chain_cache_entry *entry)
+{
+	TAILQ_REMOVE(&cache->lru, entry, queue);
+	RB_REMOVE(x509_chain_cache_tree, &cache->tree, entry);
+	x509_chain_cache_entry_free(entry);
+	cache->count--;
+}
+
+void
+x509_chain_cache_flush(struct x509_chain_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	if (pthread_mutex_lock(&cache->mutex) != 0)
+		return;
+	while (cache->count > 0)
+		x509_chain_cache_unlink(cache, TAILQ_LAST(&cache->lru,
+		    x509_chain_cache_lru));
+	(void) pthread_mutex_unlock(&cache->mutex);
+}
+
+void
+x509_chain_cache_free(struct x509_chain_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	x509_chain_cache_flush(cache);
+	(void) pthread_mutex_destroy(&cache->mutex);
+	free(cache);
+}
+
+/*
+ * Find the validated chain for key. Returns a new reference to a copy of
+ * the chain, or NULL if there is no entry or the entry has expired.
+ */
+STACK_OF(X509) *
+x509_chain_cache_find(struct x509_chain_cache *cache, const unsigned char *key,
+    time_t now)
+{
+	struct x509_chain_cache_entry candidate, *found;
+	STACK_OF(X509) *chain = NULL;
+
+	if (cache == NULL)
+		return NULL;
+
+	memset(&candidate, 0, sizeof(candidate));
+	memcpy(candidate.key, key, sizeof(candidate.key));
+
+	if (pthread_mutex_lock(&cache->mutex) != 0)
+		return NULL;
+	if ((found = RB_FIND(x509_chain_cache_tree, &cache->tree,
+	    &candidate)) != NULL) {
+		if (now > found->expires) {
+			x509_chain_cache_unlink(cache, found);
+		} else {
+			TAILQ_REMOVE(&cache->lru, found, queue);
+			TAILQ_INSERT_HEAD(&cache->lru, found, queue);
+			chain = X509_chain_up_ref(found->chain);
+		}
+	}
+	(void) pthread_mutex_unlock(&cache->mutex);
+
+	return chain;
+}
+
+/*
+ * Add a validated chain to the cache, replacing any previous entry for key.
+ * The chain must have had extensions cached, so that the validity times of
+ * the certificates are known.
+ */
+void
+x509_chain_cache_add(struct x509_chain_cache *cache, const unsigned char *key,
+    STACK_OF(X509) *chain, time_t now)
+{
+	struct x509_chain_cache_entry *new, *old;
+	X509 *cert;
+	int i;
+
+	if (cache == NULL || cache->max == 0)
+		return;
+
+	if ((new = calloc(1, sizeof(*new))) == NULL)
+		return;
+	memcpy(new->key, key, sizeof(new->key));
+
+	new->expires = -1;
+	for (i = 0; i < sk_X509_num(chain); i++) {
+		cert = sk_X509_value(chain, i);
+		if (cert->not_after == -1)
+			goto err;
+		if (new->expires == -1 || cert->not_after < new->expires)
+			new->expires = cert->not_after;
+	}
+	if (new->expires <= now)
+		goto err;
+
+	if ((new->chain = X509_chain_up_ref(chain)) == NULL)
+		goto err;
+
+	if (pthread_mutex_lock(&cache->mutex) != 0)
+		goto err;
+	if ((old = RB_FIND(x509_chain_cache_tree, &cache->tree, new)) != NULL)
+		x509_chain_cache_unlink(cache, old);
+	while (cache->count >= cache->max)
+		x509_chain_cache_unlink(cache, TAILQ_LAST(&cache->lru,
+		    x509_chain_cache_lru));
+	RB_INSERT(x509_chain_cache_tree, &cache->tree, new);
+	TAILQ_INSERT_HEAD(&cache->lru, new, queue);
+	cache->count++;
+	new = NULL;
+	(void) pthread_mutex_unlock(&cache->mutex);
+
+ err:
+	x509_chain_cache_entry_free(new);
+}
+
+void
+x509_chain_cache_remove(struct x509_chain_cache *cache,
+    const unsigned char *key)
+{
+	struct x509_chain_cache_entry candidate, *found;
+
+	if (cache == NULL)
+		return;
+
+	memset(&candidate, 0, sizeof(candidate));
+	memcpy(candidate.key, key, sizeof(candidate.key));
+
+	if (pthread_mutex_lock(&cache->mutex) != 0)
+		return;
+	if ((found = RB_FIND(x509_chain_cache_tree, &cache->tree,
+	    &candidate)) != NULL)
+		x509_chain_cache_unlink(cache, found);
+	(void) pthread_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,45 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* x509_chain_cache */
+#ifndef HEADER_X509_CHAIN_CACHE_H
+#define HEADER_X509_CHAIN_CACHE_H
+
+#include <time.h>
+
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+
+__BEGIN_HIDDEN_DECLS
+
+#define X509_CHAIN_CACHE_KEY_LEN	SHA256_DIGEST_LENGTH
+
+struct x509_chain_cache;
+
+struct x509_chain_cache *x509_chain_cache_new(size_t max);
+void x509_chain_cache_free(struct x509_chain_cache *cache);
+void x509_chain_cache_flush(struct x509_chain_cache *cache);
+STACK_OF(X509) *x509_chain_cache_find(struct x509_chain_cache *cache,
+    const unsigned char *key, time_t now);
+void x509_chain_cache_add(struct x509_chain_cache *cache,
+    const unsigned char *key, STACK_OF(X509) *chain, time_t now);
+void x509_chain_cache_remove(struct x509_chain_cache *cache,
+    const unsigned char *key);
+
+__END_HIDDEN_DECLS
+
+#endif
@@ -241,16 +241,10 @@ X509_NAME_cmp(const X509_NAME *a, const X509_NAME *b)
 	int ret;
 
 	/* Ensure canonical encoding is present and up to date */
-	if (!a->canon_enc || a->modified) {
-		ret = i2d_X509_NAME((X509_NAME *)a, NULL);
-		if (ret < 0)
-			return -2;
-	}
-	if (!b->canon_enc || b->modified) {
-		ret = i2d_X509_NAME((X509_NAME *)b, NULL);
-		if (ret < 0)
-			return -2;
-	}
+	if (!x509_name_ensure_canon((X509_NAME *)a))
+		return -2;
+	if (!x509_name_ensure_canon((X509_NAME *)b))
+		return -2;
 	ret = a->canon_enclen - b->canon_enclen;
 	if (ret)
 		return ret;
@@ -264,8 +258,9 @@ X509_NAME_hash(X509_NAME *x)
 	unsigned long ret = 0;
 	unsigned char md[SHA_DIGEST_LENGTH];
 
-	/* Make sure X509_NAME structure contains valid cached encoding */
-	i2d_X509_NAME(x, NULL);
+	/* Make sure X509_NAME structure contains valid canonical encoding */
+	if (!x509_name_ensure_canon(x))
+		return 0;
 	if (!EVP_Digest(x->canon_enc, x->canon_enclen, md, NULL, EVP_sha1(),
 	    NULL))
 		return 0;
@@ -729,7 +729,7 @@ x509_constraints_general_to_bytes(GENERAL_NAME *name, uint8_t **bytes,
 	if (name->type == GEN_DIRNAME) {
 		X509_NAME *dname = name->d.directoryName;
 
-		if (!dname->modified || i2d_X509_NAME(dname, NULL) >= 0) {
+		if (x509_name_ensure_canon(dname)) {
 			*bytes = dname->canon_enc;
 			*len = dname->canon_enclen;
 
@@ -859,8 +859,7 @@ x509_constraints_extract_names(struct x509_constraints_names *names,
 		 * the subject as a dirname to be compared against
 		 * any dirname constraints
 		 */
-		if ((subject_name->modified &&
-		    i2d_X509_NAME(subject_name, NULL) < 0) ||
+		if (!x509_name_ensure_canon(subject_name) ||
 		    (vname = x509_constraints_name_new()) == NULL ||
 		    (vname->der = malloc(subject_name->canon_enclen)) == NULL) {
 			*error = X509_V_ERR_OUT_OF_MEM;
@@ -1220,8 +1219,7 @@ x509_constraints_chain(STACK_OF(X509) *chain, int *error, int *depth)
 {
 	int chain_length, verify_err = X509_V_ERR_UNSPECIFIED, i = 0;
 	struct x509_constraints_names *names = NULL;
-	struct x509_constraints_names *excluded = NULL;
-	struct x509_constraints_names *permitted = NULL;
+	struct x509_constraints_index *index;
 	size_t constraints_count = 0;
 	X509 *cert;
 
@@ -1243,33 +1241,19 @@ x509_constraints_chain(STACK_OF(X509) *chain, int *error, int *depth)
 		if ((cert = sk_X509_value(chain, i)) == NULL)
 			goto err;
 		if (cert->nc != NULL) {
-			if ((permitted = x509_constraints_names_new(
-			    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL) {
-				verify_err = X509_V_ERR_OUT_OF_MEM;
-				goto err;
-			}
-			if ((excluded = x509_constraints_names_new(
-			    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL) {
-				verify_err = X509_V_ERR_OUT_OF_MEM;
-				goto err;
-			}
-			if (!x509_constraints_extract_constraints(cert,
-			    permitted, excluded, &verify_err))
+			if ((index = x509_constraints_index_get(cert,
+			    &verify_err)) == NULL)
 				goto err;
-			constraints_count += permitted->names_count;
-			constraints_count += excluded->names_count;
+			constraints_count +=
+			    x509_constraints_index_count(index);
 			if (constraints_count >
 			    X509_VERIFY_MAX_CHAIN_CONSTRAINTS) {
 				verify_err = X509_V_ERR_OUT_OF_MEM;
 				goto err;
 			}
-			if (!x509_constraints_check(names, permitted, excluded,
+			if (!x509_constraints_index_check(names, index,
 			    &verify_err))
 				goto err;
-			x509_constraints_names_free(excluded);
-			excluded = NULL;
-			x509_constraints_names_free(permitted);
-			permitted = NULL;
 		}
 		if (!x509_constraints_extract_names(names, cert, 0,
 		    &verify_err))
@@ -1282,8 +1266,6 @@ x509_constraints_chain(STACK_OF(X509) *chain, int *error, int *depth)
  err:
 	*error = verify_err;
 	*depth = i;
-	x509_constraints_names_free(excluded);
-	x509_constraints_names_free(permitted);
 	x509_constraints_names_free(names);
 	return 0;
 }
@@ -0,0 +1,499 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Precompiled name constraints of a CA certificate. DNS, URI and email
+ * domain constraints are kept in tries keyed on the reversed, lower cased
+ * constraint, so that all suffix and exact matches for a name are found in
+ * a single walk over the name. IP address constraints with a contiguous
+ * mask are kept in a binary prefix tree per address family. Everything
+ * else (directory names, mailboxes and IP constraints with holes in the
+ * mask) is matched linearly with x509_constraints_match().
+ *
+ * The index is built on first use and cached on the certificate, matching
+ * exactly what x509_constraints_check() does with the extracted lists.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include <openssl/x509v3.h>
+
+#include "x509_internal.h"
+#include "x509_local.h"
+
+/* The constraint is a suffix of any matching name. */
+#define TRIE_SUFFIX	0x01
+/* The constraint must equal the name. */
+#define TRIE_EXACT	0x02
+/* An exact constraint has this node's path as a suffix. */
+#define TRIE_BELOW_EXACT	0x04
+
+struct x509_constraints_trie {
+	struct x509_constraints_trie *child;
+	struct x509_constraints_trie *sibling;
+	uint8_t c;
+	uint8_t flags;
+};
+
+struct x509_constraints_ip_trie {
+	struct x509_constraints_ip_trie *child[2];
+	int terminal;
+};
+
+struct x509_constraints_set {
+	struct x509_constraints_trie *dns;
+	struct x509_constraints_trie *uri;
+	struct x509_constraints_trie *email;
+	struct x509_constraints_ip_trie *ipv4;
+	struct x509_constraints_ip_trie *ipv6;
+	struct x509_constraints_name **linear;
+	size_t linear_count;
+	size_t type_count[GEN_RID + 1];
+};
+
+struct x509_constraints_index {
+	struct x509_constraints_names *permitted_names;
+	struct x509_constraints_names *excluded_names;
+	struct x509_constraints_set permitted;
+	struct x509_constraints_set excluded;
+};
+
+static void
+x509_constraints_trie_free(struct x509_constraints_trie *node)
+{
+	struct x509_constraints_trie *sibling;
+
+	while (node != NULL) {
+		sibling = node->sibling;
+		x509_constraints_trie_free(node->child);
+		free(node);
+		node = sibling;
+	}
+}
+
+static struct x509_constraints_trie *
+x509_constraints_trie_child(struct x509_constraints_trie *node, uint8_t c)
+{
+	for (node = node->child; node != NULL; node = node->sibling) {
+		if (node->c == c)
+			return node;
+	}
+
+	return NULL;
+}
+
+static int
+x509_constraints_trie_insert(struct x509_constraints_trie **root,
+    const char *name, uint8_t flags, uint8_t path_flags)
+{
+	struct x509_constraints_trie *node, *child;
+	size_t len;
+	uint8_t c;
+
+	if (*root == NULL) {
+		if ((*root = calloc(1, sizeof(**root))) == NULL)
+			return 0;
+	}
+
+	node = *root;
+	node->flags |= path_flags;
+
+	for (len = strlen(name); len > 0; len--) {
+		c = tolower((unsigned char)name[len - 1]);
+		if ((child = x509_constraints_trie_child(node, c)) == NULL) {
+			if ((child = calloc(1, sizeof(*child))) == NULL)
+				return 0;
+			child->c = c;
+			child->sibling = node->child;
+			node->child = child;
+		}
+		node = child;
+		node->flags |= path_flags;
+	}
+	node->flags |= flags;
+
+	return 1;
+}
+
+/*
+ * Walk the name from its end. If domain is set the x509_constraints_domain()
+ * rules apply, otherwise those of x509_constraints_sandns().
+ */
+static int
+x509_constraints_trie_match(struct x509_constraints_trie *node,
+    const char *name, int domain)
+{
+	size_t len, dlen;
+
+	if (node == NULL)
+		return 0;
+	if (node->flags & TRIE_SUFFIX)
+		return 1;
+
+	dlen = strlen(name);
+	for (len = dlen; len > 0; len--) {
+		node = x509_constraints_trie_child(node,
+		    tolower((unsigned char)name[len - 1]));
+		if (node == NULL)
+			return 0;
+		if (node->flags & TRIE_SUFFIX)
+			return 1;
+	}
+
+	if (!domain)
+		return 0;
+	if (node->flags & TRIE_EXACT)
+		return 1;
+	if (dlen > 0 && name[0] == '.' && (node->flags & TRIE_BELOW_EXACT))
+		return 1;
+
+	return 0;
+}
+
+static int
+x509_constraints_trie_add_domain(struct x509_constraints_trie **root,
+    const char *name)
+{
+	if (name[0] == '\0' || name[0] == '.')
+		return x509_constraints_trie_insert(root, name, TRIE_SUFFIX, 0);
+
+	return x509_constraints_trie_insert(root, name, TRIE_EXACT,
+	    TRIE_BELOW_EXACT);
+}
+
+static void
+x509_constraints_ip_trie_free(struct x509_constraints_ip_trie *node)
+{
+	if (node == NULL)
+		return;
+
+	x509_constraints_ip_trie_free(node->child[0]);
+	x509_constraints_ip_trie_free(node->child[1]);
+	free(node);
+}
+
+static int
+x509_constraints_ip_bit(const uint8_t *address, size_t bit)
+{
+	return (address[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/*
+ * Returns the prefix length of a contiguous mask, or -1 if the mask has
+ * holes and cannot be put into the prefix tree.
+ */
+static int
+x509_constraints_ip_prefix_len(const uint8_t *mask, size_t alen)
+{
+	size_t bit, prefix_len;
+
+	for (prefix_len = 0; prefix_len < alen * 8; prefix_len++) {
+		if (!x509_constraints_ip_bit(mask, prefix_len))
+			break;
+	}
+	for (bit = prefix_len; bit < alen * 8; bit++) {
+		if (x509_constraints_ip_bit(mask, bit))
+			return -1;
+	}
+
+	return prefix_len;
+}
+
+static int
+x509_constraints_ip_trie_insert(struct x509_constraints_ip_trie **root,
+    const uint8_t *address, size_t prefix_len)
+{
+	struct x509_constraints_ip_trie *node, **child;
+	size_t bit;
+
+	if (*root == NULL) {
+		if ((*root = calloc(1, sizeof(**root))) == NULL)
+			return 0;
+	}
+
+	node = *root;
+	for (bit = 0; bit < prefix_len; bit++) {
+		child = &node->child[x509_constraints_ip_bit(address, bit)];
+		if (*child == NULL) {
+			if ((*child = calloc(1, sizeof(**child))) == NULL)
+				return 0;
+		}
+		node = *child;
+	}
+	node->terminal = 1;
+
+	return 1;
+}
+
+static int
+x509_constraints_ip_trie_match(struct x509_constraints_ip_trie *node,
+    const uint8_t *address, size_t alen)
+{
+	size_t bit;
+
+	for (bit = 0; node != NULL && bit < alen * 8; bit++) {
+		if (node->terminal)
+			return 1;
+		node = node->child[x509_constraints_ip_bit(address, bit)];
+	}
+
+	return node != NULL && node->terminal;
+}
+
+static void
+x509_constraints_set_clear(struct x509_constraints_set *set)
+{
+	x509_constraints_trie_free(set->dns);
+	x509_constraints_trie_free(set->uri);
+	x509_constraints_trie_free(set->email);
+	x509_constraints_ip_trie_free(set->ipv4);
+	x509_constraints_ip_trie_free(set->ipv6);
+	free(set->linear);
+	memset(set, 0, sizeof(*set));
+}
+
+static int
+x509_constraints_set_add_linear(struct x509_constraints_set *set,
+    struct x509_constraints_name *name)
+{
+	struct x509_constraints_name **linear;
+
+	if ((linear = reallocarray(set->linear, set->linear_count + 1,
+	    sizeof(*linear))) == NULL)
+		return 0;
+	set->linear = linear;
+	set->linear[set->linear_count++] = name;
+
+	return 1;
+}
+
+static int
+x509_constraints_set_add_ipaddr(struct x509_constraints_set *set,
+    struct x509_constraints_name *name)
+{
+	struct x509_constraints_ip_trie **root;
+	size_t alen;
+	int prefix_len;
+
+	if (name->af == AF_INET) {
+		root = &set->ipv4;
+		alen = 4;
+	} else if (name->af == AF_INET6) {
+		root = &set->ipv6;
+		alen = 16;
+	} else
+		return x509_constraints_set_add_linear(set, name);
+
+	/* The constraint is the address followed by the mask. */
+	if ((prefix_len = x509_constraints_ip_prefix_len(name->address + alen,
+	    alen)) == -1)
+		return x509_constraints_set_add_linear(set, name);
+
+	return x509_constraints_ip_trie_insert(root, name->address,
+	    prefix_len);
+}
+
+static int
+x509_constraints_set_add(struct x509_constraints_set *set,
+    struct x509_constraints_name *name)
+{
+	if (name->type < 0 || name->type > GEN_RID)
+		return 0;
+	set->type_count[name->type]++;
+
+	switch (name->type) {
+	case GEN_DNS:
+		return x509_constraints_trie_insert(&set->dns, name->name,
+		    TRIE_SUFFIX, 0);
+	case GEN_URI:
+		return x509_constraints_trie_add_domain(&set->uri, name->name);
+	case GEN_EMAIL:
+		if (name->local != NULL)
+			break;
+		return x509_constraints_trie_add_domain(&set->email,
+		    name->name);
+	case GEN_IPADD:
+		return x509_constraints_set_add_ipaddr(set, name);
+	}
+
+	return x509_constraints_set_add_linear(set, name);
+}
+
+static int
+x509_constraints_set_match(struct x509_constraints_set *set,
+    struct x509_constraints_name *name)
+{
+	size_t i;
+
+	switch (name->type) {
+	case GEN_DNS:
+		return x509_constraints_trie_match(set->dns, name->name, 0);
+	case GEN_URI:
+		return x509_constraints_trie_match(set->uri, name->name, 1);
+	case GEN_EMAIL:
+		if (x509_constraints_trie_match(set->email, name->name, 1))
+			return 1;
+		break;
+	case GEN_IPADD:
+		if (name->af == AF_INET &&
+		    x509_constraints_ip_trie_match(set->ipv4, name->address, 4))
+			return 1;
+		if (name->af == AF_INET6 &&
+		    x509_constraints_ip_trie_match(set->ipv6, name->address,
+		    16))
+			return 1;
+		break;
+	}
+
+	for (i = 0; i < set->linear_count; i++) {
+		if (x509_constraints_match(name, set->linear[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
+static int
+x509_constraints_set_build(struct x509_constraints_set *set,
+    struct x509_constraints_names *names)
+{
+	size_t i;
+
+	for (i = 0; i < names->names_count; i++) {
+		if (!x509_constraints_set_add(set, names->names[i]))
+			return 0;
+	}
+
+	return 1;
+}
+
+void
+x509_constraints_index_free(struct x509_constraints_index *index)
+{
+	if (index == NULL)
+		return;
+
+	x509_constraints_set_clear(&index->permitted);
+	x509_constraints_set_clear(&index->excluded);
+	x509_constraints_names_free(index->permitted_names);
+	x509_constraints_names_free(index->excluded_names);
+	free(index);
+}
+
+static struct x509_constraints_index *
+x509_constraints_index_new(X509 *cert, int *error)
+{
+	struct x509_constraints_index *index;
+
+	*error = X509_V_ERR_OUT_OF_MEM;
+
+	if ((index = calloc(1, sizeof(*index))) == NULL)
+		goto err;
+	if ((index->permitted_names = x509_constraints_names_new(
+	    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL)
+		goto err;
+	if ((index->excluded_names = x509_constraints_names_new(
+	    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL)
+		goto err;
+	if (!x509_constraints_extract_constraints(cert,
+	    index->permitted_names, index->excluded_names, error))
+		goto err;
+
+	*error = X509_V_ERR_OUT_OF_MEM;
+	if (!x509_constraints_set_build(&index->permitted,
+	    index->permitted_names))
+		goto err;
+	if (!x509_constraints_set_build(&index->excluded,
+	    index->excluded_names))
+		goto err;
+
+	*error = X509_V_OK;
+
+	return index;
+
+ err:
+	x509_constraints_index_free(index);
+
+	return NULL;
+}
+
+/*
+ * Returns the name constraints index of cert, building and caching it on
+ * first use. Errors are not cached, the caller fails verification anyway.
+ */
+struct x509_constraints_index *
+x509_constraints_index_get(X509 *cert, int *error)
+{
+	struct x509_constraints_index *index, *installed = NULL;
+
+	index = atomic_load_explicit(&cert->nc_index, memory_order_acquire);
+	if (index != NULL)
+		return index;
+
+	if ((index = x509_constraints_index_new(cert, error)) == NULL)
+		return NULL;
+
+	if (!atomic_compare_exchange_strong_explicit(&cert->nc_index,
+	    &installed, index, memory_order_acq_rel, memory_order_acquire)) {
+		/* Another thread got there first. */
+		x509_constraints_index_free(index);
+		return installed;
+	}
+
+	return index;
+}
+
+size_t
+x509_constraints_index_count(struct x509_constraints_index *index)
+{
+	return index->permitted_names->names_count +
+	    index->excluded_names->names_count;
+}
+
+/*
+ * Same as x509_constraints_check(), using the precompiled constraints.
+ */
+int
+x509_constraints_index_check(struct x509_constraints_names *names,
+    struct x509_constraints_index *index, int *error)
+{
+	struct x509_constraints_name *name;
+	size_t i;
+
+	for (i = 0; i < names->names_count; i++) {
+		name = names->names[i];
+
+		if (x509_constraints_set_match(&index->excluded, name)) {
+			*error = X509_V_ERR_EXCLUDED_VIOLATION;
+			return 0;
+		}
+		if (name->type < 0 || name->type > GEN_RID)
+			continue;
+		if (index->permitted.type_count[name->type] == 0)
+			continue;
+		if (!x509_constraints_set_match(&index->permitted, name)) {
+			*error = X509_V_ERR_PERMITTED_VIOLATION;
+			return 0;
+		}
+	}
+
+	return 1;
+}
@@ -0,0 +1,708 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * CRL revocation index.
+ *
+ * The index is a table of fixed width entries sorted by serial number,
+ * built by walking the DER encoding of a CRL without decoding the revoked
+ * entries into X509_REVOKED structures. Its in-memory layout is identical
+ * to its file format, so that a previously written index can be loaded
+ * and used without walking the CRL again.
+ *
+ * All integers are stored in network byte order:
+ *
+ *	header		magic "X509CRX1"
+ *			u32 number of entries
+ *			u8[64] SHA-512 hash of the DER encoded CRL
+ *	entry		u8 serial number length
+ *			u8[24] serial number magnitude, zero padded
+ *			u32 position of the entry in the CRL
+ *			u8 flags
+ *			u8[2] zero padding
+ *
+ * Comparing the first 25 bytes of two entries orders them by serial number.
+ * CRLs containing negative or overlong serial numbers, indirect entries or
+ * critical entry extensions cannot be indexed.
+ */
+
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "bytestring.h"
+#include "x509_local.h"
+
+#define X509_CRL_INDEX_MAGIC		"X509CRX1"
+#define X509_CRL_INDEX_MAGIC_LEN	8
+#define X509_CRL_INDEX_HEADER_LEN \
+    (X509_CRL_INDEX_MAGIC_LEN + 4 + X509_CRL_HASH_LEN)
+#define X509_CRL_INDEX_SERIAL_MAX	24
+#define X509_CRL_INDEX_KEY_LEN		(1 + X509_CRL_INDEX_SERIAL_MAX)
+#define X509_CRL_INDEX_ENTRY_LEN	(X509_CRL_INDEX_KEY_LEN + 4 + 1 + 2)
+#define X509_CRL_INDEX_MAX_ENTRIES	(1 << 26)
+
+#define X509_CRL_INDEX_REMOVE_FROM_CRL	0x01
+
+struct x509_crl_index_st {
+	uint8_t *mem;
+	size_t mem_len;
+	const uint8_t *entries;
+	uint32_t num_entries;
+	uint8_t hash[X509_CRL_HASH_LEN];
+	int references;
+};
+
+/* id-ce-cRLReasons and id-ce-certificateIssuer. */
+static const uint8_t crl_reason_oid[] = { 0x55, 0x1d, 0x15 };
+static const uint8_t certificate_issuer_oid[] = { 0x55, 0x1d, 0x1d };
+
+static X509_CRL_INDEX *
+x509_crl_index_alloc(void)
+{
+	X509_CRL_INDEX *index;
+
+	if ((index = calloc(1, sizeof(*index))) == NULL) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+	index->references = 1;
+
+	return index;
+}
+
+void
+X509_CRL_INDEX_free(X509_CRL_INDEX *index)
+{
+	if (index == NULL)
+		return;
+
+	if (CRYPTO_add(&index->references, -1, CRYPTO_LOCK_X509_CRL) > 0)
+		return;
+
+	freezero(index->mem, index->mem_len);
+	free(index);
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_free);
+
+int
+X509_CRL_INDEX_up_ref(X509_CRL_INDEX *index)
+{
+	return CRYPTO_add(&index->references, 1, CRYPTO_LOCK_X509_CRL) > 1;
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_up_ref);
+
+/*
+ * Parse the header of an index in index->mem and set up the entry table.
+ * The entries are checked separately by x509_crl_index_check().
+ */
+static int
+x509_crl_index_parse(X509_CRL_INDEX *index)
+{
+	CBS cbs, magic, hash;
+
+	CBS_init(&cbs, index->mem, index->mem_len);
+
+	if (!CBS_get_bytes(&cbs, &magic, X509_CRL_INDEX_MAGIC_LEN))
+		return 0;
+	if (!CBS_mem_equal(&magic, X509_CRL_INDEX_MAGIC,
+	    X509_CRL_INDEX_MAGIC_LEN))
+		return 0;
+	if (!CBS_get_u32(&cbs, &index->num_entries))
+		return 0;
+	if (!CBS_get_bytes(&cbs, &hash, X509_CRL_HASH_LEN))
+		return 0;
+	if (index->num_entries > X509_CRL_INDEX_MAX_ENTRIES)
+		return 0;
+	if (CBS_len(&cbs) !=
+	    (size_t)index->num_entries * X509_CRL_INDEX_ENTRY_LEN)
+		return 0;
+
+	memcpy(index->hash, CBS_data(&hash), X509_CRL_HASH_LEN);
+	index->entries = CBS_data(&cbs);
+
+	return 1;
+}
+
+static int
+x509_crl_index_entry_cmp(const void *a, const void *b)
+{
+	/* Break ties on the position, so the first entry in the CRL wins. */
+	return memcmp(a, b, X509_CRL_INDEX_KEY_LEN + 4);
+}
+
+/*
+ * Check that the entries of an index read from a file are well formed,
+ * sorted and refer to positions within the CRL, so that lookups behave
+ * as they would in an index built from the CRL.
+ */
+static int
+x509_crl_index_check(const X509_CRL_INDEX *index)
+{
+	const uint8_t *entry, *prev = NULL;
+	uint32_t i, position;
+	uint8_t len, flags;
+	size_t j;
+	CBS cbs;
+
+	for (i = 0; i < index->num_entries; i++) {
+		entry = &index->entries[(size_t)i * X509_CRL_INDEX_ENTRY_LEN];
+
+		/* Minimal magnitude, zero padded. */
+		if ((len = entry[0]) > X509_CRL_INDEX_SERIAL_MAX)
+			return 0;
+		if (len > 0 && entry[1] == 0)
+			return 0;
+		for (j = 1 + len; j < X509_CRL_INDEX_KEY_LEN; j++) {
+			if (entry[j] != 0)
+				return 0;
+		}
+
+		CBS_init(&cbs, entry + X509_CRL_INDEX_KEY_LEN,
+		    X509_CRL_INDEX_ENTRY_LEN - X509_CRL_INDEX_KEY_LEN);
+		if (!CBS_get_u32(&cbs, &position))
+			return 0;
+		if (position >= index->num_entries)
+			return 0;
+		if (!CBS_get_u8(&cbs, &flags))
+			return 0;
+		if ((flags & ~X509_CRL_INDEX_REMOVE_FROM_CRL) != 0)
+			return 0;
+		if (!CBS_mem_equal(&cbs, "\0\0", 2))
+			return 0;
+
+		if (prev != NULL && x509_crl_index_entry_cmp(prev, entry) >= 0)
+			return 0;
+		prev = entry;
+	}
+
+	return 1;
+}
+
+/*
+ * Parse the extensions of a revoked entry, looking for a removeFromCRL
+ * reason code. Extensions that would change the meaning of the entry are
+ * not supported.
+ */
+static int
+x509_crl_index_entry_flags(CBS *extensions, uint8_t *out_flags)
+{
+	CBS ext, oid, boolean, value, reason;
+	uint8_t critical, code;
+
+	*out_flags = 0;
+
+	while (CBS_len(extensions) > 0) {
+		if (!CBS_get_asn1(extensions, &ext, CBS_ASN1_SEQUENCE))
+			return 0;
+		if (!CBS_get_asn1(&ext, &oid, CBS_ASN1_OBJECT))
+			return 0;
+		critical = 0;
+		if (CBS_peek_asn1_tag(&ext, CBS_ASN1_BOOLEAN)) {
+			if (!CBS_get_asn1(&ext, &boolean, CBS_ASN1_BOOLEAN))
+				return 0;
+			if (!CBS_get_u8(&boolean, &critical) ||
+			    CBS_len(&boolean) != 0)
+				return 0;
+		}
+		if (!CBS_get_asn1(&ext, &value, CBS_ASN1_OCTETSTRING))
+			return 0;
+		if (CBS_len(&ext) != 0)
+			return 0;
+
+		if (CBS_mem_equal(&oid, certificate_issuer_oid,
+		    sizeof(certificate_issuer_oid)))
+			return 0;
+		if (CBS_mem_equal(&oid, crl_reason_oid,
+		    sizeof(crl_reason_oid))) {
+			if (!CBS_get_asn1(&value, &reason,
+			    CBS_ASN1_ENUMERATED))
+				return 0;
+			if (!CBS_get_u8(&reason, &code) ||
+			    CBS_len(&reason) != 0)
+				return 0;
+			if (code == CRL_REASON_REMOVE_FROM_CRL)
+				*out_flags |= X509_CRL_INDEX_REMOVE_FROM_CRL;
+			continue;
+		}
+		if (critical)
+			return 0;
+	}
+
+	return 1;
+}
+
+static int
+x509_crl_index_add_entry(CBB *cbb, CBS *revoked, uint32_t position)
+{
+	uint8_t serial[X509_CRL_INDEX_SERIAL_MAX];
+	CBS entry, cbs, extensions;
+	uint8_t flags = 0;
+
+	if (!CBS_get_asn1(revoked, &entry, CBS_ASN1_SEQUENCE))
+		return 0;
+	if (!CBS_get_asn1(&entry, &cbs, CBS_ASN1_INTEGER))
+		return 0;
+
+	/* Negative serial numbers are not supported. */
+	if (CBS_len(&cbs) == 0 || (CBS_data(&cbs)[0] & 0x80) != 0)
+		return 0;
+	while (CBS_len(&cbs) > 0 && CBS_data(&cbs)[0] == 0)
+		CBS_skip(&cbs, 1);
+	if (CBS_len(&cbs) > X509_CRL_INDEX_SERIAL_MAX)
+		return 0;
+
+	memset(serial, 0, sizeof(serial));
+	memcpy(serial, CBS_data(&cbs), CBS_len(&cbs));
+
+	/* revocationDate */
+	if (!CBS_get_any_asn1_element(&entry, NULL, NULL, NULL))
+		return 0;
+	if (CBS_len(&entry) > 0) {
+		if (!CBS_get_asn1(&entry, &extensions, CBS_ASN1_SEQUENCE))
+			return 0;
+		if (!x509_crl_index_entry_flags(&extensions, &flags))
+			return 0;
+	}
+	if (CBS_len(&entry) != 0)
+		return 0;
+
+	if (!CBB_add_u8(cbb, CBS_len(&cbs)))
+		return 0;
+	if (!CBB_add_bytes(cbb, serial, sizeof(serial)))
+		return 0;
+	if (!CBB_add_u32(cbb, position))
+		return 0;
+	if (!CBB_add_u8(cbb, flags))
+		return 0;
+	if (!CBB_add_u16(cbb, 0))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Build an index from a DER encoded TBSCertList, binding it to the given
+ * CRL hash.
+ */
+static X509_CRL_INDEX *
+x509_crl_index_build(CBS *tbs_der, const uint8_t *hash)
+{
+	X509_CRL_INDEX *index = NULL;
+	CBS tbs, revoked, entries;
+	uint32_t num_entries = 0;
+	uint8_t *entry_mem;
+	CBB cbb;
+
+	memset(&cbb, 0, sizeof(cbb));
+	CBS_init(&revoked, NULL, 0);
+
+	if (!CBS_get_asn1(tbs_der, &tbs, CBS_ASN1_SEQUENCE))
+		goto err;
+	if (CBS_peek_asn1_tag(&tbs, CBS_ASN1_INTEGER)) {
+		if (!CBS_get_asn1(&tbs, NULL, CBS_ASN1_INTEGER))
+			goto err;
+	}
+	/* signature, issuer, thisUpdate */
+	if (!CBS_get_asn1(&tbs, NULL, CBS_ASN1_SEQUENCE))
+		goto err;
+	if (!CBS_get_asn1(&tbs, NULL, CBS_ASN1_SEQUENCE))
+		goto err;
+	if (!CBS_get_any_asn1_element(&tbs, NULL, NULL, NULL))
+		goto err;
+	/* nextUpdate is the only optional field that is not a SEQUENCE. */
+	if (CBS_len(&tbs) > 0 && !CBS_peek_asn1_tag(&tbs, CBS_ASN1_SEQUENCE) &&
+	    !CBS_peek_asn1_tag(&tbs,
+	    CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED)) {
+		if (!CBS_get_any_asn1_element(&tbs, NULL, NULL, NULL))
+			goto err;
+	}
+	if (CBS_peek_asn1_tag(&tbs, CBS_ASN1_SEQUENCE)) {
+		if (!CBS_get_asn1(&tbs, &revoked, CBS_ASN1_SEQUENCE))
+			goto err;
+	}
+
+	CBS_dup(&revoked, &entries);
+	while (CBS_len(&entries) > 0) {
+		if (!CBS_get_asn1(&entries, NULL, CBS_ASN1_SEQUENCE))
+			goto err;
+		if (++num_entries > X509_CRL_INDEX_MAX_ENTRIES)
+			goto err;
+	}
+
+	if ((index = x509_crl_index_alloc()) == NULL)
+		return NULL;
+	memcpy(index->hash, hash, X509_CRL_HASH_LEN);
+
+	if (!CBB_init(&cbb, X509_CRL_INDEX_HEADER_LEN +
+	    (size_t)num_entries * X509_CRL_INDEX_ENTRY_LEN))
+		goto err;
+	if (!CBB_add_bytes(&cbb, X509_CRL_INDEX_MAGIC,
+	    X509_CRL_INDEX_MAGIC_LEN))
+		goto err;
+	if (!CBB_add_u32(&cbb, num_entries))
+		goto err;
+	if (!CBB_add_bytes(&cbb, hash, X509_CRL_HASH_LEN))
+		goto err;
+
+	for (num_entries = 0; CBS_len(&revoked) > 0; num_entries++) {
+		if (!x509_crl_index_add_entry(&cbb, &revoked, num_entries))
+			goto err;
+	}
+
+	if (!CBB_finish(&cbb, &index->mem, &index->mem_len))
+		goto err;
+
+	entry_mem = index->mem + X509_CRL_INDEX_HEADER_LEN;
+	qsort(entry_mem, num_entries, X509_CRL_INDEX_ENTRY_LEN,
+	    x509_crl_index_entry_cmp);
+
+	if (!x509_crl_index_parse(index))
+		goto err;
+
+	return index;
+
+ err:
+	X509error(X509_R_ERR_ASN1_LIB);
+	CBB_cleanup(&cbb);
+	X509_CRL_INDEX_free(index);
+
+	return NULL;
+}
+
+X509_CRL_INDEX *
+X509_CRL_INDEX_new(const unsigned char *der, size_t der_len)
+{
+	uint8_t hash[X509_CRL_HASH_LEN];
+	CBS cbs, crl, tbs;
+
+	CBS_init(&cbs, der, der_len);
+	if (!CBS_get_asn1_element(&cbs, &crl, CBS_ASN1_SEQUENCE) ||
+	    CBS_len(&cbs) != 0) {
+		X509error(X509_R_ERR_ASN1_LIB);
+		return NULL;
+	}
+
+	/* Same hash as the one cached in the X509_CRL by the decoder. */
+	SHA512(CBS_data(&crl), CBS_len(&crl), hash);
+
+	CBS_dup(&crl, &cbs);
+	if (!CBS_get_asn1(&cbs, &tbs, CBS_ASN1_SEQUENCE)) {
+		X509error(X509_R_ERR_ASN1_LIB);
+		return NULL;
+	}
+
+	return x509_crl_index_build(&tbs, hash);
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_new);
+
+/*
+ * Build an index for a decoded CRL from its cached TBSCertList encoding.
+ * Returns NULL without error if the CRL cannot be indexed.
+ */
+X509_CRL_INDEX *
+x509_crl_index_new_crl(X509_CRL *crl)
+{
+	X509_CRL_INDEX *index;
+	CBS tbs;
+
+	if (crl->crl->enc.enc == NULL || crl->crl->enc.modified)
+		return NULL;
+	if (crl->issuers != NULL)
+		return NULL;
+
+	CBS_init(&tbs, crl->crl->enc.enc, crl->crl->enc.len);
+
+	ERR_set_mark();
+	index = x509_crl_index_build(&tbs, crl->hash);
+	ERR_pop_to_mark();
+
+	if (index == NULL)
+		return NULL;
+
+	if (index->num_entries !=
+	    (uint32_t)sk_X509_REVOKED_num(crl->crl->revoked)) {
+		X509_CRL_INDEX_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+/*
+ * The file is read into memory rather than mapped, a mapping would fault
+ * if the file was truncated while the index is in use.
+ */
+X509_CRL_INDEX *
+X509_CRL_INDEX_load_file(const char *path)
+{
+	X509_CRL_INDEX *index = NULL;
+	struct stat sb;
+	uint8_t *mem = NULL;
+	size_t mem_len = 0, off;
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		X509error(ERR_R_SYS_LIB);
+		return NULL;
+	}
+	if (fstat(fd, &sb) == -1) {
+		X509error(ERR_R_SYS_LIB);
+		goto err;
+	}
+	if (sb.st_size < X509_CRL_INDEX_HEADER_LEN ||
+	    sb.st_size > X509_CRL_INDEX_HEADER_LEN +
+	    (off_t)X509_CRL_INDEX_MAX_ENTRIES * X509_CRL_INDEX_ENTRY_LEN) {
+		X509error(X509_R_BAD_X509_FILETYPE);
+		goto err;
+	}
+	mem_len = sb.st_size;
+	if ((mem = malloc(mem_len)) == NULL) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	for (off = 0; off < mem_len; off += n) {
+		if ((n = read(fd, mem + off, mem_len - off)) == -1) {
+			X509error(ERR_R_SYS_LIB);
+			goto err;
+		}
+		if (n == 0) {
+			X509error(X509_R_BAD_X509_FILETYPE);
+			goto err;
+		}
+	}
+
+	if ((index = x509_crl_index_alloc()) == NULL)
+		goto err;
+	index->mem = mem;
+	index->mem_len = mem_len;
+	mem = NULL;
+
+	if (!x509_crl_index_parse(index) || !x509_crl_index_check(index)) {
+		X509error(X509_R_BAD_X509_FILETYPE);
+		goto err;
+	}
+
+	close(fd);
+
+	return index;
+
+ err:
+	close(fd);
+	free(mem);
+	X509_CRL_INDEX_free(index);
+
+	return NULL;
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_load_file);
+
+int
+X509_CRL_INDEX_write_bio(BIO *bio, const X509_CRL_INDEX *index)
+{
+	if (index->mem_len > INT_MAX)
+		return 0;
+	if (BIO_write(bio, index->mem, index->mem_len) != (int)index->mem_len)
+		return 0;
+
+	return 1;
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_write_bio);
+
+/*
+ * Build the lookup key for serial. Fails for serial numbers that cannot be
+ * in an index.
+ */
+static int
+x509_crl_index_key(const ASN1_INTEGER *serial, uint8_t *key)
+{
+	CBS cbs;
+
+	if (serial->type == V_ASN1_NEG_INTEGER)
+		return 0;
+	CBS_init(&cbs, serial->data, serial->length);
+	while (CBS_len(&cbs) > 0 && CBS_data(&cbs)[0] == 0)
+		CBS_skip(&cbs, 1);
+	if (CBS_len(&cbs) > X509_CRL_INDEX_SERIAL_MAX)
+		return 0;
+
+	memset(key, 0, X509_CRL_INDEX_KEY_LEN);
+	key[0] = CBS_len(&cbs);
+	memcpy(&key[1], CBS_data(&cbs), CBS_len(&cbs));
+
+	return 1;
+}
+
+/*
+ * Find the first entry for serial. On success return 1 and the position of
+ * the entry in the CRL and whether it has the removeFromCRL reason.
+ */
+int
+x509_crl_index_find(const X509_CRL_INDEX *index, const ASN1_INTEGER *serial,
+    uint32_t *out_position, int *out_removed)
+{
+	uint8_t key[X509_CRL_INDEX_KEY_LEN];
+	const uint8_t *entry;
+	uint32_t lo, hi, mid;
+	uint8_t flags;
+	CBS cbs;
+
+	/* The index never contains negative or overlong serial numbers. */
+	if (!x509_crl_index_key(serial, key))
+		return 0;
+
+	lo = 0;
+	hi = index->num_entries;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		entry = &index->entries[(size_t)mid * X509_CRL_INDEX_ENTRY_LEN];
+		if (memcmp(entry, key, sizeof(key)) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == index->num_entries)
+		return 0;
+
+	entry = &index->entries[(size_t)lo * X509_CRL_INDEX_ENTRY_LEN];
+	if (memcmp(entry, key, sizeof(key)) != 0)
+		return 0;
+
+	CBS_init(&cbs, entry + sizeof(key),
+	    X509_CRL_INDEX_ENTRY_LEN - sizeof(key));
+	if (!CBS_get_u32(&cbs, out_position))
+		return 0;
+	if (!CBS_get_u8(&cbs, &flags))
+		return 0;
+	*out_removed = (flags & X509_CRL_INDEX_REMOVE_FROM_CRL) != 0;
+
+	return 1;
+}
+
+int
+X509_CRL_INDEX_lookup(const X509_CRL_INDEX *index, const ASN1_INTEGER *serial)
+{
+	uint32_t position;
+	int removed;
+
+	if (!x509_crl_index_find(index, serial, &position, &removed))
+		return 0;
+
+	return removed ? 2 : 1;
+}
+LCRYPTO_ALIAS(X509_CRL_INDEX_lookup);
+
+/*
+ * Check that index holds exactly the revoked entries of crl, each at its
+ * position in the CRL. The hash only ties an index to a CRL, it does not
+ * vouch for the entries of an index read from a file, and lookups rely on
+ * a serial number missing from the index not being revoked. Must be called
+ * with the CRL lock held, so that the revoked entries are not reordered.
+ */
+static int
+x509_crl_index_matches_crl(const X509_CRL_INDEX *index, X509_CRL *crl)
+{
+	uint8_t key[X509_CRL_INDEX_KEY_LEN];
+	const uint8_t *entry;
+	X509_REVOKED *rev;
+	uint8_t *seen = NULL;
+	uint32_t i, position;
+	int removed;
+	int ret = 0;
+	CBS cbs;
+
+	if (crl->crl->enc.modified || crl->issuers != NULL)
+		goto err;
+	/* Sorting lost the order of the entries in the encoding. */
+	if (sk_X509_REVOKED_is_sorted(crl->crl->revoked))
+		goto err;
+	if (index->num_entries !=
+	    (uint32_t)sk_X509_REVOKED_num(crl->crl->revoked))
+		goto err;
+	if (index->num_entries == 0)
+		return 1;
+	if ((seen = calloc(index->num_entries, 1)) == NULL)
+		goto err;
+
+	for (i = 0; i < index->num_entries; i++) {
+		entry = &index->entries[(size_t)i * X509_CRL_INDEX_ENTRY_LEN];
+		CBS_init(&cbs, entry + X509_CRL_INDEX_KEY_LEN,
+		    X509_CRL_INDEX_ENTRY_LEN - X509_CRL_INDEX_KEY_LEN);
+		if (!CBS_get_u32(&cbs, &position))
+			goto err;
+		if (position >= index->num_entries || seen[position])
+			goto err;
+		seen[position] = 1;
+
+		rev = sk_X509_REVOKED_value(crl->crl->revoked, position);
+		if (!x509_crl_index_key(rev->serialNumber, key))
+			goto err;
+		if (memcmp(entry, key, sizeof(key)) != 0)
+			goto err;
+		removed = (entry[X509_CRL_INDEX_KEY_LEN + 4] &
+		    X509_CRL_INDEX_REMOVE_FROM_CRL) != 0;
+		if (removed != (rev->reason == CRL_REASON_REMOVE_FROM_CRL))
+			goto err;
+	}
+
+	ret = 1;
+
+ err:
+	free(seen);
+
+	return ret;
+}
+
+int
+X509_CRL_set1_index(X509_CRL *crl, X509_CRL_INDEX *index)
+{
+	int ret = 0;
+
+	if (memcmp(index->hash, crl->hash, X509_CRL_HASH_LEN) != 0) {
+		X509error(X509_R_WRONG_TYPE);
+		return 0;
+	}
+	if (!X509_CRL_INDEX_up_ref(index))
+		return 0;
+
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_CRL);
+	/* Lookups use the index without a reference, it cannot be replaced. */
+	if (crl->index == NULL) {
+		if (x509_crl_index_matches_crl(index, crl)) {
+			crl->index = index;
+			index = NULL;
+			ret = 1;
+		} else
+			X509error(X509_R_WRONG_TYPE);
+	}
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_CRL);
+
+	X509_CRL_INDEX_free(index);
+
+	return ret;
+}
+LCRYPTO_ALIAS(X509_CRL_set1_index);
@@ -28,6 +28,7 @@
 #define X509_VERIFY_MAX_CHAINS		8	/* Max validated chains */
 #define X509_VERIFY_MAX_CHAIN_CERTS	32	/* Max depth of a chain */
 #define X509_VERIFY_MAX_SIGCHECKS	256	/* Max signature checks */
+#define X509_VERIFY_MAX_SIGCHECKS_LIMIT	100000	/* Max configurable checks */
 
 /*
  * Limit the number of names and constraints we will check in a chain
@@ -79,6 +80,11 @@ struct x509_verify_ctx {
 	size_t max_depth;		/* Max chain depth for validation */
 	size_t max_sigs;		/* Max number of signature checks */
 	size_t sig_checks;		/* Number of signature checks done */
+	size_t max_paths;		/* Max partial chains, 0 for no limit */
+	size_t paths;			/* Number of partial chains built */
+	X509_STORE_dispatch_fn dispatch; /* Runs signature checks */
+	void *dispatch_arg;
+	struct x509_verify_sig_batch *sig_batch; /* Prefetched signatures */
 	size_t error_depth;		/* Depth of last error seen */
 	int error;			/* Last error seen */
 };
@@ -100,6 +106,7 @@ time_t x509_verify_asn1_time_to_time_t(const ASN1_TIME *atime, int notafter);
 
 struct x509_verify_ctx *x509_verify_ctx_new_from_xsc(X509_STORE_CTX *xsc);
 
+struct x509_constraints_name *x509_constraints_name_new(void);
 void x509_constraints_name_clear(struct x509_constraints_name *name);
 void x509_constraints_name_free(struct x509_constraints_name *name);
 int x509_constraints_names_add(struct x509_constraints_names *names,
@@ -128,9 +135,16 @@ int x509_constraints_extract_constraints(X509 *cert,
     struct x509_constraints_names *excluded, int *error);
 int x509_constraints_validate(GENERAL_NAME *constraint,
     struct x509_constraints_name **out_name, int *error);
+int x509_constraints_match(struct x509_constraints_name *name,
+    struct x509_constraints_name *constraint);
 int x509_constraints_check(struct x509_constraints_names *names,
     struct x509_constraints_names *permitted,
     struct x509_constraints_names *excluded, int *error);
+struct x509_constraints_index *x509_constraints_index_get(X509 *cert,
+    int *error);
+size_t x509_constraints_index_count(struct x509_constraints_index *index);
+int x509_constraints_index_check(struct x509_constraints_names *names,
+    struct x509_constraints_index *index, int *error);
 int x509_constraints_chain(STACK_OF(X509) *chain, int *error,
     int *depth);
 void x509_verify_cert_info_populate(X509 *cert);
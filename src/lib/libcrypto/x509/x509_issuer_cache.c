@@ -29,6 +29,13 @@
  * validity of "child". It allows us to skip doing the public key math
  * when validating a certificate chain. It does not allow us to skip
  * any other steps of validation (times, names, key usage, etc.)
+ *
+ * The cache is split into shards, each with its own lock, so that
+ * verifying threads rarely contend. Recency is tracked with a CLOCK
+ * approximation of LRU: a hit only sets the referenced flag of the entry,
+ * so lookups can share a read lock. When a shard is full, the clock hand
+ * sweeps the ring, clearing referenced flags until it finds an entry that
+ * has not been used since the hand last passed it.
  */
 
 #include <pthread.h>
@@ -45,68 +52,232 @@ x509_issuer_cmp(struct x509_issuer *x1, struct x509_issuer *x2)
 	return memcmp(x1->child_md, x2->child_md, EVP_MAX_MD_SIZE);
 }
 
-static size_t x509_issuer_cache_count;
-static size_t x509_issuer_cache_max = X509_ISSUER_CACHE_MAX;
-static RB_HEAD(x509_issuer_tree, x509_issuer) x509_issuer_cache =
-    RB_INITIALIZER(&x509_issuer_cache);
-static TAILQ_HEAD(lruqueue, x509_issuer) x509_issuer_lru =
-    TAILQ_HEAD_INITIALIZER(x509_issuer_lru);
-static pthread_mutex_t x509_issuer_tree_mutex = PTHREAD_MUTEX_INITIALIZER;
+RB_HEAD(x509_issuer_tree, x509_issuer);
+TAILQ_HEAD(x509_issuer_ring, x509_issuer);
+
+struct x509_issuer_shard {
+	pthread_rwlock_t lock;
+	struct x509_issuer_tree tree;
+	struct x509_issuer_ring ring;
+	struct x509_issuer *hand;	/* Next eviction candidate. */
+	size_t count;
+	size_t max;
+	atomic_uint_fast64_t hits;
+	atomic_uint_fast64_t misses;
+	atomic_uint_fast64_t evictions;
+};
+
+static struct x509_issuer_shard x509_issuer_shards[X509_ISSUER_CACHE_SHARDS];
+static pthread_once_t x509_issuer_shards_once = PTHREAD_ONCE_INIT;
+static int x509_issuer_shards_ready;
 
 RB_PROTOTYPE(x509_issuer_tree, x509_issuer, entry, x509_issuer_cmp);
 RB_GENERATE(x509_issuer_tree, x509_issuer, entry, x509_issuer_cmp);
 
+static void
+x509_issuer_shards_init(void)
+{
+	struct x509_issuer_shard *shard;
+	size_t i;
+
+	for (i = 0; i < X509_ISSUER_CACHE_SHARDS; i++) {
+		shard = &x509_issuer_shards[i];
+		if (pthread_rwlock_init(&shard->lock, NULL) != 0)
+			return;
+		RB_INIT(&shard->tree);
+		TAILQ_INIT(&shard->ring);
+		shard->max = X509_ISSUER_CACHE_MAX / X509_ISSUER_CACHE_SHARDS;
+	}
+	x509_issuer_shards_ready = 1;
+}
+
+static int
+x509_issuer_shards_setup(void)
+{
+	if (pthread_once(&x509_issuer_shards_once,
+	    x509_issuer_shards_init) != 0)
+		return 0;
+	return x509_issuer_shards_ready;
+}
+
 /*
- * Set the maximum number of cached entries. On additions to the cache
- * the least recently used entries will be discarded so that the cache
- * stays under the maximum number of entries.  Setting a maximum of 0
- * disables the cache.
+ * The digests are uniformly distributed, so a byte of each is enough to
+ * pick a shard.
+ */
+static struct x509_issuer_shard *
+x509_issuer_shard(const unsigned char *parent_md,
+    const unsigned char *child_md)
+{
+	return &x509_issuer_shards[(parent_md[0] ^ child_md[0]) %
+	    X509_ISSUER_CACHE_SHARDS];
+}
+
+static void
+x509_issuer_free(struct x509_issuer *issuer)
+{
+	if (issuer == NULL)
+		return;
+	free(issuer->parent_md);
+	free(issuer->child_md);
+	free(issuer);
+}
+
+/*
+ * Evict one entry from the shard, giving entries that have been used since
+ * the clock hand last passed them a second chance. Must be called with the
+ * shard write locked.
+ */
+static void
+x509_issuer_shard_evict(struct x509_issuer_shard *shard)
+{
+	struct x509_issuer *victim;
+
+	if (shard->count == 0)
+		return;
+
+	for (;;) {
+		if (shard->hand == NULL)
+			shard->hand = TAILQ_FIRST(&shard->ring);
+		victim = shard->hand;
+		shard->hand = TAILQ_NEXT(victim, queue);
+		if (!atomic_exchange_explicit(&victim->referenced, 0,
+		    memory_order_relaxed))
+			break;
+	}
+
+	TAILQ_REMOVE(&shard->ring, victim, queue);
+	RB_REMOVE(x509_issuer_tree, &shard->tree, victim);
+	x509_issuer_free(victim);
+	shard->count--;
+	atomic_fetch_add_explicit(&shard->evictions, 1, memory_order_relaxed);
+}
+
+/*
+ * Set the maximum number of entries in one shard of the cache, discarding
+ * entries if the shard is above the new maximum. Setting a maximum of 0
+ * disables caching in the shard.
  */
 int
-x509_issuer_cache_set_max(size_t max)
+X509_issuer_cache_set_shard_max(size_t idx, size_t max)
 {
-	if (pthread_mutex_lock(&x509_issuer_tree_mutex) != 0)
+	struct x509_issuer_shard *shard;
+
+	if (idx >= X509_ISSUER_CACHE_SHARDS)
 		return 0;
-	x509_issuer_cache_max = max;
-	(void) pthread_mutex_unlock(&x509_issuer_tree_mutex);
+	if (!x509_issuer_shards_setup())
+		return 0;
+
+	shard = &x509_issuer_shards[idx];
+
+	if (pthread_rwlock_wrlock(&shard->lock) != 0)
+		return 0;
+	shard->max = max;
+	while (shard->count > shard->max)
+		x509_issuer_shard_evict(shard);
+	(void) pthread_rwlock_unlock(&shard->lock);
 
 	return 1;
 }
+LCRYPTO_ALIAS(X509_issuer_cache_set_shard_max);
 
 /*
- * Free the oldest entry in the issuer cache. Returns 1
- * if an entry was successfully freed, 0 otherwise. Must
- * be called with x509_issuer_tree_mutex held.
+ * Set the maximum number of cached entries, which is divided evenly between
+ * the shards. On additions to the cache entries that have not been used
+ * recently will be discarded so that each shard stays under its maximum
+ * number of entries. Setting a maximum of 0 disables the cache.
  */
-void
-x509_issuer_cache_free_oldest()
+int
+X509_issuer_cache_set_max(size_t max)
 {
-	struct x509_issuer *old;
+	size_t i, shard_max;
 
-	if (x509_issuer_cache_count == 0)
-		return;
-	old = TAILQ_LAST(&x509_issuer_lru, lruqueue);
-	TAILQ_REMOVE(&x509_issuer_lru, old, queue);
-	RB_REMOVE(x509_issuer_tree, &x509_issuer_cache, old);
-	free(old->parent_md);
-	free(old->child_md);
-	free(old);
-	x509_issuer_cache_count--;
+	shard_max = max / X509_ISSUER_CACHE_SHARDS;
+	if (max > 0 && shard_max == 0)
+		shard_max = 1;
+
+	for (i = 0; i < X509_ISSUER_CACHE_SHARDS; i++) {
+		if (!X509_issuer_cache_set_shard_max(i, shard_max))
+			return 0;
+	}
+
+	return 1;
 }
+LCRYPTO_ALIAS(X509_issuer_cache_set_max);
+
+/*
+ * Return the number of shards the cache is split into.
+ */
+size_t
+X509_issuer_cache_shards(void)
+{
+	return X509_ISSUER_CACHE_SHARDS;
+}
+LCRYPTO_ALIAS(X509_issuer_cache_shards);
 
 /*
  * Free the entire issuer cache, discarding all entries.
  */
 void
-x509_issuer_cache_free()
+x509_issuer_cache_free(void)
 {
-	if (pthread_mutex_lock(&x509_issuer_tree_mutex) != 0)
+	struct x509_issuer_shard *shard;
+	size_t i;
+
+	if (!x509_issuer_shards_setup())
 		return;
-	while (x509_issuer_cache_count > 0)
-		x509_issuer_cache_free_oldest();
-	(void) pthread_mutex_unlock(&x509_issuer_tree_mutex);
+
+	for (i = 0; i < X509_ISSUER_CACHE_SHARDS; i++) {
+		shard = &x509_issuer_shards[i];
+		if (pthread_rwlock_wrlock(&shard->lock) != 0)
+			continue;
+		while (shard->count > 0)
+			x509_issuer_shard_evict(shard);
+		shard->hand = NULL;
+		(void) pthread_rwlock_unlock(&shard->lock);
+	}
 }
 
+/*
+ * Return the number of hits, misses and evictions since the cache was
+ * created, along with the current number of entries. Any of the pointers
+ * may be NULL.
+ */
+void
+X509_issuer_cache_stats(uint64_t *out_hits, uint64_t *out_misses,
+    uint64_t *out_evictions, size_t *out_entries)
+{
+	struct x509_issuer_shard *shard;
+	uint64_t hits = 0, misses = 0, evictions = 0;
+	size_t entries = 0;
+	size_t i;
+
+	if (x509_issuer_shards_setup()) {
+		for (i = 0; i < X509_ISSUER_CACHE_SHARDS; i++) {
+			shard = &x509_issuer_shards[i];
+			hits += atomic_load_explicit(&shard->hits,
+			    memory_order_relaxed);
+			misses += atomic_load_explicit(&shard->misses,
+			    memory_order_relaxed);
+			evictions += atomic_load_explicit(&shard->evictions,
+			    memory_order_relaxed);
+			if (pthread_rwlock_rdlock(&shard->lock) != 0)
+				continue;
+			entries += shard->count;
+			(void) pthread_rwlock_unlock(&shard->lock);
+		}
+	}
+
+	if (out_hits != NULL)
+		*out_hits = hits;
+	if (out_misses != NULL)
+		*out_misses = misses;
+	if (out_evictions != NULL)
+		*out_evictions = evictions;
+	if (out_entries != NULL)
+		*out_entries = entries;
+}
+LCRYPTO_ALIAS(X509_issuer_cache_stats);
+
 /*
  * Find a previous result of checking if parent signed child
  *
@@ -119,24 +290,34 @@ int
 x509_issuer_cache_find(unsigned char *parent_md, unsigned char *child_md)
 {
 	struct x509_issuer candidate, *found;
+	struct x509_issuer_shard *shard;
 	int ret = -1;
 
 	memset(&candidate, 0, sizeof(candidate));
 	candidate.parent_md = parent_md;
 	candidate.child_md = child_md;
 
-	if (x509_issuer_cache_max == 0)
+	if (!x509_issuer_shards_setup())
 		return -1;
 
-	if (pthread_mutex_lock(&x509_issuer_tree_mutex) != 0)
+	shard = x509_issuer_shard(parent_md, child_md);
+
+	if (pthread_rwlock_rdlock(&shard->lock) != 0)
 		return -1;
-	if ((found = RB_FIND(x509_issuer_tree, &x509_issuer_cache,
+	if ((found = RB_FIND(x509_issuer_tree, &shard->tree,
 	    &candidate)) != NULL) {
-		TAILQ_REMOVE(&x509_issuer_lru, found, queue);
-		TAILQ_INSERT_HEAD(&x509_issuer_lru, found, queue);
+		atomic_store_explicit(&found->referenced, 1,
+		    memory_order_relaxed);
 		ret = found->valid;
 	}
-	(void) pthread_mutex_unlock(&x509_issuer_tree_mutex);
+	(void) pthread_rwlock_unlock(&shard->lock);
+
+	if (ret == -1)
+		atomic_fetch_add_explicit(&shard->misses, 1,
+		    memory_order_relaxed);
+	else
+		atomic_fetch_add_explicit(&shard->hits, 1,
+		    memory_order_relaxed);
 
 	return ret;
 }
@@ -154,12 +335,15 @@ void
 x509_issuer_cache_add(unsigned char *parent_md, unsigned char *child_md,
     int valid)
 {
+	struct x509_issuer_shard *shard;
 	struct x509_issuer *new;
 
-	if (x509_issuer_cache_max == 0)
-		return;
 	if (valid != 0 && valid != 1)
 		return;
+	if (!x509_issuer_shards_setup())
+		return;
+
+	shard = x509_issuer_shard(parent_md, child_md);
 
 	if ((new = calloc(1, sizeof(struct x509_issuer))) == NULL)
 		return;
@@ -172,22 +356,25 @@ x509_issuer_cache_add(unsigned char *parent_md, unsigned char *child_md,
 
 	new->valid = valid;
 
-	if (pthread_mutex_lock(&x509_issuer_tree_mutex) != 0)
+	if (pthread_rwlock_wrlock(&shard->lock) != 0)
+		goto err;
+	if (shard->max == 0) {
+		(void) pthread_rwlock_unlock(&shard->lock);
 		goto err;
-	while (x509_issuer_cache_count >= x509_issuer_cache_max)
-		x509_issuer_cache_free_oldest();
-	if (RB_INSERT(x509_issuer_tree, &x509_issuer_cache, new) == NULL) {
-		TAILQ_INSERT_HEAD(&x509_issuer_lru, new, queue);
-		x509_issuer_cache_count++;
+	}
+	while (shard->count >= shard->max)
+		x509_issuer_shard_evict(shard);
+	if (RB_INSERT(x509_issuer_tree, &shard->tree, new) == NULL) {
+		/* Insert just behind the hand, the last place it visits. */
+		if (shard->hand != NULL)
+			TAILQ_INSERT_BEFORE(shard->hand, new, queue);
+		else
+			TAILQ_INSERT_TAIL(&shard->ring, new, queue);
+		shard->count++;
 		new = NULL;
 	}
-	(void) pthread_mutex_unlock(&x509_issuer_tree_mutex);
+	(void) pthread_rwlock_unlock(&shard->lock);
 
  err:
-	if (new != NULL) {
-		free(new->parent_md);
-		free(new->child_md);
-	}
-	free(new);
-	return;
+	x509_issuer_free(new);
 }
@@ -59,6 +59,8 @@
 #ifndef HEADER_X509_LOCAL_H
 #define HEADER_X509_LOCAL_H
 
+#include <stdatomic.h>
+
 __BEGIN_HIDDEN_DECLS
 
 #define TS_HASH_EVP		EVP_sha1()
@@ -99,6 +101,7 @@ struct X509_name_st {
 /*	unsigned long hash; Keep the hash around for lookups */
 	unsigned char *canon_enc;
 	int canon_enclen;
+	atomic_int canon_valid;	/* canon_enc has been generated */
 } /* X509_NAME */;
 
 struct X509_extension_st {
@@ -161,7 +164,6 @@ struct x509_st {
 	ASN1_BIT_STRING *signature;
 	int valid;
 	int references;
-	char *name;
 	CRYPTO_EX_DATA ex_data;
 	/* These contain copies of various extension values */
 	long ex_pathlen;
@@ -174,6 +176,8 @@ struct x509_st {
 	STACK_OF(DIST_POINT) *crldp;
 	STACK_OF(GENERAL_NAME) *altname;
 	NAME_CONSTRAINTS *nc;
+	/* Compiled nc, built on use. */
+	struct x509_constraints_index *_Atomic nc_index;
 #ifndef OPENSSL_NO_RFC3779
 	STACK_OF(IPAddressFamily) *rfc3779_addr;
 	struct ASIdentifiers_st *rfc3779_asid;
@@ -226,6 +230,9 @@ struct X509_crl_st {
 	STACK_OF(GENERAL_NAMES) *issuers;
 	const X509_CRL_METHOD *meth;
 	void *meth_data;
+	/* Revocation index, protected by CRYPTO_LOCK_X509_CRL. */
+	X509_CRL_INDEX *index;
+	int no_index;
 } /* X509_CRL */;
 
 struct pkcs8_priv_key_info_st {
@@ -271,6 +278,8 @@ struct X509_VERIFY_PARAM_st {
 	int trust;		/* trust setting to check */
 	int depth;		/* Verify depth */
 	int security_level;	/* 'Security level', see SP800-57. */
+	int max_signatures;	/* Signature check budget, 0 for default */
+	int max_chains;		/* Partial chain budget, 0 for default */
 	STACK_OF(ASN1_OBJECT) *policies;	/* Permissible policies */
 	STACK_OF(OPENSSL_STRING) *hosts; /* Set of acceptable names */
 	unsigned int hostflags;     /* Flags to control matching features */
@@ -290,6 +299,9 @@ struct X509_VERIFY_PARAM_st {
 struct x509_store_st {
 	/* The following is a cache of trusted certs */
 	STACK_OF(X509_OBJECT) *objs;	/* Cache of all objects */
+	struct x509_store_index *index;	/* Hash indexes over objs */
+	int objs_generation;		/* Bumped when objs may change */
+	int objs_exported;		/* objs handed out, index unusable */
 
 	/* These are external lookup methods */
 	STACK_OF(X509_LOOKUP) *get_cert_methods;
@@ -309,6 +321,13 @@ struct x509_store_st {
 	STACK_OF(X509_CRL) * (*lookup_crls)(X509_STORE_CTX *ctx, X509_NAME *nm);
 	int (*cleanup)(X509_STORE_CTX *ctx);
 
+	/* Validated chains, see x509_chain_cache.c. */
+	struct x509_chain_cache *chain_cache;
+
+	/* Runs candidate signature checks on the caller's threads. */
+	X509_STORE_dispatch_fn dispatch;
+	void *dispatch_arg;
+
 	CRYPTO_EX_DATA ex_data;
 	int references;
 } /* X509_STORE */;
@@ -379,10 +398,18 @@ int x509_check_cert_time(X509_STORE_CTX *ctx, X509 *x, int quiet);
 
 int name_cmp(const char *name, const char *cmp);
 
+int x509_name_ensure_canon(X509_NAME *name);
+
 int X509_policy_check(const STACK_OF(X509) *certs,
     const STACK_OF(ASN1_OBJECT) *user_policies, unsigned long flags,
     X509 **out_current_cert);
 
+X509_CRL_INDEX *x509_crl_index_new_crl(X509_CRL *crl);
+int x509_crl_index_find(const X509_CRL_INDEX *index, const ASN1_INTEGER *serial,
+    uint32_t *out_position, int *out_removed);
+
+void x509_constraints_index_free(struct x509_constraints_index *index);
+
 __END_HIDDEN_DECLS
 
 #endif /* !HEADER_X509_LOCAL_H */
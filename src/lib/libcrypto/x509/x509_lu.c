@@ -63,7 +63,11 @@
 #include <openssl/lhash.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
+
+#include "x509_chain_cache.h"
+#include "x509_internal.h"
 #include "x509_local.h"
+#include "x509_store_index.h"
 
 X509_LOOKUP *
 X509_LOOKUP_new(X509_LOOKUP_METHOD *method)
@@ -198,6 +202,8 @@ X509_STORE_new(void)
 
 	if ((store->objs = sk_X509_OBJECT_new(x509_object_cmp)) == NULL)
 		goto err;
+	if ((store->index = x509_store_index_new()) == NULL)
+		goto err;
 	if ((store->get_cert_methods = sk_X509_LOOKUP_new_null()) == NULL)
 		goto err;
 	if ((store->param = X509_VERIFY_PARAM_new()) == NULL)
@@ -275,6 +281,8 @@ X509_STORE_free(X509_STORE *store)
 	}
 	sk_X509_LOOKUP_free(sk);
 	sk_X509_OBJECT_pop_free(store->objs, X509_OBJECT_free);
+	x509_store_index_free(store->index);
+	x509_chain_cache_free(store->chain_cache);
 
 	CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE, store, &store->ex_data);
 	X509_VERIFY_PARAM_free(store->param);
@@ -318,6 +326,39 @@ X509_STORE_add_lookup(X509_STORE *store, X509_LOOKUP_METHOD *method)
 }
 LCRYPTO_ALIAS(X509_STORE_add_lookup);
 
+/*
+ * Bring the index up to date with the store's object stack. Once the stack
+ * has been handed out by X509_STORE_get0_objects() the caller may delete
+ * and add objects behind our back without changing the object count, so
+ * from then on the index is rebuilt for every lookup.
+ * The caller must hold the store lock.
+ */
+static int
+x509_store_sync_index(X509_STORE *store)
+{
+	if (store->objs_exported)
+		store->objs_generation++;
+
+	return x509_store_index_sync(store->index, store->objs,
+	    store->objs_generation);
+}
+
+/*
+ * Return the first object of the given type and subject in the store.
+ * The caller must hold the store lock.
+ */
+static X509_OBJECT *
+x509_store_retrieve_by_subject(X509_STORE *store, X509_LOOKUP_TYPE type,
+    X509_NAME *name)
+{
+	struct x509_store_index_entry *cursor = NULL;
+
+	if (!x509_store_sync_index(store))
+		return NULL;
+
+	return x509_store_index_subject_next(store->index, type, name, &cursor);
+}
+
 X509_OBJECT *
 X509_STORE_CTX_get_obj_by_subject(X509_STORE_CTX *vs, X509_LOOKUP_TYPE type,
     X509_NAME *name)
@@ -350,7 +391,7 @@ X509_STORE_CTX_get_by_subject(X509_STORE_CTX *vs, X509_LOOKUP_TYPE type,
 	memset(&stmp, 0, sizeof(stmp));
 
 	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-	tmp = X509_OBJECT_retrieve_by_subject(ctx->objs, type, name);
+	tmp = x509_store_retrieve_by_subject(ctx, type, name);
 	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
 
 	if (tmp == NULL || type == X509_LU_CRL) {
@@ -382,7 +423,12 @@ X509_STORE_add_object(X509_STORE *store, X509_OBJECT *obj)
 
 	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
 
-	if (X509_OBJECT_retrieve_match(store->objs, obj) != NULL) {
+	if (!x509_store_sync_index(store)) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		goto out;
+	}
+
+	if (x509_store_index_match(store->index, obj) != NULL) {
 		/* Object is already present in the store. That's fine. */
 		ret = 1;
 		goto out;
@@ -393,6 +439,15 @@ X509_STORE_add_object(X509_STORE *store, X509_OBJECT *obj)
 		goto out;
 	}
 
+	store->objs_generation++;
+
+	/* On failure the index is rebuilt by the next lookup. */
+	(void)x509_store_index_add(store->index, obj, store->objs_generation);
+
+	/* A new certificate may allow chains to be built differently. */
+	if (obj->type == X509_LU_X509)
+		x509_chain_cache_flush(store->chain_cache);
+
 	obj = NULL;
 	ret = 1;
 
@@ -469,16 +524,15 @@ X509_OBJECT_get_type(const X509_OBJECT *a)
 }
 LCRYPTO_ALIAS(X509_OBJECT_get_type);
 
-static int
-x509_object_idx_cnt(STACK_OF(X509_OBJECT) *h, X509_LOOKUP_TYPE type,
-    X509_NAME *name, int *pnmatch)
+int
+X509_OBJECT_idx_by_subject(STACK_OF(X509_OBJECT) *h, X509_LOOKUP_TYPE type,
+    X509_NAME *name)
 {
 	X509_OBJECT stmp;
 	X509 x509_s;
 	X509_CINF cinf_s;
 	X509_CRL crl_s;
 	X509_CRL_INFO crl_info_s;
-	int idx;
 
 	stmp.type = type;
 	switch (type) {
@@ -496,28 +550,7 @@ x509_object_idx_cnt(STACK_OF(X509_OBJECT) *h, X509_LOOKUP_TYPE type,
 		return -1;
 	}
 
-	idx = sk_X509_OBJECT_find(h, &stmp);
-	if (idx >= 0 && pnmatch) {
-		int tidx;
-		const X509_OBJECT *tobj, *pstmp;
-
-		*pnmatch = 1;
-		pstmp = &stmp;
-		for (tidx = idx + 1; tidx < sk_X509_OBJECT_num(h); tidx++) {
-			tobj = sk_X509_OBJECT_value(h, tidx);
-			if (x509_object_cmp(&tobj, &pstmp))
-				break;
-			(*pnmatch)++;
-		}
-	}
-	return idx;
-}
-
-int
-X509_OBJECT_idx_by_subject(STACK_OF(X509_OBJECT) *h, X509_LOOKUP_TYPE type,
-    X509_NAME *name)
-{
-	return x509_object_idx_cnt(h, type, name, NULL);
+	return sk_X509_OBJECT_find(h, &stmp);
 }
 LCRYPTO_ALIAS(X509_OBJECT_idx_by_subject);
 
@@ -555,22 +588,20 @@ LCRYPTO_ALIAS(X509_OBJECT_get0_X509_CRL);
 static STACK_OF(X509) *
 X509_get1_certs_from_cache(X509_STORE *store, X509_NAME *name)
 {
+	struct x509_store_index_entry *cursor = NULL;
 	STACK_OF(X509) *sk = NULL;
 	X509 *x = NULL;
 	X509_OBJECT *obj;
-	int i, idx, cnt;
 
 	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
 
-	idx = x509_object_idx_cnt(store->objs, X509_LU_X509, name, &cnt);
-	if (idx < 0)
+	if (!x509_store_sync_index(store))
 		goto err;
 
-	if ((sk = sk_X509_new_null()) == NULL)
-		goto err;
-
-	for (i = 0; i < cnt; i++, idx++) {
-		obj = sk_X509_OBJECT_value(store->objs, idx);
+	while ((obj = x509_store_index_subject_next(store->index, X509_LU_X509,
+	    name, &cursor)) != NULL) {
+		if (sk == NULL && (sk = sk_X509_new_null()) == NULL)
+			goto err;
 
 		x = obj->data.x509;
 		if (!X509_up_ref(x)) {
@@ -579,6 +610,7 @@ X509_get1_certs_from_cache(X509_STORE *store, X509_NAME *name)
 		}
 		if (!sk_X509_push(sk, x))
 			goto err;
+		x = NULL;
 	}
 
 	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
@@ -621,9 +653,9 @@ X509_STORE_CTX_get1_crls(X509_STORE_CTX *ctx, X509_NAME *name)
 {
 	X509_STORE *store = ctx->store;
 	STACK_OF(X509_CRL) *sk = NULL;
+	struct x509_store_index_entry *cursor = NULL;
 	X509_CRL *x = NULL;
 	X509_OBJECT *obj = NULL;
-	int i, idx, cnt;
 
 	if (store == NULL)
 		return NULL;
@@ -637,15 +669,13 @@ X509_STORE_CTX_get1_crls(X509_STORE_CTX *ctx, X509_NAME *name)
 	obj = NULL;
 
 	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-	idx = x509_object_idx_cnt(store->objs, X509_LU_CRL, name, &cnt);
-	if (idx < 0)
+	if (!x509_store_sync_index(store))
 		goto err;
 
-	if ((sk = sk_X509_CRL_new_null()) == NULL)
-		goto err;
-
-	for (i = 0; i < cnt; i++, idx++) {
-		obj = sk_X509_OBJECT_value(store->objs, idx);
+	while ((obj = x509_store_index_subject_next(store->index, X509_LU_CRL,
+	    name, &cursor)) != NULL) {
+		if (sk == NULL && (sk = sk_X509_CRL_new_null()) == NULL)
+			goto err;
 
 		x = obj->data.crl;
 		if (!X509_CRL_up_ref(x)) {
@@ -654,6 +684,7 @@ X509_STORE_CTX_get1_crls(X509_STORE_CTX *ctx, X509_NAME *name)
 		}
 		if (!sk_X509_CRL_push(sk, x))
 			goto err;
+		x = NULL;
 	}
 
 	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
@@ -696,6 +727,79 @@ X509_OBJECT_retrieve_match(STACK_OF(X509_OBJECT) *h, X509_OBJECT *x)
 }
 LCRYPTO_ALIAS(X509_OBJECT_retrieve_match);
 
+/*
+ * Look through the store for a certificate accepted by 'check_issued'.
+ * Candidates whose subject key identifier or issuer and serial number
+ * match the authority key identifier of x are tried first, followed by
+ * all certificates with a matching subject name. If no candidate has a
+ * valid time, the last one accepted is returned as the nearest match.
+ * The caller must hold the store lock.
+ */
+static X509 *
+x509_store_find_issuer(X509_STORE_CTX *ctx, X509 *x, X509_NAME *xn)
+{
+	struct x509_store_index *index = ctx->store->index;
+	struct x509_store_index_entry *cursor;
+	AUTHORITY_KEYID *akid;
+	GENERAL_NAME *gen;
+	X509_NAME *akid_issuer = NULL;
+	X509_OBJECT *obj;
+	X509 *issuer = NULL;
+	int i;
+
+	(void)x509v3_cache_extensions(x);
+
+	if ((akid = x->akid) != NULL && akid->keyid != NULL) {
+		cursor = NULL;
+		while ((obj = x509_store_index_keyid_next(index, akid->keyid,
+		    &cursor)) != NULL) {
+			if (!ctx->check_issued(ctx, x, obj->data.x509))
+				continue;
+			issuer = obj->data.x509;
+			if (x509_check_cert_time(ctx, issuer, -1))
+				return issuer;
+		}
+	}
+
+	if (akid != NULL && akid->issuer != NULL && akid->serial != NULL) {
+		for (i = 0; i < sk_GENERAL_NAME_num(akid->issuer); i++) {
+			gen = sk_GENERAL_NAME_value(akid->issuer, i);
+			if (gen->type == GEN_DIRNAME) {
+				akid_issuer = gen->d.dirn;
+				break;
+			}
+		}
+	}
+	if (akid_issuer != NULL) {
+		cursor = NULL;
+		while ((obj = x509_store_index_serial_next(index, akid_issuer,
+		    akid->serial, &cursor)) != NULL) {
+			if (!ctx->check_issued(ctx, x, obj->data.x509))
+				continue;
+			issuer = obj->data.x509;
+			if (x509_check_cert_time(ctx, issuer, -1))
+				return issuer;
+		}
+	}
+
+	cursor = NULL;
+	while ((obj = x509_store_index_subject_next(index, X509_LU_X509, xn,
+	    &cursor)) != NULL) {
+		if (!ctx->check_issued(ctx, x, obj->data.x509))
+			continue;
+		issuer = obj->data.x509;
+		/*
+		 * If times check, exit with match, otherwise keep looking.
+		 * Leave last match in issuer so we return nearest match if
+		 * no certificate time is OK.
+		 */
+		if (x509_check_cert_time(ctx, issuer, -1))
+			return issuer;
+	}
+
+	return issuer;
+}
+
 /* Try to get issuer certificate from store. Due to limitations
  * of the API this can only retrieve a single certificate matching
  * a given subject name. However it will fill the cache with all
@@ -711,9 +815,9 @@ int
 X509_STORE_CTX_get1_issuer(X509 **out_issuer, X509_STORE_CTX *ctx, X509 *x)
 {
 	X509_NAME *xn;
-	X509_OBJECT *obj, *pobj;
+	X509_OBJECT *obj;
 	X509 *issuer = NULL;
-	int i, idx, ret;
+	int ret;
 
 	*out_issuer = NULL;
 
@@ -747,32 +851,13 @@ X509_STORE_CTX_get1_issuer(X509 **out_issuer, X509_STORE_CTX *ctx, X509 *x)
 	if (ctx->store == NULL)
 		return 0;
 
-	/* Else find index of first cert accepted by 'check_issued' */
+	/* Else find the first cert accepted by 'check_issued' */
 	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-	idx = X509_OBJECT_idx_by_subject(ctx->store->objs, X509_LU_X509, xn);
-	if (idx != -1) /* should be true as we've had at least one match */ {
-		/* Look through all matching certs for suitable issuer */
-		for (i = idx; i < sk_X509_OBJECT_num(ctx->store->objs); i++) {
-			pobj = sk_X509_OBJECT_value(ctx->store->objs, i);
-			/* See if we've run past the matches */
-			if (pobj->type != X509_LU_X509)
-				break;
-			if (X509_NAME_cmp(xn,
-			    X509_get_subject_name(pobj->data.x509)))
-				break;
-			if (ctx->check_issued(ctx, x, pobj->data.x509)) {
-				issuer = pobj->data.x509;
-				/*
-				 * If times check, exit with match,
-				 * otherwise keep looking. Leave last
-				 * match in issuer so we return nearest
-				 * match if no certificate time is OK.
-				 */
-				if (x509_check_cert_time(ctx, issuer, -1))
-					break;
-			}
-		}
+	if (!x509_store_sync_index(ctx->store)) {
+		CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+		return -1;
 	}
+	issuer = x509_store_find_issuer(ctx, x, xn);
 	ret = 0;
 	if (issuer != NULL) {
 		if (!X509_up_ref(issuer)) {
@@ -790,6 +875,11 @@ LCRYPTO_ALIAS(X509_STORE_CTX_get1_issuer);
 STACK_OF(X509_OBJECT) *
 X509_STORE_get0_objects(X509_STORE *xs)
 {
+	/* The caller may modify the stack at any time from now on. */
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	xs->objs_exported = 1;
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+
 	return xs->objs;
 }
 LCRYPTO_ALIAS(X509_STORE_get0_objects);
@@ -823,6 +913,23 @@ X509_STORE_set_depth(X509_STORE *ctx, int depth)
 }
 LCRYPTO_ALIAS(X509_STORE_set_depth);
 
+int
+X509_STORE_set_chain_cache_size(X509_STORE *store, size_t max)
+{
+	struct x509_chain_cache *cache = NULL;
+
+	if (max > 0 && (cache = x509_chain_cache_new(max)) == NULL) {
+		X509error(ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+
+	x509_chain_cache_free(store->chain_cache);
+	store->chain_cache = cache;
+
+	return 1;
+}
+LCRYPTO_ALIAS(X509_STORE_set_chain_cache_size);
+
 int
 X509_STORE_set_purpose(X509_STORE *ctx, int purpose)
 {
@@ -872,6 +979,15 @@ X509_STORE_set_verify_cb(X509_STORE *store, X509_STORE_CTX_verify_cb verify_cb)
 }
 LCRYPTO_ALIAS(X509_STORE_set_verify_cb);
 
+void
+X509_STORE_set_dispatch(X509_STORE *store, X509_STORE_dispatch_fn dispatch,
+    void *arg)
+{
+	store->dispatch = dispatch;
+	store->dispatch_arg = arg;
+}
+LCRYPTO_ALIAS(X509_STORE_set_dispatch);
+
 X509_STORE_CTX_verify_cb
 X509_STORE_get_verify_cb(X509_STORE *store)
 {
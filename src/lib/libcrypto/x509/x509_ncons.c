@@ -436,9 +436,9 @@ static int
 nc_dn(X509_NAME *nm, X509_NAME *base)
 {
 	/* Ensure canonical encodings are up to date.  */
-	if (nm->modified && i2d_X509_NAME(nm, NULL) < 0)
+	if (!x509_name_ensure_canon(nm))
 		return X509_V_ERR_OUT_OF_MEM;
-	if (base->modified && i2d_X509_NAME(base, NULL) < 0)
+	if (!x509_name_ensure_canon(base))
 		return X509_V_ERR_OUT_OF_MEM;
 	if (base->canon_enclen > nm->canon_enclen)
 		return X509_V_ERR_PERMITTED_VIOLATION;
@@ -0,0 +1,440 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* x509_store_index */
+
+/*
+ * Hash indexes over the objects held in an X509_STORE. Objects are indexed
+ * by subject name (issuer name for CRLs) and certificates additionally by
+ * subject key identifier and by issuer name and serial number. The index
+ * does not hold references, the objects are owned by the store's stack and
+ * the caller must hold the store lock.
+ *
+ * Entries within a bucket are kept in insertion order, so that lookups
+ * return matching objects in the order they were added to the store.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/x509v3.h>
+
+#include "x509_internal.h"
+#include "x509_local.h"
+#include "x509_store_index.h"
+
+#define X509_STORE_INDEX_MIN_BUCKETS	64
+
+struct x509_store_index_entry {
+	struct x509_store_index_entry *next;
+	X509_OBJECT *obj;
+	uint32_t hash;
+};
+
+struct x509_store_index_table {
+	struct x509_store_index_entry **buckets;
+	size_t num_buckets;
+	size_t count;
+};
+
+struct x509_store_index {
+	struct x509_store_index_table subjects;
+	struct x509_store_index_table keyids;
+	struct x509_store_index_table serials;
+	int num_objs;
+	int generation;		/* Store generation that is indexed. */
+};
+
+static uint32_t
+x509_store_index_hash_bytes(uint32_t hash, const uint8_t *data, size_t len)
+{
+	size_t i;
+
+	/* FNV-1a. */
+	for (i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static int
+x509_store_index_hash_name(uint32_t *hash, X509_NAME *name)
+{
+	/* Ensure the canonical encoding is present and up to date. */
+	if (!x509_name_ensure_canon(name))
+		return 0;
+	*hash = x509_store_index_hash_bytes(*hash, name->canon_enc,
+	    name->canon_enclen);
+
+	return 1;
+}
+
+static int
+x509_store_index_subject_hash(uint32_t *hash, X509_LOOKUP_TYPE type,
+    X509_NAME *name)
+{
+	uint8_t t = type;
+
+	*hash = x509_store_index_hash_bytes(2166136261U, &t, sizeof(t));
+
+	return x509_store_index_hash_name(hash, name);
+}
+
+static uint32_t
+x509_store_index_keyid_hash(const ASN1_OCTET_STRING *keyid)
+{
+	return x509_store_index_hash_bytes(2166136261U, keyid->data,
+	    keyid->length);
+}
+
+static int
+x509_store_index_serial_hash(uint32_t *hash, X509_NAME *issuer,
+    const ASN1_INTEGER *serial)
+{
+	*hash = x509_store_index_hash_bytes(2166136261U, serial->data,
+	    serial->length);
+
+	return x509_store_index_hash_name(hash, issuer);
+}
+
+static X509_NAME *
+x509_store_index_object_name(X509_OBJECT *obj)
+{
+	switch (obj->type) {
+	case X509_LU_X509:
+		return X509_get_subject_name(obj->data.x509);
+	case X509_LU_CRL:
+		return X509_CRL_get_issuer(obj->data.crl);
+	default:
+		return NULL;
+	}
+}
+
+static void
+x509_store_index_table_clear(struct x509_store_index_table *table)
+{
+	struct x509_store_index_entry *entry, *next;
+	size_t i;
+
+	for (i = 0; i < table->num_buckets; i++) {
+		for (entry = table->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+	}
+	free(table->buckets);
+
+	table->buckets = NULL;
+	table->num_buckets = 0;
+	table->count = 0;
+}
+
+static int
+x509_store_index_table_grow(struct x509_store_index_table *table)
+{
+	struct x509_store_index_entry **buckets, **tail, *entry, *next;
+	size_t num_buckets, i, j;
+
+	if (table->count < table->num_buckets)
+		return 1;
+
+	num_buckets = table->num_buckets * 2;
+	if (num_buckets < X509_STORE_INDEX_MIN_BUCKETS)
+		num_buckets = X509_STORE_INDEX_MIN_BUCKETS;
+
+	if ((buckets = calloc(num_buckets, sizeof(*buckets))) == NULL)
+		return 0;
+
+	/* Rehash, keeping entries within each bucket in insertion order. */
+	for (i = 0; i < table->num_buckets; i++) {
+		for (entry = table->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			entry->next = NULL;
+			j = entry->hash & (num_buckets - 1);
+			for (tail = &buckets[j]; *tail != NULL;
+			    tail = &(*tail)->next)
+				;
+			*tail = entry;
+		}
+	}
+	free(table->buckets);
+
+	table->buckets = buckets;
+	table->num_buckets = num_buckets;
+
+	return 1;
+}
+
+static int
+x509_store_index_table_add(struct x509_store_index_table *table,
+    uint32_t hash, X509_OBJECT *obj)
+{
+	struct x509_store_index_entry *entry, **tail;
+
+	if (!x509_store_index_table_grow(table))
+		return 0;
+
+	if ((entry = calloc(1, sizeof(*entry))) == NULL)
+		return 0;
+	entry->obj = obj;
+	entry->hash = hash;
+
+	tail = &table->buckets[hash & (table->num_buckets - 1)];
+	while (*tail != NULL)
+		tail = &(*tail)->next;
+	*tail = entry;
+
+	table->count++;
+
+	return 1;
+}
+
+static struct x509_store_index_entry *
+x509_store_index_table_next(struct x509_store_index_table *table,
+    uint32_t hash, struct x509_store_index_entry *cursor)
+{
+	struct x509_store_index_entry *entry;
+
+	if (table->num_buckets == 0)
+		return NULL;
+
+	if (cursor == NULL)
+		entry = table->buckets[hash & (table->num_buckets - 1)];
+	else
+		entry = cursor->next;
+
+	for (; entry != NULL; entry = entry->next) {
+		if (entry->hash == hash)
+			return entry;
+	}
+
+	return NULL;
+}
+
+struct x509_store_index *
+x509_store_index_new(void)
+{
+	return calloc(1, sizeof(struct x509_store_index));
+}
+
+static void
+x509_store_index_clear(struct x509_store_index *index)
+{
+	x509_store_index_table_clear(&index->subjects);
+	x509_store_index_table_clear(&index->keyids);
+	x509_store_index_table_clear(&index->serials);
+	index->num_objs = 0;
+}
+
+void
+x509_store_index_free(struct x509_store_index *index)
+{
+	if (index == NULL)
+		return;
+
+	x509_store_index_clear(index);
+	free(index);
+}
+
+/*
+ * Add an object that was just pushed onto the store's stack, which moved
+ * the store to the given generation. On failure the index is left partially
+ * updated and is marked so that the next call to x509_store_index_sync()
+ * rebuilds it.
+ */
+int
+x509_store_index_add(struct x509_store_index *index, X509_OBJECT *obj,
+    int generation)
+{
+	X509_NAME *name;
+	X509 *x;
+	uint32_t hash;
+
+	if ((name = x509_store_index_object_name(obj)) == NULL)
+		goto err;
+	if (!x509_store_index_subject_hash(&hash, obj->type, name))
+		goto err;
+	if (!x509_store_index_table_add(&index->subjects, hash, obj))
+		goto err;
+
+	if (obj->type != X509_LU_X509)
+		goto done;
+
+	x = obj->data.x509;
+
+	/*
+	 * Invalid extensions only make the certificate unusable later on,
+	 * the key identifier is still worth indexing.
+	 */
+	(void)x509v3_cache_extensions(x);
+
+	if (x->skid != NULL) {
+		hash = x509_store_index_keyid_hash(x->skid);
+		if (!x509_store_index_table_add(&index->keyids, hash, obj))
+			goto err;
+	}
+
+	if (!x509_store_index_serial_hash(&hash, X509_get_issuer_name(x),
+	    X509_get_serialNumber(x)))
+		goto err;
+	if (!x509_store_index_table_add(&index->serials, hash, obj))
+		goto err;
+
+ done:
+	index->num_objs++;
+	index->generation = generation;
+
+	return 1;
+
+ err:
+	index->num_objs = -1;
+
+	return 0;
+}
+
+/*
+ * The store bumps its generation whenever its object stack may have changed.
+ * If the generation differs from the one that was indexed, or an earlier
+ * update failed, rebuild the index from the stack.
+ */
+int
+x509_store_index_sync(struct x509_store_index *index,
+    STACK_OF(X509_OBJECT) *objs, int generation)
+{
+	int i;
+
+	if (index->generation == generation &&
+	    index->num_objs == sk_X509_OBJECT_num(objs))
+		return 1;
+
+	x509_store_index_clear(index);
+
+	for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+		if (!x509_store_index_add(index, sk_X509_OBJECT_value(objs, i),
+		    generation))
+			goto err;
+	}
+	index->generation = generation;
+
+	return 1;
+
+ err:
+	x509_store_index_clear(index);
+
+	return 0;
+}
+
+X509_OBJECT *
+x509_store_index_match(struct x509_store_index *index, X509_OBJECT *obj)
+{
+	struct x509_store_index_entry *cursor = NULL;
+	X509_OBJECT *found;
+	X509_NAME *name;
+
+	if ((name = x509_store_index_object_name(obj)) == NULL)
+		return NULL;
+
+	while ((found = x509_store_index_subject_next(index, obj->type, name,
+	    &cursor)) != NULL) {
+		if (obj->type == X509_LU_X509 &&
+		    X509_cmp(found->data.x509, obj->data.x509) == 0)
+			return found;
+		if (obj->type == X509_LU_CRL &&
+		    X509_CRL_match(found->data.crl, obj->data.crl) == 0)
+			return found;
+	}
+
+	return NULL;
+}
+
+X509_OBJECT *
+x509_store_index_subject_next(struct x509_store_index *index,
+    X509_LOOKUP_TYPE type, X509_NAME *name,
+    struct x509_store_index_entry **cursor)
+{
+	struct x509_store_index_entry *entry = *cursor;
+	X509_NAME *found_name;
+	uint32_t hash;
+
+	if (!x509_store_index_subject_hash(&hash, type, name))
+		return NULL;
+
+	while ((entry = x509_store_index_table_next(&index->subjects, hash,
+	    entry)) != NULL) {
+		if (entry->obj->type != type)
+			continue;
+		found_name = x509_store_index_object_name(entry->obj);
+		if (X509_NAME_cmp(found_name, name) == 0)
+			break;
+	}
+
+	if ((*cursor = entry) == NULL)
+		return NULL;
+
+	return entry->obj;
+}
+
+X509_OBJECT *
+x509_store_index_keyid_next(struct x509_store_index *index,
+    const ASN1_OCTET_STRING *keyid, struct x509_store_index_entry **cursor)
+{
+	struct x509_store_index_entry *entry = *cursor;
+	uint32_t hash;
+
+	hash = x509_store_index_keyid_hash(keyid);
+
+	while ((entry = x509_store_index_table_next(&index->keyids, hash,
+	    entry)) != NULL) {
+		if (ASN1_OCTET_STRING_cmp(entry->obj->data.x509->skid,
+		    keyid) == 0)
+			break;
+	}
+
+	if ((*cursor = entry) == NULL)
+		return NULL;
+
+	return entry->obj;
+}
+
+X509_OBJECT *
+x509_store_index_serial_next(struct x509_store_index *index,
+    X509_NAME *issuer, const ASN1_INTEGER *serial,
+    struct x509_store_index_entry **cursor)
+{
+	struct x509_store_index_entry *entry = *cursor;
+	X509 *x;
+	uint32_t hash;
+
+	if (!x509_store_index_serial_hash(&hash, issuer, serial))
+		return NULL;
+
+	while ((entry = x509_store_index_table_next(&index->serials, hash,
+	    entry)) != NULL) {
+		x = entry->obj->data.x509;
+		if (ASN1_INTEGER_cmp(X509_get_serialNumber(x), serial) == 0 &&
+		    X509_NAME_cmp(X509_get_issuer_name(x), issuer) == 0)
+			break;
+	}
+
+	if ((*cursor = entry) == NULL)
+		return NULL;
+
+	return entry->obj;
+}
@@ -0,0 +1,48 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* x509_store_index */
+#ifndef HEADER_X509_STORE_INDEX_H
+#define HEADER_X509_STORE_INDEX_H
+
+#include <openssl/x509.h>
+
+__BEGIN_HIDDEN_DECLS
+
+struct x509_store_index;
+struct x509_store_index_entry;
+
+struct x509_store_index *x509_store_index_new(void);
+void x509_store_index_free(struct x509_store_index *index);
+int x509_store_index_add(struct x509_store_index *index, X509_OBJECT *obj,
+    int generation);
+int x509_store_index_sync(struct x509_store_index *index,
+    STACK_OF(X509_OBJECT) *objs, int generation);
+X509_OBJECT *x509_store_index_match(struct x509_store_index *index,
+    X509_OBJECT *obj);
+X509_OBJECT *x509_store_index_subject_next(struct x509_store_index *index,
+    X509_LOOKUP_TYPE type, X509_NAME *name,
+    struct x509_store_index_entry **cursor);
+X509_OBJECT *x509_store_index_keyid_next(struct x509_store_index *index,
+    const ASN1_OCTET_STRING *keyid, struct x509_store_index_entry **cursor);
+X509_OBJECT *x509_store_index_serial_next(struct x509_store_index *index,
+    X509_NAME *issuer, const ASN1_INTEGER *serial,
+    struct x509_store_index_entry **cursor);
+
+__END_HIDDEN_DECLS
+
+#endif
@@ -18,15 +18,19 @@
 /* x509_verify - inspired by golang's crypto/x509.Verify */
 
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
 #include <openssl/safestack.h>
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 
+#include "x509_chain_cache.h"
 #include "x509_internal.h"
 #include "x509_issuer_cache.h"
 
@@ -226,6 +230,7 @@ x509_verify_ctx_reset(struct x509_verify_ctx *ctx)
 	ctx->error_depth = 0;
 	ctx->chains_count = 0;
 	ctx->sig_checks = 0;
+	ctx->paths = 0;
 	ctx->check_time = NULL;
 }
 
@@ -529,13 +534,276 @@ x509_verify_potential_parent(struct x509_verify_ctx *ctx, X509 *parent,
 	return X509_check_issued(child, parent) != X509_V_OK;
 }
 
+/*
+ * Signature checks for sibling candidates may be run concurrently by a
+ * dispatch function supplied by the caller. The results are collected in a
+ * batch before the candidates are considered in order, so the chains that
+ * are built do not depend on which checks complete first.
+ *
+ * Jobs are claimed by whichever of the caller and the dispatcher gets to
+ * them first, so the caller only ever waits for checks that are actually
+ * running. The batch is reference counted, since the dispatcher may run a
+ * job that has already been claimed after the verification has finished.
+ */
+struct x509_verify_sig_job {
+	struct x509_verify_sig_batch *batch;
+	X509 *parent;
+	X509 *child;
+	EVP_PKEY *pkey;
+	atomic_int claimed;
+	int done;
+	int result;
+	int error;
+};
+
+struct x509_verify_sig_batch {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int references;
+	struct x509_verify_sig_job *jobs;
+	size_t num_jobs;
+};
+
+static void
+x509_verify_sig_batch_free(struct x509_verify_sig_batch *batch)
+{
+	size_t i;
+	int references;
+
+	if (batch == NULL)
+		return;
+
+	pthread_mutex_lock(&batch->mutex);
+	references = --batch->references;
+	pthread_mutex_unlock(&batch->mutex);
+
+	if (references > 0)
+		return;
+
+	for (i = 0; i < batch->num_jobs; i++)
+		EVP_PKEY_free(batch->jobs[i].pkey);
+	free(batch->jobs);
+	pthread_cond_destroy(&batch->cond);
+	pthread_mutex_destroy(&batch->mutex);
+	free(batch);
+}
+
+static void
+x509_verify_sig_job_verify(struct x509_verify_sig_job *job)
+{
+	struct x509_verify_sig_batch *batch = job->batch;
+	int result, error = X509_V_OK;
+
+	if ((result = X509_verify(job->child, job->pkey) > 0) == 0)
+		error = X509_V_ERR_CERT_SIGNATURE_FAILURE;
+
+	x509_issuer_cache_add(job->parent->hash, job->child->hash, result);
+
+	pthread_mutex_lock(&batch->mutex);
+	EVP_PKEY_free(job->pkey);
+	job->pkey = NULL;
+	job->result = result;
+	job->error = error;
+	job->done = 1;
+	pthread_cond_broadcast(&batch->cond);
+	pthread_mutex_unlock(&batch->mutex);
+}
+
+/* Entry point for jobs run by the dispatcher. */
+static void
+x509_verify_sig_job_run(void *arg)
+{
+	struct x509_verify_sig_job *job = arg;
+
+	if (atomic_exchange(&job->claimed, 1) == 0)
+		x509_verify_sig_job_verify(job);
+
+	x509_verify_sig_batch_free(job->batch);
+}
+
+static int
+x509_verify_chain_contains(struct x509_verify_chain *chain, X509 *cert)
+{
+	int i;
+
+	for (i = 0; i < sk_X509_num(chain->certs); i++) {
+		if (X509_cmp(sk_X509_value(chain->certs, i), cert) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void
+x509_verify_sig_batch_add(struct x509_verify_sig_batch *batch,
+    size_t max_jobs, X509 *candidate, X509 *cert,
+    struct x509_verify_chain *current_chain)
+{
+	struct x509_verify_sig_job *job;
+	EVP_PKEY *pkey;
+
+	if (batch->num_jobs >= max_jobs)
+		return;
+
+	/*
+	 * This is only a prediction of which candidates will be considered,
+	 * so use the side effect free check rather than the check_issued
+	 * callback. Missing or undecodable keys are left to the sequential
+	 * check, which reports the error.
+	 */
+	if (!x509_verify_cert_cache_extensions(candidate))
+		return;
+	if (X509_check_issued(candidate, cert) != X509_V_OK)
+		return;
+	if (x509_verify_chain_contains(current_chain, candidate))
+		return;
+	if (x509_issuer_cache_find(candidate->hash, cert->hash) >= 0)
+		return;
+	if ((pkey = X509_get_pubkey(candidate)) == NULL)
+		return;
+
+	job = &batch->jobs[batch->num_jobs++];
+	job->batch = batch;
+	job->parent = candidate;
+	job->child = cert;
+	job->pkey = pkey;
+}
+
+/*
+ * Check the signatures of all candidate issuers of cert that are known
+ * up front, using the dispatcher to run them concurrently.
+ */
+static struct x509_verify_sig_batch *
+x509_verify_sig_batch_new(struct x509_verify_ctx *ctx, X509 *cert,
+    struct x509_verify_chain *current_chain)
+{
+	struct x509_verify_sig_batch *batch = NULL;
+	struct x509_verify_sig_job *job;
+	size_t max_jobs, num_candidates, i;
+	int dispatched;
+
+	if (ctx->dispatch == NULL)
+		return NULL;
+	if (ctx->sig_checks >= ctx->max_sigs)
+		return NULL;
+
+	/* In legacy mode roots are found one at a time through get_issuer. */
+	num_candidates = sk_X509_num(ctx->intermediates);
+	if (ctx->xsc == NULL)
+		num_candidates += sk_X509_num(ctx->roots);
+	if (num_candidates < 2)
+		return NULL;
+
+	max_jobs = ctx->max_sigs - ctx->sig_checks;
+	if (max_jobs > num_candidates)
+		max_jobs = num_candidates;
+
+	if ((batch = calloc(1, sizeof(*batch))) == NULL)
+		return NULL;
+	if ((batch->jobs = calloc(max_jobs, sizeof(*batch->jobs))) == NULL) {
+		free(batch);
+		return NULL;
+	}
+	if (pthread_mutex_init(&batch->mutex, NULL) != 0) {
+		free(batch->jobs);
+		free(batch);
+		return NULL;
+	}
+	if (pthread_cond_init(&batch->cond, NULL) != 0) {
+		pthread_mutex_destroy(&batch->mutex);
+		free(batch->jobs);
+		free(batch);
+		return NULL;
+	}
+	batch->references = 1;
+
+	if (ctx->xsc == NULL) {
+		for (i = 0; i < sk_X509_num(ctx->roots); i++)
+			x509_verify_sig_batch_add(batch, max_jobs,
+			    sk_X509_value(ctx->roots, i), cert, current_chain);
+	}
+	for (i = 0; i < sk_X509_num(ctx->intermediates); i++)
+		x509_verify_sig_batch_add(batch, max_jobs,
+		    sk_X509_value(ctx->intermediates, i), cert, current_chain);
+
+	/*
+	 * Every job is a signature check, whether or not chain building
+	 * ends up considering its candidate, so charge them all now.
+	 */
+	ctx->sig_checks += batch->num_jobs;
+
+	if (batch->num_jobs < 2)
+		goto done;
+
+	/* Hand all but the first job to the dispatcher. */
+	for (i = 1; i < batch->num_jobs; i++) {
+		pthread_mutex_lock(&batch->mutex);
+		batch->references++;
+		pthread_mutex_unlock(&batch->mutex);
+
+		dispatched = ctx->dispatch(x509_verify_sig_job_run,
+		    &batch->jobs[i], ctx->dispatch_arg);
+
+		if (!dispatched) {
+			pthread_mutex_lock(&batch->mutex);
+			batch->references--;
+			pthread_mutex_unlock(&batch->mutex);
+		}
+	}
+
+ done:
+	/* Run whatever has not been picked up yet ourselves. */
+	for (i = 0; i < batch->num_jobs; i++) {
+		job = &batch->jobs[i];
+		if (atomic_exchange(&job->claimed, 1) == 0)
+			x509_verify_sig_job_verify(job);
+	}
+
+	pthread_mutex_lock(&batch->mutex);
+	for (i = 0; i < batch->num_jobs; i++) {
+		while (!batch->jobs[i].done)
+			pthread_cond_wait(&batch->cond, &batch->mutex);
+	}
+	pthread_mutex_unlock(&batch->mutex);
+
+	return batch;
+}
+
+static struct x509_verify_sig_job *
+x509_verify_sig_batch_find(struct x509_verify_sig_batch *batch, X509 *parent,
+    X509 *child)
+{
+	size_t i;
+
+	if (batch == NULL)
+		return NULL;
+
+	for (i = 0; i < batch->num_jobs; i++) {
+		if (batch->jobs[i].parent == parent &&
+		    batch->jobs[i].child == child)
+			return &batch->jobs[i];
+	}
+
+	return NULL;
+}
+
 static int
-x509_verify_parent_signature(X509 *parent, X509 *child, int *error)
+x509_verify_parent_signature(struct x509_verify_ctx *ctx, X509 *parent,
+    X509 *child, int *error)
 {
+	struct x509_verify_sig_job *job;
 	EVP_PKEY *pkey;
 	int cached;
 	int ret = 0;
 
+	/* Use a result checked ahead of time if we have it */
+	if ((job = x509_verify_sig_batch_find(ctx->sig_batch, parent,
+	    child)) != NULL) {
+		if (!job->result)
+			*error = job->error;
+		return job->result;
+	}
+
 	/* Use cached value if we have it */
 	if ((cached = x509_issuer_cache_find(parent->hash, child->hash)) >= 0)
 		return cached;
@@ -565,23 +833,21 @@ x509_verify_consider_candidate(struct x509_verify_ctx *ctx, X509 *cert,
 {
 	int depth = sk_X509_num(current_chain->certs);
 	struct x509_verify_chain *new_chain;
-	int i;
 
 	/* Fail if the certificate is already in the chain */
-	for (i = 0; i < sk_X509_num(current_chain->certs); i++) {
-		if (X509_cmp(sk_X509_value(current_chain->certs, i),
-		    candidate) == 0)
-			return 0;
-	}
+	if (x509_verify_chain_contains(current_chain, candidate))
+		return 0;
 
-	if (ctx->sig_checks++ > X509_VERIFY_MAX_SIGCHECKS) {
+	/* Checks done ahead of time in a batch have already been charged. */
+	if (x509_verify_sig_batch_find(ctx->sig_batch, candidate,
+	    cert) == NULL && ctx->sig_checks++ > ctx->max_sigs) {
 		/* don't allow callback to override safety check */
 		(void) x509_verify_cert_error(ctx, candidate, depth,
 		    X509_V_ERR_CERT_CHAIN_TOO_LONG, 0);
 		return 0;
 	}
 
-	if (!x509_verify_parent_signature(candidate, cert, &ctx->error)) {
+	if (!x509_verify_parent_signature(ctx, candidate, cert, &ctx->error)) {
 		if (!x509_verify_cert_error(ctx, candidate, depth,
 		    ctx->error, 0))
 			return 0;
@@ -590,6 +856,13 @@ x509_verify_consider_candidate(struct x509_verify_ctx *ctx, X509 *cert,
 	if (!x509_verify_cert_valid(ctx, candidate, current_chain))
 		return 0;
 
+	if (ctx->max_paths != 0 && ctx->paths++ >= ctx->max_paths) {
+		/* don't allow callback to override safety check */
+		(void) x509_verify_cert_error(ctx, candidate, depth,
+		    X509_V_ERR_CERT_CHAIN_TOO_LONG, 0);
+		return 0;
+	}
+
 	/* candidate is good, add it to a copy of the current chain */
 	if ((new_chain = x509_verify_chain_dup(current_chain)) == NULL) {
 		x509_verify_cert_error(ctx, candidate, depth,
@@ -645,6 +918,7 @@ static void
 x509_verify_build_chains(struct x509_verify_ctx *ctx, X509 *cert,
     struct x509_verify_chain *current_chain, int full_chain, char *name)
 {
+	struct x509_verify_sig_batch *saved_sig_batch;
 	X509 *candidate;
 	int i, depth, count, ret, is_root;
 
@@ -688,11 +962,16 @@ x509_verify_build_chains(struct x509_verify_ctx *ctx, X509 *cert,
 			    X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN;
 	}
 
+	saved_sig_batch = ctx->sig_batch;
+	ctx->sig_batch = x509_verify_sig_batch_new(ctx, cert, current_chain);
+
 	/* Check for legacy mode roots */
 	if (ctx->xsc != NULL) {
 		if ((ret = ctx->xsc->get_issuer(&candidate, ctx->xsc, cert)) < 0) {
 			x509_verify_cert_error(ctx, cert, depth,
 			    X509_V_ERR_STORE_LOOKUP, 0);
+			x509_verify_sig_batch_free(ctx->sig_batch);
+			ctx->sig_batch = saved_sig_batch;
 			return;
 		}
 		if (ret > 0) {
@@ -731,6 +1010,9 @@ x509_verify_build_chains(struct x509_verify_ctx *ctx, X509 *cert,
 		}
 	}
 
+	x509_verify_sig_batch_free(ctx->sig_batch);
+	ctx->sig_batch = saved_sig_batch;
+
 	if (ctx->chains_count > count) {
 		if (ctx->xsc != NULL) {
 			ctx->xsc->error = X509_V_OK;
@@ -843,39 +1125,23 @@ static int
 x509_verify_validate_constraints(X509 *cert,
     struct x509_verify_chain *current_chain, int *error)
 {
-	struct x509_constraints_names *excluded = NULL;
-	struct x509_constraints_names *permitted = NULL;
+	struct x509_constraints_index *index;
 	int err = X509_V_ERR_UNSPECIFIED;
 
 	if (current_chain == NULL)
 		return 1;
 
 	if (cert->nc != NULL) {
-		if ((permitted = x509_constraints_names_new(
-		    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL) {
-			err = X509_V_ERR_OUT_OF_MEM;
-			goto err;
-		}
-		if ((excluded = x509_constraints_names_new(
-		    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL) {
-			err = X509_V_ERR_OUT_OF_MEM;
-			goto err;
-		}
-		if (!x509_constraints_extract_constraints(cert,
-		    permitted, excluded, &err))
+		if ((index = x509_constraints_index_get(cert, &err)) == NULL)
 			goto err;
-		if (!x509_constraints_check(current_chain->names,
-		    permitted, excluded, &err))
+		if (!x509_constraints_index_check(current_chain->names,
+		    index, &err))
 			goto err;
-		x509_constraints_names_free(excluded);
-		x509_constraints_names_free(permitted);
 	}
 
 	return 1;
  err:
 	*error = err;
-	x509_constraints_names_free(excluded);
-	x509_constraints_names_free(permitted);
 	return 0;
 }
 
@@ -953,7 +1219,7 @@ struct x509_verify_ctx *
 x509_verify_ctx_new_from_xsc(X509_STORE_CTX *xsc)
 {
 	struct x509_verify_ctx *ctx;
-	size_t max_depth;
+	size_t max_depth, max_sigs;
 
 	if (xsc == NULL)
 		return NULL;
@@ -973,6 +1239,21 @@ x509_verify_ctx_new_from_xsc(X509_STORE_CTX *xsc)
 	if (!x509_verify_ctx_set_max_depth(ctx, max_depth))
 		goto err;
 
+	max_sigs = X509_VERIFY_MAX_SIGCHECKS;
+	if (xsc->param->max_signatures > 0 &&
+	    xsc->param->max_signatures < X509_VERIFY_MAX_SIGCHECKS_LIMIT)
+		max_sigs = xsc->param->max_signatures;
+	if (!x509_verify_ctx_set_max_signatures(ctx, max_sigs))
+		goto err;
+
+	if (xsc->param->max_chains > 0)
+		ctx->max_paths = xsc->param->max_chains;
+
+	if (xsc->store != NULL) {
+		ctx->dispatch = xsc->store->dispatch;
+		ctx->dispatch_arg = xsc->store->dispatch_arg;
+	}
+
 	return ctx;
  err:
 	x509_verify_ctx_free(ctx);
@@ -1042,7 +1323,7 @@ x509_verify_ctx_set_max_chains(struct x509_verify_ctx *ctx, size_t max)
 int
 x509_verify_ctx_set_max_signatures(struct x509_verify_ctx *ctx, size_t max)
 {
-	if (max < 1 || max > 100000)
+	if (max < 1 || max > X509_VERIFY_MAX_SIGCHECKS_LIMIT)
 		return 0;
 	ctx->max_sigs = max;
 	return 1;
@@ -1086,11 +1367,134 @@ x509_verify_ctx_chain(struct x509_verify_ctx *ctx, size_t i)
 	return ctx->chains[i]->certs;
 }
 
+/*
+ * Return the chain cache of the store if the result of chain building for
+ * this verification can be cached. Results are only cached with a store,
+ * since the cached chain depends on the trusted certificates available.
+ */
+static struct x509_chain_cache *
+x509_verify_ctx_chain_cache(struct x509_verify_ctx *ctx)
+{
+	if (ctx->xsc == NULL || ctx->xsc->store == NULL)
+		return NULL;
+	if (ctx->xsc->trusted != NULL)
+		return NULL;
+	if (ctx->xsc->param->flags &
+	    (X509_V_FLAG_USE_CHECK_TIME | X509_V_FLAG_NO_CHECK_TIME))
+		return NULL;
+
+	return ctx->xsc->store->chain_cache;
+}
+
+/*
+ * The chain cache key is a digest of the leaf, the intermediates presented
+ * with it and the verify parameters that influence chain building.
+ */
+static int
+x509_verify_chain_cache_key(struct x509_verify_ctx *ctx, X509 *leaf,
+    unsigned char *key)
+{
+	X509_VERIFY_PARAM *param = ctx->xsc->param;
+	SHA256_CTX sha256;
+	X509 *cert;
+	int i;
+
+	if (!x509_verify_cert_cache_extensions(leaf))
+		return 0;
+
+	SHA256_Init(&sha256);
+	SHA256_Update(&sha256, leaf->hash, sizeof(leaf->hash));
+	for (i = 0; i < sk_X509_num(ctx->intermediates); i++) {
+		cert = sk_X509_value(ctx->intermediates, i);
+		if (!x509_verify_cert_cache_extensions(cert))
+			return 0;
+		SHA256_Update(&sha256, cert->hash, sizeof(cert->hash));
+	}
+	SHA256_Update(&sha256, &param->flags, sizeof(param->flags));
+	SHA256_Update(&sha256, &param->purpose, sizeof(param->purpose));
+	SHA256_Update(&sha256, &param->trust, sizeof(param->trust));
+	SHA256_Update(&sha256, &param->security_level,
+	    sizeof(param->security_level));
+	SHA256_Update(&sha256, &ctx->max_depth, sizeof(ctx->max_depth));
+	SHA256_Final(key, &sha256);
+
+	return 1;
+}
+
+/*
+ * Use a previously validated chain from the cache instead of building
+ * one. The cached chain is subjected to the same checks as a newly built
+ * chain on addition, which covers the leaf validity times, the hostname and
+ * the legacy trust, revocation and policy checks. If the cached chain
+ * fails, its entry is dropped and any trace of it is removed from the
+ * context, so that chains are built as if there had been no cache entry.
+ *
+ * Returns 1 if a cached chain was used, 0 if chains need to be built.
+ */
+static int
+x509_verify_ctx_add_cached_chain(struct x509_verify_ctx *ctx,
+    struct x509_chain_cache *cache, const unsigned char *key,
+    struct x509_verify_chain *current_chain, char *name)
+{
+	struct x509_verify_chain *chain = NULL;
+	STACK_OF(X509) *certs;
+	size_t chains_count = ctx->chains_count;
+	int error = X509_V_OK;
+	int i;
+
+	if ((certs = x509_chain_cache_find(cache, key, time(NULL))) == NULL)
+		return 0;
+
+	/* Leave the chain built so far untouched in case this fails. */
+	if ((chain = x509_verify_chain_dup(current_chain)) == NULL)
+		goto err;
+	for (i = 1; i < sk_X509_num(certs); i++) {
+		if (!x509_verify_chain_append(chain, sk_X509_value(certs, i),
+		    &error))
+			goto err;
+	}
+	if (!x509_verify_ctx_add_chain(ctx, chain, name))
+		goto err;
+	if (ctx->xsc != NULL && ctx->xsc->error != X509_V_OK)
+		goto err;
+
+	x509_verify_chain_free(chain);
+	sk_X509_pop_free(certs, X509_free);
+
+	return 1;
+
+ err:
+	x509_chain_cache_remove(cache, key);
+
+	while (ctx->chains_count > chains_count) {
+		ctx->chains_count--;
+		x509_verify_chain_free(ctx->chains[ctx->chains_count]);
+		ctx->chains[ctx->chains_count] = NULL;
+	}
+	ctx->error = X509_V_OK;
+	ctx->error_depth = 0;
+	if (ctx->xsc != NULL) {
+		ctx->xsc->error = X509_V_OK;
+		ctx->xsc->error_depth = 0;
+		ctx->xsc->current_cert = x509_verify_chain_leaf(current_chain);
+	}
+	/* Put back the legacy chain holding only the leaf. */
+	(void) x509_verify_ctx_set_xsc_chain(ctx, current_chain, 0, 0);
+
+	x509_verify_chain_free(chain);
+	sk_X509_pop_free(certs, X509_free);
+
+	return 0;
+}
+
 size_t
 x509_verify(struct x509_verify_ctx *ctx, X509 *leaf, char *name)
 {
 	struct x509_verify_chain *current_chain;
+	struct x509_chain_cache *chain_cache;
+	unsigned char cache_key[X509_CHAIN_CACHE_KEY_LEN];
 	int retry_chain_build, full_chain = 0;
+	int cacheable = 0;
 
 	if (ctx->roots == NULL || ctx->max_depth == 0) {
 		ctx->error = X509_V_ERR_INVALID_CALL;
@@ -1148,6 +1552,17 @@ x509_verify(struct x509_verify_ctx *ctx, X509 *leaf, char *name)
 		x509_verify_chain_free(current_chain);
 		goto err;
 	}
+
+	if ((chain_cache = x509_verify_ctx_chain_cache(ctx)) != NULL &&
+	    x509_verify_chain_cache_key(ctx, leaf, cache_key)) {
+		if (x509_verify_ctx_add_cached_chain(ctx, chain_cache,
+		    cache_key, current_chain, name)) {
+			x509_verify_chain_free(current_chain);
+			goto done;
+		}
+		cacheable = 1;
+	}
+
 	do {
 		retry_chain_build = 0;
 		if (x509_verify_ctx_cert_is_root(ctx, leaf, full_chain)) {
@@ -1178,12 +1593,14 @@ x509_verify(struct x509_verify_ctx *ctx, X509 *leaf, char *name)
 				}
 				full_chain = 0;
 				retry_chain_build = 1;
+				cacheable = 0;
 			}
 		}
 	} while (retry_chain_build);
 
 	x509_verify_chain_free(current_chain);
 
+ done:
 	/*
 	 * Do the new verifier style return, where we don't have an xsc
 	 * that allows a crazy callback to turn invalid things into valid.
@@ -1239,6 +1656,11 @@ x509_verify(struct x509_verify_ctx *ctx, X509 *leaf, char *name)
 		 */
 		if (!x509_vfy_callback_indicate_completion(ctx->xsc))
 			goto err;
+
+		/* Only cache chains that validated without any help. */
+		if (cacheable && ctx->xsc->error == X509_V_OK)
+			x509_chain_cache_add(chain_cache, cache_key,
+			    ctx->xsc->chain, time(NULL));
 	} else {
 		/*
 		 * We did not find a chain. Bring back the failure
@@ -110,6 +110,7 @@ typedef struct X509_VERIFY_PARAM_ID_st X509_VERIFY_PARAM_ID;
 
 
 int X509_STORE_set_depth(X509_STORE *store, int depth);
+int X509_STORE_set_chain_cache_size(X509_STORE *store, size_t max);
 
 void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 
@@ -121,6 +122,7 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 #define X509_L_FILE_LOAD	1
 #define X509_L_ADD_DIR		2
 #define X509_L_MEM		3
+#define X509_L_INDEX_LOAD	4
 
 #define X509_LOOKUP_load_file(x,name,type) \
 		X509_LOOKUP_ctrl((x),X509_L_FILE_LOAD,(name),(long)(type),NULL)
@@ -132,6 +134,9 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 		X509_LOOKUP_ctrl((x),X509_L_MEM,(const char *)(iov),\
 		(long)(type),NULL)
 
+#define X509_LOOKUP_load_index(x,name) \
+		X509_LOOKUP_ctrl((x),X509_L_INDEX_LOAD,(name),0,NULL)
+
 #define		X509_V_OK					0
 #define		X509_V_ERR_UNSPECIFIED				1
 #define		X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT		2
@@ -324,6 +329,12 @@ void X509_STORE_set_check_issued(X509_STORE *store,
 X509_STORE_CTX_check_issued_fn
     X509_STORE_CTX_get_check_issued(X509_STORE_CTX *ctx);
 
+typedef int (*X509_STORE_dispatch_fn)(void (*job)(void *), void *job_arg,
+    void *arg);
+
+void X509_STORE_set_dispatch(X509_STORE *store,
+    X509_STORE_dispatch_fn dispatch, void *arg);
+
 X509_STORE_CTX *X509_STORE_CTX_new(void);
 
 int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x);
@@ -345,6 +356,14 @@ X509_LOOKUP *X509_STORE_add_lookup(X509_STORE *v, X509_LOOKUP_METHOD *m);
 X509_LOOKUP_METHOD *X509_LOOKUP_hash_dir(void);
 X509_LOOKUP_METHOD *X509_LOOKUP_file(void);
 X509_LOOKUP_METHOD *X509_LOOKUP_mem(void);
+X509_LOOKUP_METHOD *X509_LOOKUP_index(void);
+int X509_LOOKUP_write_index(BIO *bio, STACK_OF(X509) *certs);
+
+int X509_issuer_cache_set_max(size_t max);
+int X509_issuer_cache_set_shard_max(size_t shard, size_t max);
+size_t X509_issuer_cache_shards(void);
+void X509_issuer_cache_stats(uint64_t *hits, uint64_t *misses,
+    uint64_t *evictions, size_t *entries);
 
 int X509_STORE_add_cert(X509_STORE *ctx, X509 *x);
 int X509_STORE_add_crl(X509_STORE *ctx, X509_CRL *x);
@@ -451,6 +470,10 @@ int X509_VERIFY_PARAM_add0_policy(X509_VERIFY_PARAM *param,
 int X509_VERIFY_PARAM_set1_policies(X509_VERIFY_PARAM *param,
 					STACK_OF(ASN1_OBJECT) *policies);
 int X509_VERIFY_PARAM_get_depth(const X509_VERIFY_PARAM *param);
+int X509_VERIFY_PARAM_set_max_signatures(X509_VERIFY_PARAM *param, int max);
+int X509_VERIFY_PARAM_get_max_signatures(const X509_VERIFY_PARAM *param);
+int X509_VERIFY_PARAM_set_max_chains(X509_VERIFY_PARAM *param, int max);
+int X509_VERIFY_PARAM_get_max_chains(const X509_VERIFY_PARAM *param);
 int X509_VERIFY_PARAM_set1_host(X509_VERIFY_PARAM *param, const char *name,
     size_t namelen);
 int X509_VERIFY_PARAM_add1_host(X509_VERIFY_PARAM *param, const char *name,
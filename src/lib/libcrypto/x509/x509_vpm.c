@@ -177,6 +177,8 @@ x509_verify_param_zero(X509_VERIFY_PARAM *param)
 	param->inh_flags = 0;
 	param->flags = 0;
 	param->depth = -1;
+	param->max_signatures = 0;
+	param->max_chains = 0;
 	sk_ASN1_OBJECT_pop_free(param->policies, ASN1_OBJECT_free);
 	param->policies = NULL;
 	sk_OPENSSL_STRING_pop_free(param->hosts, str_free);
@@ -286,6 +288,8 @@ X509_VERIFY_PARAM_inherit(X509_VERIFY_PARAM *dest, const X509_VERIFY_PARAM *src)
 	x509_verify_param_copy(purpose, 0);
 	x509_verify_param_copy(trust, 0);
 	x509_verify_param_copy(depth, -1);
+	x509_verify_param_copy(max_signatures, 0);
+	x509_verify_param_copy(max_chains, 0);
 
 	/* If overwrite or check time not set, copy across */
 
@@ -595,6 +599,40 @@ X509_VERIFY_PARAM_get_depth(const X509_VERIFY_PARAM *param)
 }
 LCRYPTO_ALIAS(X509_VERIFY_PARAM_get_depth);
 
+int
+X509_VERIFY_PARAM_set_max_signatures(X509_VERIFY_PARAM *param, int max)
+{
+	if (max < 0)
+		return 0;
+	param->max_signatures = max;
+	return 1;
+}
+LCRYPTO_ALIAS(X509_VERIFY_PARAM_set_max_signatures);
+
+int
+X509_VERIFY_PARAM_get_max_signatures(const X509_VERIFY_PARAM *param)
+{
+	return param->max_signatures;
+}
+LCRYPTO_ALIAS(X509_VERIFY_PARAM_get_max_signatures);
+
+int
+X509_VERIFY_PARAM_set_max_chains(X509_VERIFY_PARAM *param, int max)
+{
+	if (max < 0)
+		return 0;
+	param->max_chains = max;
+	return 1;
+}
+LCRYPTO_ALIAS(X509_VERIFY_PARAM_set_max_chains);
+
+int
+X509_VERIFY_PARAM_get_max_chains(const X509_VERIFY_PARAM *param)
+{
+	return param->max_chains;
+}
+LCRYPTO_ALIAS(X509_VERIFY_PARAM_get_max_chains);
+
 const char *
 X509_VERIFY_PARAM_get0_name(const X509_VERIFY_PARAM *param)
 {
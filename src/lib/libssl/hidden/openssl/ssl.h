@@ -35,11 +35,13 @@ LSSL_USED(SSL_CTX_set_num_tickets);
 LSSL_USED(SSL_CTX_get_num_tickets);
 LSSL_USED(SSL_get0_verified_chain);
 LSSL_USED(SSL_CTX_sessions);
+LSSL_USED(SSL_CTX_sessions_free);
 LSSL_USED(SSL_CTX_sess_set_new_cb);
 LSSL_USED(SSL_CTX_sess_get_new_cb);
 LSSL_USED(SSL_CTX_sess_set_remove_cb);
 LSSL_USED(SSL_CTX_sess_get_remove_cb);
 LSSL_USED(SSL_CTX_sess_set_get_cb);
+LSSL_USED(SSL_CTX_set_session_cache_shm);
 LSSL_USED(SSL_CTX_set_info_callback);
 LSSL_USED(SSL_CTX_get_info_callback);
 LSSL_USED(SSL_CTX_set_client_cert_cb);
@@ -1572,6 +1572,9 @@ ssl3_free(SSL *s)
 	sk_X509_pop_free(s->s3->hs.peer_certs_no_leaf, X509_free);
 	sk_X509_pop_free(s->s3->hs.verified_chain, X509_free);
 	tls_key_share_free(s->s3->hs.key_share);
+	freezero(s->s3->hs.sign_pss_em, s->s3->hs.sign_pss_em_len);
+	freezero(s->s3->hs.tls12.signed_params,
+	    s->s3->hs.tls12.signed_params_len);
 
 	tls13_secrets_destroy(s->s3->hs.tls13.secrets);
 	freezero(s->s3->hs.tls13.cookie, s->s3->hs.tls13.cookie_len);
@@ -1622,6 +1625,14 @@ ssl3_clear(SSL *s)
 	tls_key_share_free(s->s3->hs.key_share);
 	s->s3->hs.key_share = NULL;
 
+	freezero(s->s3->hs.sign_pss_em, s->s3->hs.sign_pss_em_len);
+	s->s3->hs.sign_pss_em = NULL;
+	s->s3->hs.sign_pss_em_len = 0;
+	freezero(s->s3->hs.tls12.signed_params,
+	    s->s3->hs.tls12.signed_params_len);
+	s->s3->hs.tls12.signed_params = NULL;
+	s->s3->hs.tls12.signed_params_len = 0;
+
 	tls13_secrets_destroy(s->s3->hs.tls13.secrets);
 	s->s3->hs.tls13.secrets = NULL;
 	freezero(s->s3->hs.tls13.cookie, s->s3->hs.tls13.cookie_len);
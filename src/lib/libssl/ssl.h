@@ -564,6 +564,7 @@ struct lhash_st_SSL_SESSION {
 	(SSL_SESS_CACHE_NO_INTERNAL_LOOKUP|SSL_SESS_CACHE_NO_INTERNAL_STORE)
 
 struct lhash_st_SSL_SESSION *SSL_CTX_sessions(SSL_CTX *ctx);
+void SSL_CTX_sessions_free(struct lhash_st_SSL_SESSION *sessions);
 #define SSL_CTX_sess_number(ctx) \
 	SSL_CTX_ctrl(ctx,SSL_CTRL_SESS_NUMBER,0,NULL)
 #define SSL_CTX_sess_connect(ctx) \
@@ -602,6 +603,7 @@ void SSL_CTX_sess_set_get_cb(SSL_CTX *ctx,
     const unsigned char *data, int len, int *copy));
 SSL_SESSION *(*SSL_CTX_sess_get_get_cb(SSL_CTX *ctx))(struct ssl_st *ssl,
     const unsigned char *data, int len, int *copy);
+int SSL_CTX_set_session_cache_shm(SSL_CTX *ctx, size_t size);
 void SSL_CTX_set_info_callback(SSL_CTX *ctx, void (*cb)(const SSL *ssl,
     int type, int val));
 void (*SSL_CTX_get_info_callback(SSL_CTX *ctx))(const SSL *ssl, int type,
@@ -655,12 +657,15 @@ void SSL_set_psk_use_session_callback(SSL *s, SSL_psk_use_session_cb_func cb);
 #define SSL_WRITING	2
 #define SSL_READING	3
 #define SSL_X509_LOOKUP	4
+#define SSL_PRIVATE_KEY_OPERATION	8
 
 /* These will only be used when doing non-blocking IO */
 #define SSL_want_nothing(s)	(SSL_want(s) == SSL_NOTHING)
 #define SSL_want_read(s)	(SSL_want(s) == SSL_READING)
 #define SSL_want_write(s)	(SSL_want(s) == SSL_WRITING)
 #define SSL_want_x509_lookup(s)	(SSL_want(s) == SSL_X509_LOOKUP)
+#define SSL_want_private_key_operation(s) \
+	(SSL_want(s) == SSL_PRIVATE_KEY_OPERATION)
 
 #define SSL_MAC_FLAG_READ_MAC_STREAM 1
 #define SSL_MAC_FLAG_WRITE_MAC_STREAM 2
@@ -839,6 +844,7 @@ int PEM_write_SSL_SESSION(FILE *fp, SSL_SESSION *x);
 #define SSL_ERROR_WANT_ASYNC			9
 #define SSL_ERROR_WANT_ASYNC_JOB		10
 #define SSL_ERROR_WANT_CLIENT_HELLO_CB		11
+#define SSL_ERROR_WANT_PRIVATE_KEY_OPERATION	13
 
 #define SSL_CTRL_NEED_TMP_RSA			1
 #define SSL_CTRL_SET_TMP_RSA			2
@@ -2341,6 +2347,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_R_PEER_BEHAVING_BADLY			 666
 #define SSL_R_QUIC_INTERNAL_ERROR			 667
 #define SSL_R_WRONG_ENCRYPTION_LEVEL_RECEIVED		 668
+#define SSL_R_PRIVATE_KEY_OPERATION_PENDING		 669
 #define SSL_R_UNKNOWN					 999
 
 /*
@@ -434,9 +434,7 @@ SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
 	r.session_id_length = id_len;
 	memcpy(r.session_id, id, id_len);
 
-	CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-	p = lh_SSL_SESSION_retrieve(ssl->ctx->sessions, &r);
-	CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
+	p = ssl_session_cache_lookup(ssl->ctx, &r, 0);
 	return (p != NULL);
 }
 LSSL_ALIAS(SSL_has_matching_session_id);
@@ -1422,10 +1420,17 @@ LSSL_ALIAS(SSL_callback_ctrl);
 struct lhash_st_SSL_SESSION *
 SSL_CTX_sessions(SSL_CTX *ctx)
 {
-	return (ctx->sessions);
+	return (ssl_session_cache_view(ctx));
 }
 LSSL_ALIAS(SSL_CTX_sessions);
 
+void
+SSL_CTX_sessions_free(struct lhash_st_SSL_SESSION *sessions)
+{
+	ssl_session_cache_view_free(sessions);
+}
+LSSL_ALIAS(SSL_CTX_sessions_free);
+
 long
 SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
 {
@@ -1464,7 +1469,7 @@ SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
 		return (ctx->session_cache_mode);
 
 	case SSL_CTRL_SESS_NUMBER:
-		return (lh_SSL_SESSION_num_items(ctx->sessions));
+		return (ssl_session_cache_count(ctx));
 	case SSL_CTRL_SESS_CONNECT:
 		return (ctx->stats.sess_connect);
 	case SSL_CTRL_SESS_CONNECT_GOOD:
@@ -1997,61 +2002,6 @@ SSL_export_keying_material(SSL *s, unsigned char *out, size_t out_len,
 }
 LSSL_ALIAS(SSL_export_keying_material);
 
-static unsigned long
-ssl_session_hash(const SSL_SESSION *a)
-{
-	unsigned long	l;
-
-	l = (unsigned long)
-	    ((unsigned int) a->session_id[0]     )|
-	    ((unsigned int) a->session_id[1]<< 8L)|
-	    ((unsigned long)a->session_id[2]<<16L)|
-	    ((unsigned long)a->session_id[3]<<24L);
-	return (l);
-}
-
-/*
- * NB: If this function (or indeed the hash function which uses a sort of
- * coarser function than this one) is changed, ensure
- * SSL_CTX_has_matching_session_id() is checked accordingly. It relies on being
- * able to construct an SSL_SESSION that will collide with any existing session
- * with a matching session ID.
- */
-static int
-ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
-{
-	if (a->ssl_version != b->ssl_version)
-		return (1);
-	if (a->session_id_length != b->session_id_length)
-		return (1);
-	if (timingsafe_memcmp(a->session_id, b->session_id, a->session_id_length) != 0)
-		return (1);
-	return (0);
-}
-
-/*
- * These wrapper functions should remain rather than redeclaring
- * SSL_SESSION_hash and SSL_SESSION_cmp for void* types and casting each
- * variable. The reason is that the functions aren't static, they're exposed via
- * ssl.h.
- */
-static unsigned long
-ssl_session_LHASH_HASH(const void *arg)
-{
-	const SSL_SESSION *a = arg;
-
-	return ssl_session_hash(a);
-}
-
-static int
-ssl_session_LHASH_COMP(const void *arg1, const void *arg2)
-{
-	const SSL_SESSION *a = arg1;
-	const SSL_SESSION *b = arg2;
-
-	return ssl_session_cmp(a, b);
-}
-
 SSL_CTX *
 SSL_CTX_new(const SSL_METHOD *meth)
 {
@@ -2087,8 +2037,6 @@ SSL_CTX_new(const SSL_METHOD *meth)
 	ret->cert_store = NULL;
 	ret->session_cache_mode = SSL_SESS_CACHE_SERVER;
 	ret->session_cache_size = SSL_SESSION_CACHE_MAX_SIZE_DEFAULT;
-	ret->session_cache_head = NULL;
-	ret->session_cache_tail = NULL;
 
 	/* We take the system default */
 	ret->session_timeout = ssl_get_default_timeout();
@@ -2125,8 +2073,7 @@ SSL_CTX_new(const SSL_METHOD *meth)
 	ret->app_gen_cookie_cb = 0;
 	ret->app_verify_cookie_cb = 0;
 
-	ret->sessions = lh_SSL_SESSION_new();
-	if (ret->sessions == NULL)
+	if (!ssl_session_cache_init(ret))
 		goto err;
 	ret->cert_store = X509_STORE_new();
 	if (ret->cert_store == NULL)
@@ -2222,12 +2169,12 @@ SSL_CTX_free(SSL_CTX *ctx)
 	 * free ex_data, then finally free the cache.
 	 * (See ticket [openssl.org #212].)
 	 */
-	if (ctx->sessions != NULL)
-		SSL_CTX_flush_sessions(ctx, 0);
+	SSL_CTX_flush_sessions(ctx, 0);
 
 	CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL_CTX, ctx, &ctx->ex_data);
 
-	lh_SSL_SESSION_free(ctx->sessions);
+	ssl_session_cache_free(ctx);
+	ssl_session_shm_free(ctx->session_shm);
 
 	X509_STORE_free(ctx->cert_store);
 	sk_SSL_CIPHER_free(ctx->cipher_list);
@@ -2559,6 +2506,9 @@ ssl_update_cache(SSL *s, int mode)
 		(void) SSL_CTX_add_session(s->session_ctx, s->session);
 	}
 
+	if (do_callback)
+		ssl_session_shm_add(s, s->session);
+
 	/*
 	 * Update the "external cache" by calling the new session
 	 * callback if present, even with TLS 1.3 without early data
@@ -2575,7 +2525,7 @@ ssl_update_cache(SSL *s, int mode)
 			    SSL_SESSION_free(s->session);
 	}
 
-	/* Auto flush every 255 connections. */
+	/* Expire a batch of sessions from each shard every 255 connections. */
 	if (!(cache_mode & SSL_SESS_CACHE_NO_AUTO_CLEAR) &&
 	    (cache_mode & mode) != 0) {
 		int connections;
@@ -2584,7 +2534,7 @@ ssl_update_cache(SSL *s, int mode)
 		else
 			connections = s->session_ctx->stats.sess_accept_good;
 		if ((connections & 0xff) == 0xff)
-			SSL_CTX_flush_sessions(s->session_ctx, time(NULL));
+			ssl_session_cache_expire(s->session_ctx, time(NULL));
 	}
 }
 
@@ -2694,6 +2644,9 @@ SSL_get_error(const SSL *s, int i)
 	if (SSL_want_x509_lookup(s))
 		return (SSL_ERROR_WANT_X509_LOOKUP);
 
+	if (SSL_want_private_key_operation(s))
+		return (SSL_ERROR_WANT_PRIVATE_KEY_OPERATION);
+
 	if ((s->shutdown & SSL_RECEIVED_SHUTDOWN) &&
 	    (s->s3->warn_alert == SSL_AD_CLOSE_NOTIFY))
 		return (SSL_ERROR_ZERO_RETURN);
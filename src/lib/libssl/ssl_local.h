@@ -146,6 +146,7 @@
 #include <sys/types.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -537,6 +538,10 @@ typedef struct ssl_handshake_tls12_st {
 
 	/* Transcript hash prior to sending certificate verify message. */
 	uint8_t cert_verify[EVP_MAX_MD_SIZE];
+
+	/* Server key exchange parameters awaiting a pending signature. */
+	uint8_t *signed_params;
+	size_t signed_params_len;
 } SSL_HANDSHAKE_TLS12;
 
 typedef struct ssl_handshake_tls13_st {
@@ -626,6 +631,10 @@ typedef struct ssl_handshake_st {
 	/* Key share for ephemeral key exchange. */
 	struct tls_key_share *key_share;
 
+	/* Encoded message for a pending RSA-PSS private key operation. */
+	uint8_t *sign_pss_em;
+	size_t sign_pss_em_len;
+
 	/*
 	 * Copies of the verify data sent in our finished message and the
 	 * verify data received in the finished message sent by our peer.
@@ -707,6 +716,25 @@ typedef void (ssl_info_callback_fn)(const SSL *s, int type, int val);
 typedef void (ssl_msg_callback_fn)(int is_write, int version, int content_type,
     const void *buf, size_t len, SSL *ssl, void *arg);
 
+/*
+ * The internal session cache is split into shards, selected by session ID.
+ * Each shard has its own lock, hash table and list, so that lookups and
+ * inserts of unrelated sessions do not contend on a single lock. The list
+ * is kept approximately ordered by expiry time, with the session that
+ * expires first at the tail, so that expired sessions can be removed in
+ * small batches instead of by walking the entire cache.
+ */
+#define SSL_SESSION_CACHE_SHARDS	16
+#define SSL_SESSION_CACHE_EXPIRE_BATCH	16
+#define SSL_SESSION_CACHE_ORDER_SCAN	32
+
+struct ssl_session_cache_shard {
+	pthread_mutex_t lock;
+	struct lhash_st_SSL_SESSION *sessions;
+	struct ssl_session_st *head;
+	struct ssl_session_st *tail;
+};
+
 struct ssl_ctx_st {
 	const SSL_METHOD *method;
 	const SSL_QUIC_METHOD *quic_method;
@@ -808,13 +836,11 @@ struct ssl_ctx_st {
 	int (*tlsext_status_cb)(SSL *ssl, void *arg);
 	void *tlsext_status_arg;
 
-	struct lhash_st_SSL_SESSION *sessions;
+	struct ssl_session_cache_shard session_cache[SSL_SESSION_CACHE_SHARDS];
 
 	/* Most session-ids that will be cached, default is
 	 * SSL_SESSION_CACHE_MAX_SIZE_DEFAULT. 0 is unlimited. */
 	unsigned long session_cache_size;
-	struct ssl_session_st *session_cache_head;
-	struct ssl_session_st *session_cache_tail;
 
 	/* This can have one of 2 values, ored together,
 	 * SSL_SESS_CACHE_CLIENT,
@@ -823,6 +849,9 @@ struct ssl_ctx_st {
 	 * SSL_accept which cache SSL_SESSIONS. */
 	int session_cache_mode;
 
+	/* Shared memory session cache, see ssl_sess_shm.c. */
+	struct ssl_session_shm *session_shm;
+
 	struct {
 		int sess_connect;	/* SSL new conn - started */
 		int sess_connect_renegotiate;/* SSL reneg - requested */
@@ -1310,6 +1339,19 @@ SSL_SESSION *ssl_session_dup(SSL_SESSION *src, int include_ticket);
 int ssl_get_new_session(SSL *s, int session);
 int ssl_get_prev_session(SSL *s, CBS *session_id, CBS *ext_block,
     int *alert);
+int ssl_session_cache_init(SSL_CTX *ctx);
+void ssl_session_cache_free(SSL_CTX *ctx);
+unsigned long ssl_session_cache_count(SSL_CTX *ctx);
+struct lhash_st_SSL_SESSION *ssl_session_cache_view(SSL_CTX *ctx);
+void ssl_session_cache_view_free(struct lhash_st_SSL_SESSION *view);
+void ssl_session_cache_expire(SSL_CTX *ctx, time_t now);
+SSL_SESSION *ssl_session_cache_lookup(SSL_CTX *ctx, SSL_SESSION *key,
+    int up_ref);
+void ssl_session_shm_add(SSL *s, SSL_SESSION *sess);
+SSL_SESSION *ssl_session_shm_get(SSL *s, const unsigned char *id,
+    size_t id_len);
+void ssl_session_shm_remove(SSL_CTX *ctx, SSL_SESSION *sess);
+void ssl_session_shm_free(struct ssl_session_shm *shm);
 int ssl_cipher_id_cmp(const SSL_CIPHER *a, const SSL_CIPHER *b);
 SSL_CIPHER *OBJ_bsearch_ssl_cipher_id(SSL_CIPHER *key, SSL_CIPHER const *base,
     int num);
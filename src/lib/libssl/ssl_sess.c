@@ -144,10 +144,312 @@
 
 #include "ssl_local.h"
 
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s);
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s);
+static void SSL_SESSION_list_remove(struct ssl_session_cache_shard *shard,
+    SSL_SESSION *s);
+static void SSL_SESSION_list_add(struct ssl_session_cache_shard *shard,
+    SSL_SESSION *s);
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck);
 
+static unsigned long
+ssl_session_hash(const SSL_SESSION *a)
+{
+	unsigned long	l;
+
+	l = (unsigned long)
+	    ((unsigned int) a->session_id[0]     )|
+	    ((unsigned int) a->session_id[1]<< 8L)|
+	    ((unsigned long)a->session_id[2]<<16L)|
+	    ((unsigned long)a->session_id[3]<<24L);
+	return (l);
+}
+
+/*
+ * NB: If this function (or indeed the hash function which uses a sort of
+ * coarser function than this one) is changed, ensure
+ * SSL_CTX_has_matching_session_id() is checked accordingly. It relies on being
+ * able to construct an SSL_SESSION that will collide with any existing session
+ * with a matching session ID.
+ */
+static int
+ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
+{
+	if (a->ssl_version != b->ssl_version)
+		return (1);
+	if (a->session_id_length != b->session_id_length)
+		return (1);
+	if (timingsafe_memcmp(a->session_id, b->session_id, a->session_id_length) != 0)
+		return (1);
+	return (0);
+}
+
+/*
+ * These wrapper functions should remain rather than redeclaring
+ * SSL_SESSION_hash and SSL_SESSION_cmp for void* types and casting each
+ * variable. The reason is that the functions aren't static, they're exposed via
+ * ssl.h.
+ */
+static unsigned long
+ssl_session_LHASH_HASH(const void *arg)
+{
+	const SSL_SESSION *a = arg;
+
+	return ssl_session_hash(a);
+}
+
+static int
+ssl_session_LHASH_COMP(const void *arg1, const void *arg2)
+{
+	const SSL_SESSION *a = arg1;
+	const SSL_SESSION *b = arg2;
+
+	return ssl_session_cmp(a, b);
+}
+
+/*
+ * The hash table within a shard is indexed by the leading bytes of the
+ * session ID, so the shard is selected by the trailing byte instead.
+ */
+static struct ssl_session_cache_shard *
+ssl_session_cache_shard(SSL_CTX *ctx, const SSL_SESSION *s)
+{
+	size_t idx = 0;
+
+	if (s->session_id_length > 0 &&
+	    s->session_id_length <= sizeof(s->session_id))
+		idx = s->session_id[s->session_id_length - 1];
+
+	return &ctx->session_cache[idx % SSL_SESSION_CACHE_SHARDS];
+}
+
+static time_t
+ssl_session_expiry(const SSL_SESSION *s)
+{
+	return s->time + s->timeout;
+}
+
+/*
+ * The cache size limit is split evenly across the shards, rounding up.
+ */
+static unsigned long
+ssl_session_cache_shard_max(SSL_CTX *ctx)
+{
+	unsigned long size;
+
+	if ((size = ctx->session_cache_size) == 0)
+		return 0;
+
+	return (size + SSL_SESSION_CACHE_SHARDS - 1) / SSL_SESSION_CACHE_SHARDS;
+}
+
+int
+ssl_session_cache_init(SSL_CTX *ctx)
+{
+	struct ssl_session_cache_shard *shard;
+	size_t i;
+
+	for (i = 0; i < SSL_SESSION_CACHE_SHARDS; i++) {
+		shard = &ctx->session_cache[i];
+		if ((shard->sessions = lh_SSL_SESSION_new()) == NULL)
+			return 0;
+		if (pthread_mutex_init(&shard->lock, NULL) != 0) {
+			lh_SSL_SESSION_free(shard->sessions);
+			shard->sessions = NULL;
+			return 0;
+		}
+		shard->head = NULL;
+		shard->tail = NULL;
+	}
+
+	return 1;
+}
+
+/* The cache must have been flushed with SSL_CTX_flush_sessions(). */
+void
+ssl_session_cache_free(SSL_CTX *ctx)
+{
+	struct ssl_session_cache_shard *shard;
+	size_t i;
+
+	for (i = 0; i < SSL_SESSION_CACHE_SHARDS; i++) {
+		shard = &ctx->session_cache[i];
+		if (shard->sessions == NULL)
+			continue;
+		lh_SSL_SESSION_free(shard->sessions);
+		shard->sessions = NULL;
+		pthread_mutex_destroy(&shard->lock);
+	}
+}
+
+unsigned long
+ssl_session_cache_count(SSL_CTX *ctx)
+{
+	struct ssl_session_cache_shard *shard;
+	unsigned long count = 0;
+	size_t i;
+
+	for (i = 0; i < SSL_SESSION_CACHE_SHARDS; i++) {
+		shard = &ctx->session_cache[i];
+		if (shard->sessions == NULL)
+			continue;
+		pthread_mutex_lock(&shard->lock);
+		count += lh_SSL_SESSION_num_items(shard->sessions);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	return count;
+}
+
+struct session_view_param {
+	struct lhash_st_SSL_SESSION *view;
+	int failed;
+};
+
+static void
+ssl_session_view_add_doall_arg(SSL_SESSION *s,
+    struct session_view_param *p)
+{
+	if (p->failed)
+		return;
+
+	CRYPTO_add(&s->references, 1, CRYPTO_LOCK_SSL_SESSION);
+	(void)lh_SSL_SESSION_insert(p->view, s);
+	if (lh_SSL_SESSION_error(p->view) > 0) {
+		SSL_SESSION_free(s);
+		p->failed = 1;
+	}
+}
+
+static void
+ssl_session_view_add_LHASH_DOALL_ARG(void *arg1, void *arg2)
+{
+	SSL_SESSION *a = arg1;
+	struct session_view_param *b = arg2;
+
+	ssl_session_view_add_doall_arg(a, b);
+}
+
+static void
+ssl_session_view_free_doall(SSL_SESSION *s)
+{
+	SSL_SESSION_free(s);
+}
+
+static void
+ssl_session_view_free_LHASH_DOALL(void *arg)
+{
+	ssl_session_view_free_doall(arg);
+}
+
+/*
+ * Build a single hash table holding the sessions of every shard. The table
+ * is owned by the caller and holds a reference to each session, so it stays
+ * valid while sessions are added to or removed from the cache. It must be
+ * released with ssl_session_cache_view_free().
+ */
+struct lhash_st_SSL_SESSION *
+ssl_session_cache_view(SSL_CTX *ctx)
+{
+	struct ssl_session_cache_shard *shard;
+	struct session_view_param p;
+	size_t i;
+
+	memset(&p, 0, sizeof(p));
+
+	if ((p.view = lh_SSL_SESSION_new()) == NULL)
+		return NULL;
+
+	for (i = 0; i < SSL_SESSION_CACHE_SHARDS && !p.failed; i++) {
+		shard = &ctx->session_cache[i];
+		if (shard->sessions == NULL)
+			continue;
+		pthread_mutex_lock(&shard->lock);
+		lh_SSL_SESSION_doall_arg(shard->sessions,
+		    ssl_session_view_add_LHASH_DOALL_ARG,
+		    struct session_view_param, &p);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	if (p.failed) {
+		ssl_session_cache_view_free(p.view);
+		return NULL;
+	}
+
+	return p.view;
+}
+
+void
+ssl_session_cache_view_free(struct lhash_st_SSL_SESSION *view)
+{
+	if (view == NULL)
+		return;
+
+	lh_SSL_SESSION_doall(view, ssl_session_view_free_LHASH_DOALL);
+	lh_SSL_SESSION_free(view);
+}
+
+/*
+ * Remove up to max expired sessions from the tail of the shard. This stops
+ * at the first session that has not yet expired, so a session that is out
+ * of order may delay the removal of others until the next full flush.
+ * Called with the shard locked.
+ */
+static void
+ssl_session_cache_shard_expire(SSL_CTX *ctx,
+    struct ssl_session_cache_shard *shard, time_t now, int max)
+{
+	SSL_SESSION *s;
+
+	while (max-- > 0 && (s = shard->tail) != NULL) {
+		if (now <= ssl_session_expiry(s))
+			break;
+		if (!remove_session_lock(ctx, s, 0))
+			break;
+	}
+}
+
+/*
+ * Remove a bounded number of expired sessions from each shard.
+ */
+void
+ssl_session_cache_expire(SSL_CTX *ctx, time_t now)
+{
+	struct ssl_session_cache_shard *shard;
+	size_t i;
+
+	for (i = 0; i < SSL_SESSION_CACHE_SHARDS; i++) {
+		shard = &ctx->session_cache[i];
+		if (shard->sessions == NULL)
+			continue;
+		pthread_mutex_lock(&shard->lock);
+		ssl_session_cache_shard_expire(ctx, shard, now,
+		    SSL_SESSION_CACHE_EXPIRE_BATCH);
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+/*
+ * Look up the cached session matching the version and session ID of key.
+ * If up_ref is set, the caller is given a reference to the returned session.
+ */
+SSL_SESSION *
+ssl_session_cache_lookup(SSL_CTX *ctx, SSL_SESSION *key, int up_ref)
+{
+	struct ssl_session_cache_shard *shard;
+	SSL_SESSION *sess;
+
+	shard = ssl_session_cache_shard(ctx, key);
+	if (shard->sessions == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&shard->lock);
+	sess = lh_SSL_SESSION_retrieve(shard->sessions, key);
+	if (sess != NULL && up_ref)
+		CRYPTO_add(&sess->references, 1, CRYPTO_LOCK_SSL_SESSION);
+	pthread_mutex_unlock(&shard->lock);
+
+	return sess;
+}
+
 /* aka SSL_get0_session; gets 0 objects, just returns a copy of the pointer */
 SSL_SESSION *
 SSL_get_session(const SSL *ssl)
@@ -170,7 +472,7 @@ SSL_get1_session(SSL *ssl)
 	CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
 	sess = ssl->session;
 	if (sess)
-		sess->references++;
+		CRYPTO_add(&sess->references, 1, CRYPTO_LOCK_SSL_SESSION);
 	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
 
 	return (sess);
@@ -560,18 +862,29 @@ ssl_session_from_cache(SSL *s, CBS *session_id)
 	    sizeof(data.session_id), &data.session_id_length))
 		return NULL;
 
-	CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-	sess = lh_SSL_SESSION_retrieve(s->session_ctx->sessions, &data);
-	if (sess != NULL)
-		CRYPTO_add(&sess->references, 1, CRYPTO_LOCK_SSL_SESSION);
-	CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
-
+	sess = ssl_session_cache_lookup(s->session_ctx, &data, 1);
 	if (sess == NULL)
 		s->session_ctx->stats.sess_miss++;
 
 	return sess;
 }
 
+static SSL_SESSION *
+ssl_session_from_shm(SSL *s, CBS *session_id)
+{
+	SSL_SESSION *sess;
+
+	if ((sess = ssl_session_shm_get(s, CBS_data(session_id),
+	    CBS_len(session_id))) == NULL)
+		return NULL;
+
+	if (!(s->session_ctx->session_cache_mode &
+	    SSL_SESS_CACHE_NO_INTERNAL_STORE))
+		SSL_CTX_add_session(s->session_ctx, sess);
+
+	return sess;
+}
+
 static SSL_SESSION *
 ssl_session_from_callback(SSL *s, CBS *session_id)
 {
@@ -618,6 +931,8 @@ ssl_session_by_id(SSL *s, CBS *session_id)
 		return NULL;
 
 	if ((sess = ssl_session_from_cache(s, session_id)) == NULL)
+		sess = ssl_session_from_shm(s, session_id);
+	if (sess == NULL)
 		sess = ssl_session_from_callback(s, session_id);
 
 	return sess;
@@ -758,9 +1073,13 @@ ssl_get_prev_session(SSL *s, CBS *session_id, CBS *ext_block, int *alert)
 int
 SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
+	struct ssl_session_cache_shard *shard;
+	unsigned long max;
 	int ret = 0;
 	SSL_SESSION *s;
 
+	shard = ssl_session_cache_shard(ctx, c);
+
 	/*
 	 * Add just 1 reference count for the SSL_CTX's session cache
 	 * even though it has two ways of access: each session is in a
@@ -772,17 +1091,17 @@ SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 	 * If session c is in already in cache, we take back the increment
 	 * later.
 	 */
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	s = lh_SSL_SESSION_insert(ctx->sessions, c);
+	pthread_mutex_lock(&shard->lock);
+	s = lh_SSL_SESSION_insert(shard->sessions, c);
 
 	/*
 	 * s != NULL iff we already had a session with the given PID.
 	 * In this case, s == c should hold (then we did not really modify
-	 * ctx->sessions), or we're in trouble.
+	 * the cache), or we're in trouble.
 	 */
 	if (s != NULL && s != c) {
 		/* We *are* in trouble ... */
-		SSL_SESSION_list_remove(ctx, s);
+		SSL_SESSION_list_remove(shard, s);
 		SSL_SESSION_free(s);
 		/*
 		 * ... so pretend the other session did not exist in cache
@@ -796,7 +1115,7 @@ SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 
 	/* Put at the head of the queue unless it is already in the cache */
 	if (s == NULL)
-		SSL_SESSION_list_add(ctx, c);
+		SSL_SESSION_list_add(shard, c);
 
 	if (s != NULL) {
 		/*
@@ -808,24 +1127,26 @@ SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 		ret = 0;
 	} else {
 		/*
-		 * New cache entry -- remove old ones if cache has become
-		 * too large.
+		 * New cache entry -- remove some expired sessions, then old
+		 * ones if this shard of the cache is still too large.
 		 */
 
 		ret = 1;
 
-		if (SSL_CTX_sess_get_cache_size(ctx) > 0) {
-			while (SSL_CTX_sess_number(ctx) >
-			    SSL_CTX_sess_get_cache_size(ctx)) {
-				if (!remove_session_lock(ctx,
-				    ctx->session_cache_tail, 0))
+		if (!(ctx->session_cache_mode & SSL_SESS_CACHE_NO_AUTO_CLEAR))
+			ssl_session_cache_shard_expire(ctx, shard, time(NULL),
+			    SSL_SESSION_CACHE_EXPIRE_BATCH);
+
+		if ((max = ssl_session_cache_shard_max(ctx)) > 0) {
+			while (lh_SSL_SESSION_num_items(shard->sessions) > max) {
+				if (!remove_session_lock(ctx, shard->tail, 0))
 					break;
 				else
 					ctx->stats.sess_cache_full++;
 			}
 		}
 	}
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+	pthread_mutex_unlock(&shard->lock);
 	return (ret);
 }
 LSSL_ALIAS(SSL_CTX_add_session);
@@ -833,28 +1154,36 @@ LSSL_ALIAS(SSL_CTX_add_session);
 int
 SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
+	ssl_session_shm_remove(ctx, c);
+
 	return remove_session_lock(ctx, c, 1);
 }
 LSSL_ALIAS(SSL_CTX_remove_session);
 
+/* If lck is not set, the caller must hold the lock of the session's shard. */
 static int
 remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck)
 {
+	struct ssl_session_cache_shard *shard;
 	SSL_SESSION *r;
 	int ret = 0;
 
 	if (c == NULL || c->session_id_length == 0)
 		return 0;
 
+	shard = ssl_session_cache_shard(ctx, c);
+	if (shard->sessions == NULL)
+		return 0;
+
 	if (lck)
-		CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	if ((r = lh_SSL_SESSION_retrieve(ctx->sessions, c)) == c) {
+		pthread_mutex_lock(&shard->lock);
+	if ((r = lh_SSL_SESSION_retrieve(shard->sessions, c)) == c) {
 		ret = 1;
-		r = lh_SSL_SESSION_delete(ctx->sessions, c);
-		SSL_SESSION_list_remove(ctx, c);
+		r = lh_SSL_SESSION_delete(shard->sessions, c);
+		SSL_SESSION_list_remove(shard, c);
 	}
 	if (lck)
-		CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+		pthread_mutex_unlock(&shard->lock);
 
 	if (ret) {
 		r->not_resumable = 1;
@@ -1131,7 +1460,7 @@ LSSL_ALIAS(SSL_set_session_ticket_ext);
 typedef struct timeout_param_st {
 	SSL_CTX *ctx;
 	long time;
-	struct lhash_st_SSL_SESSION *cache;
+	struct ssl_session_cache_shard *shard;
 } TIMEOUT_PARAM;
 
 static void
@@ -1141,8 +1470,8 @@ timeout_doall_arg(SSL_SESSION *s, TIMEOUT_PARAM *p)
 		/* timeout */
 		/* The reason we don't call SSL_CTX_remove_session() is to
 		 * save on locking overhead */
-		(void)lh_SSL_SESSION_delete(p->cache, s);
-		SSL_SESSION_list_remove(p->ctx, s);
+		(void)lh_SSL_SESSION_delete(p->shard->sessions, s);
+		SSL_SESSION_list_remove(p->shard, s);
 		s->not_resumable = 1;
 		if (p->ctx->remove_session_cb != NULL)
 			p->ctx->remove_session_cb(p->ctx, s);
@@ -1163,21 +1492,27 @@ timeout_LHASH_DOALL_ARG(void *arg1, void *arg2)
 void
 SSL_CTX_flush_sessions(SSL_CTX *s, long t)
 {
+	struct ssl_session_cache_shard *shard;
 	unsigned long i;
 	TIMEOUT_PARAM tp;
+	size_t n;
 
 	tp.ctx = s;
-	tp.cache = s->sessions;
-	if (tp.cache == NULL)
-		return;
 	tp.time = t;
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	i = CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load;
-	CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load = 0;
-	lh_SSL_SESSION_doall_arg(tp.cache, timeout_LHASH_DOALL_ARG,
-	TIMEOUT_PARAM, &tp);
-	CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load = i;
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+
+	for (n = 0; n < SSL_SESSION_CACHE_SHARDS; n++) {
+		shard = &s->session_cache[n];
+		if (shard->sessions == NULL)
+			continue;
+		tp.shard = shard;
+		pthread_mutex_lock(&shard->lock);
+		i = CHECKED_LHASH_OF(SSL_SESSION, shard->sessions)->down_load;
+		CHECKED_LHASH_OF(SSL_SESSION, shard->sessions)->down_load = 0;
+		lh_SSL_SESSION_doall_arg(shard->sessions,
+		    timeout_LHASH_DOALL_ARG, TIMEOUT_PARAM, &tp);
+		CHECKED_LHASH_OF(SSL_SESSION, shard->sessions)->down_load = i;
+		pthread_mutex_unlock(&shard->lock);
+	}
 }
 LSSL_ALIAS(SSL_CTX_flush_sessions);
 
@@ -1192,30 +1527,28 @@ ssl_clear_bad_session(SSL *s)
 		return (0);
 }
 
-/* locked by SSL_CTX in the calling function */
+/* locked by the shard in the calling function */
 static void
-SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
+SSL_SESSION_list_remove(struct ssl_session_cache_shard *shard, SSL_SESSION *s)
 {
 	if (s->next == NULL || s->prev == NULL)
 		return;
 
-	if (s->next == (SSL_SESSION *)&(ctx->session_cache_tail)) {
+	if (s->next == (SSL_SESSION *)&(shard->tail)) {
 		/* last element in list */
-		if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+		if (s->prev == (SSL_SESSION *)&(shard->head)) {
 			/* only one element in list */
-			ctx->session_cache_head = NULL;
-			ctx->session_cache_tail = NULL;
+			shard->head = NULL;
+			shard->tail = NULL;
 		} else {
-			ctx->session_cache_tail = s->prev;
-			s->prev->next =
-			    (SSL_SESSION *)&(ctx->session_cache_tail);
+			shard->tail = s->prev;
+			s->prev->next = (SSL_SESSION *)&(shard->tail);
 		}
 	} else {
-		if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+		if (s->prev == (SSL_SESSION *)&(shard->head)) {
 			/* first element in list */
-			ctx->session_cache_head = s->next;
-			s->next->prev =
-			    (SSL_SESSION *)&(ctx->session_cache_head);
+			shard->head = s->next;
+			s->next->prev = (SSL_SESSION *)&(shard->head);
 		} else {
 			/* middle of list */
 			s->next->prev = s->prev;
@@ -1225,22 +1558,57 @@ SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
 	s->prev = s->next = NULL;
 }
 
+/*
+ * Insert the session in expiry order, latest first. Sessions normally share
+ * the same timeout, so the position is almost always at the head or the
+ * tail and the scan is bounded to keep inserts cheap when timeouts are mixed.
+ */
 static void
-SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s)
+SSL_SESSION_list_add(struct ssl_session_cache_shard *shard, SSL_SESSION *s)
 {
+	SSL_SESSION *next;
+	time_t expiry;
+	int scan = SSL_SESSION_CACHE_ORDER_SCAN;
+
 	if (s->next != NULL && s->prev != NULL)
-		SSL_SESSION_list_remove(ctx, s);
+		SSL_SESSION_list_remove(shard, s);
+
+	if (shard->head == NULL) {
+		shard->head = s;
+		shard->tail = s;
+		s->prev = (SSL_SESSION *)&(shard->head);
+		s->next = (SSL_SESSION *)&(shard->tail);
+		return;
+	}
 
-	if (ctx->session_cache_head == NULL) {
-		ctx->session_cache_head = s;
-		ctx->session_cache_tail = s;
-		s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-		s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
+	expiry = ssl_session_expiry(s);
+	if (ssl_session_expiry(shard->tail) >= expiry) {
+		next = (SSL_SESSION *)&(shard->tail);
 	} else {
-		s->next = ctx->session_cache_head;
+		next = shard->head;
+		while (next != (SSL_SESSION *)&(shard->tail) && scan-- > 0 &&
+		    ssl_session_expiry(next) > expiry)
+			next = next->next;
+	}
+
+	if (next == shard->head) {
+		/* first element in list */
+		s->next = shard->head;
 		s->next->prev = s;
-		s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-		ctx->session_cache_head = s;
+		s->prev = (SSL_SESSION *)&(shard->head);
+		shard->head = s;
+	} else if (next == (SSL_SESSION *)&(shard->tail)) {
+		/* last element in list */
+		s->prev = shard->tail;
+		s->prev->next = s;
+		s->next = (SSL_SESSION *)&(shard->tail);
+		shard->tail = s;
+	} else {
+		/* middle of list */
+		s->next = next;
+		s->prev = next->prev;
+		s->prev->next = s;
+		next->prev = s;
 	}
 }
 
@@ -0,0 +1,462 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Shared memory session cache.
+ *
+ * Sessions are stored in their ASN.1 encoding in an anonymous shared
+ * mapping, which is inherited by processes forked after it has been set up.
+ * The mapping is a hash table of buckets, indexed by session ID. Each bucket
+ * holds a small number of fixed size slots.
+ *
+ * There are no locks, since a lock in shared memory is never released if
+ * the process holding it dies. Instead each slot carries a version that is
+ * odd while the slot is being written. A writer claims a slot by moving its
+ * version from even to odd with a compare and swap, and readers copy the
+ * slot and discard the copy if the version changed meanwhile. A writer that
+ * loses the race simply does not store the session. If a process dies while
+ * writing, only the slot it claimed is lost.
+ *
+ * The cache is consulted and updated directly by the session cache code,
+ * after the internal session cache and before the callbacks that the
+ * application may have installed for its own external cache.
+ */
+
+#include <sys/mman.h>
+
+#include <stdatomic.h>
+
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+
+#define SSL_SHM_MAGIC		0x53534c53	/* "SSLS" */
+#define SSL_SHM_VERSION		1
+#define SSL_SHM_SLOT_SIZE	4096
+#define SSL_SHM_BUCKET_SLOTS	4
+
+struct ssl_shm_slot {
+	atomic_uint version;
+	uint32_t id_len;
+	int64_t expires;
+	uint32_t der_len;
+	uint32_t pad;
+	uint8_t id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+	uint8_t der[SSL_SHM_SLOT_SIZE - 56];
+};
+
+CTASSERT(sizeof(struct ssl_shm_slot) == SSL_SHM_SLOT_SIZE);
+
+#define SSL_SHM_DER_MAX	(sizeof(((struct ssl_shm_slot *)0)->der))
+
+struct ssl_shm_bucket {
+	struct ssl_shm_slot slots[SSL_SHM_BUCKET_SLOTS];
+};
+
+struct ssl_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_buckets;
+	uint32_t pad;
+};
+
+struct ssl_session_shm {
+	void *mem;
+	size_t mem_len;
+	struct ssl_shm_header *header;
+	struct ssl_shm_bucket *buckets;
+	uint32_t num_buckets;
+};
+
+/* A consistent copy of the header of a slot. */
+struct ssl_shm_entry {
+	unsigned int version;
+	int64_t expires;
+	uint32_t id_len;
+	uint32_t der_len;
+	uint8_t id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+};
+
+static struct ssl_shm_bucket *
+ssl_session_shm_bucket(struct ssl_session_shm *shm, const uint8_t *id,
+    size_t id_len)
+{
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	/* FNV-1a. */
+	for (i = 0; i < id_len; i++) {
+		hash ^= id[i];
+		hash *= 16777619U;
+	}
+
+	return &shm->buckets[hash % shm->num_buckets];
+}
+
+/*
+ * Copy the header of the slot. Returns 0 if the slot is being written or
+ * was modified while it was copied.
+ */
+static int
+ssl_session_shm_peek(struct ssl_shm_slot *slot, struct ssl_shm_entry *e)
+{
+	e->version = atomic_load_explicit(&slot->version, memory_order_acquire);
+	if ((e->version & 1) != 0)
+		return 0;
+
+	e->expires = slot->expires;
+	e->id_len = slot->id_len;
+	e->der_len = slot->der_len;
+	if (e->id_len > sizeof(e->id))
+		e->id_len = 0;
+	memcpy(e->id, slot->id, e->id_len);
+
+	atomic_thread_fence(memory_order_acquire);
+
+	return atomic_load_explicit(&slot->version, memory_order_relaxed) ==
+	    e->version;
+}
+
+static int
+ssl_session_shm_match(const struct ssl_shm_entry *e, const uint8_t *id,
+    size_t id_len)
+{
+	if (e->expires == 0 || e->id_len != id_len)
+		return 0;
+
+	return timingsafe_memcmp(e->id, id, id_len) == 0;
+}
+
+/* Claim the slot for writing, provided that it is still at version. */
+static int
+ssl_session_shm_claim(struct ssl_shm_slot *slot, unsigned int version)
+{
+	if (!atomic_compare_exchange_strong_explicit(&slot->version, &version,
+	    version + 1, memory_order_acq_rel, memory_order_relaxed))
+		return 0;
+
+	/* Keep the slot contents from being written before the claim. */
+	atomic_thread_fence(memory_order_release);
+
+	return 1;
+}
+
+static void
+ssl_session_shm_release(struct ssl_shm_slot *slot)
+{
+	atomic_fetch_add_explicit(&slot->version, 1, memory_order_release);
+}
+
+static void
+ssl_session_shm_clear(struct ssl_shm_slot *slot)
+{
+	size_t der_len;
+
+	if ((der_len = slot->der_len) > SSL_SHM_DER_MAX)
+		der_len = SSL_SHM_DER_MAX;
+
+	slot->expires = 0;
+	slot->id_len = 0;
+	slot->der_len = 0;
+	explicit_bzero(slot->id, sizeof(slot->id));
+	explicit_bzero(slot->der, der_len);
+}
+
+static struct ssl_shm_slot *
+ssl_session_shm_find(struct ssl_shm_bucket *bucket, const uint8_t *id,
+    size_t id_len, struct ssl_shm_entry *e)
+{
+	struct ssl_shm_slot *slot;
+	size_t i;
+
+	for (i = 0; i < SSL_SHM_BUCKET_SLOTS; i++) {
+		slot = &bucket->slots[i];
+		if (!ssl_session_shm_peek(slot, e))
+			continue;
+		if (ssl_session_shm_match(e, id, id_len))
+			return slot;
+	}
+
+	return NULL;
+}
+
+static int
+ssl_session_shm_store(struct ssl_session_shm *shm, const uint8_t *id,
+    size_t id_len, int64_t expires, const uint8_t *der, size_t der_len)
+{
+	struct ssl_shm_bucket *bucket;
+	struct ssl_shm_slot *slot, *victim;
+	struct ssl_shm_entry e;
+	unsigned int version = 0;
+	int64_t now, victim_expires = 0;
+	size_t i;
+
+	if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return 0;
+	if (der_len > SSL_SHM_DER_MAX)
+		return 0;
+
+	now = time(NULL);
+	if (expires <= now)
+		return 0;
+
+	bucket = ssl_session_shm_bucket(shm, id, id_len);
+
+	/*
+	 * Replace the same session, else use a free or expired slot, else
+	 * evict the session that is closest to expiring. Slots that are
+	 * being written are skipped.
+	 */
+	if ((victim = ssl_session_shm_find(bucket, id, id_len, &e)) != NULL) {
+		version = e.version;
+	} else {
+		for (i = 0; i < SSL_SHM_BUCKET_SLOTS; i++) {
+			slot = &bucket->slots[i];
+			if (!ssl_session_shm_peek(slot, &e))
+				continue;
+			if (e.expires <= now) {
+				victim = slot;
+				version = e.version;
+				break;
+			}
+			if (victim == NULL || e.expires < victim_expires) {
+				victim = slot;
+				version = e.version;
+				victim_expires = e.expires;
+			}
+		}
+	}
+	if (victim == NULL)
+		return 0;
+
+	if (!ssl_session_shm_claim(victim, version))
+		return 0;
+
+	victim->expires = expires;
+	victim->id_len = id_len;
+	memcpy(victim->id, id, id_len);
+	victim->der_len = der_len;
+	memcpy(victim->der, der, der_len);
+
+	ssl_session_shm_release(victim);
+
+	return 1;
+}
+
+static SSL_SESSION *
+ssl_session_shm_fetch(struct ssl_session_shm *shm, const uint8_t *id,
+    size_t id_len)
+{
+	struct ssl_shm_bucket *bucket;
+	struct ssl_shm_slot *slot;
+	struct ssl_shm_entry e;
+	SSL_SESSION *sess = NULL;
+	const unsigned char *p;
+	uint8_t der[SSL_SHM_DER_MAX];
+
+	if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return NULL;
+
+	bucket = ssl_session_shm_bucket(shm, id, id_len);
+
+	if ((slot = ssl_session_shm_find(bucket, id, id_len, &e)) == NULL)
+		return NULL;
+	if (e.expires <= time(NULL))
+		return NULL;
+	if (e.der_len == 0 || e.der_len > sizeof(der))
+		return NULL;
+
+	memcpy(der, slot->der, e.der_len);
+
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&slot->version, memory_order_relaxed) ==
+	    e.version) {
+		p = der;
+		sess = d2i_SSL_SESSION(NULL, &p, e.der_len);
+	}
+
+	explicit_bzero(der, e.der_len);
+
+	return sess;
+}
+
+static void
+ssl_session_shm_delete(struct ssl_session_shm *shm, const uint8_t *id,
+    size_t id_len)
+{
+	struct ssl_shm_bucket *bucket;
+	struct ssl_shm_slot *slot;
+	struct ssl_shm_entry e;
+	size_t i;
+
+	if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return;
+
+	bucket = ssl_session_shm_bucket(shm, id, id_len);
+
+	/* Racing stores may have left more than one copy behind. */
+	for (i = 0; i < SSL_SHM_BUCKET_SLOTS; i++) {
+		slot = &bucket->slots[i];
+		if (!ssl_session_shm_peek(slot, &e))
+			continue;
+		if (!ssl_session_shm_match(&e, id, id_len))
+			continue;
+		if (!ssl_session_shm_claim(slot, e.version))
+			continue;
+		ssl_session_shm_clear(slot);
+		ssl_session_shm_release(slot);
+	}
+}
+
+/*
+ * Return the shared cache of the context, provided that the segment it is
+ * attached to has the layout that this code expects.
+ */
+static struct ssl_session_shm *
+ssl_session_shm_attached(SSL_CTX *ctx)
+{
+	struct ssl_session_shm *shm;
+
+	if ((shm = ctx->session_shm) == NULL)
+		return NULL;
+
+	if (shm->header->magic != SSL_SHM_MAGIC ||
+	    shm->header->version != SSL_SHM_VERSION ||
+	    shm->header->num_buckets != shm->num_buckets)
+		return NULL;
+
+	return shm;
+}
+
+/* Called when a server has negotiated a new session. */
+void
+ssl_session_shm_add(SSL *s, SSL_SESSION *sess)
+{
+	struct ssl_session_shm *shm;
+	unsigned char *der = NULL;
+	int der_len;
+
+	if ((shm = ssl_session_shm_attached(s->session_ctx)) == NULL)
+		return;
+
+	/* Only servers look up sessions by ID. */
+	if (!s->server)
+		return;
+
+	if ((der_len = i2d_SSL_SESSION(sess, &der)) <= 0)
+		return;
+
+	ssl_session_shm_store(shm, sess->session_id, sess->session_id_length,
+	    (int64_t)sess->time + sess->timeout, der, der_len);
+
+	freezero(der, der_len);
+}
+
+/* Returns a new session that the caller owns, or NULL. */
+SSL_SESSION *
+ssl_session_shm_get(SSL *s, const unsigned char *id, size_t id_len)
+{
+	struct ssl_session_shm *shm;
+
+	if ((shm = ssl_session_shm_attached(s->session_ctx)) == NULL)
+		return NULL;
+
+	return ssl_session_shm_fetch(shm, id, id_len);
+}
+
+/*
+ * Called when a session is explicitly removed from the cache, but not when
+ * it is evicted from the internal cache or flushed, since other processes
+ * may still resume it. Expired sessions are never returned.
+ */
+void
+ssl_session_shm_remove(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+	struct ssl_session_shm *shm;
+
+	if ((shm = ssl_session_shm_attached(ctx)) == NULL)
+		return;
+	if (sess == NULL)
+		return;
+
+	ssl_session_shm_delete(shm, sess->session_id,
+	    sess->session_id_length);
+}
+
+void
+ssl_session_shm_free(struct ssl_session_shm *shm)
+{
+	if (shm == NULL)
+		return;
+
+	if (shm->mem != MAP_FAILED)
+		munmap(shm->mem, shm->mem_len);
+
+	freezero(shm, sizeof(*shm));
+}
+
+int
+SSL_CTX_set_session_cache_shm(SSL_CTX *ctx, size_t size)
+{
+	struct ssl_session_shm *shm = NULL;
+	size_t num_buckets;
+
+	ssl_session_shm_free(ctx->session_shm);
+	ctx->session_shm = NULL;
+
+	if (size == 0)
+		return 1;
+
+	if (size < sizeof(struct ssl_shm_header))
+		goto err;
+	num_buckets = (size - sizeof(struct ssl_shm_header)) /
+	    sizeof(struct ssl_shm_bucket);
+	if (num_buckets == 0 || num_buckets > UINT32_MAX)
+		goto err;
+
+	if ((shm = calloc(1, sizeof(*shm))) == NULL) {
+		SSLerrorx(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
+	shm->mem_len = sizeof(struct ssl_shm_header) +
+	    num_buckets * sizeof(struct ssl_shm_bucket);
+	shm->mem = mmap(NULL, shm->mem_len, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANON, -1, 0);
+	if (shm->mem == MAP_FAILED) {
+		SSLerrorx(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
+	/* Anonymous mappings are zero filled, so all slots are free. */
+	shm->header = shm->mem;
+	shm->header->magic = SSL_SHM_MAGIC;
+	shm->header->version = SSL_SHM_VERSION;
+	shm->header->num_buckets = num_buckets;
+	shm->buckets = (struct ssl_shm_bucket *)(shm->header + 1);
+	shm->num_buckets = num_buckets;
+
+	ctx->session_shm = shm;
+
+	return 1;
+
+ err:
+	ssl_session_shm_free(shm);
+
+	return 0;
+}
+LSSL_ALIAS(SSL_CTX_set_session_cache_shm);
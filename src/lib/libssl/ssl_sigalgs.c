@@ -19,8 +19,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/opensslconf.h>
+#include <openssl/rsa.h>
 
 #include "bytestring.h"
 #include "ssl_local.h"
@@ -386,3 +388,163 @@ ssl_sigalg_for_peer(SSL *s, EVP_PKEY *pkey, uint16_t sigalg_value)
 
 	return sigalg;
 }
+
+/*
+ * A signer that completes private key operations asynchronously fails the
+ * operation with SSL_R_PRIVATE_KEY_OPERATION_PENDING. In this case the error
+ * is cleared and the handshake reports SSL_ERROR_WANT_PRIVATE_KEY_OPERATION,
+ * so that the application can retry once the operation has completed.
+ */
+static int
+ssl_sigalg_sign_pending(SSL *s)
+{
+	unsigned long err;
+
+	if ((err = ERR_peek_error()) == 0)
+		return 0;
+	if (ERR_GET_LIB(err) != ERR_LIB_SSL ||
+	    ERR_GET_REASON(err) != SSL_R_PRIVATE_KEY_OPERATION_PENDING) {
+		err = ERR_peek_last_error();
+		if (ERR_GET_LIB(err) != ERR_LIB_SSL ||
+		    ERR_GET_REASON(err) != SSL_R_PRIVATE_KEY_OPERATION_PENDING)
+			return 0;
+	}
+
+	ERR_clear_error();
+	s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+
+	return 1;
+}
+
+static void
+ssl_sigalg_sign_clear(SSL *s)
+{
+	freezero(s->s3->hs.sign_pss_em, s->s3->hs.sign_pss_em_len);
+	s->s3->hs.sign_pss_em = NULL;
+	s->s3->hs.sign_pss_em_len = 0;
+}
+
+static int
+ssl_sigalg_sign_rsa_pss(SSL *s, EVP_PKEY *pkey, const EVP_MD *md,
+    const uint8_t *msg, size_t msg_len, uint8_t **out_sig,
+    size_t *out_sig_len)
+{
+	SSL_HANDSHAKE *hs = &s->s3->hs;
+	uint8_t mhash[EVP_MAX_MD_SIZE];
+	unsigned int mhash_len;
+	uint8_t *sig = NULL;
+	int rsa_size, sig_len;
+	int valid;
+	RSA *rsa;
+	int ret = 0;
+
+	if ((rsa = EVP_PKEY_get0_RSA(pkey)) == NULL)
+		goto err;
+	if ((rsa_size = RSA_size(rsa)) <= 0)
+		goto err;
+	if (!EVP_Digest(msg, msg_len, mhash, &mhash_len, md, NULL))
+		goto err;
+
+	/*
+	 * The PSS encoding is randomised - keep the encoded message until the
+	 * operation completes, so that a retried operation has the same input.
+	 */
+	if (hs->sign_pss_em != NULL) {
+		ERR_set_mark();
+		valid = hs->sign_pss_em_len == (size_t)rsa_size &&
+		    RSA_verify_PKCS1_PSS_mgf1(rsa, mhash, md, md,
+		    hs->sign_pss_em, -1) == 1;
+		ERR_pop_to_mark();
+		if (!valid)
+			ssl_sigalg_sign_clear(s);
+	}
+	if (hs->sign_pss_em == NULL) {
+		if ((hs->sign_pss_em = calloc(1, rsa_size)) == NULL)
+			goto err;
+		hs->sign_pss_em_len = rsa_size;
+		if (!RSA_padding_add_PKCS1_PSS_mgf1(rsa, hs->sign_pss_em,
+		    mhash, md, md, -1))
+			goto err;
+	}
+
+	if ((sig = calloc(1, rsa_size)) == NULL)
+		goto err;
+	if ((sig_len = RSA_private_encrypt(rsa_size, hs->sign_pss_em, sig,
+	    rsa, RSA_NO_PADDING)) <= 0)
+		goto err;
+
+	*out_sig = sig;
+	*out_sig_len = sig_len;
+	sig = NULL;
+
+	ret = 1;
+
+ err:
+	free(sig);
+
+	return ret;
+}
+
+static int
+ssl_sigalg_sign_evp(EVP_PKEY *pkey, const EVP_MD *md, const uint8_t *msg,
+    size_t msg_len, uint8_t **out_sig, size_t *out_sig_len)
+{
+	EVP_MD_CTX *mdctx = NULL;
+	uint8_t *sig = NULL;
+	size_t sig_len;
+	int ret = 0;
+
+	if ((mdctx = EVP_MD_CTX_new()) == NULL)
+		goto err;
+	if (!EVP_DigestSignInit(mdctx, NULL, md, NULL, pkey))
+		goto err;
+	if (!EVP_DigestSign(mdctx, NULL, &sig_len, msg, msg_len))
+		goto err;
+	if ((sig = calloc(1, sig_len)) == NULL)
+		goto err;
+	if (!EVP_DigestSign(mdctx, sig, &sig_len, msg, msg_len))
+		goto err;
+
+	*out_sig = sig;
+	*out_sig_len = sig_len;
+	sig = NULL;
+
+	ret = 1;
+
+ err:
+	EVP_MD_CTX_free(mdctx);
+	free(sig);
+
+	return ret;
+}
+
+/*
+ * Sign a handshake message with the given private key and signature
+ * algorithm. Returns 1 on success, 0 on failure and -1 if the private key
+ * operation is pending, in which case the caller must repeat the call with
+ * the same message when the handshake is resumed.
+ */
+int
+ssl_sigalg_sign(SSL *s, EVP_PKEY *pkey, const struct ssl_sigalg *sigalg,
+    const uint8_t *msg, size_t msg_len, uint8_t **out_sig,
+    size_t *out_sig_len)
+{
+	int ret;
+
+	*out_sig = NULL;
+	*out_sig_len = 0;
+
+	if (sigalg->flags & SIGALG_FLAG_RSA_PSS)
+		ret = ssl_sigalg_sign_rsa_pss(s, pkey, sigalg->md(), msg,
+		    msg_len, out_sig, out_sig_len);
+	else
+		ret = ssl_sigalg_sign_evp(pkey, sigalg->md(), msg, msg_len,
+		    out_sig, out_sig_len);
+
+	if (ret != 1 && ssl_sigalg_sign_pending(s))
+		return -1;
+
+	ssl_sigalg_sign_clear(s);
+
+	return ret;
+}
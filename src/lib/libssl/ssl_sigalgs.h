@@ -73,6 +73,9 @@ int ssl_sigalgs_build(uint16_t tls_version, CBB *cbb, int security_level);
 const struct ssl_sigalg *ssl_sigalg_select(SSL *s, EVP_PKEY *pkey);
 const struct ssl_sigalg *ssl_sigalg_for_peer(SSL *s, EVP_PKEY *pkey,
     uint16_t sigalg_value);
+int ssl_sigalg_sign(SSL *s, EVP_PKEY *pkey, const struct ssl_sigalg *sigalg,
+    const uint8_t *msg, size_t msg_len, uint8_t **out_sig,
+    size_t *out_sig_len);
 
 __END_HIDDEN_DECLS
 
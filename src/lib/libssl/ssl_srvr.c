@@ -1440,53 +1440,62 @@ ssl3_send_server_key_exchange(SSL *s)
 	size_t signature_len = 0;
 	const EVP_MD *md = NULL;
 	unsigned long type;
-	EVP_MD_CTX *md_ctx = NULL;
-	EVP_PKEY_CTX *pctx;
 	EVP_PKEY *pkey;
+	int sign_ret;
 	int al;
 
 	memset(&cbb, 0, sizeof(cbb));
 	memset(&cbb_signed_params, 0, sizeof(cbb_signed_params));
 
-	if ((md_ctx = EVP_MD_CTX_new()) == NULL)
-		goto err;
-
 	if (s->s3->hs.state == SSL3_ST_SW_KEY_EXCH_A) {
 
 		if (!ssl3_handshake_msg_start(s, &cbb, &server_kex,
 		    SSL3_MT_SERVER_KEY_EXCHANGE))
 			goto err;
 
-		if (!CBB_init(&cbb_signed_params, 0))
-			goto err;
-
-		if (!CBB_add_bytes(&cbb_signed_params, s->s3->client_random,
-		    SSL3_RANDOM_SIZE)) {
-			SSLerror(s, ERR_R_INTERNAL_ERROR);
-			goto err;
-		}
-		if (!CBB_add_bytes(&cbb_signed_params, s->s3->server_random,
-		    SSL3_RANDOM_SIZE)) {
-			SSLerror(s, ERR_R_INTERNAL_ERROR);
-			goto err;
-		}
+		/*
+		 * If we are resuming after a pending private key operation,
+		 * use the same parameters (and key share) as last time.
+		 */
+		if (s->s3->hs.tls12.signed_params != NULL) {
+			signed_params = s->s3->hs.tls12.signed_params;
+			signed_params_len = s->s3->hs.tls12.signed_params_len;
+			s->s3->hs.tls12.signed_params = NULL;
+			s->s3->hs.tls12.signed_params_len = 0;
+		} else {
+			if (!CBB_init(&cbb_signed_params, 0))
+				goto err;
 
-		type = s->s3->hs.cipher->algorithm_mkey;
-		if (type & SSL_kDHE) {
-			if (!ssl3_send_server_kex_dhe(s, &cbb_signed_params))
+			if (!CBB_add_bytes(&cbb_signed_params,
+			    s->s3->client_random, SSL3_RANDOM_SIZE)) {
+				SSLerror(s, ERR_R_INTERNAL_ERROR);
 				goto err;
-		} else if (type & SSL_kECDHE) {
-			if (!ssl3_send_server_kex_ecdhe(s, &cbb_signed_params))
+			}
+			if (!CBB_add_bytes(&cbb_signed_params,
+			    s->s3->server_random, SSL3_RANDOM_SIZE)) {
+				SSLerror(s, ERR_R_INTERNAL_ERROR);
 				goto err;
-		} else {
-			al = SSL_AD_HANDSHAKE_FAILURE;
-			SSLerror(s, SSL_R_UNKNOWN_KEY_EXCHANGE_TYPE);
-			goto fatal_err;
-		}
+			}
 
-		if (!CBB_finish(&cbb_signed_params, &signed_params,
-		    &signed_params_len))
-			goto err;
+			type = s->s3->hs.cipher->algorithm_mkey;
+			if (type & SSL_kDHE) {
+				if (!ssl3_send_server_kex_dhe(s,
+				    &cbb_signed_params))
+					goto err;
+			} else if (type & SSL_kECDHE) {
+				if (!ssl3_send_server_kex_ecdhe(s,
+				    &cbb_signed_params))
+					goto err;
+			} else {
+				al = SSL_AD_HANDSHAKE_FAILURE;
+				SSLerror(s, SSL_R_UNKNOWN_KEY_EXCHANGE_TYPE);
+				goto fatal_err;
+			}
+
+			if (!CBB_finish(&cbb_signed_params, &signed_params,
+			    &signed_params_len))
+				goto err;
+		}
 
 		CBS_init(&params, signed_params, signed_params_len);
 		if (!CBS_skip(&params, 2 * SSL3_RANDOM_SIZE))
@@ -1514,28 +1523,11 @@ ssl3_send_server_key_exchange(SSL *s)
 				}
 			}
 
-			if (!EVP_DigestSignInit(md_ctx, &pctx, md, NULL, pkey)) {
-				SSLerror(s, ERR_R_EVP_LIB);
-				goto err;
-			}
-			if ((sigalg->flags & SIGALG_FLAG_RSA_PSS) &&
-			    (!EVP_PKEY_CTX_set_rsa_padding(pctx,
-			    RSA_PKCS1_PSS_PADDING) ||
-			    !EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))) {
-				SSLerror(s, ERR_R_EVP_LIB);
-				goto err;
-			}
-			if (!EVP_DigestSign(md_ctx, NULL, &signature_len,
-			    signed_params, signed_params_len)) {
-				SSLerror(s, ERR_R_EVP_LIB);
-				goto err;
-			}
-			if ((signature = calloc(1, signature_len)) == NULL) {
-				SSLerror(s, ERR_R_MALLOC_FAILURE);
-				goto err;
-			}
-			if (!EVP_DigestSign(md_ctx, signature, &signature_len,
-			    signed_params, signed_params_len)) {
+			if ((sign_ret = ssl_sigalg_sign(s, pkey, sigalg,
+			    signed_params, signed_params_len, &signature,
+			    &signature_len)) != 1) {
+				if (sign_ret == -1)
+					goto pending;
 				SSLerror(s, ERR_R_EVP_LIB);
 				goto err;
 			}
@@ -1554,18 +1546,23 @@ ssl3_send_server_key_exchange(SSL *s)
 		s->s3->hs.state = SSL3_ST_SW_KEY_EXCH_B;
 	}
 
-	EVP_MD_CTX_free(md_ctx);
 	free(signature);
 	free(signed_params);
 
 	return (ssl3_handshake_write(s));
 
+ pending:
+	/* Keep the parameters for when the handshake is resumed. */
+	s->s3->hs.tls12.signed_params = signed_params;
+	s->s3->hs.tls12.signed_params_len = signed_params_len;
+	signed_params = NULL;
+	goto err;
+
  fatal_err:
 	ssl3_send_alert(s, SSL3_AL_FATAL, al);
  err:
 	CBB_cleanup(&cbb_signed_params);
 	CBB_cleanup(&cbb);
-	EVP_MD_CTX_free(md_ctx);
 	free(signature);
 	free(signed_params);
 
@@ -461,8 +461,19 @@ tls13_handshake_send_action(struct tls13_ctx *ctx,
 		if (!tls13_handshake_msg_start(ctx->hs_msg, &cbb,
 		    action->handshake_type))
 			return TLS13_IO_FAILURE;
-		if (!action->send(ctx, &cbb))
-			return TLS13_IO_FAILURE;
+		if (!action->send(ctx, &cbb)) {
+			if (!ctx->private_key_pending)
+				return TLS13_IO_FAILURE;
+
+			/*
+			 * Discard the partial message - it will be built
+			 * again once the private key operation completes.
+			 */
+			ctx->private_key_pending = 0;
+			tls13_handshake_msg_free(ctx->hs_msg);
+			ctx->hs_msg = NULL;
+			return TLS13_IO_WANT_PRIVATE_KEY;
+		}
 		if (!tls13_handshake_msg_finish(ctx->hs_msg))
 			return TLS13_IO_FAILURE;
 	}
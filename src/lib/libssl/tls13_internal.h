@@ -41,6 +41,7 @@ __BEGIN_HIDDEN_DECLS
 #define TLS13_IO_USE_LEGACY		-6
 #define TLS13_IO_RECORD_VERSION		-7
 #define TLS13_IO_RECORD_OVERFLOW	-8
+#define TLS13_IO_WANT_PRIVATE_KEY	-9
 
 #define TLS13_ERR_VERIFY_FAILED		16
 #define TLS13_ERR_HRR_FAILED		17
@@ -277,6 +278,7 @@ struct tls13_ctx {
 	int middlebox_compat;
 	int send_dummy_ccs;
 	int send_dummy_ccs_after;
+	int private_key_pending;
 
 	int close_notify_sent;
 	int close_notify_recv;
@@ -713,11 +713,10 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	const struct ssl_sigalg *sigalg;
 	uint8_t *sig = NULL, *sig_content = NULL;
 	size_t sig_len, sig_content_len;
-	EVP_MD_CTX *mdctx = NULL;
-	EVP_PKEY_CTX *pctx;
 	EVP_PKEY *pkey;
 	const SSL_CERT_PKEY *cpk;
 	CBB sig_cbb;
+	int sign_ret;
 	int ret = 0;
 
 	memset(&sig_cbb, 0, sizeof(sig_cbb));
@@ -744,22 +743,12 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	if (!CBB_finish(&sig_cbb, &sig_content, &sig_content_len))
 		goto err;
 
-	if ((mdctx = EVP_MD_CTX_new()) == NULL)
-		goto err;
-	if (!EVP_DigestSignInit(mdctx, &pctx, sigalg->md(), NULL, pkey))
+	if ((sign_ret = ssl_sigalg_sign(ctx->ssl, pkey, sigalg, sig_content,
+	    sig_content_len, &sig, &sig_len)) != 1) {
+		if (sign_ret == -1)
+			ctx->private_key_pending = 1;
 		goto err;
-	if (sigalg->flags & SIGALG_FLAG_RSA_PSS) {
-		if (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING))
-			goto err;
-		if (!EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))
-			goto err;
 	}
-	if (!EVP_DigestSign(mdctx, NULL, &sig_len, sig_content, sig_content_len))
-		goto err;
-	if ((sig = calloc(1, sig_len)) == NULL)
-		goto err;
-	if (!EVP_DigestSign(mdctx, sig, &sig_len, sig_content, sig_content_len))
-		goto err;
 
 	if (!CBB_add_u16(cbb, sigalg->value))
 		goto err;
@@ -774,11 +763,10 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	ret = 1;
 
  err:
-	if (!ret && ctx->alert == 0)
+	if (!ret && ctx->alert == 0 && !ctx->private_key_pending)
 		ctx->alert = TLS13_ALERT_INTERNAL_ERROR;
 
 	CBB_cleanup(&sig_cbb);
-	EVP_MD_CTX_free(mdctx);
 	free(sig_content);
 	free(sig);
 
@@ -586,8 +586,13 @@ tls_ssl_cert_verify_cb(X509_STORE_CTX *x509_ctx, void *arg)
 	return (0);
 }
 
-int
-tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
+/*
+ * Build a certificate store from the CAs and CRLs of the configuration.
+ * The store is treated as immutable once built, so that it can be shared
+ * by all of the SSL contexts configured from the same configuration.
+ */
+static X509_STORE *
+tls_ca_store_new(struct tls *ctx)
 {
 	size_t ca_len = ctx->config->ca_len;
 	char *ca_mem = ctx->config->ca_mem;
@@ -595,20 +600,15 @@ tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
 	size_t crl_len = ctx->config->crl_len;
 	char *ca_free = NULL;
 	STACK_OF(X509_INFO) *xis = NULL;
-	X509_STORE *store;
+	X509_STORE *store = NULL;
 	X509_INFO *xi;
 	BIO *bio = NULL;
-	int rv = -1;
 	int i;
 
-	SSL_CTX_set_verify(ssl_ctx, verify, NULL);
-	SSL_CTX_set_cert_verify_callback(ssl_ctx, tls_ssl_cert_verify_cb, ctx);
-
-	if (ctx->config->verify_depth >= 0)
-		SSL_CTX_set_verify_depth(ssl_ctx, ctx->config->verify_depth);
-
-	if (ctx->config->verify_cert == 0)
-		goto done;
+	if ((store = X509_STORE_new()) == NULL) {
+		tls_set_errorx(ctx, "out of memory");
+		goto err;
+	}
 
 	/* If no CA has been specified, attempt to load the default. */
 	if (ctx->config->ca_mem == NULL && ctx->config->ca_path == NULL) {
@@ -623,11 +623,11 @@ tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
 			tls_set_errorx(ctx, "ca too long");
 			goto err;
 		}
-		if (SSL_CTX_load_verify_mem(ssl_ctx, ca_mem, ca_len) != 1) {
+		if (X509_STORE_load_mem(store, ca_mem, ca_len) != 1) {
 			tls_set_errorx(ctx, "ssl verify memory setup failure");
 			goto err;
 		}
-	} else if (SSL_CTX_load_verify_locations(ssl_ctx, NULL,
+	} else if (X509_STORE_load_locations(store, NULL,
 	    ctx->config->ca_path) != 1) {
 		tls_set_errorx(ctx, "ssl verify locations failure");
 		goto err;
@@ -647,7 +647,6 @@ tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
 			tls_set_errorx(ctx, "failed to parse crl");
 			goto err;
 		}
-		store = SSL_CTX_get_cert_store(ssl_ctx);
 		for (i = 0; i < sk_X509_INFO_num(xis); i++) {
 			xi = sk_X509_INFO_value(xis, i);
 			if (xi->crl == NULL)
@@ -661,15 +660,65 @@ tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
 		    X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
 	}
 
- done:
-	rv = 0;
+	sk_X509_INFO_pop_free(xis, X509_INFO_free);
+	BIO_free(bio);
+	free(ca_free);
+
+	return store;
 
  err:
+	X509_STORE_free(store);
 	sk_X509_INFO_pop_free(xis, X509_INFO_free);
 	BIO_free(bio);
 	free(ca_free);
 
-	return (rv);
+	return NULL;
+}
+
+/*
+ * Return a reference to the certificate store of the configuration, which
+ * is built on first use. A server with many SNI contexts, or many clients
+ * using the same configuration, then only parse the CAs and CRLs once.
+ */
+static X509_STORE *
+tls_config_ca_store(struct tls *ctx)
+{
+	struct tls_config *config = ctx->config;
+	X509_STORE *store;
+
+	pthread_mutex_lock(&config->mutex);
+	if (config->ca_store == NULL)
+		config->ca_store = tls_ca_store_new(ctx);
+	if ((store = config->ca_store) != NULL && !X509_STORE_up_ref(store)) {
+		tls_set_errorx(ctx, "failed to reference certificate store");
+		store = NULL;
+	}
+	pthread_mutex_unlock(&config->mutex);
+
+	return store;
+}
+
+int
+tls_configure_ssl_verify(struct tls *ctx, SSL_CTX *ssl_ctx, int verify)
+{
+	X509_STORE *store;
+
+	SSL_CTX_set_verify(ssl_ctx, verify, NULL);
+	SSL_CTX_set_cert_verify_callback(ssl_ctx, tls_ssl_cert_verify_cb, ctx);
+
+	if (ctx->config->verify_depth >= 0)
+		SSL_CTX_set_verify_depth(ssl_ctx, ctx->config->verify_depth);
+
+	if (ctx->config->verify_cert == 0)
+		return (0);
+
+	if ((store = tls_config_ca_store(ctx)) == NULL)
+		return (-1);
+
+	/* The SSL context takes over our reference. */
+	SSL_CTX_set_cert_store(ssl_ctx, store);
+
+	return (0);
 }
 
 void
@@ -688,6 +737,9 @@ tls_reset(struct tls *ctx)
 {
 	struct tls_sni_ctx *sni, *nsni;
 
+	tls_signer_cancel(ctx->signer, ctx);
+	ctx->signer = NULL;
+
 	tls_config_free(ctx->config);
 	ctx->config = NULL;
 
@@ -747,6 +799,9 @@ tls_ssl_error(struct tls *ctx, SSL *ssl_conn, int ssl_ret, const char *prefix)
 	case SSL_ERROR_WANT_WRITE:
 		return (TLS_WANT_POLLOUT);
 
+	case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
+		return (TLS_WANT_PRIVATE_KEY);
+
 	case SSL_ERROR_SYSCALL:
 		if ((err = ERR_peek_error()) != 0) {
 			errstr = ERR_error_string(err, NULL);
@@ -795,10 +850,13 @@ tls_handshake(struct tls *ctx)
 		goto out;
 	}
 
+	/* Asynchronous sign operations are tied to this context. */
+	tls_signer_set_ctx(ctx);
 	if ((ctx->flags & TLS_CLIENT) != 0)
 		rv = tls_handshake_client(ctx);
 	else if ((ctx->flags & TLS_SERVER_CONN) != 0)
 		rv = tls_handshake_server(ctx);
+	tls_signer_set_ctx(NULL);
 
 	if (rv == 0) {
 		ctx->ssl_peer_cert = SSL_get_peer_certificate(ctx->ssl_conn);
@@ -47,6 +47,7 @@ extern "C" {
 
 #define TLS_WANT_POLLIN		-2
 #define TLS_WANT_POLLOUT	-3
+#define TLS_WANT_PRIVATE_KEY	-4
 
 /* RFC 6960 Section 2.3 */
 #define TLS_OCSP_RESPONSE_SUCCESSFUL		0
@@ -160,6 +161,8 @@ int tls_config_set_session_id(struct tls_config *_config,
 int tls_config_set_session_lifetime(struct tls_config *_config, int _lifetime);
 int tls_config_add_ticket_key(struct tls_config *_config, uint32_t _keyrev,
     unsigned char *_key, size_t _keylen);
+int tls_config_set_ticket_keys(struct tls_config *_config, uint32_t _keyrev,
+    unsigned char *_keys, size_t _keyslen);
 
 struct tls *tls_client(void);
 struct tls *tls_server(void);
@@ -150,6 +150,18 @@ tls_config_new(void)
 	return tls_config_new_internal();
 }
 
+static void
+tls_ticket_ring_free_list(struct tls_ticket_ring *ring)
+{
+	struct tls_ticket_ring *next;
+
+	while (ring != NULL) {
+		next = ring->next;
+		freezero(ring, sizeof(*ring));
+		ring = next;
+	}
+}
+
 void
 tls_config_free(struct tls_config *config)
 {
@@ -179,12 +191,42 @@ tls_config_free(struct tls_config *config)
 	free((char *)config->ciphers);
 	free((char *)config->crl_mem);
 	free(config->ecdhecurves);
+	X509_STORE_free(config->ca_store);
+
+	tls_ticket_ring_free_list(atomic_load_explicit(&config->ticket_ring,
+	    memory_order_relaxed));
+	tls_ticket_ring_free_list(atomic_load_explicit(&config->ticket_retired,
+	    memory_order_relaxed));
 
 	pthread_mutex_destroy(&config->mutex);
 
 	free(config);
 }
 
+/*
+ * Install new CA or CRL data and drop the certificate store built from the
+ * old data, under the lock that the store is built with, so that contexts
+ * configured afterwards get a store built from the new data. Contexts that
+ * are already configured keep their reference to the old store. Takes
+ * ownership of mem.
+ */
+static void
+tls_config_set_ca_store_mem(struct tls_config *config, char **dest,
+    size_t *dest_len, char *mem, size_t len)
+{
+	X509_STORE *store;
+
+	pthread_mutex_lock(&config->mutex);
+	free(*dest);
+	*dest = mem;
+	*dest_len = len;
+	store = config->ca_store;
+	config->ca_store = NULL;
+	pthread_mutex_unlock(&config->mutex);
+
+	X509_STORE_free(store);
+}
+
 static void
 tls_config_keypair_add(struct tls_config *config, struct tls_keypair *keypair)
 {
@@ -435,20 +477,51 @@ tls_config_add_keypair_ocsp_file(struct tls_config *config,
 int
 tls_config_set_ca_file(struct tls_config *config, const char *ca_file)
 {
-	return tls_config_load_file(&config->error, "CA", ca_file,
-	    &config->ca_mem, &config->ca_len);
+	char *ca_mem = NULL;
+	size_t ca_len = 0;
+	int rv;
+
+	rv = tls_config_load_file(&config->error, "CA", ca_file,
+	    &ca_mem, &ca_len);
+	tls_config_set_ca_store_mem(config, &config->ca_mem, &config->ca_len,
+	    ca_mem, ca_len);
+
+	return rv;
 }
 
 int
 tls_config_set_ca_path(struct tls_config *config, const char *ca_path)
 {
-	return tls_set_string(&config->ca_path, ca_path);
+	const char *path = NULL;
+	X509_STORE *store;
+	int rv;
+
+	rv = tls_set_string(&path, ca_path);
+
+	pthread_mutex_lock(&config->mutex);
+	free((char *)config->ca_path);
+	config->ca_path = path;
+	store = config->ca_store;
+	config->ca_store = NULL;
+	pthread_mutex_unlock(&config->mutex);
+
+	X509_STORE_free(store);
+
+	return rv;
 }
 
 int
 tls_config_set_ca_mem(struct tls_config *config, const uint8_t *ca, size_t len)
 {
-	return tls_set_mem(&config->ca_mem, &config->ca_len, ca, len);
+	char *ca_mem = NULL;
+	size_t ca_len = 0;
+	int rv;
+
+	rv = tls_set_mem(&ca_mem, &ca_len, ca, len);
+	tls_config_set_ca_store_mem(config, &config->ca_mem, &config->ca_len,
+	    ca_mem, ca_len);
+
+	return rv;
 }
 
 int
@@ -503,15 +576,31 @@ tls_config_set_ciphers(struct tls_config *config, const char *ciphers)
 int
 tls_config_set_crl_file(struct tls_config *config, const char *crl_file)
 {
-	return tls_config_load_file(&config->error, "CRL", crl_file,
-	    &config->crl_mem, &config->crl_len);
+	char *crl_mem = NULL;
+	size_t crl_len = 0;
+	int rv;
+
+	rv = tls_config_load_file(&config->error, "CRL", crl_file,
+	    &crl_mem, &crl_len);
+	tls_config_set_ca_store_mem(config, &config->crl_mem, &config->crl_len,
+	    crl_mem, crl_len);
+
+	return rv;
 }
 
 int
 tls_config_set_crl_mem(struct tls_config *config, const uint8_t *crl,
     size_t len)
 {
-	return tls_set_mem(&config->crl_mem, &config->crl_len, crl, len);
+	char *crl_mem = NULL;
+	size_t crl_len = 0;
+	int rv;
+
+	rv = tls_set_mem(&crl_mem, &crl_len, crl, len);
+	tls_config_set_ca_store_mem(config, &config->crl_mem, &config->crl_len,
+	    crl_mem, crl_len);
+
+	return rv;
 }
 
 int
@@ -870,48 +959,267 @@ tls_config_set_session_lifetime(struct tls_config *config, int lifetime)
 	return (0);
 }
 
-int
-tls_config_add_ticket_key(struct tls_config *config, uint32_t keyrev,
-    unsigned char *key, size_t keylen)
+static unsigned int
+tls_ticket_ring_slot(const unsigned char *key_name)
 {
-	struct tls_ticket_key newkey;
+	unsigned int hash = 0;
+	size_t i;
+
+	for (i = 0; i < TLS_TICKET_NAME_SIZE; i++)
+		hash = hash * 31 + key_name[i];
+
+	return (hash % TLS_TICKET_RING_SLOTS);
+}
+
+static void
+tls_ticket_ring_index(struct tls_ticket_ring *ring)
+{
+	unsigned int slot;
+	int i;
+
+	memset(ring->index, 0, sizeof(ring->index));
+
+	for (i = 0; i < ring->num_keys; i++) {
+		slot = tls_ticket_ring_slot(ring->keys[i].key_name);
+		while (ring->index[slot] != 0)
+			slot = (slot + 1) % TLS_TICKET_RING_SLOTS;
+		ring->index[slot] = i + 1;
+	}
+}
+
+struct tls_ticket_key *
+tls_ticket_ring_lookup(struct tls_ticket_ring *ring,
+    const unsigned char *key_name)
+{
+	struct tls_ticket_key *tk;
+	unsigned int slot;
 	int i;
 
+	slot = tls_ticket_ring_slot(key_name);
+
+	for (i = 0; i < TLS_TICKET_RING_SLOTS; i++) {
+		if (ring->index[slot] == 0)
+			break;
+		tk = &ring->keys[ring->index[slot] - 1];
+		if (timingsafe_memcmp(key_name, tk->key_name,
+		    sizeof(tk->key_name)) == 0)
+			return (tk);
+		slot = (slot + 1) % TLS_TICKET_RING_SLOTS;
+	}
+
+	return (NULL);
+}
+
+/*
+ * Free the retired rings if no handshake is using a ring. A handshake that
+ * enters after this check can only see the current ring, since the rings
+ * were retired before. Must be called with the config mutex held.
+ */
+static void
+tls_config_ticket_ring_reap(struct tls_config *config)
+{
+	struct tls_ticket_ring *retired;
+
+	if (atomic_load(&config->ticket_readers) != 0)
+		return;
+
+	retired = atomic_exchange_explicit(&config->ticket_retired, NULL,
+	    memory_order_relaxed);
+	tls_ticket_ring_free_list(retired);
+}
+
+/*
+ * The ring returned by tls_config_ticket_ring() and the keys in it may only
+ * be used between tls_config_ticket_ring_enter() and
+ * tls_config_ticket_ring_leave().
+ */
+void
+tls_config_ticket_ring_enter(struct tls_config *config)
+{
+	atomic_fetch_add(&config->ticket_readers, 1);
+}
+
+void
+tls_config_ticket_ring_leave(struct tls_config *config)
+{
+	if (atomic_fetch_sub(&config->ticket_readers, 1) != 1)
+		return;
+
+	/* The last handshake to leave frees any retired rings. */
+	if (atomic_load_explicit(&config->ticket_retired,
+	    memory_order_relaxed) == NULL)
+		return;
+	if (pthread_mutex_trylock(&config->mutex) != 0)
+		return;
+	tls_config_ticket_ring_reap(config);
+	pthread_mutex_unlock(&config->mutex);
+}
+
+struct tls_ticket_ring *
+tls_config_ticket_ring(struct tls_config *config)
+{
+	return atomic_load(&config->ticket_ring);
+}
+
+int
+tls_config_ticket_ring_stale(struct tls_config *config,
+    struct tls_ticket_ring *ring, time_t now)
+{
+	if (ring == NULL || ring->num_keys == 0)
+		return (1);
+
+	return (now - 3 * (config->session_lifetime / 4) >
+	    ring->keys[0].time);
+}
+
+/*
+ * Install a new ticket key ring. Must be called with the config mutex held.
+ */
+static void
+tls_config_ticket_ring_swap(struct tls_config *config,
+    struct tls_ticket_ring *ring)
+{
+	struct tls_ticket_ring *old;
+
+	old = atomic_exchange(&config->ticket_ring, ring);
+
+	if (old != NULL) {
+		old->next = atomic_load_explicit(&config->ticket_retired,
+		    memory_order_relaxed);
+		atomic_store_explicit(&config->ticket_retired, old,
+		    memory_order_relaxed);
+	}
+
+	tls_config_ticket_ring_reap(config);
+}
+
+static int
+tls_ticket_key_init(struct tls_config *config, struct tls_ticket_key *tk,
+    uint32_t keyrev, unsigned char *key, size_t keylen, time_t now)
+{
 	if (TLS_TICKET_KEY_SIZE != keylen ||
-	    sizeof(newkey.aes_key) + sizeof(newkey.hmac_key) > keylen) {
+	    sizeof(tk->aes_key) + sizeof(tk->hmac_key) > keylen) {
 		tls_config_set_errorx(config,
 		    "wrong amount of ticket key data");
 		return (-1);
 	}
 
 	keyrev = htonl(keyrev);
-	memset(&newkey, 0, sizeof(newkey));
-	memcpy(newkey.key_name, &keyrev, sizeof(keyrev));
-	memcpy(newkey.aes_key, key, sizeof(newkey.aes_key));
-	memcpy(newkey.hmac_key, key + sizeof(newkey.aes_key),
-	    sizeof(newkey.hmac_key));
-	newkey.time = time(NULL);
-
-	for (i = 0; i < TLS_NUM_TICKETS; i++) {
-		struct tls_ticket_key *tk = &config->ticket_keys[i];
-		if (memcmp(newkey.key_name, tk->key_name,
-		    sizeof(tk->key_name)) != 0)
-			continue;
+	memset(tk, 0, sizeof(*tk));
+	memcpy(tk->key_name, &keyrev, sizeof(keyrev));
+	memcpy(tk->aes_key, key, sizeof(tk->aes_key));
+	memcpy(tk->hmac_key, key + sizeof(tk->aes_key),
+	    sizeof(tk->hmac_key));
+	tk->time = now;
 
+	return (0);
+}
+
+static int
+tls_config_add_ticket_key_locked(struct tls_config *config, uint32_t keyrev,
+    unsigned char *key, size_t keylen)
+{
+	struct tls_ticket_ring *ring, *cur;
+	struct tls_ticket_key newkey, *tk;
+	int i;
+
+	if (tls_ticket_key_init(config, &newkey, keyrev, key, keylen,
+	    time(NULL)) == -1)
+		return (-1);
+
+	cur = atomic_load_explicit(&config->ticket_ring, memory_order_relaxed);
+
+	if (cur != NULL &&
+	    (tk = tls_ticket_ring_lookup(cur, newkey.key_name)) != NULL) {
 		/* allow re-entry of most recent key */
-		if (i == 0 && memcmp(newkey.aes_key, tk->aes_key,
+		if (tk == &cur->keys[0] && memcmp(newkey.aes_key, tk->aes_key,
 		    sizeof(tk->aes_key)) == 0 && memcmp(newkey.hmac_key,
-		    tk->hmac_key, sizeof(tk->hmac_key)) == 0)
+		    tk->hmac_key, sizeof(tk->hmac_key)) == 0) {
+			explicit_bzero(&newkey, sizeof(newkey));
 			return (0);
+		}
 		tls_config_set_errorx(config, "ticket key already present");
+		explicit_bzero(&newkey, sizeof(newkey));
+		return (-1);
+	}
+
+	if ((ring = calloc(1, sizeof(*ring))) == NULL) {
+		tls_config_set_errorx(config, "out of memory");
+		explicit_bzero(&newkey, sizeof(newkey));
+		return (-1);
+	}
+	ring->keys[ring->num_keys++] = newkey;
+	for (i = 0; cur != NULL && i < cur->num_keys; i++) {
+		if (ring->num_keys >= TLS_NUM_TICKETS)
+			break;
+		ring->keys[ring->num_keys++] = cur->keys[i];
+	}
+	tls_ticket_ring_index(ring);
+
+	tls_config_ticket_ring_swap(config, ring);
+
+	config->ticket_autorekey = 0;
+
+	explicit_bzero(&newkey, sizeof(newkey));
+
+	return (0);
+}
+
+int
+tls_config_add_ticket_key(struct tls_config *config, uint32_t keyrev,
+    unsigned char *key, size_t keylen)
+{
+	int rv;
+
+	pthread_mutex_lock(&config->mutex);
+	rv = tls_config_add_ticket_key_locked(config, keyrev, key, keylen);
+	pthread_mutex_unlock(&config->mutex);
+
+	return (rv);
+}
+
+int
+tls_config_set_ticket_keys(struct tls_config *config, uint32_t keyrev,
+    unsigned char *keys, size_t keyslen)
+{
+	struct tls_ticket_ring *ring;
+	time_t now;
+	int i, n;
+
+	if (keyslen == 0 || keyslen % TLS_TICKET_KEY_SIZE != 0 ||
+	    keyslen / TLS_TICKET_KEY_SIZE > TLS_NUM_TICKETS) {
+		tls_config_set_errorx(config,
+		    "wrong amount of ticket key data");
+		return (-1);
+	}
+	n = keyslen / TLS_TICKET_KEY_SIZE;
+
+	if ((ring = calloc(1, sizeof(*ring))) == NULL) {
+		tls_config_set_errorx(config, "out of memory");
 		return (-1);
 	}
 
-	memmove(&config->ticket_keys[1], &config->ticket_keys[0],
-	    sizeof(config->ticket_keys) - sizeof(config->ticket_keys[0]));
-	config->ticket_keys[0] = newkey;
+	/*
+	 * Keys are given primary first, with each subsequent key having the
+	 * previous revision. The older keys are only used to decrypt tickets.
+	 */
+	now = time(NULL);
+	for (i = 0; i < n; i++) {
+		if (tls_ticket_key_init(config, &ring->keys[i], keyrev - i,
+		    keys + i * TLS_TICKET_KEY_SIZE, TLS_TICKET_KEY_SIZE,
+		    now) == -1) {
+			freezero(ring, sizeof(*ring));
+			return (-1);
+		}
+	}
+	ring->num_keys = n;
+	tls_ticket_ring_index(ring);
 
+	pthread_mutex_lock(&config->mutex);
+	tls_config_ticket_ring_swap(config, ring);
+	config->ticket_keyrev = keyrev + 1;
 	config->ticket_autorekey = 0;
+	pthread_mutex_unlock(&config->mutex);
 
 	return (0);
 }
@@ -920,11 +1228,25 @@ int
 tls_config_ticket_autorekey(struct tls_config *config)
 {
 	unsigned char key[TLS_TICKET_KEY_SIZE];
-	int rv;
+	struct tls_ticket_ring *ring;
+	int rv = 0;
+
+	pthread_mutex_lock(&config->mutex);
+
+	/* Another handshake may have already rotated the keys. */
+	ring = atomic_load_explicit(&config->ticket_ring, memory_order_relaxed);
+	if (config->ticket_autorekey != 1 ||
+	    !tls_config_ticket_ring_stale(config, ring, time(NULL)))
+		goto out;
 
 	arc4random_buf(key, sizeof(key));
-	rv = tls_config_add_ticket_key(config, config->ticket_keyrev++, key,
-	    sizeof(key));
+	rv = tls_config_add_ticket_key_locked(config, config->ticket_keyrev++,
+	    key, sizeof(key));
 	config->ticket_autorekey = 1;
+	explicit_bzero(key, sizeof(key));
+
+ out:
+	pthread_mutex_unlock(&config->mutex);
+
 	return (rv);
 }
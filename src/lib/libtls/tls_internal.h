@@ -20,6 +20,7 @@
 #define HEADER_TLS_INTERNAL_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -78,6 +79,21 @@ struct tls_ticket_key {
 	time_t		time;
 };
 
+#define TLS_TICKET_RING_SLOTS			16
+
+/*
+ * An immutable set of ticket keys, with the primary key first. Handshakes
+ * use whichever ring is current when they look up a key - rotation installs
+ * a new ring and retires the old one, which is freed once no handshake that
+ * may have looked it up is still using it.
+ */
+struct tls_ticket_ring {
+	struct tls_ticket_key keys[TLS_NUM_TICKETS];
+	int num_keys;
+	uint8_t index[TLS_TICKET_RING_SLOTS];
+	struct tls_ticket_ring *next;
+};
+
 typedef int (*tls_sign_cb)(void *_cb_arg, const char *_pubkey_hash,
     const uint8_t *_input, size_t _input_len, int _padding_type,
     uint8_t **_out_signature, size_t *_out_signature_len);
@@ -93,6 +109,7 @@ struct tls_config {
 	const char *ca_path;
 	char *ca_mem;
 	size_t ca_len;
+	X509_STORE *ca_store;
 	const char *ciphers;
 	int ciphers_server;
 	char *crl_mem;
@@ -106,7 +123,9 @@ struct tls_config {
 	unsigned char session_id[TLS_MAX_SESSION_ID_LENGTH];
 	int session_fd;
 	int session_lifetime;
-	struct tls_ticket_key ticket_keys[TLS_NUM_TICKETS];
+	struct tls_ticket_ring *_Atomic ticket_ring;
+	struct tls_ticket_ring *_Atomic ticket_retired;
+	_Atomic unsigned int ticket_readers;
 	uint32_t ticket_keyrev;
 	int ticket_autorekey;
 	int verify_cert;
@@ -205,6 +224,9 @@ struct tls {
 	tls_read_cb read_cb;
 	tls_write_cb write_cb;
 	void *cb_arg;
+
+	/* Signer holding asynchronous sign operations for this context. */
+	struct tls_signer *signer;
 };
 
 int tls_set_mem(char **_dest, size_t *_destlen, const void *_src,
@@ -252,6 +274,13 @@ int tls_handshake_server(struct tls *ctx);
 int tls_config_load_file(struct tls_error *error, const char *filetype,
     const char *filename, char **buf, size_t *len);
 int tls_config_ticket_autorekey(struct tls_config *config);
+void tls_config_ticket_ring_enter(struct tls_config *config);
+void tls_config_ticket_ring_leave(struct tls_config *config);
+struct tls_ticket_ring *tls_config_ticket_ring(struct tls_config *config);
+int tls_config_ticket_ring_stale(struct tls_config *config,
+    struct tls_ticket_ring *ring, time_t now);
+struct tls_ticket_key *tls_ticket_ring_lookup(struct tls_ticket_ring *ring,
+    const unsigned char *key_name);
 int tls_host_port(const char *hostport, char **host, char **port);
 
 int tls_set_cbs(struct tls *ctx,
@@ -316,6 +345,12 @@ int tls_signer_add_keypair_mem(struct tls_signer *_signer, const uint8_t *_cert,
 int tls_signer_sign(struct tls_signer *_signer, const char *_pubkey_hash,
     const uint8_t *_input, size_t _input_len, int _padding_type,
     uint8_t **_out_signature, size_t *_out_signature_len);
+int tls_signer_sign_async(struct tls_signer *_signer, const char *_pubkey_hash,
+    const uint8_t *_input, size_t _input_len, int _padding_type,
+    uint8_t **_out_signature, size_t *_out_signature_len);
+int tls_signer_complete(struct tls_signer *_signer);
+void tls_signer_cancel(struct tls_signer *_signer, struct tls *_ctx);
+void tls_signer_set_ctx(struct tls *_ctx);
 
 __END_HIDDEN_DECLS
 
@@ -204,7 +204,8 @@ tls_ocsp_setup_from_peer(struct tls *ctx)
 }
 
 static int
-tls_ocsp_verify_response(struct tls *ctx, OCSP_RESPONSE *resp)
+tls_ocsp_verify_response(struct tls *ctx, OCSP_RESPONSE *resp,
+    ASN1_ARENA *arena)
 {
 	OCSP_BASICRESP *br = NULL;
 	ASN1_GENERALIZEDTIME *revtime = NULL, *thisupd = NULL, *nextupd = NULL;
@@ -214,7 +215,7 @@ tls_ocsp_verify_response(struct tls *ctx, OCSP_RESPONSE *resp)
 	int ret = -1;
 	unsigned long flags;
 
-	if ((br = OCSP_response_get1_basic(resp)) == NULL) {
+	if ((br = OCSP_response_get0_basic_arena(resp, arena)) == NULL) {
 		tls_set_errorx(ctx, "cannot load ocsp reply");
 		goto err;
 	}
@@ -276,7 +277,6 @@ tls_ocsp_verify_response(struct tls *ctx, OCSP_RESPONSE *resp)
  err:
 	sk_X509_free(combined);
 	OCSP_CERTID_free(cid);
-	OCSP_BASICRESP_free(br);
 	return ret;
 }
 
@@ -284,6 +284,10 @@ tls_ocsp_verify_response(struct tls *ctx, OCSP_RESPONSE *resp)
  * Process a raw OCSP response from an OCSP server request.
  * OCSP details can then be retrieved with tls_peer_ocsp_* functions.
  * returns 0 if certificate ok, -1 otherwise.
+ *
+ * The response, the basic response and the responder certificates are
+ * only needed while verifying, so they are decoded into an arena that is
+ * released in one go.
  */
 static int
 tls_ocsp_process_response_internal(struct tls *ctx, const unsigned char *response,
@@ -291,16 +295,23 @@ tls_ocsp_process_response_internal(struct tls *ctx, const unsigned char *respons
 {
 	int ret;
 	OCSP_RESPONSE *resp;
+	ASN1_ARENA *arena;
 
-	resp = d2i_OCSP_RESPONSE(NULL, &response, size);
+	if ((arena = ASN1_ARENA_new()) == NULL) {
+		tls_set_errorx(ctx, "out of memory");
+		return -1;
+	}
+	resp = (OCSP_RESPONSE *)ASN1_item_d2i_arena(arena, &response, size,
+	    &OCSP_RESPONSE_it);
 	if (resp == NULL) {
+		ASN1_ARENA_free(arena);
 		tls_ocsp_free(ctx->ocsp);
 		ctx->ocsp = NULL;
 		tls_set_error(ctx, "unable to parse OCSP response");
 		return -1;
 	}
-	ret = tls_ocsp_verify_response(ctx, resp);
-	OCSP_RESPONSE_free(resp);
+	ret = tls_ocsp_verify_response(ctx, resp, arena);
+	ASN1_ARENA_free(arena);
 	return ret;
 }
 
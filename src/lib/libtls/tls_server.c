@@ -140,46 +140,50 @@ tls_servername_cb(SSL *ssl, int *al, void *arg)
 }
 
 static struct tls_ticket_key *
-tls_server_ticket_key(struct tls_config *config, unsigned char *keyname)
+tls_server_ticket_key(struct tls_config *config, unsigned char *keyname,
+    int *primary)
 {
-	struct tls_ticket_key *key = NULL;
+	struct tls_ticket_ring *ring;
+	struct tls_ticket_key *key;
 	time_t now;
-	int i;
+
+	*primary = 0;
 
 	now = time(NULL);
+	ring = tls_config_ticket_ring(config);
 	if (config->ticket_autorekey == 1) {
-		if (now - 3 * (config->session_lifetime / 4) >
-		    config->ticket_keys[0].time) {
+		if (tls_config_ticket_ring_stale(config, ring, now)) {
 			if (tls_config_ticket_autorekey(config) == -1)
 				return (NULL);
+			ring = tls_config_ticket_ring(config);
 		}
 	}
-	for (i = 0; i < TLS_NUM_TICKETS; i++) {
-		struct tls_ticket_key *tk = &config->ticket_keys[i];
-		if (now - config->session_lifetime > tk->time)
-			continue;
-		if (keyname == NULL || timingsafe_memcmp(keyname,
-		    tk->key_name, sizeof(tk->key_name)) == 0) {
-			key = tk;
-			break;
-		}
-	}
+	if (ring == NULL || ring->num_keys == 0)
+		return (NULL);
+
+	if (keyname == NULL)
+		key = &ring->keys[0];
+	else if ((key = tls_ticket_ring_lookup(ring, keyname)) == NULL)
+		return (NULL);
+
+	if (now - config->session_lifetime > key->time)
+		return (NULL);
+
+	*primary = (key == &ring->keys[0]);
+
 	return (key);
 }
 
 static int
-tls_server_ticket_cb(SSL *ssl, unsigned char *keyname, unsigned char *iv,
-    EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int mode)
+tls_server_ticket_crypt(struct tls *tls_ctx, unsigned char *keyname,
+    unsigned char *iv, EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int mode)
 {
 	struct tls_ticket_key *key;
-	struct tls *tls_ctx;
-
-	if ((tls_ctx = SSL_get_app_data(ssl)) == NULL)
-		return (-1);
+	int primary;
 
 	if (mode == 1) {
 		/* create new session */
-		key = tls_server_ticket_key(tls_ctx->config, NULL);
+		key = tls_server_ticket_key(tls_ctx->config, NULL, &primary);
 		if (key == NULL) {
 			tls_set_errorx(tls_ctx, "no valid ticket key found");
 			return (-1);
@@ -200,7 +204,8 @@ tls_server_ticket_cb(SSL *ssl, unsigned char *keyname, unsigned char *iv,
 		return (0);
 	} else {
 		/* get key by name */
-		key = tls_server_ticket_key(tls_ctx->config, keyname);
+		key = tls_server_ticket_key(tls_ctx->config, keyname,
+		    &primary);
 		if (key == NULL)
 			return (0);
 
@@ -216,12 +221,30 @@ tls_server_ticket_cb(SSL *ssl, unsigned char *keyname, unsigned char *iv,
 		}
 
 		/* time to renew the ticket? is it the primary key? */
-		if (key != &tls_ctx->config->ticket_keys[0])
+		if (!primary)
 			return (2);
 		return (1);
 	}
 }
 
+static int
+tls_server_ticket_cb(SSL *ssl, unsigned char *keyname, unsigned char *iv,
+    EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int mode)
+{
+	struct tls *tls_ctx;
+	int rv;
+
+	if ((tls_ctx = SSL_get_app_data(ssl)) == NULL)
+		return (-1);
+
+	/* Keep the ticket key ring from being freed while we use it. */
+	tls_config_ticket_ring_enter(tls_ctx->config);
+	rv = tls_server_ticket_crypt(tls_ctx, keyname, iv, ctx, hctx, mode);
+	tls_config_ticket_ring_leave(tls_ctx->config);
+
+	return (rv);
+}
+
 static int
 tls_configure_server_ssl(struct tls *ctx, SSL_CTX **ssl_ctx,
     struct tls_keypair *keypair)
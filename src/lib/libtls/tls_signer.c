@@ -16,6 +16,8 @@
  */
 
 #include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <openssl/ecdsa.h>
 #include <openssl/err.h>
@@ -31,13 +33,45 @@ struct tls_signer_key {
 	struct tls_signer_key *next;
 };
 
+struct tls_signer_op {
+	struct tls *ctx;
+	char *hash;
+	uint8_t *input;
+	size_t input_len;
+	int padding_type;
+	int state;
+	int rv;
+	uint8_t *signature;
+	size_t signature_len;
+	int cancelled;
+	time_t done;
+	struct tls_signer_op *next;
+};
+
+#define TLS_SIGNER_OP_QUEUED	0
+#define TLS_SIGNER_OP_RUNNING	1
+#define TLS_SIGNER_OP_DONE	2
+
+/*
+ * Completed operations that are not tied to a context are discarded if
+ * their result has not been collected within this many seconds.
+ */
+#define TLS_SIGNER_OP_TIMEOUT	60
+
 struct tls_signer {
 	struct tls_error error;
 	struct tls_signer_key *keys;
+
+	pthread_mutex_t ops_mutex;
+	struct tls_signer_op *ops;
 };
 
 static pthread_mutex_t signer_method_lock = PTHREAD_MUTEX_INITIALIZER;
 
+static pthread_once_t signer_ctx_once = PTHREAD_ONCE_INIT;
+static pthread_key_t signer_ctx_key;
+static int signer_ctx_key_rv = -1;
+
 struct tls_signer *
 tls_signer_new(void)
 {
@@ -46,19 +80,46 @@ tls_signer_new(void)
 	if ((signer = calloc(1, sizeof(*signer))) == NULL)
 		return (NULL);
 
+	if (pthread_mutex_init(&signer->ops_mutex, NULL) != 0) {
+		free(signer);
+		return (NULL);
+	}
+
 	return (signer);
 }
 
+static void
+tls_signer_op_free(struct tls_signer_op *op)
+{
+	if (op == NULL)
+		return;
+
+	free(op->hash);
+	free(op->input);
+	free(op->signature);
+	free(op);
+}
+
 void
 tls_signer_free(struct tls_signer *signer)
 {
 	struct tls_signer_key *skey;
+	struct tls_signer_op *op;
 
 	if (signer == NULL)
 		return;
 
 	tls_error_clear(&signer->error);
 
+	while (signer->ops) {
+		op = signer->ops;
+		signer->ops = op->next;
+		if (op->ctx != NULL && op->ctx->signer == signer)
+			op->ctx->signer = NULL;
+		tls_signer_op_free(op);
+	}
+	pthread_mutex_destroy(&signer->ops_mutex);
+
 	while (signer->keys) {
 		skey = signer->keys;
 		signer->keys = skey->next;
@@ -303,6 +364,267 @@ tls_signer_sign(struct tls_signer *signer, const char *pubkey_hash,
 	return (-1);
 }
 
+static void
+tls_signer_ctx_init(void)
+{
+	if (pthread_key_create(&signer_ctx_key, NULL) == 0)
+		signer_ctx_key_rv = 0;
+}
+
+/*
+ * Record the context performing a handshake on this thread, so that
+ * asynchronous sign operations can be tied to it.
+ */
+void
+tls_signer_set_ctx(struct tls *ctx)
+{
+	if (pthread_once(&signer_ctx_once, tls_signer_ctx_init) != 0 ||
+	    signer_ctx_key_rv != 0)
+		return;
+
+	(void)pthread_setspecific(signer_ctx_key, ctx);
+}
+
+static struct tls *
+tls_signer_ctx(void)
+{
+	if (pthread_once(&signer_ctx_once, tls_signer_ctx_init) != 0 ||
+	    signer_ctx_key_rv != 0)
+		return (NULL);
+
+	return (pthread_getspecific(signer_ctx_key));
+}
+
+static time_t
+tls_signer_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+		return (0);
+
+	return (ts.tv_sec);
+}
+
+/*
+ * Discard completed operations that are not tied to a context and whose
+ * result has not been collected in time. Operations of a context are
+ * discarded by tls_signer_cancel() when the context is reset or freed.
+ * Called with the ops mutex held.
+ */
+static void
+tls_signer_reap(struct tls_signer *signer, time_t now)
+{
+	struct tls_signer_op *op, **opp;
+
+	for (opp = &signer->ops; (op = *opp) != NULL; ) {
+		if (op->ctx != NULL || op->state != TLS_SIGNER_OP_DONE ||
+		    now - op->done < TLS_SIGNER_OP_TIMEOUT) {
+			opp = &op->next;
+			continue;
+		}
+		*opp = op->next;
+		tls_signer_op_free(op);
+	}
+}
+
+static int
+tls_signer_has_ctx_ops(struct tls_signer *signer, struct tls *ctx)
+{
+	struct tls_signer_op *op;
+
+	for (op = signer->ops; op != NULL; op = op->next)
+		if (op->ctx == ctx)
+			return (1);
+
+	return (0);
+}
+
+/*
+ * Discard the sign operations of a context whose handshake is abandoned.
+ * Operations that are being run by tls_signer_complete() are discarded
+ * once they complete.
+ */
+void
+tls_signer_cancel(struct tls_signer *signer, struct tls *ctx)
+{
+	struct tls_signer_op *op, **opp;
+
+	if (signer == NULL)
+		return;
+
+	pthread_mutex_lock(&signer->ops_mutex);
+
+	for (opp = &signer->ops; (op = *opp) != NULL; ) {
+		if (op->ctx != ctx) {
+			opp = &op->next;
+			continue;
+		}
+		if (op->state == TLS_SIGNER_OP_RUNNING) {
+			op->ctx = NULL;
+			op->cancelled = 1;
+			opp = &op->next;
+			continue;
+		}
+		*opp = op->next;
+		tls_signer_op_free(op);
+	}
+
+	if (ctx->signer == signer)
+		ctx->signer = NULL;
+
+	pthread_mutex_unlock(&signer->ops_mutex);
+}
+
+/*
+ * Asynchronous variant of tls_signer_sign(), suitable for use as a sign
+ * callback. If the result of a matching operation is available it is
+ * returned, otherwise the operation is queued for tls_signer_complete() and
+ * TLS_WANT_PRIVATE_KEY is returned. Once the operation has been completed,
+ * the handshake is resumed and the same operation is requested again.
+ * Operations requested during tls_handshake() belong to its context and
+ * are discarded when the context is reset or freed.
+ */
+int
+tls_signer_sign_async(struct tls_signer *signer, const char *pubkey_hash,
+    const uint8_t *input, size_t input_len, int padding_type,
+    uint8_t **out_signature, size_t *out_signature_len)
+{
+	struct tls_signer_op *op, **opp;
+	struct tls *ctx;
+	int rv = -1;
+
+	*out_signature = NULL;
+	*out_signature_len = 0;
+
+	/* A context only keeps operations on one signer. */
+	ctx = tls_signer_ctx();
+	if (ctx != NULL && ctx->signer != NULL && ctx->signer != signer)
+		tls_signer_cancel(ctx->signer, ctx);
+
+	pthread_mutex_lock(&signer->ops_mutex);
+
+	tls_signer_reap(signer, tls_signer_now());
+
+	for (opp = &signer->ops; (op = *opp) != NULL; opp = &op->next) {
+		if (op->ctx != ctx || op->cancelled)
+			continue;
+		if (op->padding_type != padding_type ||
+		    op->input_len != input_len)
+			continue;
+		if (strcmp(op->hash, pubkey_hash) != 0)
+			continue;
+		if (memcmp(op->input, input, input_len) == 0)
+			break;
+	}
+
+	if (op != NULL) {
+		if (op->state != TLS_SIGNER_OP_DONE) {
+			rv = TLS_WANT_PRIVATE_KEY;
+			goto out;
+		}
+		*opp = op->next;
+		if ((rv = op->rv) == 0) {
+			*out_signature = op->signature;
+			*out_signature_len = op->signature_len;
+			op->signature = NULL;
+		}
+		tls_signer_op_free(op);
+		if (ctx != NULL && !tls_signer_has_ctx_ops(signer, ctx))
+			ctx->signer = NULL;
+		goto out;
+	}
+
+	if ((op = calloc(1, sizeof(*op))) == NULL) {
+		tls_error_set(&signer->error, "sign operation");
+		goto out;
+	}
+	if ((op->hash = strdup(pubkey_hash)) == NULL ||
+	    (op->input = malloc(input_len)) == NULL) {
+		tls_error_set(&signer->error, "sign operation");
+		tls_signer_op_free(op);
+		goto out;
+	}
+	memcpy(op->input, input, input_len);
+	op->input_len = input_len;
+	op->padding_type = padding_type;
+	op->state = TLS_SIGNER_OP_QUEUED;
+	op->ctx = ctx;
+
+	op->next = signer->ops;
+	signer->ops = op;
+
+	if (ctx != NULL)
+		ctx->signer = signer;
+
+	rv = TLS_WANT_PRIVATE_KEY;
+
+ out:
+	pthread_mutex_unlock(&signer->ops_mutex);
+
+	return (rv);
+}
+
+/*
+ * Complete the queued sign operations. This may be called from a thread
+ * other than the one performing the handshake. Returns the number of
+ * operations completed, not counting those cancelled while they ran.
+ */
+int
+tls_signer_complete(struct tls_signer *signer)
+{
+	struct tls_signer_op *op, **opp;
+	int completed = 0;
+
+	pthread_mutex_lock(&signer->ops_mutex);
+
+	for (;;) {
+		for (op = signer->ops; op != NULL; op = op->next)
+			if (op->state == TLS_SIGNER_OP_QUEUED)
+				break;
+		if (op == NULL)
+			break;
+
+		/* The operation stays on the list, but is ours to run. */
+		op->state = TLS_SIGNER_OP_RUNNING;
+		pthread_mutex_unlock(&signer->ops_mutex);
+
+		op->rv = tls_signer_sign(signer, op->hash, op->input,
+		    op->input_len, op->padding_type, &op->signature,
+		    &op->signature_len);
+
+		pthread_mutex_lock(&signer->ops_mutex);
+		if (op->cancelled) {
+			opp = &signer->ops;
+			while (*opp != op)
+				opp = &(*opp)->next;
+			*opp = op->next;
+			tls_signer_op_free(op);
+			continue;
+		}
+		op->state = TLS_SIGNER_OP_DONE;
+		op->done = tls_signer_now();
+		completed++;
+	}
+
+	tls_signer_reap(signer, tls_signer_now());
+
+	pthread_mutex_unlock(&signer->ops_mutex);
+
+	return (completed);
+}
+
+static void
+tls_sign_cb_pending(int rv)
+{
+	if (rv != TLS_WANT_PRIVATE_KEY)
+		return;
+
+	/* Tell libssl to suspend the handshake until we are called again. */
+	ERR_put_error(ERR_LIB_SSL, 0xfff, SSL_R_PRIVATE_KEY_OPERATION_PENDING,
+	    __FILE__, __LINE__);
+}
+
 static int
 tls_rsa_priv_enc(int from_len, const unsigned char *from, unsigned char *to,
     RSA *rsa, int rsa_padding)
@@ -312,6 +634,7 @@ tls_rsa_priv_enc(int from_len, const unsigned char *from, unsigned char *to,
 	size_t signature_len = 0;
 	const char *pubkey_hash;
 	int padding_type;
+	int rv;
 
 	/*
 	 * This function is called via RSA_private_encrypt() and has to conform
@@ -336,9 +659,11 @@ tls_rsa_priv_enc(int from_len, const unsigned char *from, unsigned char *to,
 	if (from_len < 0)
 		goto err;
 
-	if (config->sign_cb(config->sign_cb_arg, pubkey_hash, from, from_len,
-	    padding_type, &signature, &signature_len) == -1)
+	if ((rv = config->sign_cb(config->sign_cb_arg, pubkey_hash, from,
+	    from_len, padding_type, &signature, &signature_len)) != 0) {
+		tls_sign_cb_pending(rv);
 		goto err;
+	}
 
 	if (signature_len > INT_MAX || (int)signature_len > RSA_size(rsa))
 		goto err;
@@ -386,6 +711,7 @@ tls_ecdsa_do_sign(const unsigned char *dgst, int dgst_len, const BIGNUM *inv,
 	size_t signature_len = 0;
 	const unsigned char *p;
 	const char *pubkey_hash;
+	int rv;
 
 	/*
 	 * This function is called via ECDSA_do_sign_ex() and has to conform
@@ -401,9 +727,11 @@ tls_ecdsa_do_sign(const unsigned char *dgst, int dgst_len, const BIGNUM *inv,
 	if (dgst_len < 0)
 		goto err;
 
-	if (config->sign_cb(config->sign_cb_arg, pubkey_hash, dgst, dgst_len,
-	    TLS_PADDING_NONE, &signature, &signature_len) == -1)
+	if ((rv = config->sign_cb(config->sign_cb_arg, pubkey_hash, dgst,
+	    dgst_len, TLS_PADDING_NONE, &signature, &signature_len)) != 0) {
+		tls_sign_cb_pending(rv);
 		goto err;
+	}
 
 	p = signature;
 	if ((ecdsa_sig = d2i_ECDSA_SIG(NULL, &p, signature_len)) == NULL)
@@ -0,0 +1,144 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int	crypt_checkpass_batch(const char * const *, const char * const *,
+	    int *, size_t);
+
+struct checkpass_test {
+	const char *pass;
+	const char *pref;	/* bcrypt hash of hash_pass, or NULL */
+	const char *hash_pass;
+	const char *hash;	/* used as is if pref is NULL */
+};
+
+/* Matches and mismatches of several costs, interleaved with bad hashes. */
+static const struct checkpass_test checkpass_tests[] = {
+	{ "correct", "bcrypt,4", "correct", NULL },
+	{ "wrong", "bcrypt,4", "correct", NULL },
+	{ "secret", "bcrypt,5", "secret", NULL },
+	{ "", NULL, NULL, "" },
+	{ "other", "bcrypt,5", "secret", NULL },
+	{ "password", NULL, NULL, NULL },
+	{ "password", "bcrypt,6", "password", NULL },
+	{ "x", NULL, NULL, "" },
+	{ "password", NULL, NULL, "$1$abcdefgh$0123456789abcdefghijkl" },
+	{ "password", NULL, NULL, "$2b$04$tooshort" },
+	{ "password", NULL, NULL,
+	    "$2b$99$abcdefghijklmnopqrstuuabcdefghijklmnopqrstuvwxyz01234" },
+	{ "correct", "bcrypt,4", "correct", NULL },
+	{ "secret", "bcrypt,6", "secret", NULL },
+	{ "Secret", "bcrypt,6", "secret", NULL },
+};
+
+#define N_CHECKPASS_TESTS \
+    (sizeof(checkpass_tests) / sizeof(checkpass_tests[0]))
+
+static char hashes[N_CHECKPASS_TESTS][_PASSWORD_LEN];
+static const char *passes[N_CHECKPASS_TESTS];
+static const char *goodhashes[N_CHECKPASS_TESTS];
+static int want[N_CHECKPASS_TESTS];
+
+static void
+setup_checkpass_tests(void)
+{
+	const struct checkpass_test *cpt;
+	size_t i;
+
+	for (i = 0; i < N_CHECKPASS_TESTS; i++) {
+		cpt = &checkpass_tests[i];
+		passes[i] = cpt->pass;
+		goodhashes[i] = cpt->hash;
+		if (cpt->pref != NULL) {
+			if (crypt_newhash(cpt->hash_pass, cpt->pref,
+			    hashes[i], sizeof(hashes[i])) != 0)
+				err(1, "crypt_newhash");
+			goodhashes[i] = hashes[i];
+		}
+		want[i] = crypt_checkpass(passes[i], goodhashes[i]) == 0 ?
+		    0 : -1;
+	}
+}
+
+static int
+check_batch(const char *name, size_t start, size_t count)
+{
+	int result[N_CHECKPASS_TESTS];
+	int rv, want_rv = 0;
+	size_t i;
+	int failed = 0;
+
+	for (i = start; i < start + count; i++) {
+		if (want[i] != 0)
+			want_rv = -1;
+	}
+
+	errno = 0;
+	rv = crypt_checkpass_batch(&passes[start], &goodhashes[start],
+	    result, count);
+	if (rv != want_rv) {
+		fprintf(stderr, "FAIL: %s: returned %d, want %d\n",
+		    name, rv, want_rv);
+		failed = 1;
+	}
+	if (rv != 0 && errno != EACCES) {
+		fprintf(stderr, "FAIL: %s: errno %d, want EACCES\n",
+		    name, errno);
+		failed = 1;
+	}
+	for (i = 0; i < count; i++) {
+		if (result[i] != want[start + i]) {
+			fprintf(stderr, "FAIL: %s: entry %zu: got %d, "
+			    "want %d\n", name, start + i, result[i],
+			    want[start + i]);
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+int
+main(void)
+{
+	size_t i;
+	int failed = 0;
+
+	setup_checkpass_tests();
+
+	/* Sanity check that the table has both outcomes. */
+	if (want[0] != 0 || want[1] != -1)
+		errx(1, "crypt_checkpass gave unexpected results");
+
+	failed |= check_batch("all", 0, N_CHECKPASS_TESTS);
+	failed |= check_batch("empty", 0, 0);
+	failed |= check_batch("single match", 0, 1);
+	failed |= check_batch("single mismatch", 1, 1);
+	failed |= check_batch("matches of mixed costs", 11, 2);
+
+	/* Every window, so that batches start and end everywhere. */
+	for (i = 0; i + 4 <= N_CHECKPASS_TESTS; i++)
+		failed |= check_batch("window", i, 4);
+
+	return failed;
+}
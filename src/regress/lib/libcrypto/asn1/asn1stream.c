@@ -0,0 +1,290 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/asn1.h>
+#include <openssl/bio.h>
+#include <openssl/objects.h>
+#include <openssl/x509.h>
+
+#include "bytestring.h"
+
+#define NUM_REVOKED	1000
+
+static const uint8_t ecdsa_with_sha256[] = {
+	0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce,
+	0x3d, 0x04, 0x03, 0x02,
+};
+
+static const char utc_time[] = "261019000000Z";
+
+static void
+add_utc_time(CBB *cbb)
+{
+	CBB time;
+
+	if (!CBB_add_asn1(cbb, &time, V_ASN1_UTCTIME))
+		errx(1, "CBB_add_asn1");
+	if (!CBB_add_bytes(&time, (const uint8_t *)utc_time, strlen(utc_time)))
+		errx(1, "CBB_add_bytes");
+	if (!CBB_flush(cbb))
+		errx(1, "CBB_flush");
+}
+
+/*
+ * Encode a version 2 CRL with NUM_REVOKED entries. The stream is never
+ * asked to verify it, so the signature is left empty.
+ */
+static unsigned char *
+make_crl(int *out_len)
+{
+	CBB cbb, crl, tbs, revoked, entry, sig;
+	X509_NAME *name;
+	unsigned char *name_der = NULL, *der;
+	size_t der_len;
+	int name_len, i;
+
+	if ((name = X509_NAME_new()) == NULL)
+		errx(1, "X509_NAME_new");
+	if (!X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+	    (const unsigned char *)"ASN1 stream test", -1, -1, 0))
+		errx(1, "X509_NAME_add_entry_by_txt");
+	if ((name_len = i2d_X509_NAME(name, &name_der)) <= 0)
+		errx(1, "i2d_X509_NAME");
+	X509_NAME_free(name);
+
+	if (!CBB_init(&cbb, 0))
+		errx(1, "CBB_init");
+	if (!CBB_add_asn1(&cbb, &crl, CBS_ASN1_SEQUENCE) ||
+	    !CBB_add_asn1(&crl, &tbs, CBS_ASN1_SEQUENCE))
+		errx(1, "CBB_add_asn1");
+	if (!CBB_add_asn1_uint64(&tbs, 1) ||
+	    !CBB_add_bytes(&tbs, ecdsa_with_sha256,
+	    sizeof(ecdsa_with_sha256)) ||
+	    !CBB_add_bytes(&tbs, name_der, name_len))
+		errx(1, "CBB_add_bytes");
+	add_utc_time(&tbs);
+	add_utc_time(&tbs);
+
+	if (!CBB_add_asn1(&tbs, &revoked, CBS_ASN1_SEQUENCE))
+		errx(1, "CBB_add_asn1");
+	for (i = 0; i < NUM_REVOKED; i++) {
+		if (!CBB_add_asn1(&revoked, &entry, CBS_ASN1_SEQUENCE))
+			errx(1, "CBB_add_asn1");
+		if (!CBB_add_asn1_uint64(&entry, i + 1))
+			errx(1, "CBB_add_asn1_uint64");
+		add_utc_time(&entry);
+		if (!CBB_flush(&revoked))
+			errx(1, "CBB_flush");
+	}
+	if (!CBB_flush(&crl))
+		errx(1, "CBB_flush");
+
+	if (!CBB_add_bytes(&crl, ecdsa_with_sha256,
+	    sizeof(ecdsa_with_sha256)))
+		errx(1, "CBB_add_bytes");
+	if (!CBB_add_asn1(&crl, &sig, CBS_ASN1_BITSTRING) ||
+	    !CBB_add_u8(&sig, 0))
+		errx(1, "CBB_add_asn1");
+	if (!CBB_finish(&cbb, &der, &der_len))
+		errx(1, "CBB_finish");
+
+	free(name_der);
+
+	*out_len = der_len;
+
+	return der;
+}
+
+static int
+is_time(int tag)
+{
+	return tag == V_ASN1_UTCTIME || tag == V_ASN1_GENERALIZEDTIME;
+}
+
+/*
+ * Walk CertificateList and TBSCertList, decoding the revoked certificates
+ * one at a time. Returns 1 if the whole CRL was walked, 0 otherwise. If
+ * max_element is set, decoding fails and each entry is skipped instead.
+ */
+static int
+stream_crl(const char *name, BIO *bio, size_t max_element, int *out_count)
+{
+	ASN1_STREAM *stream;
+	X509_REVOKED *rev;
+	long serial;
+	int tag, more, count = 0;
+	int ret = 0;
+
+	*out_count = 0;
+
+	if ((stream = ASN1_STREAM_new(bio)) == NULL)
+		errx(1, "ASN1_STREAM_new");
+	if (max_element != 0 &&
+	    !ASN1_STREAM_set_max_element(stream, max_element))
+		errx(1, "ASN1_STREAM_set_max_element");
+
+	if (ASN1_STREAM_leave(stream)) {
+		fprintf(stderr, "FAIL: %s: left the top level\n", name);
+		goto done;
+	}
+
+	/* CertificateList and TBSCertList. */
+	if (!ASN1_STREAM_enter(stream))
+		goto done;
+	if (!ASN1_STREAM_enter(stream))
+		goto done;
+
+	/* Optional version, signature, issuer and thisUpdate. */
+	if (ASN1_STREAM_peek(stream, &tag, NULL, NULL) != 1)
+		goto done;
+	if (tag == V_ASN1_INTEGER && !ASN1_STREAM_skip(stream))
+		goto done;
+	if (!ASN1_STREAM_skip(stream) || !ASN1_STREAM_skip(stream) ||
+	    !ASN1_STREAM_skip(stream))
+		goto done;
+
+	/* Optional nextUpdate. */
+	if (ASN1_STREAM_peek(stream, &tag, NULL, NULL) != 1)
+		goto done;
+	if (is_time(tag) && !ASN1_STREAM_skip(stream))
+		goto done;
+
+	if (!ASN1_STREAM_enter(stream))
+		goto done;
+	if (ASN1_STREAM_get_depth(stream) != 3) {
+		fprintf(stderr, "FAIL: %s: got depth %d, want 3\n", name,
+		    ASN1_STREAM_get_depth(stream));
+		goto done;
+	}
+	while ((more = ASN1_STREAM_peek(stream, NULL, NULL, NULL)) == 1) {
+		if (max_element != 0) {
+			if ((rev = ASN1_STREAM_d2i(stream,
+			    &X509_REVOKED_it)) != NULL) {
+				fprintf(stderr, "FAIL: %s: decoded oversized "
+				    "element\n", name);
+				X509_REVOKED_free(rev);
+				goto done;
+			}
+			if (!ASN1_STREAM_skip(stream))
+				goto done;
+			count++;
+			continue;
+		}
+		if ((rev = ASN1_STREAM_d2i(stream, &X509_REVOKED_it)) == NULL)
+			goto done;
+		serial = ASN1_INTEGER_get(X509_REVOKED_get0_serialNumber(rev));
+		X509_REVOKED_free(rev);
+		if (serial != ++count) {
+			fprintf(stderr, "FAIL: %s: got serial %ld, want %d\n",
+			    name, serial, count);
+			goto done;
+		}
+	}
+	if (more != 0)
+		goto done;
+
+	/* Leaving TBSCertList skips the CRL extensions. */
+	if (!ASN1_STREAM_leave(stream) || !ASN1_STREAM_leave(stream))
+		goto done;
+	if (!ASN1_STREAM_skip(stream) || !ASN1_STREAM_skip(stream))
+		goto done;
+	if (!ASN1_STREAM_leave(stream))
+		goto done;
+
+	ret = ASN1_STREAM_peek(stream, NULL, NULL, NULL) == 0;
+
+ done:
+	ASN1_STREAM_free(stream);
+
+	*out_count = count;
+
+	return ret;
+}
+
+static int
+asn1_stream_crl_test(void)
+{
+	unsigned char *der;
+	BIO *bio;
+	int der_len, count;
+	int failed = 1;
+
+	der = make_crl(&der_len);
+
+	if ((bio = BIO_new_mem_buf(der, der_len)) == NULL)
+		errx(1, "BIO_new_mem_buf");
+	if (!stream_crl("full", bio, 0, &count)) {
+		fprintf(stderr, "FAIL: full: stream failed after %d entries\n",
+		    count);
+		goto failure;
+	}
+	if (count != NUM_REVOKED) {
+		fprintf(stderr, "FAIL: full: got %d entries, want %d\n",
+		    count, NUM_REVOKED);
+		goto failure;
+	}
+	BIO_free(bio);
+
+	if ((bio = BIO_new_mem_buf(der, der_len)) == NULL)
+		errx(1, "BIO_new_mem_buf");
+	if (!stream_crl("oversized", bio, 8, &count)) {
+		fprintf(stderr, "FAIL: oversized: stream failed after %d "
+		    "entries\n", count);
+		goto failure;
+	}
+	if (count != NUM_REVOKED) {
+		fprintf(stderr, "FAIL: oversized: got %d entries, want %d\n",
+		    count, NUM_REVOKED);
+		goto failure;
+	}
+	BIO_free(bio);
+
+	/* A truncated CRL must fail part way through the revoked list. */
+	if ((bio = BIO_new_mem_buf(der, der_len / 2)) == NULL)
+		errx(1, "BIO_new_mem_buf");
+	if (stream_crl("truncated", bio, 0, &count)) {
+		fprintf(stderr, "FAIL: truncated: stream succeeded\n");
+		goto failure;
+	}
+	if (count == 0 || count >= NUM_REVOKED) {
+		fprintf(stderr, "FAIL: truncated: got %d entries\n", count);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BIO_free(bio);
+	free(der);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= asn1_stream_crl_test();
+
+	return failed;
+}
@@ -20,6 +20,7 @@
 
 #include <err.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -439,6 +440,134 @@ done:
 	return failure;
 }
 
+/*
+ * Whole lines of base64 are decoded directly from the input, falling back
+ * to decoding one character at a time for anything unusual.
+ */
+struct base64_lines_test {
+	int in_len;
+	int crlf;
+	int pos;
+	char c;
+	int rv;
+	int out_len;
+};
+
+static const struct base64_lines_test base64_lines_tests[] = {
+	{ 240, 0, -1, 0, 1, 240 },
+	{ 250, 1, -1, 0, 1, 250 },
+	{ 145, 0, -1, 0, 1, 145 },
+	{ 240, 0, 70, '*', -1, 48 },
+	{ 250, 1, 70, '*', -1, 48 },
+	{ 145, 0, 70, '*', -1, 48 },
+	{ 240, 0, 70, '=', -1, 48 },
+	{ 250, 1, 70, '=', -1, 48 },
+	{ 145, 0, 70, '=', -1, 48 },
+	{ 240, 0, 70, ' ', -1, 192 },
+	{ 250, 1, 70, ' ', -1, 240 },
+	{ 145, 0, 70, ' ', -1, 144 },
+	{ 240, 0, 70, '\xc1', -1, 48 },
+	{ 250, 1, 70, '\xc1', -1, 48 },
+	{ 145, 0, 70, '\xc1', -1, 48 },
+	{ 240, 0, 64, 'A', -1, 240 },
+	{ 250, 1, 64, 'A', -1, 240 },
+	{ 145, 0, 64, 'A', -1, 144 },
+	{ 240, 0, 65, '\n', -1, 192 },
+	{ 250, 1, 65, '\n', 1, 250 },
+	{ 145, 0, 65, '\n', -1, 144 },
+	{ 240, 0, 129, '-', 1, 96 },
+	{ 250, 1, 129, '-', -1, 48 },
+	{ 145, 0, 129, '-', 1, 96 },
+};
+
+#define N_LINES_TESTS \
+    (sizeof(base64_lines_tests) / sizeof(*base64_lines_tests))
+
+static int
+base64_lines_test(int test_no, const struct base64_lines_test *blt)
+{
+	EVP_ENCODE_CTX *ctx;
+	unsigned char *in, *enc, *text, *out;
+	int enclen, len, textlen, outlen, rv;
+	int i, j;
+	int failure = 1;
+
+	if ((in = malloc(blt->in_len)) == NULL)
+		errx(1, "malloc");
+	for (i = 0; i < blt->in_len; i++)
+		in[i] = i * 7 + 3;
+
+	if ((enc = malloc(blt->in_len * 2 + 16)) == NULL)
+		errx(1, "malloc");
+	if ((text = malloc(blt->in_len * 3 + 16)) == NULL)
+		errx(1, "malloc");
+	if ((out = malloc(blt->in_len * 2 + 16)) == NULL)
+		errx(1, "malloc");
+
+	if ((ctx = EVP_ENCODE_CTX_new()) == NULL)
+		errx(1, "EVP_ENCODE_CTX_new");
+
+	EVP_EncodeInit(ctx);
+	if (!EVP_EncodeUpdate(ctx, enc, &enclen, in, blt->in_len))
+		errx(1, "EVP_EncodeUpdate");
+	EVP_EncodeFinal(ctx, enc + enclen, &len);
+	enclen += len;
+
+	for (i = 0, j = 0; i < enclen; i++) {
+		if (blt->crlf && enc[i] == '\n')
+			text[j++] = '\r';
+		text[j++] = enc[i];
+	}
+	textlen = j;
+	if (blt->pos >= 0)
+		text[blt->pos] = blt->c;
+
+	EVP_DecodeInit(ctx);
+	rv = EVP_DecodeUpdate(ctx, out, &outlen, text, textlen);
+	if (rv >= 0) {
+		rv = EVP_DecodeFinal(ctx, out + outlen, &len);
+		outlen += len;
+	}
+
+	if (rv != blt->rv || outlen != blt->out_len) {
+		fprintf(stderr, "FAIL: Test %d decoded %d bytes with %d, "
+		    "want %d bytes with %d\n", test_no, outlen, rv,
+		    blt->out_len, blt->rv);
+		goto done;
+	}
+	if (blt->pos < 0 && memcmp(out, in, blt->in_len) != 0) {
+		fprintf(stderr, "FAIL: Test %d decoded data differs\n",
+		    test_no);
+		goto done;
+	}
+
+	/* PEM_read_bio() decodes in place. */
+	EVP_DecodeInit(ctx);
+	rv = EVP_DecodeUpdate(ctx, text, &outlen, text, textlen);
+	if (rv >= 0) {
+		rv = EVP_DecodeFinal(ctx, text + outlen, &len);
+		outlen += len;
+	}
+
+	if (rv != blt->rv || outlen != blt->out_len ||
+	    memcmp(text, out, outlen) != 0) {
+		fprintf(stderr, "FAIL: Test %d in place decoding differs\n",
+		    test_no);
+		goto done;
+	}
+
+	failure = 0;
+
+ done:
+	EVP_ENCODE_CTX_free(ctx);
+	free(in);
+	free(enc);
+	free(text);
+	free(out);
+
+	return failure;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -482,5 +611,10 @@ main(int argc, char **argv)
 			failed += base64_decoding_test(i, bt, 0);
 	}
 
+	fprintf(stderr, "Starting line tests...\n");
+
+	for (i = 0; i < N_LINES_TESTS; i++)
+		failed += base64_lines_test(i, &base64_lines_tests[i]);
+
 	return failed;
 }
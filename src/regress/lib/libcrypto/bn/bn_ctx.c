@@ -0,0 +1,333 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+
+#include "bn_local.h"
+
+#define INLINE_WORDS	2
+
+static int
+words_are_zero(const BN_ULONG *words, int nwords)
+{
+	int i;
+
+	for (i = 0; i < nwords; i++) {
+		if (words[i] != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+static int
+test_bn_inline_expand(void)
+{
+	BN_ULONG words[INLINE_WORDS];
+	BIGNUM bn, *want = NULL;
+	int failed = 1;
+
+	bn_init_inline(&bn, words, INLINE_WORDS);
+
+	if (!BN_set_word(&bn, 0x1234))
+		errx(1, "BN_set_word");
+	if (bn.d != words) {
+		fprintf(stderr, "FAIL: small value did not use inline words\n");
+		goto failure;
+	}
+
+	/* Growing past the inline words moves the value to the heap. */
+	if (!BN_lshift(&bn, &bn, 8 * BN_BITS2))
+		errx(1, "BN_lshift");
+	if (bn.d == words || BN_get_flags(&bn, BN_FLG_INLINE_DATA)) {
+		fprintf(stderr, "FAIL: large value still uses inline words\n");
+		goto failure;
+	}
+	if (!words_are_zero(words, INLINE_WORDS)) {
+		fprintf(stderr, "FAIL: inline words not cleared on expand\n");
+		goto failure;
+	}
+
+	if ((want = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if (!BN_set_word(want, 0x1234))
+		errx(1, "BN_set_word");
+	if (!BN_lshift(want, want, 8 * BN_BITS2))
+		errx(1, "BN_lshift");
+	if (BN_cmp(&bn, want) != 0) {
+		fprintf(stderr, "FAIL: value changed on expand\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BN_free(&bn);
+	BN_free(want);
+
+	return failed;
+}
+
+static int
+test_bn_inline_free(void)
+{
+	BN_ULONG words[INLINE_WORDS];
+	BIGNUM bn;
+
+	bn_init_inline(&bn, words, INLINE_WORDS);
+	if (!BN_set_word(&bn, BN_MASK2))
+		errx(1, "BN_set_word");
+	BN_free(&bn);
+
+	if (!words_are_zero(words, INLINE_WORDS)) {
+		fprintf(stderr, "FAIL: inline words not cleared on free\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static int
+test_bn_inline_swap(void)
+{
+	BN_ULONG words[INLINE_WORDS];
+	BN_ULONG *heap_d;
+	BIGNUM bn, *a = NULL, *b = NULL, *heap = NULL;
+	int failed = 1;
+
+	bn_init_inline(&bn, words, INLINE_WORDS);
+
+	if ((a = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if ((b = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if ((heap = BN_new()) == NULL)
+		errx(1, "BN_new");
+
+	if (!BN_set_word(a, 17))
+		errx(1, "BN_set_word");
+	if (!BN_set_word(b, 1))
+		errx(1, "BN_set_word");
+	if (!BN_lshift(b, b, 4 * BN_BITS2))
+		errx(1, "BN_lshift");
+	BN_set_negative(b, 1);
+
+	if (!bn_copy(&bn, a))
+		errx(1, "bn_copy");
+	if (!bn_copy(heap, b))
+		errx(1, "bn_copy");
+
+	/* The words move with the values, nothing is allocated. */
+	heap_d = heap->d;
+	BN_swap(&bn, heap);
+	if (BN_cmp(&bn, b) != 0 || BN_cmp(heap, a) != 0) {
+		fprintf(stderr, "FAIL: BN_swap values\n");
+		goto failure;
+	}
+	if (bn.d != heap_d || BN_get_flags(&bn, BN_FLG_INLINE_DATA)) {
+		fprintf(stderr, "FAIL: BN_swap did not move heap words\n");
+		goto failure;
+	}
+	if (heap->d != words || !BN_get_flags(heap, BN_FLG_INLINE_DATA)) {
+		fprintf(stderr, "FAIL: BN_swap did not move inline words\n");
+		goto failure;
+	}
+
+	BN_swap(&bn, heap);
+	if (BN_cmp(&bn, a) != 0 || BN_cmp(heap, b) != 0) {
+		fprintf(stderr, "FAIL: BN_swap values after second swap\n");
+		goto failure;
+	}
+	if (bn.d != words || heap->d != heap_d) {
+		fprintf(stderr, "FAIL: BN_swap words after second swap\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BN_free(&bn);
+	BN_free(a);
+	BN_free(b);
+	BN_free(heap);
+
+	return failed;
+}
+
+static int
+test_bn_ctx_reserve(void)
+{
+	BN_CTX *bctx;
+	BIGNUM *m, *x, *r, *want;
+	int i;
+	int failed = 1;
+
+	if ((bctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	bn_ctx_reserve(bctx, 256);
+
+	BN_CTX_start(bctx);
+
+	for (i = 0; i < 20; i++) {
+		if ((r = BN_CTX_get(bctx)) == NULL)
+			errx(1, "BN_CTX_get");
+		if (r->dmax < 2 * (256 / BN_BITS2) + 2) {
+			fprintf(stderr, "FAIL: BIGNUM %d has %d words\n", i,
+			    r->dmax);
+			goto failure;
+		}
+	}
+
+	if ((m = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((x = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((r = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((want = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	/* Values larger than the reservation still work. */
+	if (!BN_set_bit(m, 4096) || !BN_add_word(m, 159))
+		errx(1, "BN_set_bit");
+	if (!BN_set_bit(x, 4000) || !BN_sub_word(x, 1))
+		errx(1, "BN_set_bit");
+	if (!BN_mod_sqr(r, x, m, bctx))
+		errx(1, "BN_mod_sqr");
+	if (!BN_mod_mul(want, x, x, m, bctx))
+		errx(1, "BN_mod_mul");
+	if (BN_cmp(r, want) != 0) {
+		fprintf(stderr, "FAIL: BN_mod_sqr and BN_mod_mul differ\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BN_CTX_end(bctx);
+	BN_CTX_free(bctx);
+
+	return failed;
+}
+
+static int
+test_bn_ctx_cache(void)
+{
+	BN_CTX *bctx, *nested;
+	BIGNUM *bn;
+	BN_ULONG *d;
+	int dmax;
+	int failed = 1;
+
+	if ((bctx = bn_ctx_acquire(256)) == NULL)
+		errx(1, "bn_ctx_acquire");
+	BN_CTX_start(bctx);
+	if ((bn = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if (!BN_set_word(bn, BN_MASK2))
+		errx(1, "BN_set_word");
+	d = bn->d;
+	dmax = bn->dmax;
+
+	/* A nested acquire must not return the context that is in use. */
+	if ((nested = bn_ctx_acquire(256)) == NULL)
+		errx(1, "bn_ctx_acquire");
+	if (nested == bctx) {
+		fprintf(stderr, "FAIL: nested acquire returned same context\n");
+		goto failure;
+	}
+	bn_ctx_release(nested);
+
+	BN_CTX_end(bctx);
+	bn_ctx_release(bctx);
+
+	/* The released context is reused and its words have been cleared. */
+	if ((bctx = bn_ctx_acquire(256)) == NULL)
+		errx(1, "bn_ctx_acquire");
+	BN_CTX_start(bctx);
+	if ((bn = BN_CTX_get(bctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if (bn->d != d) {
+		fprintf(stderr, "FAIL: released context was not reused\n");
+		goto failure;
+	}
+	if (!words_are_zero(bn->d, dmax)) {
+		fprintf(stderr, "FAIL: released context was not cleared\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BN_CTX_end(bctx);
+	bn_ctx_release(bctx);
+
+	return failed;
+}
+
+static void *
+bn_ctx_thread(void *arg)
+{
+	int *failed = arg;
+
+	*failed = test_bn_ctx_cache();
+
+	return NULL;
+}
+
+static int
+test_bn_ctx_cache_threads(void)
+{
+	pthread_t threads[4];
+	int failed[4];
+	int i;
+	int ret = 0;
+
+	for (i = 0; i < 4; i++) {
+		if (pthread_create(&threads[i], NULL, bn_ctx_thread,
+		    &failed[i]) != 0)
+			errx(1, "pthread_create");
+	}
+	for (i = 0; i < 4; i++) {
+		if (pthread_join(threads[i], NULL) != 0)
+			errx(1, "pthread_join");
+		ret |= failed[i];
+	}
+
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= test_bn_inline_expand();
+	failed |= test_bn_inline_free();
+	failed |= test_bn_inline_swap();
+	failed |= test_bn_ctx_reserve();
+	failed |= test_bn_ctx_cache();
+	failed |= test_bn_ctx_cache_threads();
+
+	return failed;
+}
@@ -0,0 +1,145 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/err.h>
+
+#define NUM_THREADS	16
+#define NUM_ROUNDS	1000
+
+struct err_thread {
+	pthread_t thread;
+	int reason;
+	int failed;
+};
+
+static int
+check_error(const char *name, int want_reason)
+{
+	const char *data;
+	unsigned long e;
+	int flags;
+
+	if ((e = ERR_get_error_line_data(NULL, NULL, &data, &flags)) == 0) {
+		fprintf(stderr, "FAIL: %s: no error queued\n", name);
+		return 1;
+	}
+	if (ERR_GET_LIB(e) != ERR_LIB_USER ||
+	    ERR_GET_REASON(e) != want_reason) {
+		fprintf(stderr, "FAIL: %s: got lib %d reason %d, want %d %d\n",
+		    name, ERR_GET_LIB(e), ERR_GET_REASON(e), ERR_LIB_USER,
+		    want_reason);
+		return 1;
+	}
+	if ((flags & ERR_TXT_STRING) == 0 || strcmp(data, "data") != 0) {
+		fprintf(stderr, "FAIL: %s: missing error data\n", name);
+		return 1;
+	}
+	if ((e = ERR_get_error()) != 0) {
+		fprintf(stderr, "FAIL: %s: unexpected error %lx\n", name, e);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void
+put_error(int reason)
+{
+	ERR_put_error(ERR_LIB_USER, 0, reason, __FILE__, __LINE__);
+	ERR_asprintf_error_data("%s", "data");
+}
+
+static void *
+err_thread_run(void *arg)
+{
+	struct err_thread *et = arg;
+	int i;
+
+	for (i = 0; i < NUM_ROUNDS && !et->failed; i++) {
+		put_error(et->reason);
+		et->failed |= check_error("thread", et->reason);
+		ERR_clear_error();
+	}
+
+	/* Leave an error behind for the destructor to free. */
+	put_error(et->reason);
+
+	return NULL;
+}
+
+static int
+err_thread_test(void)
+{
+	struct err_thread threads[NUM_THREADS];
+	int i, failed = 0;
+
+	/* Errors queued by other threads must not be visible here. */
+	put_error(1);
+
+	memset(threads, 0, sizeof(threads));
+	for (i = 0; i < NUM_THREADS; i++) {
+		threads[i].reason = i + 2;
+		if (pthread_create(&threads[i].thread, NULL, err_thread_run,
+		    &threads[i]) != 0)
+			errx(1, "pthread_create");
+	}
+	for (i = 0; i < NUM_THREADS; i++) {
+		if (pthread_join(threads[i].thread, NULL) != 0)
+			errx(1, "pthread_join");
+		failed |= threads[i].failed;
+	}
+
+	failed |= check_error("main", 1);
+
+	return failed;
+}
+
+static int
+err_remove_state_test(void)
+{
+	int failed = 0;
+
+	put_error(42);
+	ERR_remove_thread_state(NULL);
+
+	if (ERR_peek_error() != 0) {
+		fprintf(stderr, "FAIL: error survived state removal\n");
+		failed = 1;
+	}
+
+	/* A new state must be set up on the next use. */
+	put_error(43);
+	failed |= check_error("removed", 43);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= err_thread_test();
+	failed |= err_remove_state_test();
+
+	return failed;
+}
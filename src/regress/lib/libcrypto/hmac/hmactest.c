@@ -314,6 +314,56 @@ main(int argc, char *argv[])
 	} else {
 		printf("test 6 ok\n");
 	}
+
+	/* test 7: reuse a keyed context and copy it as a template */
+	for (i = 0; i < 3; i++) {
+		if (!HMAC_Init_ex(ctx, NULL, 0, NULL, NULL)) {
+			printf("Failed to restart HMAC (test 7)\n");
+			err++;
+			goto end;
+		}
+		if (!HMAC_CTX_copy(ctx2, ctx)) {
+			printf("Failed to copy HMAC_CTX (test 7)\n");
+			err++;
+			goto end;
+		}
+		if (!HMAC_Update(ctx2, test[7].data, test[7].data_len)) {
+			printf("Error updating HMAC with data (test 7)\n");
+			err++;
+			goto end;
+		}
+		if (!HMAC_Final(ctx2, buf, &len)) {
+			printf("Error finalising data (test 7)\n");
+			err++;
+			goto end;
+		}
+		p = pt(buf, len);
+		if (strcmp(p, (char *)test[7].digest) != 0) {
+			printf("Error calculating HMAC on test 7 copy %d\n", i);
+			printf("got %s instead of %s\n", p, test[7].digest);
+			err++;
+			goto end;
+		}
+		if (!HMAC_Update(ctx, test[7].data, test[7].data_len)) {
+			printf("Error updating HMAC with data (test 7)\n");
+			err++;
+			goto end;
+		}
+		if (!HMAC_Final(ctx, buf, &len)) {
+			printf("Error finalising data (test 7)\n");
+			err++;
+			goto end;
+		}
+		p = pt(buf, len);
+		if (strcmp(p, (char *)test[7].digest) != 0) {
+			printf("Error calculating HMAC on test 7 reuse %d\n",
+			    i);
+			printf("got %s instead of %s\n", p, test[7].digest);
+			err++;
+			goto end;
+		}
+	}
+	printf("test 7 ok\n");
 end:
 	HMAC_CTX_free(ctx);
 	HMAC_CTX_free(ctx2);
@@ -0,0 +1,176 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/lhash.h>
+
+#define NUM_VALUES	5000
+#define NUM_OPS		200000
+
+static int values[NUM_VALUES];
+static char present[NUM_VALUES];
+
+static unsigned long
+int_hash(const void *a)
+{
+	return *(const int *)a;
+}
+
+/* Forces long probe sequences and many full comparisons. */
+static unsigned long
+int_bad_hash(const void *a)
+{
+	return *(const int *)a % 7;
+}
+
+static int
+int_cmp(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+struct delete_arg {
+	_LHASH *lh;
+	int seen;
+	int failed;
+};
+
+static void
+delete_odd(void *data, void *arg)
+{
+	struct delete_arg *da = arg;
+	int *value = data;
+
+	da->seen++;
+	if (*value % 2 == 0)
+		return;
+	if (lh_delete(da->lh, value) != value)
+		da->failed = 1;
+	present[*value] = 0;
+}
+
+static int
+lhash_test(const char *name, LHASH_HASH_FN_TYPE hash)
+{
+	struct delete_arg da;
+	_LHASH *lh;
+	unsigned long num_items = 0;
+	void *ret;
+	int i, value;
+	int failed = 1;
+
+	if ((lh = lh_new(hash, int_cmp)) == NULL)
+		errx(1, "lh_new");
+
+	memset(present, 0, sizeof(present));
+	for (i = 0; i < NUM_VALUES; i++)
+		values[i] = i;
+
+	/* Random operations, checked against a plain array. */
+	for (i = 0; i < NUM_OPS; i++) {
+		value = arc4random_uniform(NUM_VALUES);
+		switch (arc4random_uniform(3)) {
+		case 0:
+			ret = lh_insert(lh, &values[value]);
+			if (lh_error(lh))
+				errx(1, "lh_insert");
+			if ((ret != NULL) != present[value]) {
+				fprintf(stderr, "FAIL: %s: insert %d\n", name,
+				    value);
+				goto failure;
+			}
+			if (!present[value])
+				num_items++;
+			present[value] = 1;
+			break;
+		case 1:
+			ret = lh_delete(lh, &values[value]);
+			if ((ret != NULL) != present[value]) {
+				fprintf(stderr, "FAIL: %s: delete %d\n", name,
+				    value);
+				goto failure;
+			}
+			if (present[value])
+				num_items--;
+			present[value] = 0;
+			break;
+		default:
+			ret = lh_retrieve(lh, &values[value]);
+			if ((ret != NULL) != present[value]) {
+				fprintf(stderr, "FAIL: %s: retrieve %d\n", name,
+				    value);
+				goto failure;
+			}
+			break;
+		}
+		if (lh_num_items(lh) != num_items) {
+			fprintf(stderr, "FAIL: %s: got %lu items, want %lu\n",
+			    name, lh_num_items(lh), num_items);
+			goto failure;
+		}
+	}
+
+	/* Deleting the current entry from lh_doall() must not skip any. */
+	for (i = 0; i < NUM_VALUES; i++) {
+		if (!present[i]) {
+			lh_insert(lh, &values[i]);
+			present[i] = 1;
+		}
+	}
+	memset(&da, 0, sizeof(da));
+	da.lh = lh;
+	lh_doall_arg(lh, delete_odd, &da);
+	if (da.failed || da.seen != NUM_VALUES) {
+		fprintf(stderr, "FAIL: %s: doall saw %d of %d entries\n", name,
+		    da.seen, NUM_VALUES);
+		goto failure;
+	}
+	if (lh_num_items(lh) != NUM_VALUES / 2) {
+		fprintf(stderr, "FAIL: %s: got %lu items after doall, "
+		    "want %d\n", name, lh_num_items(lh), NUM_VALUES / 2);
+		goto failure;
+	}
+	for (i = 0; i < NUM_VALUES; i++) {
+		if ((lh_retrieve(lh, &values[i]) != NULL) != present[i]) {
+			fprintf(stderr, "FAIL: %s: retrieve %d after doall\n",
+			    name, i);
+			goto failure;
+		}
+	}
+
+	failed = 0;
+
+ failure:
+	lh_free(lh);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= lhash_test("hash", int_hash);
+	failed |= lhash_test("bad hash", int_bad_hash);
+
+	return failed;
+}
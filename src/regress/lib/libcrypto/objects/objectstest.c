@@ -15,6 +15,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <openssl/err.h>
 #include <openssl/objects.h>
 
 #include <err.h>
@@ -573,6 +574,95 @@ obj_oid_large_tests(void)
 	return failed;
 }
 
+/*
+ * Every built-in object must be found again by its short name, long name and
+ * encoding. Names and encodings shared by several objects resolve to one of
+ * them, so compare the name or encoding of the object that was found.
+ */
+static int
+obj_lookup_test(int nid)
+{
+	ASN1_OBJECT *obj, *copy = NULL;
+	const char *sn, *ln;
+	int found;
+	int failed = 1;
+
+	if ((obj = OBJ_nid2obj(nid)) == NULL) {
+		ERR_clear_error();
+		return 0;
+	}
+
+	sn = OBJ_nid2sn(nid);
+	if ((found = OBJ_sn2nid(sn)) == NID_undef ||
+	    strcmp(OBJ_nid2sn(found), sn) != 0) {
+		fprintf(stderr, "FAIL: OBJ_sn2nid(\"%s\") = %d, want %d\n",
+		    sn, found, nid);
+		goto failed;
+	}
+
+	ln = OBJ_nid2ln(nid);
+	if ((found = OBJ_ln2nid(ln)) == NID_undef ||
+	    strcmp(OBJ_nid2ln(found), ln) != 0) {
+		fprintf(stderr, "FAIL: OBJ_ln2nid(\"%s\") = %d, want %d\n",
+		    ln, found, nid);
+		goto failed;
+	}
+
+	if (OBJ_length(obj) == 0)
+		goto done;
+
+	/* A copy without a NID forces a lookup by encoding. */
+	if ((copy = ASN1_OBJECT_create(NID_undef,
+	    (unsigned char *)OBJ_get0_data(obj), OBJ_length(obj), NULL,
+	    NULL)) == NULL)
+		errx(1, "ASN1_OBJECT_create");
+	if ((found = OBJ_obj2nid(copy)) == NID_undef ||
+	    OBJ_cmp(OBJ_nid2obj(found), obj) != 0) {
+		fprintf(stderr, "FAIL: OBJ_obj2nid() for NID %d = %d\n",
+		    nid, found);
+		goto failed;
+	}
+
+ done:
+	failed = 0;
+
+ failed:
+	ASN1_OBJECT_free(copy);
+
+	return failed;
+}
+
+static int
+obj_lookup_tests(void)
+{
+	static const unsigned char unknown[] = { 0x2b, 0x06, 0x01, 0x7f };
+	ASN1_OBJECT *obj;
+	int failed = 0;
+	int nid;
+
+	for (nid = 1; nid < 2048; nid++)
+		failed |= obj_lookup_test(nid);
+
+	if (OBJ_sn2nid("no-such-object") != NID_undef) {
+		fprintf(stderr, "FAIL: OBJ_sn2nid() found unknown name\n");
+		failed = 1;
+	}
+	if (OBJ_ln2nid("no such object") != NID_undef) {
+		fprintf(stderr, "FAIL: OBJ_ln2nid() found unknown name\n");
+		failed = 1;
+	}
+	if ((obj = ASN1_OBJECT_create(NID_undef, (unsigned char *)unknown,
+	    sizeof(unknown), NULL, NULL)) == NULL)
+		errx(1, "ASN1_OBJECT_create");
+	if (OBJ_obj2nid(obj) != NID_undef) {
+		fprintf(stderr, "FAIL: OBJ_obj2nid() found unknown OID\n");
+		failed = 1;
+	}
+	ASN1_OBJECT_free(obj);
+
+	return failed;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -583,6 +673,7 @@ main(int argc, char **argv)
 	failed |= obj_oid_tests();
 	failed |= obj_txt_tests();
 	failed |= obj_oid_large_tests();
+	failed |= obj_lookup_tests();
 
 	return (failed);
 }
@@ -77,6 +77,11 @@ static const testdata test_cases[] = {
 	{"passwordPASSWORDpassword", 24,
 	 "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096},
 	{"pass\0word", 9, "sa\0lt", 5, 4096},
+	{"passwordPASSWORDpasswordPASSWORDpasswordPASSWORDpasswordPASSWORD"
+	 "passwordPASSWORDpasswordPASSWORDpass", 100, "saltSALTsalt", 12, 1000},
+	{"passwordPASSWORDpasswordPASSWORDpasswordPASSWORDpasswordPASSWORD"
+	 "passwordPASSWORDpasswordPASSWORDpasswordPASSWORDpasswordPASSWORD"
+	 "passwordPASSWORD", 144, "saltSALTsalt", 12, 1000},
 	{NULL},
 };
 
@@ -86,6 +91,8 @@ static const char *sha1_results[] = {
 	"4b007901b765489abead49d926f721d065a429c1",
 	"3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038",
 	"56fa6aa75548099dcc37d7f03425e0c3",
+	"3ec577f756aa154128fe47ed6bb5c98f2746eeeb39fd93a427",
+	"5c71416487673c311830c9d1799bd70328611072e7ddf6b8b8",
 };
 
 static const char *sha256_results[] = {
@@ -95,6 +102,10 @@ static const char *sha256_results[] = {
 	"348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c63551"
 		"8c7dac47e9",
 	"89b69d0516f829893c696226650a8687",
+	"b301aa94025a5b143f9ddd52e704288ed66767e0be77caaeaf722874d184be3341b67d"
+		"351bcf0b63a2d86a46b1b4f75f0812",
+	"2513ebd4194d71130ae92254f65aa485b83730693a957b28c20f9d558b169ac85832ed"
+		"b388db7a9f22df5d971483e8660fb9",
 };
 
 static const char *sha512_results[] = {
@@ -107,6 +118,12 @@ static const char *sha512_results[] = {
 	"8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71115b59"
 		"f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8",
 	"9d9e9c4cd21fe4be24d5b8244c759665",
+	"79f46e38f104febec7321508562e6fa6691d5d4b32940b1ff304ce21b88174ae709811"
+		"9377953b9afef50ac1c993d36341d194ecb48d65c9eb827f193d96e2d7e790"
+		"2819a42f7ab68608303dd193dee6",
+	"241b6de03add66209581a72b60362d99da4298171c403fdceb7915eebaea8e147d8b16"
+		"beb902052bfee7fa63e0d226eabf6fea4fee4943ae980396750ee0180cf6fa"
+		"6051fc4499db6b0653159a2ad158",
 };
 
 static void
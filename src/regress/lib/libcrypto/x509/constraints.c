@@ -18,6 +18,9 @@
 #include <err.h>
 #include <string.h>
 
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
 #include <openssl/safestack.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
@@ -517,6 +520,170 @@ test_constraints1(void)
 	return failure;
 }
 
+struct constraints_index_test {
+	int type;
+	const char *name;
+	int want;
+};
+
+static const struct constraints_index_test constraints_index_tests[] = {
+	{ GEN_DNS, "www.openbsd.org", X509_V_OK },
+	{ GEN_DNS, "openbsd.org", X509_V_OK },
+	{ GEN_DNS, "www.bad.openbsd.org", X509_V_ERR_EXCLUDED_VIOLATION },
+	{ GEN_DNS, "WWW.OpenBSD.ORG", X509_V_OK },
+	{ GEN_DNS, "www.freebsd.org", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_DNS, "host.example.ca", X509_V_OK },
+	{ GEN_URI, "www.openbsd.org", X509_V_OK },
+	{ GEN_URI, "ftp.openbsd.org", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_URI, "cdn.libressl.org", X509_V_OK },
+	{ GEN_URI, "libressl.org", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_EMAIL, "openbsd.org", X509_V_OK },
+	{ GEN_EMAIL, "mail.openbsd.org", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_EMAIL, "sub.example.net", X509_V_OK },
+	{ GEN_IPADD, "10.1.2.3", X509_V_OK },
+	{ GEN_IPADD, "10.66.2.3", X509_V_ERR_EXCLUDED_VIOLATION },
+	{ GEN_IPADD, "11.1.2.3", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_IPADD, "192.168.7.1", X509_V_OK },
+	{ GEN_IPADD, "192.168.8.1", X509_V_ERR_PERMITTED_VIOLATION },
+	{ GEN_IPADD, "2001:db8::1", X509_V_OK },
+	{ GEN_IPADD, "2001:db9::1", X509_V_ERR_PERMITTED_VIOLATION },
+};
+
+#define N_CONSTRAINTS_INDEX_TESTS \
+    (sizeof(constraints_index_tests) / sizeof(constraints_index_tests[0]))
+
+static const char *constraints_index_conf =
+    "permitted;DNS:openbsd.org,"
+    "permitted;DNS:.example.ca,"
+    "excluded;DNS:bad.openbsd.org,"
+    "permitted;URI:www.openbsd.org,"
+    "permitted;URI:.libressl.org,"
+    "permitted;email:openbsd.org,"
+    "permitted;email:.example.net,"
+    "permitted;IP:10.0.0.0/255.0.0.0,"
+    "excluded;IP:10.66.0.0/255.255.0.0,"
+    "permitted;IP:192.168.7.0/255.255.255.0,"
+    "permitted;IP:2001:db8::/ffff:ffff::";
+
+static struct x509_constraints_name *
+constraints_index_name(const struct constraints_index_test *cit)
+{
+	struct x509_constraints_name *name;
+
+	if ((name = x509_constraints_name_new()) == NULL)
+		errx(1, "x509_constraints_name_new");
+	name->type = cit->type;
+
+	if (cit->type == GEN_IPADD) {
+		if (inet_pton(AF_INET, cit->name, name->address) == 1)
+			name->af = AF_INET;
+		else if (inet_pton(AF_INET6, cit->name, name->address) == 1)
+			name->af = AF_INET6;
+		else
+			errx(1, "bad address %s", cit->name);
+		return name;
+	}
+
+	if ((name->name = strdup(cit->name)) == NULL)
+		errx(1, "strdup");
+	if (cit->type == GEN_EMAIL && (name->local = strdup("beck")) == NULL)
+		errx(1, "strdup");
+
+	return name;
+}
+
+static int
+test_constraints_index(void)
+{
+	struct x509_constraints_names *names = NULL;
+	struct x509_constraints_names *permitted = NULL, *excluded = NULL;
+	struct x509_constraints_index *index;
+	const struct constraints_index_test *cit;
+	X509_EXTENSION *ext;
+	X509 *cert;
+	int error, index_error, want;
+	size_t i;
+	int failure = 1;
+
+	if ((cert = X509_new()) == NULL)
+		errx(1, "X509_new");
+	if (!X509_set_version(cert, 2))
+		errx(1, "X509_set_version");
+	if ((ext = X509V3_EXT_conf_nid(NULL, NULL, NID_name_constraints,
+	    constraints_index_conf)) == NULL)
+		errx(1, "X509V3_EXT_conf_nid");
+	if (!X509_add_ext(cert, ext, -1))
+		errx(1, "X509_add_ext");
+	X509_EXTENSION_free(ext);
+	if (X509_get_extension_flags(cert) & EXFLAG_INVALID)
+		errx(1, "invalid extensions");
+
+	if ((permitted = x509_constraints_names_new(
+	    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL)
+		errx(1, "x509_constraints_names_new");
+	if ((excluded = x509_constraints_names_new(
+	    X509_VERIFY_MAX_CHAIN_CONSTRAINTS)) == NULL)
+		errx(1, "x509_constraints_names_new");
+	error = 0;
+	if (!x509_constraints_extract_constraints(cert, permitted, excluded,
+	    &error)) {
+		FAIL("failed to extract constraints (error %d)\n", error);
+		goto done;
+	}
+
+	error = 0;
+	if ((index = x509_constraints_index_get(cert, &error)) == NULL) {
+		FAIL("failed to build constraints index (error %d)\n", error);
+		goto done;
+	}
+	if (x509_constraints_index_get(cert, &error) != index) {
+		FAIL("constraints index not cached\n");
+		goto done;
+	}
+	if (x509_constraints_index_count(index) !=
+	    permitted->names_count + excluded->names_count) {
+		FAIL("got %zu indexed constraints, want %zu\n",
+		    x509_constraints_index_count(index),
+		    permitted->names_count + excluded->names_count);
+		goto done;
+	}
+
+	for (i = 0; i < N_CONSTRAINTS_INDEX_TESTS; i++) {
+		cit = &constraints_index_tests[i];
+
+		if ((names = x509_constraints_names_new(1)) == NULL)
+			errx(1, "x509_constraints_names_new");
+		if (!x509_constraints_names_add(names,
+		    constraints_index_name(cit)))
+			errx(1, "x509_constraints_names_add");
+
+		error = X509_V_OK;
+		(void)x509_constraints_check(names, permitted, excluded,
+		    &error);
+		index_error = X509_V_OK;
+		(void)x509_constraints_index_check(names, index, &index_error);
+
+		x509_constraints_names_free(names);
+		names = NULL;
+
+		want = cit->want;
+		if (error != want || index_error != want) {
+			FAIL("name '%s': got errors %d (list) and %d (index), "
+			    "want %d\n", cit->name, error, index_error, want);
+			goto done;
+		}
+	}
+
+	failure = 0;
+
+ done:
+	x509_constraints_names_free(permitted);
+	x509_constraints_names_free(excluded);
+	X509_free(cert);
+
+	return failure;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -532,6 +699,7 @@ main(int argc, char **argv)
 	failed |= test_invalid_domain_constraints();
 	failed |= test_invalid_uri();
 	failed |= test_constraints1();
+	failed |= test_constraints_index();
 
 	return (failed);
 }
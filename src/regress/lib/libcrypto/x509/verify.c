@@ -17,6 +17,7 @@
  */
 
 #include <err.h>
+#include <pthread.h>
 #include <string.h>
 
 #include <openssl/bio.h>
@@ -32,6 +33,8 @@
 #define MODE_MODERN_VFY_DIR	1
 #define MODE_LEGACY_VFY		2
 #define MODE_VERIFY		3
+#define MODE_MODERN_VFY_DIR_CACHE 4
+#define MODE_MODERN_VFY_DIR_DISPATCH 5
 
 static int verbose = 1;
 
@@ -102,6 +105,67 @@ verify_cert_cb(int ok, X509_STORE_CTX *xsc)
 	return ok;
 }
 
+/*
+ * Verify once with a chain cache enabled on the store, so that the
+ * verification that is checked uses the cached chain.
+ */
+static void
+verify_cert_prime_cache(X509_STORE *store, X509 *leaf, STACK_OF(X509) *bundle)
+{
+	X509_STORE_CTX *xsc;
+
+	if (!X509_STORE_set_chain_cache_size(store, 16))
+		errx(1, "failed to enable chain cache");
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX");
+	if (!X509_STORE_CTX_init(xsc, store, leaf, bundle)) {
+		ERR_print_errors_fp(stderr);
+		errx(1, "failed to init store context");
+	}
+	X509_VERIFY_PARAM_clear_flags(X509_STORE_CTX_get0_param(xsc),
+	    X509_V_FLAG_LEGACY_VERIFY);
+	(void)X509_verify_cert(xsc);
+	X509_STORE_CTX_free(xsc);
+}
+
+struct verify_dispatch_job {
+	void (*job)(void *);
+	void *job_arg;
+};
+
+static void *
+verify_dispatch_thread(void *arg)
+{
+	struct verify_dispatch_job *vdj = arg;
+
+	vdj->job(vdj->job_arg);
+	free(vdj);
+
+	return NULL;
+}
+
+/* Run each signature check on a thread of its own. */
+static int
+verify_dispatch(void (*job)(void *), void *job_arg, void *arg)
+{
+	struct verify_dispatch_job *vdj;
+	pthread_t thread;
+
+	if ((vdj = malloc(sizeof(*vdj))) == NULL)
+		return 0;
+	vdj->job = job;
+	vdj->job_arg = job_arg;
+
+	if (pthread_create(&thread, NULL, verify_dispatch_thread, vdj) != 0) {
+		free(vdj);
+		return 0;
+	}
+	pthread_detach(thread);
+
+	return 1;
+}
+
 static void
 verify_cert(const char *roots_dir, const char *roots_file,
     const char *bundle_file, int *chains, int *error, int *error_depth,
@@ -118,7 +182,9 @@ verify_cert(const char *roots_dir, const char *roots_file,
 	*error = 0;
 	*error_depth = 0;
 
-	use_dir = (mode == MODE_MODERN_VFY_DIR);
+	use_dir = (mode == MODE_MODERN_VFY_DIR ||
+	    mode == MODE_MODERN_VFY_DIR_CACHE ||
+	    mode == MODE_MODERN_VFY_DIR_DISPATCH);
 
 	if (!use_dir && !certs_from_file(roots_file, &roots))
 		errx(1, "failed to load roots from '%s'", roots_file);
@@ -140,6 +206,10 @@ verify_cert(const char *roots_dir, const char *roots_file,
 		if (!X509_STORE_load_locations(store, NULL, roots_dir))
 			errx(1, "failed to set by_dir directory of %s", roots_dir);
 	}
+	if (mode == MODE_MODERN_VFY_DIR_CACHE)
+		verify_cert_prime_cache(store, leaf, bundle);
+	if (mode == MODE_MODERN_VFY_DIR_DISPATCH)
+		X509_STORE_set_dispatch(store, verify_dispatch, NULL);
 	if (mode == MODE_LEGACY_VFY)
 		X509_STORE_CTX_set_flags(xsc, X509_V_FLAG_LEGACY_VERIFY);
 	else
@@ -522,7 +592,10 @@ verify_cert_test(const char *certs_path, int mode)
 				    vct->want_legacy_error_depth);
 				failed |= 1;
 			}
-		} else if (mode == MODE_MODERN_VFY || mode == MODE_MODERN_VFY_DIR) {
+		} else if (mode == MODE_MODERN_VFY ||
+		    mode == MODE_MODERN_VFY_DIR ||
+		    mode == MODE_MODERN_VFY_DIR_CACHE ||
+		    mode == MODE_MODERN_VFY_DIR_DISPATCH) {
 			if (error != vct->want_error) {
 				fprintf(stderr, "FAIL: Got error %d, want %d\n",
 				    error, vct->want_error);
@@ -545,6 +618,100 @@ verify_cert_test(const char *certs_path, int mode)
 	return failed;
 }
 
+/*
+ * A leaf whose intermediate is cross signed by two roots. Once the chain
+ * through one root is cached, that root is rejected without changing the
+ * store contents, so the cached chain fails and verification has to fall
+ * back to building the chain through the other root.
+ */
+static int
+verify_cert_cache_invalidated_test(const char *certs_path)
+{
+	STACK_OF(X509) *roots = NULL, *bundle = NULL;
+	X509_STORE_CTX *xsc = NULL;
+	X509_STORE *store = NULL;
+	X509 *leaf, *root, *cached_root;
+	char *roots_file, *bundle_file;
+	int i;
+	int failed = 1;
+
+	if (asprintf(&roots_file, "%s/4a/roots.pem", certs_path) == -1)
+		errx(1, "asprintf");
+	if (asprintf(&bundle_file, "%s/4a/bundle.pem", certs_path) == -1)
+		errx(1, "asprintf");
+	if (!certs_from_file(roots_file, &roots))
+		errx(1, "failed to load roots from '%s'", roots_file);
+	if (!certs_from_file(bundle_file, &bundle))
+		errx(1, "failed to load bundle from '%s'", bundle_file);
+	if ((leaf = sk_X509_shift(bundle)) == NULL)
+		errx(1, "failed to get leaf certificate");
+
+	if ((store = X509_STORE_new()) == NULL)
+		errx(1, "X509_STORE_new");
+	for (i = 0; i < sk_X509_num(roots); i++) {
+		if (!X509_STORE_add_cert(store, sk_X509_value(roots, i)))
+			errx(1, "failed to add root");
+	}
+	X509_STORE_set_flags(store, X509_V_FLAG_TRUSTED_FIRST);
+
+	verify_cert_prime_cache(store, leaf, bundle);
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX");
+	if (!X509_STORE_CTX_init(xsc, store, leaf, bundle))
+		errx(1, "failed to init store context");
+	X509_VERIFY_PARAM_clear_flags(X509_STORE_CTX_get0_param(xsc),
+	    X509_V_FLAG_LEGACY_VERIFY);
+	if (X509_verify_cert(xsc) != 1) {
+		fprintf(stderr, "FAIL: cache invalidated: initial verify "
+		    "failed: %d\n", X509_STORE_CTX_get_error(xsc));
+		goto failure;
+	}
+	cached_root = sk_X509_value(X509_STORE_CTX_get0_chain(xsc),
+	    sk_X509_num(X509_STORE_CTX_get0_chain(xsc)) - 1);
+	if (!X509_add1_reject_object(cached_root,
+	    OBJ_nid2obj(NID_anyExtendedKeyUsage)))
+		errx(1, "X509_add1_reject_object");
+	X509_STORE_CTX_free(xsc);
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX");
+	if (!X509_STORE_CTX_init(xsc, store, leaf, bundle))
+		errx(1, "failed to init store context");
+	X509_VERIFY_PARAM_clear_flags(X509_STORE_CTX_get0_param(xsc),
+	    X509_V_FLAG_LEGACY_VERIFY);
+	if (X509_verify_cert(xsc) != 1) {
+		fprintf(stderr, "FAIL: cache invalidated: verify failed: "
+		    "%d\n", X509_STORE_CTX_get_error(xsc));
+		goto failure;
+	}
+	if (X509_STORE_CTX_get_error(xsc) != X509_V_OK) {
+		fprintf(stderr, "FAIL: cache invalidated: got error %d\n",
+		    X509_STORE_CTX_get_error(xsc));
+		goto failure;
+	}
+	root = sk_X509_value(X509_STORE_CTX_get0_chain(xsc),
+	    sk_X509_num(X509_STORE_CTX_get0_chain(xsc)) - 1);
+	if (root == cached_root) {
+		fprintf(stderr, "FAIL: cache invalidated: chain uses the "
+		    "rejected root\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	X509_STORE_CTX_free(xsc);
+	X509_STORE_free(store);
+	X509_free(leaf);
+	sk_X509_pop_free(roots, X509_free);
+	sk_X509_pop_free(bundle, X509_free);
+	free(roots_file);
+	free(bundle_file);
+
+	return failed;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -561,6 +728,11 @@ main(int argc, char **argv)
 	failed |= verify_cert_test(argv[1], MODE_MODERN_VFY);
 	fprintf(stderr, "\n\nTesting modern x509_vfy by_dir\n");
 	failed |= verify_cert_test(argv[1], MODE_MODERN_VFY_DIR);
+	fprintf(stderr, "\n\nTesting modern x509_vfy by_dir with chain cache\n");
+	failed |= verify_cert_test(argv[1], MODE_MODERN_VFY_DIR_CACHE);
+	failed |= verify_cert_cache_invalidated_test(argv[1]);
+	fprintf(stderr, "\n\nTesting modern x509_vfy by_dir with dispatch\n");
+	failed |= verify_cert_test(argv[1], MODE_MODERN_VFY_DIR_DISPATCH);
 	fprintf(stderr, "\n\nTesting x509_verify\n");
 	failed |= verify_cert_test(argv[1], MODE_VERIFY);
 
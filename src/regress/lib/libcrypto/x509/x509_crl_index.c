@@ -0,0 +1,401 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#define INDEX_FILE	"x509_crl_index.idx"
+
+/* Offsets in the index file format, see x509_crl_index.c. */
+#define INDEX_HEADER_LEN	(8 + 4 + 64)
+#define INDEX_ENTRY_LEN		32
+#define INDEX_POSITION_OFF	25
+
+struct crl_index_test {
+	const char *serial;
+	int revoked;
+	int want;
+};
+
+/* Revoked serials are listed out of order to check the index is sorted. */
+static const struct crl_index_test crl_index_tests[] = {
+	{ .serial = "1000", .revoked = 1, .want = 1 },
+	{ .serial = "01", .revoked = 1, .want = 1 },
+	{ .serial = "ff", .revoked = 1, .want = 2 },
+	{ .serial = "0102030405060708090a0b0c0d0e0f1011121314",
+	    .revoked = 1, .want = 1 },
+	{ .serial = "02", .revoked = 1, .want = 1 },
+	{ .serial = "03", .revoked = 0, .want = 0 },
+	{ .serial = "0fff", .revoked = 0, .want = 0 },
+	{ .serial = "-01", .revoked = 0, .want = 0 },
+	{ .serial = "0102030405060708090a0b0c0d0e0f101112131415161718191a",
+	    .revoked = 0, .want = 0 },
+};
+
+#define N_CRL_INDEX_TESTS \
+    (sizeof(crl_index_tests) / sizeof(crl_index_tests[0]))
+
+static ASN1_INTEGER *
+serial_from_hex(const char *hex)
+{
+	ASN1_INTEGER *serial;
+	BIGNUM *bn = NULL;
+
+	if (!BN_hex2bn(&bn, hex))
+		errx(1, "BN_hex2bn");
+	if ((serial = BN_to_ASN1_INTEGER(bn, NULL)) == NULL)
+		errx(1, "BN_to_ASN1_INTEGER");
+	BN_free(bn);
+
+	return serial;
+}
+
+static EVP_PKEY *
+generate_key(void)
+{
+	EVP_PKEY *pkey;
+	EC_KEY *ec;
+
+	if ((ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) == NULL)
+		errx(1, "EC_KEY_new_by_curve_name");
+	if (!EC_KEY_generate_key(ec))
+		errx(1, "EC_KEY_generate_key");
+	if ((pkey = EVP_PKEY_new()) == NULL)
+		errx(1, "EVP_PKEY_new");
+	if (!EVP_PKEY_assign_EC_KEY(pkey, ec))
+		errx(1, "EVP_PKEY_assign_EC_KEY");
+
+	return pkey;
+}
+
+static X509_CRL *
+make_crl(EVP_PKEY *pkey)
+{
+	ASN1_ENUMERATED *reason;
+	X509_REVOKED *rev;
+	X509_NAME *name;
+	ASN1_TIME *now;
+	X509_CRL *crl;
+	size_t i;
+
+	if ((crl = X509_CRL_new()) == NULL)
+		errx(1, "X509_CRL_new");
+	if (!X509_CRL_set_version(crl, 1))
+		errx(1, "X509_CRL_set_version");
+	if ((name = X509_NAME_new()) == NULL)
+		errx(1, "X509_NAME_new");
+	if (!X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+	    (const unsigned char *)"CRL index test", -1, -1, 0))
+		errx(1, "X509_NAME_add_entry_by_txt");
+	if (!X509_CRL_set_issuer_name(crl, name))
+		errx(1, "X509_CRL_set_issuer_name");
+	X509_NAME_free(name);
+	if ((now = X509_gmtime_adj(NULL, 0)) == NULL)
+		errx(1, "X509_gmtime_adj");
+	if (!X509_CRL_set1_lastUpdate(crl, now))
+		errx(1, "X509_CRL_set1_lastUpdate");
+
+	for (i = 0; i < N_CRL_INDEX_TESTS; i++) {
+		const struct crl_index_test *cit = &crl_index_tests[i];
+		ASN1_INTEGER *serial;
+
+		if (!cit->revoked)
+			continue;
+		if ((rev = X509_REVOKED_new()) == NULL)
+			errx(1, "X509_REVOKED_new");
+		serial = serial_from_hex(cit->serial);
+		if (!X509_REVOKED_set_serialNumber(rev, serial))
+			errx(1, "X509_REVOKED_set_serialNumber");
+		ASN1_INTEGER_free(serial);
+		if (!X509_REVOKED_set_revocationDate(rev, now))
+			errx(1, "X509_REVOKED_set_revocationDate");
+		if (cit->want == 2) {
+			if ((reason = ASN1_ENUMERATED_new()) == NULL)
+				errx(1, "ASN1_ENUMERATED_new");
+			if (!ASN1_ENUMERATED_set(reason,
+			    CRL_REASON_REMOVE_FROM_CRL))
+				errx(1, "ASN1_ENUMERATED_set");
+			if (!X509_REVOKED_add1_ext_i2d(rev, NID_crl_reason,
+			    reason, 0, 0))
+				errx(1, "X509_REVOKED_add1_ext_i2d");
+			ASN1_ENUMERATED_free(reason);
+		}
+		if (!X509_CRL_add0_revoked(crl, rev))
+			errx(1, "X509_CRL_add0_revoked");
+	}
+	ASN1_TIME_free(now);
+
+	if (!X509_CRL_sign(crl, pkey, EVP_sha256()))
+		errx(1, "X509_CRL_sign");
+
+	return crl;
+}
+
+static int
+check_index(const char *name, X509_CRL_INDEX *index)
+{
+	const struct crl_index_test *cit;
+	ASN1_INTEGER *serial;
+	size_t i;
+	int got;
+	int failed = 0;
+
+	for (i = 0; i < N_CRL_INDEX_TESTS; i++) {
+		cit = &crl_index_tests[i];
+		serial = serial_from_hex(cit->serial);
+		if ((got = X509_CRL_INDEX_lookup(index, serial)) != cit->want) {
+			fprintf(stderr, "FAIL: %s: serial %s: got %d, "
+			    "want %d\n", name, cit->serial, got, cit->want);
+			failed = 1;
+		}
+		ASN1_INTEGER_free(serial);
+	}
+
+	return !failed;
+}
+
+/*
+ * The reason code of a revoked entry is only cached when the CRL is
+ * decoded, so a CRL built in memory never reports removeFromCRL.
+ */
+static int
+check_crl(const char *name, X509_CRL *crl, int decoded)
+{
+	const struct crl_index_test *cit;
+	ASN1_INTEGER *serial;
+	X509_REVOKED *rev;
+	size_t i;
+	int got, want;
+	int failed = 0;
+
+	for (i = 0; i < N_CRL_INDEX_TESTS; i++) {
+		cit = &crl_index_tests[i];
+		want = cit->want;
+		if (!decoded && want == 2)
+			want = 1;
+		serial = serial_from_hex(cit->serial);
+		rev = NULL;
+		got = X509_CRL_get0_by_serial(crl, &rev, serial);
+		if (got != want) {
+			fprintf(stderr, "FAIL: %s: serial %s: got %d, "
+			    "want %d\n", name, cit->serial, got, want);
+			failed = 1;
+		} else if (got != 0 && ASN1_INTEGER_cmp(serial,
+		    X509_REVOKED_get0_serialNumber(rev)) != 0) {
+			fprintf(stderr, "FAIL: %s: serial %s: wrong entry\n",
+			    name, cit->serial);
+			failed = 1;
+		}
+		ASN1_INTEGER_free(serial);
+	}
+
+	return !failed;
+}
+
+static X509_CRL *
+decode_crl(const unsigned char *der, int der_len)
+{
+	const unsigned char *p = der;
+	X509_CRL *crl;
+
+	if ((crl = d2i_X509_CRL(NULL, &p, der_len)) == NULL)
+		errx(1, "d2i_X509_CRL");
+
+	return crl;
+}
+
+/*
+ * Write index to the index file after applying a modification to the
+ * entries at positions a and b, which are swapped in full or only in
+ * their CRL position.
+ */
+static void
+write_modified_index(const X509_CRL_INDEX *index, int a, int b,
+    int position_only)
+{
+	unsigned char tmp[INDEX_ENTRY_LEN];
+	unsigned char *data, *ea, *eb;
+	size_t off, len;
+	long data_len;
+	BIO *mem, *bio;
+
+	if ((mem = BIO_new(BIO_s_mem())) == NULL)
+		errx(1, "BIO_new");
+	if (!X509_CRL_INDEX_write_bio(mem, index))
+		errx(1, "X509_CRL_INDEX_write_bio");
+	if ((data_len = BIO_get_mem_data(mem, &data)) <= 0)
+		errx(1, "BIO_get_mem_data");
+
+	ea = data + INDEX_HEADER_LEN + a * INDEX_ENTRY_LEN;
+	eb = data + INDEX_HEADER_LEN + b * INDEX_ENTRY_LEN;
+	if (eb + INDEX_ENTRY_LEN > data + data_len)
+		errx(1, "index too short");
+	off = position_only ? INDEX_POSITION_OFF : 0;
+	len = position_only ? 4 : INDEX_ENTRY_LEN;
+	memcpy(tmp, ea + off, len);
+	memcpy(ea + off, eb + off, len);
+	memcpy(eb + off, tmp, len);
+
+	if ((bio = BIO_new_file(INDEX_FILE, "w")) == NULL)
+		errx(1, "failed to create %s", INDEX_FILE);
+	if (BIO_write(bio, data, data_len) != data_len)
+		errx(1, "BIO_write");
+	BIO_free(bio);
+	BIO_free(mem);
+}
+
+/*
+ * Index files are not trusted: malformed files are rejected on load and
+ * files that do not match the CRL are rejected when attached.
+ */
+static int
+crl_index_file_test(const X509_CRL_INDEX *index, const unsigned char *der,
+    int der_len)
+{
+	X509_CRL_INDEX *loaded = NULL;
+	X509_CRL *decoded = NULL;
+	int failed = 1;
+
+	/* Entries out of order. */
+	write_modified_index(index, 0, 1, 0);
+	if ((loaded = X509_CRL_INDEX_load_file(INDEX_FILE)) != NULL) {
+		fprintf(stderr, "FAIL: loaded unsorted index\n");
+		goto failure;
+	}
+
+	/* Sorted entries pointing at the wrong revoked entries. */
+	write_modified_index(index, 0, 1, 1);
+	if ((loaded = X509_CRL_INDEX_load_file(INDEX_FILE)) == NULL) {
+		fprintf(stderr, "FAIL: X509_CRL_INDEX_load_file\n");
+		goto failure;
+	}
+	decoded = decode_crl(der, der_len);
+	if (X509_CRL_set1_index(decoded, loaded)) {
+		fprintf(stderr, "FAIL: attached index not matching the CRL\n");
+		goto failure;
+	}
+	if (!check_crl("mismatched", decoded, 1))
+		goto failure;
+
+	failed = 0;
+
+ failure:
+	X509_CRL_INDEX_free(loaded);
+	X509_CRL_free(decoded);
+
+	return failed;
+}
+
+static int
+crl_index_test(void)
+{
+	X509_CRL_INDEX *index = NULL, *loaded = NULL;
+	X509_CRL *crl, *decoded = NULL, *lazy = NULL;
+	unsigned char *der = NULL;
+	EVP_PKEY *pkey;
+	BIO *bio;
+	int der_len;
+	int failed = 1;
+
+	pkey = generate_key();
+	crl = make_crl(pkey);
+
+	if ((der_len = i2d_X509_CRL(crl, &der)) <= 0)
+		errx(1, "i2d_X509_CRL");
+
+	if ((index = X509_CRL_INDEX_new(der, der_len)) == NULL) {
+		fprintf(stderr, "FAIL: X509_CRL_INDEX_new\n");
+		goto failure;
+	}
+	if (!check_index("built", index))
+		goto failure;
+
+	if ((bio = BIO_new_file(INDEX_FILE, "w")) == NULL)
+		errx(1, "failed to create %s", INDEX_FILE);
+	if (!X509_CRL_INDEX_write_bio(bio, index)) {
+		fprintf(stderr, "FAIL: X509_CRL_INDEX_write_bio\n");
+		BIO_free(bio);
+		goto failure;
+	}
+	BIO_free(bio);
+
+	if ((loaded = X509_CRL_INDEX_load_file(INDEX_FILE)) == NULL) {
+		fprintf(stderr, "FAIL: X509_CRL_INDEX_load_file\n");
+		goto failure;
+	}
+	if (!check_index("loaded", loaded))
+		goto failure;
+
+	/* The index is bound to the encoding it was built from. */
+	if (X509_CRL_set1_index(crl, loaded)) {
+		fprintf(stderr, "FAIL: index attached to a different CRL\n");
+		goto failure;
+	}
+
+	decoded = decode_crl(der, der_len);
+	if (!X509_CRL_set1_index(decoded, loaded)) {
+		fprintf(stderr, "FAIL: X509_CRL_set1_index\n");
+		goto failure;
+	}
+	if (!check_crl("attached", decoded, 1))
+		goto failure;
+
+	if (crl_index_file_test(index, der, der_len))
+		goto failure;
+
+	/* Without an attached index one is built on first lookup. */
+	lazy = decode_crl(der, der_len);
+	if (!check_crl("lazy", lazy, 1))
+		goto failure;
+
+	/* A CRL without a cached encoding is searched without an index. */
+	if (!check_crl("unencoded", crl, 0))
+		goto failure;
+
+	failed = 0;
+
+ failure:
+	X509_CRL_INDEX_free(index);
+	X509_CRL_INDEX_free(loaded);
+	X509_CRL_free(crl);
+	X509_CRL_free(decoded);
+	X509_CRL_free(lazy);
+	EVP_PKEY_free(pkey);
+	free(der);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= crl_index_test();
+
+	return failed;
+}
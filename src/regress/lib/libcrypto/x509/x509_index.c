@@ -0,0 +1,265 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#define INDEX_FILE	"x509_index.idx"
+
+static const char *index_tests[] = {
+	"1a",
+	"2a",
+	"10a",
+	"13a",
+};
+
+#define N_INDEX_TESTS (sizeof(index_tests) / sizeof(index_tests[0]))
+
+static STACK_OF(X509) *
+certs_from_file(const char *filename)
+{
+	STACK_OF(X509_INFO) *xis;
+	STACK_OF(X509) *xs;
+	BIO *bio;
+	X509 *x;
+	int i;
+
+	if ((xs = sk_X509_new_null()) == NULL)
+		errx(1, "failed to create X509 stack");
+	if ((bio = BIO_new_file(filename, "r")) == NULL)
+		errx(1, "failed to open %s", filename);
+	if ((xis = PEM_X509_INFO_read_bio(bio, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read PEM from %s", filename);
+
+	for (i = 0; i < sk_X509_INFO_num(xis); i++) {
+		if ((x = sk_X509_INFO_value(xis, i)->x509) == NULL)
+			continue;
+		if (!sk_X509_push(xs, x))
+			errx(1, "failed to push X509");
+		X509_up_ref(x);
+	}
+
+	sk_X509_INFO_pop_free(xis, X509_INFO_free);
+	BIO_free(bio);
+
+	return xs;
+}
+
+static int
+x509_index_test(const char *certs_path, const char *name)
+{
+	STACK_OF(X509) *roots;
+	X509_STORE_CTX *xsc = NULL;
+	X509_STORE *store = NULL;
+	X509_LOOKUP *lookup;
+	X509_OBJECT *obj = NULL;
+	char path[PATH_MAX];
+	BIO *bio;
+	X509 *x;
+	int i;
+	int failed = 1;
+
+	if (snprintf(path, sizeof(path), "%s/%s/roots.pem", certs_path,
+	    name) >= (int)sizeof(path))
+		errx(1, "certs path too long");
+	roots = certs_from_file(path);
+
+	if ((bio = BIO_new_file(INDEX_FILE, "w")) == NULL)
+		errx(1, "failed to create %s", INDEX_FILE);
+	if (!X509_LOOKUP_write_index(bio, roots)) {
+		fprintf(stderr, "FAIL: %s: X509_LOOKUP_write_index\n", name);
+		BIO_free(bio);
+		goto failure;
+	}
+	BIO_free(bio);
+
+	if ((store = X509_STORE_new()) == NULL)
+		errx(1, "X509_STORE_new");
+	if ((lookup = X509_STORE_add_lookup(store, X509_LOOKUP_index())) == NULL)
+		errx(1, "X509_STORE_add_lookup");
+	if (!X509_LOOKUP_load_index(lookup, INDEX_FILE)) {
+		fprintf(stderr, "FAIL: %s: X509_LOOKUP_load_index\n", name);
+		goto failure;
+	}
+
+	/* Nothing is decoded until it is looked up. */
+	if (sk_X509_OBJECT_num(X509_STORE_get0_objects(store)) != 0) {
+		fprintf(stderr, "FAIL: %s: store is not empty after load\n",
+		    name);
+		goto failure;
+	}
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX_new");
+	if (!X509_STORE_CTX_init(xsc, store, NULL, NULL))
+		errx(1, "X509_STORE_CTX_init");
+
+	for (i = 0; i < sk_X509_num(roots); i++) {
+		x = sk_X509_value(roots, i);
+
+		X509_OBJECT_free(obj);
+		obj = X509_STORE_CTX_get_obj_by_subject(xsc, X509_LU_X509,
+		    X509_get_subject_name(x));
+		if (obj == NULL) {
+			fprintf(stderr, "FAIL: %s: root %d not found by "
+			    "subject\n", name, i);
+			goto failure;
+		}
+		if (X509_NAME_cmp(X509_get_subject_name(
+		    X509_OBJECT_get0_X509(obj)), X509_get_subject_name(x)) != 0) {
+			fprintf(stderr, "FAIL: %s: root %d has wrong "
+			    "subject\n", name, i);
+			goto failure;
+		}
+	}
+
+	failed = 0;
+
+ failure:
+	X509_OBJECT_free(obj);
+	X509_STORE_CTX_free(xsc);
+	X509_STORE_free(store);
+	sk_X509_pop_free(roots, X509_free);
+
+	return failed;
+}
+
+/*
+ * All certificates with the subject that is looked up end up in the store,
+ * not only the first one in the index.
+ */
+static int
+x509_index_same_subject_test(const char *certs_path)
+{
+	STACK_OF(X509) *roots, *certs;
+	ASN1_INTEGER *serial;
+	X509_STORE_CTX *xsc = NULL;
+	X509_STORE *store = NULL;
+	X509_LOOKUP *lookup;
+	X509_OBJECT *obj = NULL;
+	char path[PATH_MAX];
+	BIO *bio;
+	X509 *x, *y;
+	int failed = 1;
+
+	if (snprintf(path, sizeof(path), "%s/1a/roots.pem",
+	    certs_path) >= (int)sizeof(path))
+		errx(1, "certs path too long");
+	roots = certs_from_file(path);
+	if ((x = sk_X509_value(roots, 0)) == NULL)
+		errx(1, "no roots in %s", path);
+
+	/* A second certificate with the same subject. */
+	if ((y = X509_dup(x)) == NULL)
+		errx(1, "X509_dup");
+	if ((serial = ASN1_INTEGER_new()) == NULL)
+		errx(1, "ASN1_INTEGER_new");
+	if (!ASN1_INTEGER_set(serial, 4242))
+		errx(1, "ASN1_INTEGER_set");
+	if (!X509_set_serialNumber(y, serial))
+		errx(1, "X509_set_serialNumber");
+	ASN1_INTEGER_free(serial);
+
+	if ((certs = sk_X509_new_null()) == NULL)
+		errx(1, "sk_X509_new_null");
+	if (!sk_X509_push(certs, x) || !sk_X509_push(certs, y))
+		errx(1, "sk_X509_push");
+
+	if ((bio = BIO_new_file(INDEX_FILE, "w")) == NULL)
+		errx(1, "failed to create %s", INDEX_FILE);
+	if (!X509_LOOKUP_write_index(bio, certs)) {
+		fprintf(stderr, "FAIL: same subject: X509_LOOKUP_write_index\n");
+		BIO_free(bio);
+		goto failure;
+	}
+	BIO_free(bio);
+
+	if ((store = X509_STORE_new()) == NULL)
+		errx(1, "X509_STORE_new");
+	if ((lookup = X509_STORE_add_lookup(store, X509_LOOKUP_index())) == NULL)
+		errx(1, "X509_STORE_add_lookup");
+	if (!X509_LOOKUP_load_index(lookup, INDEX_FILE)) {
+		fprintf(stderr, "FAIL: same subject: X509_LOOKUP_load_index\n");
+		goto failure;
+	}
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX_new");
+	if (!X509_STORE_CTX_init(xsc, store, NULL, NULL))
+		errx(1, "X509_STORE_CTX_init");
+
+	obj = X509_STORE_CTX_get_obj_by_subject(xsc, X509_LU_X509,
+	    X509_get_subject_name(x));
+	if (obj == NULL) {
+		fprintf(stderr, "FAIL: same subject: not found by subject\n");
+		goto failure;
+	}
+	if (sk_X509_OBJECT_num(X509_STORE_get0_objects(store)) != 2) {
+		fprintf(stderr, "FAIL: same subject: got %d certificates in "
+		    "store, want 2\n",
+		    sk_X509_OBJECT_num(X509_STORE_get0_objects(store)));
+		goto failure;
+	}
+
+	/* Loading the index again keeps the decoded certificates. */
+	if (!X509_LOOKUP_load_index(lookup, INDEX_FILE)) {
+		fprintf(stderr, "FAIL: same subject: reload failed\n");
+		goto failure;
+	}
+	if (sk_X509_OBJECT_num(X509_STORE_get0_objects(store)) != 2) {
+		fprintf(stderr, "FAIL: same subject: store changed by "
+		    "reload\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	X509_OBJECT_free(obj);
+	X509_STORE_CTX_free(xsc);
+	X509_STORE_free(store);
+	sk_X509_free(certs);
+	X509_free(y);
+	sk_X509_pop_free(roots, X509_free);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t i;
+	int failed = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <certs_path>\n", argv[0]);
+		exit(1);
+	}
+
+	for (i = 0; i < N_INDEX_TESTS; i++)
+		failed |= x509_index_test(argv[1], index_tests[i]);
+	failed |= x509_index_same_subject_test(argv[1]);
+
+	return failed;
+}
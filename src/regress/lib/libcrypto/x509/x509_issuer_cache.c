@@ -0,0 +1,151 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "x509_issuer_cache.h"
+
+static void
+make_md(unsigned char *md, int shard, int n)
+{
+	memset(md, 0, EVP_MAX_MD_SIZE);
+	md[0] = shard;
+	md[1] = n;
+}
+
+static int
+stats_check(const char *name, uint64_t hits, uint64_t misses,
+    uint64_t evictions, size_t entries)
+{
+	uint64_t got_hits, got_misses, got_evictions;
+	size_t got_entries;
+
+	X509_issuer_cache_stats(&got_hits, &got_misses, &got_evictions,
+	    &got_entries);
+
+	if (got_hits != hits || got_misses != misses ||
+	    got_evictions != evictions || got_entries != entries) {
+		fprintf(stderr, "FAIL: %s: got hits %llu misses %llu "
+		    "evictions %llu entries %zu, want %llu %llu %llu %zu\n",
+		    name, (unsigned long long)got_hits,
+		    (unsigned long long)got_misses,
+		    (unsigned long long)got_evictions, got_entries,
+		    (unsigned long long)hits, (unsigned long long)misses,
+		    (unsigned long long)evictions, entries);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+issuer_cache_test(void)
+{
+	unsigned char parent[EVP_MAX_MD_SIZE], child[EVP_MAX_MD_SIZE];
+	int i;
+	int failed = 1;
+
+	/* Parent and child digests with a zero first byte use shard 0. */
+	if (!X509_issuer_cache_set_shard_max(0, 3)) {
+		fprintf(stderr, "FAIL: X509_issuer_cache_set_shard_max\n");
+		goto failure;
+	}
+	if (X509_issuer_cache_set_shard_max(
+	    X509_issuer_cache_shards(), 1)) {
+		fprintf(stderr, "FAIL: set max succeeded for invalid shard\n");
+		goto failure;
+	}
+
+	make_md(parent, 0, 0);
+	make_md(child, 0, 1);
+	if (x509_issuer_cache_find(parent, child) != -1) {
+		fprintf(stderr, "FAIL: found entry in empty cache\n");
+		goto failure;
+	}
+	x509_issuer_cache_add(parent, child, 1);
+	if (x509_issuer_cache_find(parent, child) != 1) {
+		fprintf(stderr, "FAIL: did not find valid entry\n");
+		goto failure;
+	}
+	if (!stats_check("first entry", 1, 1, 0, 1))
+		goto failure;
+
+	for (i = 2; i <= 3; i++) {
+		make_md(child, 0, i);
+		x509_issuer_cache_add(parent, child, 0);
+	}
+	if (!stats_check("full shard", 1, 1, 0, 3))
+		goto failure;
+
+	/*
+	 * Entry 1 has been referenced, so the clock hand gives it a second
+	 * chance and evicts entry 2 when entry 4 is added.
+	 */
+	make_md(child, 0, 4);
+	x509_issuer_cache_add(parent, child, 0);
+	if (!stats_check("eviction", 1, 1, 1, 3))
+		goto failure;
+
+	make_md(child, 0, 1);
+	if (x509_issuer_cache_find(parent, child) != 1) {
+		fprintf(stderr, "FAIL: referenced entry was evicted\n");
+		goto failure;
+	}
+	make_md(child, 0, 2);
+	if (x509_issuer_cache_find(parent, child) != -1) {
+		fprintf(stderr, "FAIL: unreferenced entry was not evicted\n");
+		goto failure;
+	}
+	make_md(child, 0, 3);
+	if (x509_issuer_cache_find(parent, child) != 0) {
+		fprintf(stderr, "FAIL: did not find invalid entry\n");
+		goto failure;
+	}
+	if (!stats_check("lookups", 3, 2, 1, 3))
+		goto failure;
+
+	/* Shrinking the shard evicts immediately, zero disables it. */
+	if (!X509_issuer_cache_set_shard_max(0, 0)) {
+		fprintf(stderr, "FAIL: X509_issuer_cache_set_shard_max\n");
+		goto failure;
+	}
+	make_md(child, 0, 5);
+	x509_issuer_cache_add(parent, child, 1);
+	if (!stats_check("disabled", 3, 2, 4, 0))
+		goto failure;
+
+	failed = 0;
+
+ failure:
+	x509_issuer_cache_free();
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= issuer_cache_test();
+
+	return failed;
+}
@@ -0,0 +1,262 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+static const char *store_index_tests[] = {
+	"1a",
+	"2a",
+	"10a",
+	"13a",
+};
+
+#define N_STORE_INDEX_TESTS \
+    (sizeof(store_index_tests) / sizeof(store_index_tests[0]))
+
+static STACK_OF(X509) *
+certs_from_file(const char *certs_path, const char *name, const char *file)
+{
+	STACK_OF(X509_INFO) *xis;
+	STACK_OF(X509) *xs;
+	char path[PATH_MAX];
+	BIO *bio;
+	X509 *x;
+	int i;
+
+	if (snprintf(path, sizeof(path), "%s/%s/%s", certs_path, name,
+	    file) >= (int)sizeof(path))
+		errx(1, "certs path too long");
+
+	if ((xs = sk_X509_new_null()) == NULL)
+		errx(1, "failed to create X509 stack");
+	if ((bio = BIO_new_file(path, "r")) == NULL)
+		errx(1, "failed to open %s", path);
+	if ((xis = PEM_X509_INFO_read_bio(bio, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read PEM from %s", path);
+
+	for (i = 0; i < sk_X509_INFO_num(xis); i++) {
+		if ((x = sk_X509_INFO_value(xis, i)->x509) == NULL)
+			continue;
+		if (!sk_X509_push(xs, x))
+			errx(1, "failed to push X509");
+		X509_up_ref(x);
+	}
+
+	sk_X509_INFO_pop_free(xis, X509_INFO_free);
+	BIO_free(bio);
+
+	return xs;
+}
+
+static int
+count_by_subject(STACK_OF(X509_OBJECT) *objs, X509_NAME *subject)
+{
+	X509 *x;
+	int i, count = 0;
+
+	for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+		if ((x = X509_OBJECT_get0_X509(sk_X509_OBJECT_value(objs,
+		    i))) == NULL)
+			continue;
+		if (X509_NAME_cmp(X509_get_subject_name(x), subject) == 0)
+			count++;
+	}
+
+	return count;
+}
+
+static int
+check_certs_by_subject(const char *name, X509_STORE_CTX *xsc,
+    STACK_OF(X509_OBJECT) *objs, X509 *x)
+{
+	STACK_OF(X509) *certs;
+	int count, want;
+
+	want = count_by_subject(objs, X509_get_subject_name(x));
+
+	count = 0;
+	certs = X509_STORE_CTX_get1_certs(xsc, X509_get_subject_name(x));
+	if (certs != NULL)
+		count = sk_X509_num(certs);
+	sk_X509_pop_free(certs, X509_free);
+
+	if (count != want) {
+		fprintf(stderr, "FAIL: %s: got %d certs by subject, want %d\n",
+		    name, count, want);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+x509_store_index_test(const char *certs_path, const char *name)
+{
+	STACK_OF(X509) *roots, *bundle;
+	STACK_OF(X509_OBJECT) *objs;
+	X509_STORE_CTX *xsc = NULL;
+	X509_STORE *store = NULL, *other = NULL;
+	X509_OBJECT *obj = NULL, *removed = NULL;
+	X509 *x, *issuer = NULL;
+	int i, num_objs;
+	int failed = 1;
+
+	roots = certs_from_file(certs_path, name, "roots.pem");
+	bundle = certs_from_file(certs_path, name, "bundle.pem");
+
+	if ((store = X509_STORE_new()) == NULL)
+		errx(1, "X509_STORE_new");
+
+	for (i = 0; i < sk_X509_num(roots); i++) {
+		if (!X509_STORE_add_cert(store, sk_X509_value(roots, i)))
+			errx(1, "X509_STORE_add_cert");
+	}
+	/* Skip the leaf, the rest of the bundle are intermediates. */
+	for (i = 1; i < sk_X509_num(bundle); i++) {
+		if (!X509_STORE_add_cert(store, sk_X509_value(bundle, i)))
+			errx(1, "X509_STORE_add_cert");
+	}
+
+	/* Adding the same certificates again must not grow the store. */
+	objs = X509_STORE_get0_objects(store);
+	num_objs = sk_X509_OBJECT_num(objs);
+	for (i = 0; i < sk_X509_num(roots); i++) {
+		if (!X509_STORE_add_cert(store, sk_X509_value(roots, i)))
+			errx(1, "X509_STORE_add_cert");
+	}
+	if (sk_X509_OBJECT_num(objs) != num_objs) {
+		fprintf(stderr, "FAIL: %s: duplicate certificates added\n",
+		    name);
+		goto failure;
+	}
+
+	if ((xsc = X509_STORE_CTX_new()) == NULL)
+		errx(1, "X509_STORE_CTX_new");
+	if (!X509_STORE_CTX_init(xsc, store, NULL, NULL))
+		errx(1, "X509_STORE_CTX_init");
+
+	for (i = 0; i < sk_X509_num(bundle); i++) {
+		x = sk_X509_value(bundle, i);
+
+		X509_free(issuer);
+		issuer = NULL;
+		if (X509_STORE_CTX_get1_issuer(&issuer, xsc, x) != 1)
+			continue;
+		if (X509_check_issued(issuer, x) != X509_V_OK) {
+			fprintf(stderr, "FAIL: %s: cert %d got wrong issuer\n",
+			    name, i);
+			goto failure;
+		}
+	}
+
+	for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+		x = X509_OBJECT_get0_X509(sk_X509_OBJECT_value(objs, i));
+		if (!check_certs_by_subject(name, xsc, objs, x))
+			goto failure;
+	}
+
+	/*
+	 * Replacing an object through the exposed stack leaves the number of
+	 * objects unchanged.
+	 */
+	if ((other = X509_STORE_new()) == NULL)
+		errx(1, "X509_STORE_new");
+	x = sk_X509_value(bundle, 0);
+	if (!X509_STORE_add_cert(other, x))
+		errx(1, "X509_STORE_add_cert");
+	if ((obj = sk_X509_OBJECT_delete(X509_STORE_get0_objects(other),
+	    0)) == NULL)
+		errx(1, "sk_X509_OBJECT_delete");
+	objs = X509_STORE_get0_objects(store);
+	X509_OBJECT_free(sk_X509_OBJECT_value(objs, 0));
+	(void)sk_X509_OBJECT_set(objs, 0, obj);
+	obj = NULL;
+	if (!check_certs_by_subject(name, xsc, objs, x))
+		goto failure;
+
+	/*
+	 * Deleting an object and pushing another one through the stack that
+	 * was handed out earlier changes neither the generation nor the number
+	 * of objects. The index must not keep pointing at the deleted object.
+	 */
+	x = sk_X509_value(roots, 0);
+	if (!X509_STORE_add_cert(other, x))
+		errx(1, "X509_STORE_add_cert");
+	if ((obj = sk_X509_OBJECT_delete(X509_STORE_get0_objects(other),
+	    0)) == NULL)
+		errx(1, "sk_X509_OBJECT_delete");
+	if ((removed = sk_X509_OBJECT_delete(objs, 0)) == NULL)
+		errx(1, "sk_X509_OBJECT_delete");
+	if (sk_X509_OBJECT_push(objs, obj) <= 0)
+		errx(1, "sk_X509_OBJECT_push");
+	obj = NULL;
+	if (!check_certs_by_subject(name, xsc, objs, x))
+		goto failure;
+	if (!check_certs_by_subject(name, xsc, objs,
+	    X509_OBJECT_get0_X509(removed)))
+		goto failure;
+
+	/*
+	 * Removing an object through the exposed stack must be picked up
+	 * by later lookups.
+	 */
+	if ((obj = sk_X509_OBJECT_delete(objs, 0)) == NULL)
+		errx(1, "sk_X509_OBJECT_delete");
+	x = X509_OBJECT_get0_X509(obj);
+	if (!check_certs_by_subject(name, xsc, objs, x))
+		goto failure;
+
+	failed = 0;
+
+ failure:
+	X509_OBJECT_free(obj);
+	X509_OBJECT_free(removed);
+	X509_free(issuer);
+	X509_STORE_CTX_free(xsc);
+	X509_STORE_free(other);
+	X509_STORE_free(store);
+	sk_X509_pop_free(roots, X509_free);
+	sk_X509_pop_free(bundle, X509_free);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t i;
+	int failed = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <certs_path>\n", argv[0]);
+		exit(1);
+	}
+
+	for (i = 0; i < N_STORE_INDEX_TESTS; i++)
+		failed |= x509_store_index_test(argv[1], store_index_tests[i]);
+
+	return failed;
+}
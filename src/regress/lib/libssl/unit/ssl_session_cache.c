@@ -0,0 +1,486 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/wait.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+
+#define N_SESSIONS	1024
+
+static void
+session_id(unsigned char *id, size_t id_len, int n)
+{
+	memset(id, 0, id_len);
+	id[0] = n & 0xff;
+	id[1] = (n >> 8) & 0xff;
+	id[id_len - 1] = (n * 7) & 0xff;
+}
+
+static SSL_SESSION *
+session_new(int n, time_t t)
+{
+	unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+	SSL_SESSION *sess;
+
+	session_id(id, sizeof(id), n);
+
+	if ((sess = SSL_SESSION_new()) == NULL)
+		errx(1, "SSL_SESSION_new");
+	if (!SSL_SESSION_set1_id(sess, id, sizeof(id)))
+		errx(1, "SSL_SESSION_set1_id");
+	sess->ssl_version = TLS1_2_VERSION;
+	sess->time = t;
+	sess->timeout = 60;
+
+	return sess;
+}
+
+static int
+session_cached(SSL *ssl, int n)
+{
+	unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+
+	session_id(id, sizeof(id), n);
+
+	return SSL_has_matching_session_id(ssl, id, sizeof(id));
+}
+
+static int
+test_session_cache_add_remove(void)
+{
+	SSL_SESSION *sessions[N_SESSIONS] = { 0 };
+	SSL_CTX *ssl_ctx = NULL;
+	SSL *ssl = NULL;
+	time_t now = time(NULL);
+	int i;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_cache_size(ssl_ctx, 0);
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	ssl->version = TLS1_2_VERSION;
+
+	for (i = 0; i < N_SESSIONS; i++) {
+		sessions[i] = session_new(i, now);
+		if (SSL_CTX_add_session(ssl_ctx, sessions[i]) != 1) {
+			fprintf(stderr, "FAIL: failed to add session %d\n", i);
+			goto failure;
+		}
+	}
+	if (SSL_CTX_add_session(ssl_ctx, sessions[0]) != 0) {
+		fprintf(stderr, "FAIL: re-added session already in cache\n");
+		goto failure;
+	}
+	if (SSL_CTX_sess_number(ssl_ctx) != N_SESSIONS) {
+		fprintf(stderr, "FAIL: got %ld cached sessions, want %d\n",
+		    SSL_CTX_sess_number(ssl_ctx), N_SESSIONS);
+		goto failure;
+	}
+
+	for (i = 0; i < N_SESSIONS; i += 2) {
+		if (SSL_CTX_remove_session(ssl_ctx, sessions[i]) != 1) {
+			fprintf(stderr, "FAIL: failed to remove session %d\n",
+			    i);
+			goto failure;
+		}
+	}
+	if (SSL_CTX_sess_number(ssl_ctx) != N_SESSIONS / 2) {
+		fprintf(stderr, "FAIL: got %ld cached sessions, want %d\n",
+		    SSL_CTX_sess_number(ssl_ctx), N_SESSIONS / 2);
+		goto failure;
+	}
+	for (i = 0; i < N_SESSIONS; i++) {
+		if (session_cached(ssl, i) != (i % 2)) {
+			fprintf(stderr, "FAIL: session %d %s cache\n", i,
+			    (i % 2) ? "missing from" : "unexpectedly in");
+			goto failure;
+		}
+	}
+
+	failed = 0;
+
+ failure:
+	for (i = 0; i < N_SESSIONS; i++)
+		SSL_SESSION_free(sessions[i]);
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_session_cache_size(void)
+{
+	SSL_SESSION *sess;
+	SSL_CTX *ssl_ctx = NULL;
+	time_t now = time(NULL);
+	long size = 64;
+	int i;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_cache_size(ssl_ctx, size);
+
+	for (i = 0; i < N_SESSIONS; i++) {
+		sess = session_new(i, now);
+		SSL_CTX_add_session(ssl_ctx, sess);
+		SSL_SESSION_free(sess);
+	}
+	if (SSL_CTX_sess_number(ssl_ctx) > size) {
+		fprintf(stderr, "FAIL: got %ld cached sessions, want <= %ld\n",
+		    SSL_CTX_sess_number(ssl_ctx), size);
+		goto failure;
+	}
+	if (SSL_CTX_sess_cache_full(ssl_ctx) <
+	    N_SESSIONS - SSL_CTX_sess_number(ssl_ctx)) {
+		fprintf(stderr, "FAIL: got %ld cache full evictions\n",
+		    SSL_CTX_sess_cache_full(ssl_ctx));
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_session_cache_flush(void)
+{
+	SSL_SESSION *sess;
+	SSL_CTX *ssl_ctx = NULL;
+	time_t now = time(NULL);
+	int i;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_cache_size(ssl_ctx, 0);
+
+	/* Every other session has already expired. */
+	for (i = 0; i < N_SESSIONS; i++) {
+		sess = session_new(i, (i % 2) ? now : now - 3600);
+		SSL_CTX_add_session(ssl_ctx, sess);
+		SSL_SESSION_free(sess);
+	}
+
+	SSL_CTX_flush_sessions(ssl_ctx, now);
+	if (SSL_CTX_sess_number(ssl_ctx) != N_SESSIONS / 2) {
+		fprintf(stderr, "FAIL: got %ld sessions after flush, want %d\n",
+		    SSL_CTX_sess_number(ssl_ctx), N_SESSIONS / 2);
+		goto failure;
+	}
+
+	SSL_CTX_flush_sessions(ssl_ctx, 0);
+	if (SSL_CTX_sess_number(ssl_ctx) != 0) {
+		fprintf(stderr, "FAIL: got %ld sessions after full flush\n",
+		    SSL_CTX_sess_number(ssl_ctx));
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_session_cache_expire(void)
+{
+	SSL_SESSION *sess;
+	SSL_CTX *ssl_ctx = NULL;
+	time_t now = time(NULL);
+	int i;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_cache_size(ssl_ctx, 0);
+
+	/* Add sessions that expire later, then sessions that expired. */
+	for (i = 0; i < N_SESSIONS; i++) {
+		sess = session_new(i, (i < N_SESSIONS / 2) ? now : now - 3600);
+		SSL_CTX_add_session(ssl_ctx, sess);
+		SSL_SESSION_free(sess);
+	}
+
+	/* Expired sessions are removed as new sessions are added. */
+	if (SSL_CTX_sess_number(ssl_ctx) != N_SESSIONS / 2) {
+		fprintf(stderr, "FAIL: got %ld sessions, want %d\n",
+		    SSL_CTX_sess_number(ssl_ctx), N_SESSIONS / 2);
+		goto failure;
+	}
+
+	SSL_CTX_set_session_cache_mode(ssl_ctx,
+	    SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_AUTO_CLEAR);
+	for (i = N_SESSIONS; i < 2 * N_SESSIONS; i++) {
+		sess = session_new(i, now - 3600);
+		SSL_CTX_add_session(ssl_ctx, sess);
+		SSL_SESSION_free(sess);
+	}
+	if (SSL_CTX_sess_number(ssl_ctx) != N_SESSIONS + N_SESSIONS / 2) {
+		fprintf(stderr, "FAIL: got %ld sessions with no auto clear, "
+		    "want %d\n", SSL_CTX_sess_number(ssl_ctx),
+		    N_SESSIONS + N_SESSIONS / 2);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_session_cache_sessions(void)
+{
+	SSL_SESSION *sessions[N_SESSIONS] = { 0 };
+	LHASH_OF(SSL_SESSION) *lh = NULL, *lh2 = NULL;
+	SSL_CTX *ssl_ctx = NULL;
+	time_t now = time(NULL);
+	int i;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_cache_size(ssl_ctx, 0);
+
+	for (i = 0; i < N_SESSIONS; i++) {
+		sessions[i] = session_new(i, now);
+		if (SSL_CTX_add_session(ssl_ctx, sessions[i]) != 1) {
+			fprintf(stderr, "FAIL: failed to add session %d\n", i);
+			goto failure;
+		}
+	}
+
+	if ((lh = SSL_CTX_sessions(ssl_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: SSL_CTX_sessions returned NULL\n");
+		goto failure;
+	}
+	if (lh_SSL_SESSION_num_items(lh) != N_SESSIONS) {
+		fprintf(stderr, "FAIL: got %lu sessions in view, want %d\n",
+		    lh_SSL_SESSION_num_items(lh), N_SESSIONS);
+		goto failure;
+	}
+	for (i = 0; i < N_SESSIONS; i++) {
+		if (lh_SSL_SESSION_retrieve(lh, sessions[i]) != sessions[i]) {
+			fprintf(stderr, "FAIL: session %d missing from view\n",
+			    i);
+			goto failure;
+		}
+	}
+
+	/*
+	 * Removing sessions from the cache leaves the snapshot untouched and
+	 * the sessions in it alive, while a new snapshot no longer has them.
+	 */
+	for (i = 0; i < N_SESSIONS; i += 2) {
+		SSL_CTX_remove_session(ssl_ctx, sessions[i]);
+		SSL_SESSION_free(sessions[i]);
+		sessions[i] = NULL;
+	}
+	if ((lh2 = SSL_CTX_sessions(ssl_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: SSL_CTX_sessions returned NULL\n");
+		goto failure;
+	}
+	if (lh2 == lh) {
+		fprintf(stderr, "FAIL: SSL_CTX_sessions returned same table\n");
+		goto failure;
+	}
+	if (lh_SSL_SESSION_num_items(lh) != N_SESSIONS) {
+		fprintf(stderr, "FAIL: got %lu sessions in old view, want %d\n",
+		    lh_SSL_SESSION_num_items(lh), N_SESSIONS);
+		goto failure;
+	}
+	if (lh_SSL_SESSION_num_items(lh2) != N_SESSIONS / 2) {
+		fprintf(stderr, "FAIL: got %lu sessions in view, want %d\n",
+		    lh_SSL_SESSION_num_items(lh2), N_SESSIONS / 2);
+		goto failure;
+	}
+	for (i = 1; i < N_SESSIONS; i += 2) {
+		if (lh_SSL_SESSION_retrieve(lh2, sessions[i]) != sessions[i]) {
+			fprintf(stderr, "FAIL: session %d missing from view\n",
+			    i);
+			goto failure;
+		}
+	}
+
+	/* The old snapshot holds the last references to removed sessions. */
+	SSL_CTX_sessions_free(lh);
+	lh = NULL;
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_sessions_free(lh);
+	SSL_CTX_sessions_free(lh2);
+	for (i = 0; i < N_SESSIONS; i++)
+		SSL_SESSION_free(sessions[i]);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+new_session_cb(SSL *ssl, SSL_SESSION *sess)
+{
+	return 0;
+}
+
+static int
+test_session_cache_shm(void)
+{
+	unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+	SSL_SESSION *sess = NULL, *shared = NULL, *other = NULL;
+	SSL_CTX *ssl_ctx = NULL;
+	SSL *ssl = NULL;
+	int status;
+	pid_t pid;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	SSL_CTX_sess_set_new_cb(ssl_ctx, new_session_cb);
+	if (!SSL_CTX_set_session_cache_shm(ssl_ctx, 1024 * 1024)) {
+		fprintf(stderr, "FAIL: failed to set up shared cache\n");
+		goto failure;
+	}
+	if (SSL_CTX_sess_get_new_cb(ssl_ctx) != new_session_cb) {
+		fprintf(stderr, "FAIL: shared cache replaced new session "
+		    "callback\n");
+		goto failure;
+	}
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	SSL_set_accept_state(ssl);
+	ssl->version = TLS1_2_VERSION;
+
+	sess = session_new(42, time(NULL));
+	sess->cipher_id = TLS1_CK_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+	sess->master_key_length = sizeof(sess->master_key);
+	arc4random_buf(sess->master_key, sizeof(sess->master_key));
+	session_id(id, sizeof(id), 42);
+
+	/* Store the session from a child process. */
+	if ((pid = fork()) == -1)
+		err(1, "fork");
+	if (pid == 0) {
+		ssl_session_shm_add(ssl, sess);
+		_exit(0);
+	}
+	if (waitpid(pid, &status, 0) == -1)
+		err(1, "waitpid");
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "FAIL: child failed to store session\n");
+		goto failure;
+	}
+
+	if ((shared = ssl_session_shm_get(ssl, id, sizeof(id))) == NULL) {
+		fprintf(stderr, "FAIL: session not found in shared cache\n");
+		goto failure;
+	}
+	if (shared->master_key_length != sess->master_key_length ||
+	    memcmp(shared->master_key, sess->master_key,
+	    sess->master_key_length) != 0) {
+		fprintf(stderr, "FAIL: shared session master key differs\n");
+		goto failure;
+	}
+	SSL_SESSION_free(shared);
+	shared = NULL;
+
+	/*
+	 * Evicting the session from the internal cache keeps it shared.
+	 * Session 58 lands in the same shard as session 42 and expires
+	 * later, so session 42 is evicted.
+	 */
+	SSL_CTX_sess_set_cache_size(ssl_ctx, 1);
+	if (SSL_CTX_add_session(ssl_ctx, sess) != 1 ||
+	    !session_cached(ssl, 42)) {
+		fprintf(stderr, "FAIL: failed to add session\n");
+		goto failure;
+	}
+	other = session_new(58, time(NULL) + 30);
+	if (SSL_CTX_add_session(ssl_ctx, other) != 1) {
+		fprintf(stderr, "FAIL: failed to add session\n");
+		goto failure;
+	}
+	if (session_cached(ssl, 42)) {
+		fprintf(stderr, "FAIL: session not evicted\n");
+		goto failure;
+	}
+	if ((shared = ssl_session_shm_get(ssl, id, sizeof(id))) == NULL) {
+		fprintf(stderr, "FAIL: evicted session removed from shared "
+		    "cache\n");
+		goto failure;
+	}
+	SSL_SESSION_free(shared);
+	shared = NULL;
+
+	/* Explicit removal drops it from the shared cache as well. */
+	SSL_CTX_remove_session(ssl_ctx, sess);
+	if ((shared = ssl_session_shm_get(ssl, id, sizeof(id))) != NULL) {
+		fprintf(stderr, "FAIL: removed session found in shared cache\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_SESSION_free(shared);
+	SSL_SESSION_free(other);
+	SSL_SESSION_free(sess);
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	SSL_library_init();
+
+	failed |= test_session_cache_add_remove();
+	failed |= test_session_cache_size();
+	failed |= test_session_cache_flush();
+	failed |= test_session_cache_expire();
+	failed |= test_session_cache_sessions();
+	failed |= test_session_cache_shm();
+
+	if (failed == 0)
+		printf("PASS %s\n", __FILE__);
+
+	return (failed);
+}
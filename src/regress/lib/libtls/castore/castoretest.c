@@ -0,0 +1,178 @@
+/* $OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+
+#include <tls.h>
+
+#include "tls_internal.h"
+
+#ifndef CERTSDIR
+#define CERTSDIR "."
+#endif
+
+const char *ca_root_file = CERTSDIR "/ca-root-rsa.pem";
+const char *ca_file = CERTSDIR "/ca.pem";
+const char *crl_file = CERTSDIR "/ca-int-rsa.crl";
+
+struct ca_store_ctx {
+	struct tls *tls;
+	SSL_CTX *ssl_ctx;
+	X509_STORE *store;
+};
+
+static void
+ca_store_ctx_configure(struct ca_store_ctx *csc, struct tls_config *config)
+{
+	if ((csc->tls = tls_client()) == NULL)
+		errx(1, "failed to create tls client");
+	if (tls_configure(csc->tls, config) != 0)
+		errx(1, "failed to configure client: %s", tls_error(csc->tls));
+	if ((csc->ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "failed to create SSL_CTX");
+	if (tls_configure_ssl_verify(csc->tls, csc->ssl_ctx,
+	    SSL_VERIFY_PEER) != 0)
+		errx(1, "failed to configure verify: %s", tls_error(csc->tls));
+	if ((csc->store = SSL_CTX_get_cert_store(csc->ssl_ctx)) == NULL)
+		errx(1, "no certificate store");
+}
+
+static void
+ca_store_ctx_cleanup(struct ca_store_ctx *csc)
+{
+	SSL_CTX_free(csc->ssl_ctx);
+	tls_free(csc->tls);
+}
+
+static int
+ca_store_count(X509_STORE *store, X509_LOOKUP_TYPE type)
+{
+	STACK_OF(X509_OBJECT) *objs;
+	int i, count = 0;
+
+	objs = X509_STORE_get0_objects(store);
+	for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+		if (X509_OBJECT_get_type(sk_X509_OBJECT_value(objs, i)) == type)
+			count++;
+	}
+
+	return count;
+}
+
+static int
+ca_store_check(const char *name, X509_STORE *store, int certs, int crls)
+{
+	unsigned long flags;
+	int got;
+
+	if ((got = ca_store_count(store, X509_LU_X509)) != certs) {
+		fprintf(stderr, "FAIL: %s: got %d certificates, want %d\n",
+		    name, got, certs);
+		return 1;
+	}
+	if ((got = ca_store_count(store, X509_LU_CRL)) != crls) {
+		fprintf(stderr, "FAIL: %s: got %d CRLs, want %d\n",
+		    name, got, crls);
+		return 1;
+	}
+	flags = X509_VERIFY_PARAM_get_flags(X509_STORE_get0_param(store));
+	if (((flags & X509_V_FLAG_CRL_CHECK) != 0) != (crls != 0)) {
+		fprintf(stderr, "FAIL: %s: CRL checking %s\n", name,
+		    crls != 0 ? "disabled" : "enabled");
+		return 1;
+	}
+
+	return 0;
+}
+
+static int
+do_ca_store_test(void)
+{
+	struct ca_store_ctx a = { 0 }, b = { 0 }, c = { 0 }, d = { 0 };
+	struct tls_config *config;
+	int failed = 1;
+
+	if ((config = tls_config_new()) == NULL)
+		errx(1, "failed to create config");
+	if (tls_config_set_ca_file(config, ca_root_file) != 0)
+		errx(1, "failed to set CA file: %s", tls_config_error(config));
+
+	/* Contexts configured from the same configuration share a store. */
+	ca_store_ctx_configure(&a, config);
+	ca_store_ctx_configure(&b, config);
+	if (a.store != b.store) {
+		fprintf(stderr, "FAIL: certificate store is not shared\n");
+		goto done;
+	}
+	if (ca_store_check("initial", a.store, 1, 0))
+		goto done;
+
+	/* Changing the CAs builds a new store for new contexts only. */
+	if (tls_config_set_ca_file(config, ca_file) != 0)
+		errx(1, "failed to set CA file: %s", tls_config_error(config));
+	ca_store_ctx_configure(&c, config);
+	if (c.store == a.store) {
+		fprintf(stderr, "FAIL: certificate store not rebuilt after "
+		    "changing CAs\n");
+		goto done;
+	}
+	if (ca_store_check("new CAs", c.store, 2, 0))
+		goto done;
+	if (ca_store_check("old CAs", a.store, 1, 0))
+		goto done;
+
+	/* Changing the CRLs also builds a new store. */
+	if (tls_config_set_crl_file(config, crl_file) != 0)
+		errx(1, "failed to set CRL file: %s", tls_config_error(config));
+	ca_store_ctx_configure(&d, config);
+	if (d.store == c.store) {
+		fprintf(stderr, "FAIL: certificate store not rebuilt after "
+		    "changing CRLs\n");
+		goto done;
+	}
+	if (ca_store_check("new CRLs", d.store, 2, 1))
+		goto done;
+	if (ca_store_check("old CRLs", c.store, 2, 0))
+		goto done;
+
+	failed = 0;
+
+ done:
+	ca_store_ctx_cleanup(&a);
+	ca_store_ctx_cleanup(&b);
+	ca_store_ctx_cleanup(&c);
+	ca_store_ctx_cleanup(&d);
+	tls_config_free(config);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= do_ca_store_test();
+
+	return failed;
+}
@@ -158,6 +158,77 @@ do_parse_protocols_test(int test_no, struct parse_protocols_test *ppt)
 	return (failed);
 }
 
+static int
+do_ticket_keys_test(void)
+{
+	unsigned char keys[5 * TLS_TICKET_KEY_SIZE];
+	struct tls_config *config;
+	int failed = 1;
+
+	arc4random_buf(keys, sizeof(keys));
+
+	if ((config = tls_config_new()) == NULL)
+		errx(1, "failed to create config");
+
+	if (tls_config_set_ticket_keys(config, 100, keys, 0) != -1) {
+		fprintf(stderr, "FAIL: set ticket keys succeeded with no "
+		    "keys\n");
+		goto done;
+	}
+	if (tls_config_set_ticket_keys(config, 100, keys,
+	    TLS_TICKET_KEY_SIZE + 1) != -1) {
+		fprintf(stderr, "FAIL: set ticket keys succeeded with a "
+		    "partial key\n");
+		goto done;
+	}
+	if (tls_config_set_ticket_keys(config, 100, keys,
+	    sizeof(keys)) != -1) {
+		fprintf(stderr, "FAIL: set ticket keys succeeded with too "
+		    "many keys\n");
+		goto done;
+	}
+	if (tls_config_set_ticket_keys(config, 100, keys,
+	    2 * TLS_TICKET_KEY_SIZE) != 0) {
+		fprintf(stderr, "FAIL: set ticket keys failed: %s\n",
+		    tls_config_error(config));
+		goto done;
+	}
+
+	/* The primary key may be re-added, older keys may not. */
+	if (tls_config_add_ticket_key(config, 100, keys,
+	    TLS_TICKET_KEY_SIZE) != 0) {
+		fprintf(stderr, "FAIL: failed to re-add primary ticket key: "
+		    "%s\n", tls_config_error(config));
+		goto done;
+	}
+	if (tls_config_add_ticket_key(config, 99,
+	    keys + TLS_TICKET_KEY_SIZE, TLS_TICKET_KEY_SIZE) != -1) {
+		fprintf(stderr, "FAIL: re-added older ticket key\n");
+		goto done;
+	}
+
+	/* Rotating in a new key retains the previous keys. */
+	if (tls_config_add_ticket_key(config, 101,
+	    keys + 2 * TLS_TICKET_KEY_SIZE, TLS_TICKET_KEY_SIZE) != 0) {
+		fprintf(stderr, "FAIL: failed to add ticket key: %s\n",
+		    tls_config_error(config));
+		goto done;
+	}
+	if (tls_config_add_ticket_key(config, 100, keys,
+	    TLS_TICKET_KEY_SIZE) != -1) {
+		fprintf(stderr, "FAIL: re-added previous primary ticket "
+		    "key\n");
+		goto done;
+	}
+
+	failed = 0;
+
+ done:
+	tls_config_free(config);
+
+	return (failed);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -169,5 +240,7 @@ main(int argc, char **argv)
 	for (i = 0; i < N_PARSE_PROTOCOLS_TESTS; i++)
 		failed += do_parse_protocols_test(i, &parse_protocols_tests[i]);
 
+	failed += do_ticket_keys_test();
+
 	return (failed);
 }
@@ -40,6 +40,8 @@
 
 const char *cert_path = CERTSDIR;
 int sign_cb_count;
+int sign_complete_count;
+struct tls_signer *async_signer;
 
 static void
 hexdump(const unsigned char *buf, size_t len)
@@ -288,6 +290,15 @@ do_tls_handshake(char *name, struct tls *ctx)
 		return (1);
 	if (rv == TLS_WANT_POLLIN || rv == TLS_WANT_POLLOUT)
 		return (0);
+	if (rv == TLS_WANT_PRIVATE_KEY) {
+		if (async_signer == NULL)
+			errx(1, "%s handshake wants private key", name);
+		if (tls_signer_complete(async_signer) != 1)
+			errx(1, "%s handshake has no pending sign operation",
+			    name);
+		sign_complete_count++;
+		return (0);
+	}
 
 	errx(1, "%s handshake failed: %s", name, tls_error(ctx));
 }
@@ -355,7 +366,21 @@ test_signer_tls_sign(void *cb_arg, const char *pubkey_hash,
 }
 
 static int
-test_signer_tls(char *certfile, char *keyfile, char *cafile)
+test_signer_tls_sign_async(void *cb_arg, const char *pubkey_hash,
+    const uint8_t *input, size_t input_len, int padding_type,
+    uint8_t **out_signature, size_t *out_signature_len)
+{
+	struct tls_signer *signer = cb_arg;
+
+	sign_cb_count++;
+
+	return tls_signer_sign_async(signer, pubkey_hash, input, input_len,
+	    padding_type, out_signature, out_signature_len);
+}
+
+static int
+test_signer_tls(char *certfile, char *keyfile, char *cafile, tls_sign_cb cb,
+    uint32_t protocols)
 {
 	struct tls_config *client_cfg, *server_cfg;
 	struct tls_signer *signer;
@@ -374,13 +399,15 @@ test_signer_tls(char *certfile, char *keyfile, char *cafile)
 	tls_config_insecure_noverifyname(client_cfg);
 	if (tls_config_set_ca_file(client_cfg, cafile) == -1)
 		errx(1, "failed to set ca: %s", tls_config_error(client_cfg));
+	if (tls_config_set_protocols(client_cfg, protocols) == -1)
+		errx(1, "failed to set protocols: %s",
+		    tls_config_error(client_cfg));
 
 	if ((server = tls_server()) == NULL)
 		errx(1, "failed to create tls server");
 	if ((server_cfg = tls_config_new()) == NULL)
 		errx(1, "failed to create tls server config");
-	if (tls_config_set_sign_cb(server_cfg, test_signer_tls_sign,
-	    signer) == -1)
+	if (tls_config_set_sign_cb(server_cfg, cb, signer) == -1)
 		errx(1, "failed to set server signer callback: %s",
 		    tls_config_error(server_cfg));
 	if (tls_config_set_cert_file(server_cfg, certfile) == -1)
@@ -395,7 +422,107 @@ test_signer_tls(char *certfile, char *keyfile, char *cafile)
 	tls_config_free(client_cfg);
 	tls_config_free(server_cfg);
 
+	async_signer = signer;
 	failure |= test_tls_handshake_socket(client, server);
+	async_signer = NULL;
+
+	tls_signer_free(signer);
+	tls_free(client);
+	tls_free(server);
+
+	return (failure);
+}
+
+static int
+test_signer_tls_cancel(char *certfile, char *keyfile, char *cafile)
+{
+	struct tls_config *client_cfg, *server_cfg;
+	struct tls *client, *server, *server_cctx = NULL;
+	struct tls_signer *signer;
+	int failure = 1;
+	int i, rv, sv[2];
+
+	if ((signer = tls_signer_new()) == NULL)
+		errx(1, "failed to create tls signer");
+	if (tls_signer_add_keypair_file(signer, certfile, keyfile))
+		errx(1, "failed to add keypair to signer");
+
+	if ((client = tls_client()) == NULL)
+		errx(1, "failed to create tls client");
+	if ((client_cfg = tls_config_new()) == NULL)
+		errx(1, "failed to create tls client config");
+	tls_config_insecure_noverifyname(client_cfg);
+	if (tls_config_set_ca_file(client_cfg, cafile) == -1)
+		errx(1, "failed to set ca: %s", tls_config_error(client_cfg));
+
+	if ((server = tls_server()) == NULL)
+		errx(1, "failed to create tls server");
+	if ((server_cfg = tls_config_new()) == NULL)
+		errx(1, "failed to create tls server config");
+	if (tls_config_set_sign_cb(server_cfg, test_signer_tls_sign_async,
+	    signer) == -1)
+		errx(1, "failed to set server signer callback: %s",
+		    tls_config_error(server_cfg));
+	if (tls_config_set_cert_file(server_cfg, certfile) == -1)
+		errx(1, "failed to set server certificate: %s",
+		    tls_config_error(server_cfg));
+
+	if (tls_configure(client, client_cfg) == -1)
+		errx(1, "failed to configure client: %s", tls_error(client));
+	if (tls_configure(server, server_cfg) == -1)
+		errx(1, "failed to configure server: %s", tls_error(server));
+
+	tls_config_free(client_cfg);
+	tls_config_free(server_cfg);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, PF_UNSPEC,
+	    sv) == -1)
+		err(1, "failed to create socketpair");
+	if (tls_accept_socket(server, &server_cctx, sv[0]) == -1)
+		errx(1, "failed to accept: %s", tls_error(server));
+	if (tls_connect_socket(client, sv[1], "test") == -1)
+		errx(1, "failed to connect: %s", tls_error(client));
+
+	/* Run the handshake until the server waits for its signature. */
+	for (i = 0; i < 100; i++) {
+		rv = tls_handshake(client);
+		if (rv != TLS_WANT_POLLIN && rv != TLS_WANT_POLLOUT)
+			errx(1, "client handshake failed: %s",
+			    tls_error(client));
+		if ((rv = tls_handshake(server_cctx)) == TLS_WANT_PRIVATE_KEY)
+			break;
+		if (rv != TLS_WANT_POLLIN && rv != TLS_WANT_POLLOUT)
+			errx(1, "server handshake failed: %s",
+			    tls_error(server_cctx));
+	}
+	if (rv != TLS_WANT_PRIVATE_KEY) {
+		fprintf(stderr, "FAIL: server handshake did not wait for "
+		    "signature\n");
+		goto failure;
+	}
+	if (server_cctx->signer != signer) {
+		fprintf(stderr, "FAIL: sign operation not tied to context\n");
+		goto failure;
+	}
+
+	/* Abandoning the handshake discards the queued operation. */
+	tls_reset(server_cctx);
+	if (server_cctx->signer != NULL) {
+		fprintf(stderr, "FAIL: context still holds sign operations\n");
+		goto failure;
+	}
+	if ((rv = tls_signer_complete(signer)) != 0) {
+		fprintf(stderr, "FAIL: completed %d sign operations of "
+		    "abandoned handshake, want 0\n", rv);
+		goto failure;
+	}
+
+	failure = 0;
+
+ failure:
+	tls_free(server_cctx);
+	close(sv[0]);
+	close(sv[1]);
 
 	tls_signer_free(signer);
 	tls_free(client);
@@ -432,9 +559,9 @@ do_signer_tls_tests(void)
 		err(1, "server rsa key");
 
 	failure |= test_signer_tls(server_ecdsa_cert, server_ecdsa_key,
-	    ca_root_ecdsa);
+	    ca_root_ecdsa, test_signer_tls_sign, TLS_PROTOCOLS_DEFAULT);
 	failure |= test_signer_tls(server_rsa_cert, server_rsa_key,
-	    ca_root_rsa);
+	    ca_root_rsa, test_signer_tls_sign, TLS_PROTOCOLS_DEFAULT);
 
 	if (sign_cb_count != 2) {
 		fprintf(stderr, "FAIL: sign callback was called %d times, "
@@ -442,6 +569,35 @@ do_signer_tls_tests(void)
 		failure |= 1;
 	}
 
+	/*
+	 * Each asynchronous signature results in the callback being called
+	 * once to queue the operation and once to collect the result.
+	 */
+	sign_cb_count = 0;
+
+	failure |= test_signer_tls(server_ecdsa_cert, server_ecdsa_key,
+	    ca_root_ecdsa, test_signer_tls_sign_async, TLS_PROTOCOL_TLSv1_3);
+	failure |= test_signer_tls(server_rsa_cert, server_rsa_key,
+	    ca_root_rsa, test_signer_tls_sign_async, TLS_PROTOCOL_TLSv1_3);
+	failure |= test_signer_tls(server_ecdsa_cert, server_ecdsa_key,
+	    ca_root_ecdsa, test_signer_tls_sign_async, TLS_PROTOCOL_TLSv1_2);
+	failure |= test_signer_tls(server_rsa_cert, server_rsa_key,
+	    ca_root_rsa, test_signer_tls_sign_async, TLS_PROTOCOL_TLSv1_2);
+
+	if (sign_cb_count != 8) {
+		fprintf(stderr, "FAIL: async sign callback was called %d "
+		    "times, want 8\n", sign_cb_count);
+		failure |= 1;
+	}
+	if (sign_complete_count != 4) {
+		fprintf(stderr, "FAIL: completed %d async sign operations, "
+		    "want 4\n", sign_complete_count);
+		failure |= 1;
+	}
+
+	failure |= test_signer_tls_cancel(server_ecdsa_cert, server_ecdsa_key,
+	    ca_root_ecdsa);
+
 	free(ca_root_ecdsa);
 	free(ca_root_rsa);
 	free(server_ecdsa_cert);
@@ -27,6 +27,7 @@
 #include <unistd.h>
 
 #include <openssl/bio.h>
+#include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/pem.h>
 #include <openssl/x509.h>
@@ -35,6 +36,7 @@
 
 static struct {
 	int dryrun;
+	char *index;
 	int verbose;
 } cfg;
 
@@ -45,6 +47,13 @@ static const struct option certhash_options[] = {
 		.type = OPTION_FLAG,
 		.opt.flag = &cfg.dryrun,
 	},
+	{
+		.name = "o",
+		.argname = "index",
+		.desc = "Write an indexed trust store of the given PEM files",
+		.type = OPTION_ARG,
+		.opt.arg = &cfg.index,
+	},
 	{
 		.name = "v",
 		.desc = "Verbose",
@@ -640,10 +649,143 @@ certhash_directory(const char *path)
 	return (ret);
 }
 
+static int
+certhash_read_certs(const char *filename, STACK_OF(X509) *certs)
+{
+	STACK_OF(X509_INFO) *xis = NULL;
+	X509 *x509;
+	BIO *bio;
+	int i, count = 0;
+
+	if ((bio = BIO_new_file(filename, "r")) == NULL) {
+		fprintf(stderr, "failed to open %s\n", filename);
+		return (-1);
+	}
+	if ((xis = PEM_X509_INFO_read_bio(bio, NULL, NULL, NULL)) == NULL) {
+		fprintf(stderr, "failed to read PEM from %s\n", filename);
+		BIO_free(bio);
+		return (-1);
+	}
+	BIO_free(bio);
+
+	for (i = 0; i < sk_X509_INFO_num(xis); i++) {
+		if ((x509 = sk_X509_INFO_value(xis, i)->x509) == NULL)
+			continue;
+		if (!sk_X509_push(certs, x509)) {
+			fprintf(stderr, "failed to add certificate\n");
+			sk_X509_INFO_pop_free(xis, X509_INFO_free);
+			return (-1);
+		}
+		X509_up_ref(x509);
+		count++;
+	}
+	sk_X509_INFO_pop_free(xis, X509_INFO_free);
+
+	if (count == 0)
+		fprintf(stderr, "PEM file %s does not contain a certificate, "
+		    "ignoring...\n", filename);
+	else if (cfg.verbose)
+		fprintf(stdout, "adding %d certificates from %s\n", count,
+		    filename);
+
+	return (0);
+}
+
+/*
+ * Write an indexed trust store for use with X509_LOOKUP_index(). The index
+ * is written to a temporary file and renamed into place, so that processes
+ * that have the previous index mapped are not affected.
+ */
+static int
+certhash_write_index(const char *index, int argc, char **argv)
+{
+	STACK_OF(X509) *certs = NULL;
+	char *tmp = NULL;
+	BIO *bio = NULL;
+	int fd = -1;
+	int i, ret = 1;
+
+	if ((certs = sk_X509_new_null()) == NULL) {
+		fprintf(stderr, "failed to create certificate stack\n");
+		goto err;
+	}
+	for (i = 0; i < argc; i++) {
+		if (certhash_read_certs(argv[i], certs) == -1)
+			goto err;
+	}
+
+	if (cfg.verbose)
+		fprintf(stdout, "%s index %s with %d certificates\n",
+		    (cfg.dryrun ? "would write" : "writing"), index,
+		    sk_X509_num(certs));
+	if (cfg.dryrun) {
+		ret = 0;
+		goto err;
+	}
+
+	if (asprintf(&tmp, "%s.XXXXXXXXXX", index) == -1) {
+		tmp = NULL;
+		fprintf(stderr, "failed to allocate temporary file name\n");
+		goto err;
+	}
+	if ((fd = mkstemp(tmp)) == -1) {
+		fprintf(stderr, "failed to create %s: %s\n", tmp,
+		    strerror(errno));
+		free(tmp);
+		tmp = NULL;
+		goto err;
+	}
+	if (fchmod(fd, 0644) == -1) {
+		fprintf(stderr, "failed to change mode of %s: %s\n", tmp,
+		    strerror(errno));
+		goto err;
+	}
+	if ((bio = BIO_new_fd(fd, BIO_CLOSE)) == NULL) {
+		fprintf(stderr, "failed to create bio\n");
+		goto err;
+	}
+	fd = -1;
+
+	if (!X509_LOOKUP_write_index(bio, certs)) {
+		fprintf(stderr, "failed to write index %s\n", index);
+		ERR_print_errors_fp(stderr);
+		goto err;
+	}
+	if (BIO_flush(bio) != 1) {
+		fprintf(stderr, "failed to write index %s\n", index);
+		goto err;
+	}
+	BIO_free(bio);
+	bio = NULL;
+
+	if (rename(tmp, index) == -1) {
+		fprintf(stderr, "failed to rename %s to %s: %s\n", tmp, index,
+		    strerror(errno));
+		goto err;
+	}
+	free(tmp);
+	tmp = NULL;
+
+	ret = 0;
+
+ err:
+	BIO_free(bio);
+	if (fd != -1)
+		close(fd);
+	if (tmp != NULL) {
+		unlink(tmp);
+		free(tmp);
+	}
+	sk_X509_pop_free(certs, X509_free);
+
+	return (ret);
+}
+
 static void
 certhash_usage(void)
 {
-	fprintf(stderr, "usage: certhash [-nv] dir ...\n");
+	fprintf(stderr, "usage: certhash [-nv] dir ...\n"
+	    "       certhash [-nv] -o index file ...\n");
 	options_usage(certhash_options);
 }
 
@@ -653,7 +795,7 @@ certhash_main(int argc, char **argv)
 	int argsused;
 	int i, cwdfd, ret = 0;
 
-	if (pledge("stdio cpath wpath rpath", NULL) == -1) {
+	if (pledge("stdio cpath wpath rpath fattr", NULL) == -1) {
 		perror("pledge");
 		exit(1);
 	}
@@ -665,6 +807,15 @@ certhash_main(int argc, char **argv)
                 return (1);
         }
 
+	if (cfg.index != NULL) {
+		if (argsused >= argc) {
+			certhash_usage();
+			return (1);
+		}
+		return (certhash_write_index(cfg.index, argc - argsused,
+		    argv + argsused));
+	}
+
 	if ((cwdfd = open(".", O_RDONLY)) == -1) {
 		perror("failed to open current directory");
 		return (1);